@@ -7,6 +7,7 @@ package main
 import (
 	"context"
 	"crypto/tls"
+	"crypto/x509"
 	"encoding/json"
 	"errors"
 	"fmt"
@@ -22,11 +23,14 @@ import (
 	"github.com/rs/zerolog"
 	"github.com/rs/zerolog/log"
 	"google.golang.org/grpc"
+	"google.golang.org/grpc/credentials"
+	"google.golang.org/grpc/credentials/insecure"
 	"google.golang.org/grpc/health"
 	healthpb "google.golang.org/grpc/health/grpc_health_v1"
 	"google.golang.org/grpc/reflection"
 
 	"github.com/AmmannChristian/nist-800-90b/internal/config"
+	"github.com/AmmannChristian/nist-800-90b/internal/entropy"
 	"github.com/AmmannChristian/nist-800-90b/internal/middleware"
 	"github.com/AmmannChristian/nist-800-90b/internal/service"
 	pb "github.com/AmmannChristian/nist-800-90b/pkg/pb"
@@ -69,8 +73,20 @@ func run() error {
 		Bool("grpc_enabled", cfg.GRPCEnabled).
 		Bool("auth_enabled", cfg.AuthEnabled).
 		Int64("max_upload_bytes", cfg.MaxUploadSize).
+		Int("result_cache_entries", cfg.ResultCacheEntries).
+		Str("result_cache_dir", cfg.ResultCacheDir).
+		Int("thread_budget", cfg.ThreadBudget).
+		Int("max_threads_per_assessment", cfg.MaxThreadsPerAssessment).
+		Int64("scratch_pool_bytes", cfg.ScratchPoolBytes).
+		Bool("estimator_metrics_enabled", cfg.MetricsEnabled && cfg.EstimatorMetricsEnabled).
+		Strs("permutation_workers", cfg.PermutationWorkers).
 		Msg("starting SP800-90B entropy assessment server")
 
+	// Instrumentation is only worth its cost if the histograms are exported
+	entropy.SetInstrumentation(cfg.MetricsEnabled && cfg.EstimatorMetricsEnabled)
+	entropy.SetThreadBudget(cfg.ThreadBudget)
+	entropy.SetScratchLimit(cfg.ScratchPoolBytes)
+
 	srv := &server{
 		config: cfg,
 		mux:    http.NewServeMux(),
@@ -80,6 +96,7 @@ func run() error {
 
 	var grpcServer *grpc.Server
 	var grpcListener net.Listener
+	var workerConns []*grpc.ClientConn
 	if cfg.GRPCEnabled {
 		grpcListener, err = net.Listen("tcp", fmt.Sprintf("%s:%d", cfg.ServerHost, cfg.GRPCPort))
 		if err != nil {
@@ -98,7 +115,26 @@ func run() error {
 
 		grpcServer = grpc.NewServer(serverOpts...)
 
-		pb.RegisterSp80090BAssessmentServiceServer(grpcServer, service.NewGRPCServer(service.NewService()))
+		svc := service.NewService()
+		svc.SetMaxThreads(cfg.MaxThreadsPerAssessment)
+		svc.SetMaxStreamSize(cfg.MaxUploadSize)
+		if cfg.ResultCacheEntries > 0 {
+			cache, err := service.NewResultCache(cfg.ResultCacheEntries, cfg.ResultCacheDir)
+			if err != nil {
+				return fmt.Errorf("failed to configure result cache: %w", err)
+			}
+			svc.SetResultCache(cache)
+		}
+		if len(cfg.PermutationWorkers) > 0 {
+			var coordinator *service.PermutationCoordinator
+			coordinator, workerConns, err = buildPermutationCoordinator(cfg, svc)
+			if err != nil {
+				return fmt.Errorf("failed to configure permutation workers: %w", err)
+			}
+			svc.SetPermutationCoordinator(coordinator, cfg.PermutationMinSamples)
+		}
+
+		pb.RegisterSp80090BAssessmentServiceServer(grpcServer, service.NewGRPCServer(svc))
 		healthServer := health.NewServer()
 		healthpb.RegisterHealthServer(grpcServer, healthServer)
 		healthServer.SetServingStatus("", healthpb.HealthCheckResponse_SERVING)
@@ -156,6 +192,9 @@ func run() error {
 				_ = grpcListener.Close()
 			}
 		}
+		for _, conn := range workerConns {
+			_ = conn.Close()
+		}
 
 		log.Info().Msg("server stopped gracefully")
 	}
@@ -265,8 +304,10 @@ func authorizationEnabled(cfg *config.Config) bool {
 }
 
 // buildGRPCServerOptions constructs gRPC server options from the provided
-// configuration. When TLS is enabled, it loads certificates and configures
-// client authentication and minimum protocol version.
+// configuration. Streaming RPCs pass through the same interceptors as unary
+// ones, adapted with middleware.StreamFromUnary. When TLS is enabled, it loads
+// certificates and configures client authentication and minimum protocol
+// version.
 func buildGRPCServerOptions(cfg *config.Config, unaryInterceptors []grpc.UnaryServerInterceptor) ([]grpc.ServerOption, error) {
 	maxRecvMessageSize := cfg.GRPCMaxRecvMessageSize
 	if maxRecvMessageSize <= 0 {
@@ -279,6 +320,7 @@ func buildGRPCServerOptions(cfg *config.Config, unaryInterceptors []grpc.UnarySe
 
 	opts := []grpc.ServerOption{
 		grpc.ChainUnaryInterceptor(unaryInterceptors...),
+		grpc.ChainStreamInterceptor(middleware.StreamFromUnaryChain(unaryInterceptors)...),
 		grpc.MaxRecvMsgSize(maxRecvMessageSize),
 		grpc.MaxSendMsgSize(maxSendMessageSize),
 	}
@@ -322,6 +364,109 @@ func buildGRPCServerOptions(cfg *config.Config, unaryInterceptors []grpc.UnarySe
 	return append(opts, tlsOpt), nil
 }
 
+// buildPermutationCoordinator creates the coordinator spreading the
+// permutation test rounds of large IID assessments over this server and the
+// configured workers, which are other instances of this server. Workers are
+// dialed with TLS when it is enabled, presenting the server certificate as
+// client certificate and verifying them against TLS_CA_FILE, and are sent
+// PERMUTATION_WORKER_TOKEN as bearer token if it is set. The returned
+// connections must be closed on shutdown.
+func buildPermutationCoordinator(cfg *config.Config, svc *service.EntropyService) (*service.PermutationCoordinator, []*grpc.ClientConn, error) {
+	transport, err := buildWorkerTransportCredentials(cfg)
+	if err != nil {
+		return nil, nil, err
+	}
+
+	dialOpts := []grpc.DialOption{grpc.WithTransportCredentials(transport)}
+	if cfg.PermutationWorkerToken != "" {
+		dialOpts = append(dialOpts, grpc.WithPerRPCCredentials(bearerToken{
+			token:  cfg.PermutationWorkerToken,
+			secure: cfg.TLSEnabled,
+		}))
+	}
+
+	workers := []service.PermutationWorker{svc.LocalPermutationWorker()}
+	conns := make([]*grpc.ClientConn, 0, len(cfg.PermutationWorkers))
+	for _, addr := range cfg.PermutationWorkers {
+		conn, err := grpc.NewClient(addr, dialOpts...)
+		if err != nil {
+			for _, c := range conns {
+				_ = c.Close()
+			}
+			return nil, nil, fmt.Errorf("failed to create client for %s: %w", addr, err)
+		}
+		conns = append(conns, conn)
+		workers = append(workers, service.NewRemotePermutationWorker(addr, pb.NewSp80090BAssessmentServiceClient(conn)))
+	}
+
+	coordinator, err := service.NewPermutationCoordinator(cfg.PermutationStreamsPerShard, workers...)
+	if err != nil {
+		for _, c := range conns {
+			_ = c.Close()
+		}
+		return nil, nil, err
+	}
+
+	log.Info().
+		Strs("workers", cfg.PermutationWorkers).
+		Int("min_samples", cfg.PermutationMinSamples).
+		Int("streams_per_shard", cfg.PermutationStreamsPerShard).
+		Msg("distributed permutation tests enabled")
+
+	return coordinator, conns, nil
+}
+
+// buildWorkerTransportCredentials returns the transport credentials used to
+// dial permutation workers.
+func buildWorkerTransportCredentials(cfg *config.Config) (credentials.TransportCredentials, error) {
+	if !cfg.TLSEnabled {
+		return insecure.NewCredentials(), nil
+	}
+
+	minVersion, err := cfg.TLSMinVersionValue()
+	if err != nil {
+		return nil, fmt.Errorf("invalid TLS min version: %w", err)
+	}
+
+	cert, err := tls.LoadX509KeyPair(cfg.TLSCertFile, cfg.TLSKeyFile)
+	if err != nil {
+		return nil, fmt.Errorf("failed to load client certificate: %w", err)
+	}
+
+	tlsConfig := &tls.Config{
+		Certificates: []tls.Certificate{cert},
+		MinVersion:   minVersion,
+	}
+	if cfg.TLSCAFile != "" {
+		pem, err := os.ReadFile(cfg.TLSCAFile)
+		if err != nil {
+			return nil, fmt.Errorf("failed to read CA file: %w", err)
+		}
+		pool := x509.NewCertPool()
+		if !pool.AppendCertsFromPEM(pem) {
+			return nil, fmt.Errorf("no certificates found in CA file %s", cfg.TLSCAFile)
+		}
+		tlsConfig.RootCAs = pool
+	}
+
+	return credentials.NewTLS(tlsConfig), nil
+}
+
+// bearerToken attaches a static bearer token to the requests sent to
+// permutation workers.
+type bearerToken struct {
+	token  string
+	secure bool
+}
+
+func (t bearerToken) GetRequestMetadata(context.Context, ...string) (map[string]string, error) {
+	return map[string]string{"authorization": "Bearer " + t.token}, nil
+}
+
+func (t bearerToken) RequireTransportSecurity() bool {
+	return t.secure
+}
+
 // tlsVersionString returns a human-readable string for a TLS version constant.
 func tlsVersionString(version uint16) string {
 	switch version {
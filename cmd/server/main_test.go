@@ -22,6 +22,7 @@ import (
 	"google.golang.org/grpc"
 
 	"github.com/AmmannChristian/nist-800-90b/internal/config"
+	"github.com/AmmannChristian/nist-800-90b/internal/service"
 )
 
 func TestSetupLogging(t *testing.T) {
@@ -166,6 +167,48 @@ func TestBuildUnaryInterceptors_WithOpaqueAuthPrivateKeyJWTZitadelJSON(t *testin
 	assert.Len(t, interceptors, 3)
 }
 
+func TestBuildPermutationCoordinator(t *testing.T) {
+	cfg := &config.Config{
+		PermutationWorkers:         []string{"worker-1:9090", "worker-2:9090"},
+		PermutationStreamsPerShard: 4,
+		PermutationWorkerToken:     "secret",
+	}
+
+	coordinator, conns, err := buildPermutationCoordinator(cfg, service.NewService())
+	require.NoError(t, err)
+	assert.NotNil(t, coordinator)
+	assert.Len(t, conns, 2)
+	for _, conn := range conns {
+		assert.NoError(t, conn.Close())
+	}
+
+	cfg.PermutationStreamsPerShard = 0
+	_, _, err = buildPermutationCoordinator(cfg, service.NewService())
+	assert.Error(t, err)
+}
+
+func TestBuildWorkerTransportCredentials(t *testing.T) {
+	creds, err := buildWorkerTransportCredentials(&config.Config{})
+	require.NoError(t, err)
+	assert.Equal(t, "insecure", creds.Info().SecurityProtocol)
+
+	_, err = buildWorkerTransportCredentials(&config.Config{
+		TLSEnabled:  true,
+		TLSCertFile: "/nonexistent/cert.pem",
+		TLSKeyFile:  "/nonexistent/key.pem",
+	})
+	assert.Error(t, err)
+}
+
+func TestBearerToken(t *testing.T) {
+	token := bearerToken{token: "secret", secure: true}
+
+	md, err := token.GetRequestMetadata(context.Background())
+	require.NoError(t, err)
+	assert.Equal(t, "Bearer secret", md["authorization"])
+	assert.True(t, token.RequireTransportSecurity())
+}
+
 func TestBuildAuthorizationPolicy(t *testing.T) {
 	cfg := &config.Config{
 		AuthzRequiredRoles:   []string{"NIST_ROLE"},
@@ -12,7 +12,12 @@ import (
 	"time"
 )
 
-const defaultGRPCMaxMessageSize = 10 * 1024 * 1024
+const (
+	defaultGRPCMaxMessageSize         = 10 * 1024 * 1024
+	defaultPermutationStreamsPerShard = 4
+	maxPermutationStreamsPerShard     = 64 // entropy.PermutationStreams
+	defaultPermutationMinSamples      = 1000000
+)
 
 // Config holds all runtime parameters for the server, including network
 // addresses, TLS settings, authentication, logging, and resource limits.
@@ -42,8 +47,26 @@ type Config struct {
 	// Request timeouts
 	Timeout time.Duration
 
+	// Result cache
+	ResultCacheEntries int    // Results kept in memory, 0 disables the cache
+	ResultCacheDir     string // Optional directory persisting cached results
+
+	// Assessment threads
+	ThreadBudget            int // Threads shared by concurrent assessments, 0 for the OpenMP default
+	MaxThreadsPerAssessment int // Thread limit of a single assessment, 0 for its fair share
+
+	// Assessment scratch memory
+	ScratchPoolBytes int64 // Bytes of released estimator buffers kept for later assessments, 0 keeps none
+
+	// Distributed permutation tests
+	PermutationWorkers         []string // gRPC addresses of the servers sharing the permutation test rounds
+	PermutationMinSamples      int      // Smallest IID assessment whose rounds are distributed
+	PermutationStreamsPerShard int      // RNG streams per shard handed to a worker
+	PermutationWorkerToken     string   // Optional bearer token presented to the workers
+
 	// Metrics
-	MetricsEnabled bool
+	MetricsEnabled          bool
+	EstimatorMetricsEnabled bool // Per-estimator instrumentation of the C++ library
 
 	// Authentication
 	AuthEnabled                             bool
@@ -88,7 +111,17 @@ func LoadConfig() (*Config, error) {
 		LogLevel:                                getEnv("LOG_LEVEL", "info"),
 		MaxUploadSize:                           getEnvAsInt64("MAX_UPLOAD_SIZE", 100*1024*1024), // 100MB default
 		Timeout:                                 getEnvAsDuration("TIMEOUT", 5*time.Minute),
+		ResultCacheEntries:                      getEnvAsInt("RESULT_CACHE_ENTRIES", 256),
+		ResultCacheDir:                          getEnv("RESULT_CACHE_DIR", ""),
+		ThreadBudget:                            getEnvAsInt("THREAD_BUDGET", 0),
+		MaxThreadsPerAssessment:                 getEnvAsInt("MAX_THREADS_PER_ASSESSMENT", 0),
+		ScratchPoolBytes:                        getEnvAsInt64("SCRATCH_POOL_BYTES", 256*1024*1024), // 256MB default
+		PermutationWorkers:                      parseCSV(getEnv("PERMUTATION_WORKERS", "")),
+		PermutationMinSamples:                   getEnvAsInt("PERMUTATION_MIN_SAMPLES", defaultPermutationMinSamples),
+		PermutationStreamsPerShard:              getEnvAsInt("PERMUTATION_STREAMS_PER_SHARD", defaultPermutationStreamsPerShard),
+		PermutationWorkerToken:                  getEnv("PERMUTATION_WORKER_TOKEN", ""),
 		MetricsEnabled:                          getEnvAsBool("METRICS_ENABLED", true),
+		EstimatorMetricsEnabled:                 getEnvAsBool("ESTIMATOR_METRICS_ENABLED", false),
 		AuthEnabled:                             getEnvAsBool("AUTH_ENABLED", false),
 		AuthIssuer:                              getEnv("AUTH_ISSUER", ""),
 		AuthAudience:                            getEnv("AUTH_AUDIENCE", ""),
@@ -145,6 +178,36 @@ func (c *Config) Validate() error {
 		return fmt.Errorf("max upload size too small: %d (must be at least 1024 bytes)", c.MaxUploadSize)
 	}
 
+	if c.ResultCacheEntries < 0 {
+		return fmt.Errorf("invalid RESULT_CACHE_ENTRIES: %d (must be >= 0)", c.ResultCacheEntries)
+	}
+
+	if c.ThreadBudget < 0 {
+		return fmt.Errorf("invalid THREAD_BUDGET: %d (must be >= 0)", c.ThreadBudget)
+	}
+
+	if c.MaxThreadsPerAssessment < 0 {
+		return fmt.Errorf("invalid MAX_THREADS_PER_ASSESSMENT: %d (must be >= 0)", c.MaxThreadsPerAssessment)
+	}
+
+	if c.ScratchPoolBytes < 0 {
+		return fmt.Errorf("invalid SCRATCH_POOL_BYTES: %d (must be >= 0)", c.ScratchPoolBytes)
+	}
+
+	c.PermutationWorkers = normalizeCSVValues(c.PermutationWorkers)
+	if c.PermutationMinSamples < 0 {
+		return fmt.Errorf("invalid PERMUTATION_MIN_SAMPLES: %d (must be >= 0)", c.PermutationMinSamples)
+	}
+	if c.PermutationStreamsPerShard < 0 || c.PermutationStreamsPerShard > maxPermutationStreamsPerShard {
+		return fmt.Errorf("invalid PERMUTATION_STREAMS_PER_SHARD: %d (must be 1-%d)", c.PermutationStreamsPerShard, maxPermutationStreamsPerShard)
+	}
+	if c.PermutationStreamsPerShard == 0 {
+		c.PermutationStreamsPerShard = defaultPermutationStreamsPerShard
+	}
+	if len(c.PermutationWorkers) > 0 && !c.GRPCEnabled {
+		return fmt.Errorf("permutation workers require gRPC to be enabled")
+	}
+
 	validLogLevels := map[string]bool{
 		"debug": true,
 		"info":  true,
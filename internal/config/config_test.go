@@ -31,7 +31,17 @@ func TestLoadConfig_Defaults(t *testing.T) {
 	assert.Equal(t, "info", cfg.LogLevel)
 	assert.Equal(t, int64(100*1024*1024), cfg.MaxUploadSize)
 	assert.Equal(t, 5*time.Minute, cfg.Timeout)
+	assert.Equal(t, 256, cfg.ResultCacheEntries)
+	assert.Empty(t, cfg.ResultCacheDir)
+	assert.Equal(t, 0, cfg.ThreadBudget)
+	assert.Equal(t, 0, cfg.MaxThreadsPerAssessment)
+	assert.Equal(t, int64(256*1024*1024), cfg.ScratchPoolBytes)
+	assert.Empty(t, cfg.PermutationWorkers)
+	assert.Equal(t, 1000000, cfg.PermutationMinSamples)
+	assert.Equal(t, 4, cfg.PermutationStreamsPerShard)
+	assert.Empty(t, cfg.PermutationWorkerToken)
 	assert.True(t, cfg.MetricsEnabled)
+	assert.False(t, cfg.EstimatorMetricsEnabled)
 	assert.False(t, cfg.AuthEnabled)
 	assert.Empty(t, cfg.AuthIssuer)
 	assert.Empty(t, cfg.AuthAudience)
@@ -72,7 +82,17 @@ func TestLoadConfig_EnvironmentVariables(t *testing.T) {
 	os.Setenv("LOG_LEVEL", "debug")
 	os.Setenv("MAX_UPLOAD_SIZE", "52428800")
 	os.Setenv("TIMEOUT", "10m")
+	os.Setenv("RESULT_CACHE_ENTRIES", "32")
+	os.Setenv("RESULT_CACHE_DIR", "/var/cache/nist")
+	os.Setenv("THREAD_BUDGET", "16")
+	os.Setenv("MAX_THREADS_PER_ASSESSMENT", "4")
+	os.Setenv("SCRATCH_POOL_BYTES", "0")
+	os.Setenv("PERMUTATION_WORKERS", "worker-1:9090, worker-2:9090 ")
+	os.Setenv("PERMUTATION_MIN_SAMPLES", "500000")
+	os.Setenv("PERMUTATION_STREAMS_PER_SHARD", "8")
+	os.Setenv("PERMUTATION_WORKER_TOKEN", "secret")
 	os.Setenv("METRICS_ENABLED", "false")
+	os.Setenv("ESTIMATOR_METRICS_ENABLED", "true")
 	os.Setenv("AUTH_ENABLED", "true")
 	os.Setenv("AUTH_ISSUER", "https://issuer.example.com")
 	os.Setenv("AUTH_AUDIENCE", "nist-entropy")
@@ -103,7 +123,17 @@ func TestLoadConfig_EnvironmentVariables(t *testing.T) {
 	assert.Equal(t, "debug", cfg.LogLevel)
 	assert.Equal(t, int64(52428800), cfg.MaxUploadSize)
 	assert.Equal(t, 10*time.Minute, cfg.Timeout)
+	assert.Equal(t, 32, cfg.ResultCacheEntries)
+	assert.Equal(t, "/var/cache/nist", cfg.ResultCacheDir)
+	assert.Equal(t, 16, cfg.ThreadBudget)
+	assert.Equal(t, 4, cfg.MaxThreadsPerAssessment)
+	assert.Equal(t, int64(0), cfg.ScratchPoolBytes)
+	assert.Equal(t, []string{"worker-1:9090", "worker-2:9090"}, cfg.PermutationWorkers)
+	assert.Equal(t, 500000, cfg.PermutationMinSamples)
+	assert.Equal(t, 8, cfg.PermutationStreamsPerShard)
+	assert.Equal(t, "secret", cfg.PermutationWorkerToken)
 	assert.False(t, cfg.MetricsEnabled)
+	assert.True(t, cfg.EstimatorMetricsEnabled)
 	assert.True(t, cfg.AuthEnabled)
 	assert.Equal(t, "https://issuer.example.com", cfg.AuthIssuer)
 	assert.Equal(t, "nist-entropy", cfg.AuthAudience)
@@ -276,6 +306,54 @@ func TestConfig_Validate(t *testing.T) {
 			wantErr: true,
 			errMsg:  "max upload size too small",
 		},
+		{
+			name: "invalid result cache entries",
+			cfg: &Config{
+				ServerPort:         8080,
+				GRPCPort:           9090,
+				MaxUploadSize:      1024,
+				ResultCacheEntries: -1,
+				LogLevel:           "info",
+			},
+			wantErr: true,
+			errMsg:  "RESULT_CACHE_ENTRIES",
+		},
+		{
+			name: "invalid thread budget",
+			cfg: &Config{
+				ServerPort:    8080,
+				GRPCPort:      9090,
+				MaxUploadSize: 1024,
+				ThreadBudget:  -1,
+				LogLevel:      "info",
+			},
+			wantErr: true,
+			errMsg:  "THREAD_BUDGET",
+		},
+		{
+			name: "invalid max threads per assessment",
+			cfg: &Config{
+				ServerPort:              8080,
+				GRPCPort:                9090,
+				MaxUploadSize:           1024,
+				MaxThreadsPerAssessment: -1,
+				LogLevel:                "info",
+			},
+			wantErr: true,
+			errMsg:  "MAX_THREADS_PER_ASSESSMENT",
+		},
+		{
+			name: "invalid scratch pool bytes",
+			cfg: &Config{
+				ServerPort:       8080,
+				GRPCPort:         9090,
+				MaxUploadSize:    1024,
+				ScratchPoolBytes: -1,
+				LogLevel:         "info",
+			},
+			wantErr: true,
+			errMsg:  "SCRATCH_POOL_BYTES",
+		},
 		{
 			name: "invalid log level",
 			cfg: &Config{
@@ -586,6 +664,42 @@ func TestConfig_Validate(t *testing.T) {
 			wantErr: true,
 			errMsg:  "TLS_KEY_FILE",
 		},
+		{
+			name: "invalid permutation min samples",
+			cfg: &Config{
+				ServerPort:            8080,
+				GRPCPort:              9090,
+				MaxUploadSize:         1024,
+				LogLevel:              "info",
+				PermutationMinSamples: -1,
+			},
+			wantErr: true,
+			errMsg:  "PERMUTATION_MIN_SAMPLES",
+		},
+		{
+			name: "invalid permutation streams per shard",
+			cfg: &Config{
+				ServerPort:                 8080,
+				GRPCPort:                   9090,
+				MaxUploadSize:              1024,
+				LogLevel:                   "info",
+				PermutationStreamsPerShard: 65,
+			},
+			wantErr: true,
+			errMsg:  "PERMUTATION_STREAMS_PER_SHARD",
+		},
+		{
+			name: "permutation workers without grpc",
+			cfg: &Config{
+				ServerPort:         8080,
+				GRPCPort:           9090,
+				MaxUploadSize:      1024,
+				LogLevel:           "info",
+				PermutationWorkers: []string{"worker-1:9090"},
+			},
+			wantErr: true,
+			errMsg:  "permutation workers require gRPC",
+		},
 		{
 			name: "tls enabled invalid client auth",
 			cfg: &Config{
@@ -691,7 +805,10 @@ func clearEnv(t *testing.T) {
 	envVars := []string{
 		"SERVER_PORT", "SERVER_HOST", "GRPC_ENABLED", "GRPC_PORT", "GRPC_MAX_RECV_MESSAGE_SIZE", "GRPC_MAX_SEND_MESSAGE_SIZE", "METRICS_PORT",
 		"TLS_ENABLED", "TLS_CERT_FILE", "TLS_KEY_FILE", "TLS_CA_FILE", "TLS_CLIENT_AUTH", "TLS_MIN_VERSION",
-		"LOG_LEVEL", "MAX_UPLOAD_SIZE", "TIMEOUT", "METRICS_ENABLED",
+		"LOG_LEVEL", "MAX_UPLOAD_SIZE", "TIMEOUT", "RESULT_CACHE_ENTRIES", "RESULT_CACHE_DIR",
+		"THREAD_BUDGET", "MAX_THREADS_PER_ASSESSMENT", "SCRATCH_POOL_BYTES",
+		"PERMUTATION_WORKERS", "PERMUTATION_MIN_SAMPLES", "PERMUTATION_STREAMS_PER_SHARD", "PERMUTATION_WORKER_TOKEN",
+		"METRICS_ENABLED", "ESTIMATOR_METRICS_ENABLED",
 		"AUTH_ENABLED", "AUTH_ISSUER", "AUTH_AUDIENCE", "AUTH_JWKS_URL",
 		"AUTH_TOKEN_TYPE", "AUTH_INTROSPECTION_URL",
 		"AUTH_INTROSPECTION_CLIENT_ID", "AUTH_INTROSPECTION_CLIENT_SECRET",
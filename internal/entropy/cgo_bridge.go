@@ -15,12 +15,16 @@ package entropy
 import "C"
 
 import (
+	"context"
+	"fmt"
+	"runtime"
+	"time"
 	"unsafe"
 )
 
 // calculateIIDEntropy invokes the C wrapper to run IID tests including
 // Most Common Value, Chi-Square, LRS, and Permutation tests.
-func calculateIIDEntropy(data []byte, bitsPerSymbol int, verbose int) (*Result, error) {
+func calculateIIDEntropy(ctx context.Context, data []byte, bitsPerSymbol int, verbose int, maxThreads int) (*Result, error) {
 	if len(data) == 0 {
 		return nil, newError("calculateIIDEntropy", ErrInvalidData, "data is empty")
 	}
@@ -32,28 +36,91 @@ func calculateIIDEntropy(data []byte, bitsPerSymbol int, verbose int) (*Result,
 	cInitialEntropy := C.bool(true)
 	cVerbose := C.int(verbose)
 
-	cResult := C.calculate_iid_entropy(cData, cLength, cBitsPerSymbol, cInitialEntropy, cVerbose)
+	cCancel, release := cancelToken(ctx)
+	defer release()
+
+	cResult := C.calculate_iid_entropy(cData, cLength, cBitsPerSymbol, cInitialEntropy, cVerbose, C.int(maxThreads), cCancel)
 	if cResult == nil {
 		return nil, newError("calculateIIDEntropy", ErrMemoryAllocation, "failed to allocate result structure")
 	}
 	defer C.free_entropy_result(cResult)
 
+	return convertResult("calculateIIDEntropy", cResult, IID)
+}
+
+// cancelToken creates a C cancellation token that fires once ctx is done,
+// carrying the deadline of ctx so that the C++ library also stops on time by
+// itself. release must be called after the C call has returned; it stops
+// watching ctx and frees the token. A context that can never be done needs
+// no token, and nil is returned for it.
+func cancelToken(ctx context.Context) (*C.EntropyCancelToken, func()) {
+	if ctx.Done() == nil {
+		return nil, func() {}
+	}
+
+	timeout := 0.0
+	if deadline, ok := ctx.Deadline(); ok {
+		// A deadline that has just passed must still count as one
+		timeout = max(time.Until(deadline).Seconds(), 1e-9)
+	}
+
+	token := C.entropy_cancel_token_create(C.double(timeout))
+	if token == nil {
+		return nil, func() {}
+	}
+
+	stop := make(chan struct{})
+	stopped := make(chan struct{})
+	go func() {
+		defer close(stopped)
+		select {
+		case <-ctx.Done():
+			C.entropy_cancel_token_cancel(token)
+		case <-stop:
+		}
+	}()
+
+	return token, func() {
+		close(stop)
+		<-stopped
+		C.entropy_cancel_token_free(token)
+	}
+}
+
+// convertResult marshals a C EntropyResult into a Go Result, or into the
+// error it reports.
+func convertResult(op string, cResult *C.EntropyResult, testType TestType) (*Result, error) {
 	if cResult.error_code != 0 {
 		errMsg := C.GoString(&cResult.error_message[0])
-		return nil, wrapCError("calculateIIDEntropy", int(cResult.error_code), errMsg)
+		return nil, wrapCError(op, int(cResult.error_code), errMsg)
 	}
 
-	result := &Result{
+	return &Result{
 		MinEntropy:   float64(cResult.min_entropy),
 		HOriginal:    float64(cResult.h_original),
 		HBitstring:   float64(cResult.h_bitstring),
 		HAssessed:    float64(cResult.h_assessed),
 		DataWordSize: int(cResult.data_word_size),
-		TestType:     IID,
+		TestType:     testType,
 		Estimators:   convertEstimators(cResult),
+		Permutation:  convertPermutationStats(cResult, testType),
+
+		PermutationSeed: convertPermutationSeed(cResult, testType),
+	}, nil
+}
+
+// convertPermutationSeed hex-encodes the permutation test seed of an IID
+// result, and returns an empty string for any other result.
+func convertPermutationSeed(cResult *C.EntropyResult, testType TestType) string {
+	if testType != IID {
+		return ""
 	}
 
-	return result, nil
+	seed := make([]byte, 0, 64)
+	for i := 0; i < 4; i++ {
+		seed = fmt.Appendf(seed, "%016x", uint64(cResult.permutation_seed[i]))
+	}
+	return string(seed)
 }
 
 // convertEstimators marshals the C-allocated estimator array from an
@@ -73,13 +140,69 @@ func convertEstimators(cResult *C.EntropyResult) []EstimatorResult {
 			Passed:          bool(cEst.passed),
 			IsEntropyValid:  bool(cEst.is_entropy_valid),
 		}
+		if cResult.instrumented {
+			estimators[i].Stats = &EstimatorStats{
+				WallSeconds: float64(cEst.stats.wall_seconds),
+				CPUSeconds:  float64(cEst.stats.cpu_seconds),
+				PeakBytes:   uint64(cEst.stats.peak_bytes),
+				Iterations:  uint64(cEst.stats.iterations),
+			}
+		}
 	}
 	return estimators
 }
 
+// convertPermutationStats marshals the permutation test instrumentation of
+// an instrumented IID result, and returns nil for any other result.
+func convertPermutationStats(cResult *C.EntropyResult, testType TestType) *PermutationStats {
+	if !cResult.instrumented || testType != IID {
+		return nil
+	}
+
+	stats := &PermutationStats{
+		Executed:  uint64(cResult.permutations_executed),
+		DecidedAt: make(map[string]int, C.PERMUTATION_STATISTICS),
+	}
+	for i := 0; i < C.PERMUTATION_STATISTICS; i++ {
+		name := C.GoString(C.permutation_statistic_name(C.int(i)))
+		stats.DecidedAt[name] = int(cResult.permutation_decided_at[i])
+	}
+	return stats
+}
+
+// toolVersion returns the version of the SP 800-90B reference code the C++
+// library was built from.
+func toolVersion() string {
+	return C.GoString(C.entropy_tool_version())
+}
+
+// literalIndexBuilds returns the number of suffix indexes of literal symbols
+// the C wrapper has built in this process.
+func literalIndexBuilds() uint64 {
+	return uint64(C.entropy_literal_index_builds())
+}
+
+// setInstrumentation switches the per-estimator instrumentation of the C
+// wrapper on or off for subsequent assessments.
+func setInstrumentation(enabled bool) {
+	C.set_entropy_instrumentation(C.bool(enabled))
+}
+
+// setThreadBudget sizes the thread budget the C wrapper shares between
+// concurrent calls.
+func setThreadBudget(threads int) {
+	C.set_entropy_thread_budget(C.int(threads))
+}
+
+// setScratchLimit sets the bytes of released scratch buffers the C wrapper
+// keeps for later calls.
+func setScratchLimit(bytes int64) {
+	C.set_entropy_scratch_limit(C.size_t(bytes))
+}
+
 // calculateNonIIDEntropy invokes the C wrapper to run all ten Non-IID
 // estimators defined in NIST SP 800-90B Section 6.3.
-func calculateNonIIDEntropy(data []byte, bitsPerSymbol int, verbose int) (*Result, error) {
+func calculateNonIIDEntropy(ctx context.Context, data []byte, bitsPerSymbol int, verbose int, maxThreads int) (*Result, error) {
 	if len(data) == 0 {
 		return nil, newError("calculateNonIIDEntropy", ErrInvalidData, "data is empty")
 	}
@@ -92,26 +215,237 @@ func calculateNonIIDEntropy(data []byte, bitsPerSymbol int, verbose int) (*Resul
 	cInitialEntropy := C.bool(true)
 	cVerbose := C.int(verbose)
 
-	cResult := C.calculate_non_iid_entropy(cData, cLength, cBitsPerSymbol, cInitialEntropy, cVerbose)
+	cCancel, release := cancelToken(ctx)
+	defer release()
+
+	cResult := C.calculate_non_iid_entropy(cData, cLength, cBitsPerSymbol, cInitialEntropy, cVerbose, C.int(maxThreads), cCancel)
 	if cResult == nil {
 		return nil, newError("calculateNonIIDEntropy", ErrMemoryAllocation, "failed to allocate result structure")
 	}
 	defer C.free_entropy_result(cResult)
 
-	if cResult.error_code != 0 {
-		errMsg := C.GoString(&cResult.error_message[0])
-		return nil, wrapCError("calculateNonIIDEntropy", int(cResult.error_code), errMsg)
+	return convertResult("calculateNonIIDEntropy", cResult, NonIID)
+}
+
+// calculateBatch invokes the C wrapper once for all items, which runs small
+// items concurrently and large items one after another. The sample buffers
+// are pinned for the duration of the call because the job array handed to C
+// refers to them.
+func calculateBatch(ctx context.Context, items []BatchItem, verbose int, maxThreads int) []BatchResult {
+	results := make([]BatchResult, len(items))
+	if len(items) == 0 {
+		return results
 	}
 
-	result := &Result{
-		MinEntropy:   float64(cResult.min_entropy),
-		HOriginal:    float64(cResult.h_original),
-		HBitstring:   float64(cResult.h_bitstring),
-		HAssessed:    float64(cResult.h_assessed),
-		DataWordSize: int(cResult.data_word_size),
-		TestType:     NonIID,
-		Estimators:   convertEstimators(cResult),
+	var pinner runtime.Pinner
+	defer pinner.Unpin()
+
+	jobs := make([]C.EntropyJob, len(items))
+	for i, item := range items {
+		if len(item.Data) == 0 {
+			// The C side reports the error for this job
+			continue
+		}
+		pinner.Pin(&item.Data[0])
+		jobs[i].data = (*C.uint8_t)(unsafe.Pointer(&item.Data[0]))
+		jobs[i].length = C.size_t(len(item.Data))
+		jobs[i].bits_per_symbol = C.int(item.BitsPerSymbol)
+		jobs[i].mode = C.ENTROPY_MODE_IID
+		if item.TestType == NonIID {
+			jobs[i].mode = C.ENTROPY_MODE_NON_IID
+		}
+		// Always use initial_entropy=true, as for the single-item calls
+		jobs[i].is_binary = C.bool(true)
+	}
+
+	cCancel, release := cancelToken(ctx)
+	defer release()
+
+	cResults := C.calculate_entropy_batch(&jobs[0], C.size_t(len(jobs)), C.int(verbose), C.int(maxThreads), cCancel)
+	if cResults == nil {
+		err := newError("calculateBatch", ErrMemoryAllocation, "failed to allocate result structures")
+		for i := range results {
+			results[i].Err = err
+		}
+		return results
+	}
+	defer C.free_entropy_batch(cResults)
+
+	cSlice := unsafe.Slice(cResults, len(items))
+	for i := range cSlice {
+		results[i].Result, results[i].Err = convertResult("calculateBatch", &cSlice[i], items[i].TestType)
+	}
+	return results
+}
+
+// calculatePermutationTally invokes the C wrapper to run the permutation
+// test rounds of shard.
+func calculatePermutationTally(ctx context.Context, data []byte, bitsPerSymbol int, shard PermutationShard, maxThreads int) (*PermutationTally, error) {
+	if len(data) == 0 {
+		return nil, newError("calculatePermutationTally", ErrInvalidData, "data is empty")
+	}
+
+	var cSeed [4]C.uint64_t
+	for i, word := range shard.Seed {
+		cSeed[i] = C.uint64_t(word)
+	}
+	var cUndecided [C.PERMUTATION_STATISTICS]C.bool
+	for i, decided := range shard.Decided {
+		cUndecided[i] = C.bool(!decided)
+	}
+
+	cCancel, release := cancelToken(ctx)
+	defer release()
+
+	cTally := C.calculate_permutation_tally((*C.uint8_t)(unsafe.Pointer(&data[0])), C.size_t(len(data)), C.int(bitsPerSymbol),
+		&cSeed[0], C.int(shard.FirstStream), C.int(shard.StreamCount), &cUndecided[0], C.int(maxThreads), cCancel)
+	if cTally == nil {
+		return nil, newError("calculatePermutationTally", ErrMemoryAllocation, "failed to allocate tally structure")
+	}
+	defer C.free_permutation_tally(cTally)
+
+	if cTally.error_code != 0 {
+		return nil, wrapCError("calculatePermutationTally", int(cTally.error_code), C.GoString(&cTally.error_message[0]))
+	}
+
+	tally := &PermutationTally{Executed: uint64(cTally.permutations_executed)}
+	for i := range tally.Counts {
+		for j := range tally.Counts[i] {
+			tally.Counts[i][j] = int(cTally.counts[i][j])
+		}
+	}
+	return tally, nil
+}
+
+// calculateIIDEntropyWithTally invokes the C wrapper to run the IID tests,
+// deciding the permutation tests by tally.
+func calculateIIDEntropyWithTally(ctx context.Context, data []byte, bitsPerSymbol int, verbose int, maxThreads int,
+	seed PermutationSeed, tally *PermutationTally) (*Result, error) {
+	if len(data) == 0 {
+		return nil, newError("calculateIIDEntropyWithTally", ErrInvalidData, "data is empty")
+	}
+
+	var cSeed [4]C.uint64_t
+	for i, word := range seed {
+		cSeed[i] = C.uint64_t(word)
+	}
+	var cTally C.PermutationTally
+	for i := range tally.Counts {
+		for j := range tally.Counts[i] {
+			cTally.counts[i][j] = C.int(tally.Counts[i][j])
+		}
 	}
+	cTally.permutations_executed = C.uint64_t(tally.Executed)
+
+	cCancel, release := cancelToken(ctx)
+	defer release()
 
-	return result, nil
+	// Always use initial_entropy=true, as for calculateIIDEntropy
+	cResult := C.calculate_iid_entropy_with_tally((*C.uint8_t)(unsafe.Pointer(&data[0])), C.size_t(len(data)), C.int(bitsPerSymbol),
+		C.bool(true), C.int(verbose), C.int(maxThreads), &cSeed[0], &cTally, cCancel)
+	if cResult == nil {
+		return nil, newError("calculateIIDEntropyWithTally", ErrMemoryAllocation, "failed to allocate result structure")
+	}
+	defer C.free_entropy_result(cResult)
+
+	return convertResult("calculateIIDEntropyWithTally", cResult, IID)
+}
+
+// sessionHandle owns the C session of a NonIIDSession.
+type sessionHandle struct {
+	session *C.EntropySession
+}
+
+// newSessionHandle creates the C session of a streaming Non-IID assessment.
+func newSessionHandle(bitsPerSymbol int, verbose int) (*sessionHandle, error) {
+	// Always use initial_entropy=true, as for calculateNonIIDEntropy
+	session := C.entropy_session_create(C.int(bitsPerSymbol), C.bool(true), C.int(verbose))
+	if session == nil {
+		return nil, newError("newSessionHandle", ErrMemoryAllocation, "failed to allocate session")
+	}
+	return &sessionHandle{session: session}, nil
+}
+
+// feed copies chunk, which must not be empty, into the C session.
+func (h *sessionHandle) feed(chunk []byte) error {
+	code := C.entropy_session_feed(h.session, (*C.uint8_t)(unsafe.Pointer(&chunk[0])), C.size_t(len(chunk)))
+	switch code {
+	case 0:
+		return nil
+	case -2:
+		return newError("NonIIDSession.Feed", ErrMemoryAllocation, "failed to store samples")
+	default:
+		return wrapCError("NonIIDSession.Feed", int(code), "invalid session")
+	}
+}
+
+// finalize runs the Non-IID estimators on the samples of the C session.
+func (h *sessionHandle) finalize(ctx context.Context, maxThreads int) (*Result, error) {
+	cCancel, release := cancelToken(ctx)
+	defer release()
+
+	cResult := C.entropy_session_finalize(h.session, C.int(maxThreads), cCancel)
+	if cResult == nil {
+		return nil, newError("NonIIDSession.Finalize", ErrMemoryAllocation, "failed to allocate result structure")
+	}
+	defer C.free_entropy_result(cResult)
+
+	return convertResult("NonIIDSession.Finalize", cResult, NonIID)
+}
+
+// free releases the C session; later calls do nothing.
+func (h *sessionHandle) free() {
+	if h.session != nil {
+		C.entropy_session_free(h.session)
+		h.session = nil
+	}
+}
+
+// healthHandle owns the C monitor of a HealthMonitor.
+type healthHandle struct {
+	monitor *C.EntropyHealthMonitor
+}
+
+// newHealthHandle creates the C monitor; the parameters are already validated.
+func newHealthHandle(hMin float64, bitsPerSymbol int, alphaExponent int) (*healthHandle, error) {
+	monitor := C.entropy_health_create(C.double(hMin), C.int(bitsPerSymbol), C.int(alphaExponent))
+	if monitor == nil {
+		return nil, newError("newHealthHandle", ErrMemoryAllocation, "failed to allocate health monitor")
+	}
+	return &healthHandle{monitor: monitor}, nil
+}
+
+// feed runs the health tests on chunk, which must not be empty, and returns the alarms raised.
+func (h *healthHandle) feed(chunk []byte) int {
+	return int(C.entropy_health_feed(h.monitor, (*C.uint8_t)(unsafe.Pointer(&chunk[0])), C.size_t(len(chunk))))
+}
+
+// counters reads the counters of the C monitor.
+func (h *healthHandle) counters() HealthCounters {
+	var c C.EntropyHealthCounters
+	C.entropy_health_counters(h.monitor, &c)
+	return HealthCounters{
+		Samples:        uint64(c.samples),
+		RCTAlarms:      uint64(c.rct_alarms),
+		APTAlarms:      uint64(c.apt_alarms),
+		APTWindows:     uint64(c.apt_windows),
+		LongestRun:     uint64(c.longest_run),
+		MaxWindowCount: uint32(c.max_window_count),
+		RCTCutoff:      uint32(c.rct_cutoff),
+		APTCutoff:      uint32(c.apt_cutoff),
+		APTWindow:      uint32(c.apt_window),
+	}
+}
+
+// reset restarts the C monitor, keeping its cutoffs.
+func (h *healthHandle) reset() {
+	C.entropy_health_reset(h.monitor)
+}
+
+// free releases the C monitor; later calls do nothing.
+func (h *healthHandle) free() {
+	if h.monitor != nil {
+		C.entropy_health_free(h.monitor)
+		h.monitor = nil
+	}
 }
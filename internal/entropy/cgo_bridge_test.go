@@ -0,0 +1,397 @@
+//go:build !teststub
+
+// Tests in this file run the C++ library through the CGO bridge; they are
+// excluded when the "teststub" build tag is active.
+
+package entropy
+
+import (
+	"context"
+	"math"
+	"math/rand"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+// Auto-detection takes the highest bit in use as the word size, so bytes using the top bit
+// are assessed as 8-bit symbols, with the estimates an explicit width of 8 gives them.
+func TestAssessNonIID_AutoDetectedWordSize(t *testing.T) {
+	rng := rand.New(rand.NewSource(1))
+	full := make([]byte, 20000)
+	nibbles := make([]byte, 20000)
+	for i := range full {
+		full[i] = byte(rng.Intn(256))
+		nibbles[i] = byte(rng.Intn(16))
+	}
+	full[0] = 0x80
+
+	assessment := NewAssessment()
+	assessment.SetVerbose(0)
+
+	for _, tc := range []struct {
+		data     []byte
+		wordSize int
+	}{
+		{full, 8},
+		{nibbles, 4},
+	} {
+		detected, err := assessment.AssessNonIID(tc.data, 0)
+		require.NoError(t, err)
+		explicit, err := assessment.AssessNonIID(tc.data, tc.wordSize)
+		require.NoError(t, err)
+
+		assert.Equal(t, tc.wordSize, detected.DataWordSize)
+		assert.Equal(t, explicit.MinEntropy, detected.MinEntropy)
+		assert.Equal(t, explicit.HOriginal, detected.HOriginal)
+		assert.Equal(t, explicit.HBitstring, detected.HBitstring)
+	}
+}
+
+// The IID and Non-IID assessments of one capture in a batch build the suffix
+// index of its literal symbols once between them, and still give the
+// results of separate calls, which build one each.
+func TestAssessBatch_SharesLiteralIndex(t *testing.T) {
+	rng := rand.New(rand.NewSource(5))
+	data := make([]byte, 5000)
+	other := make([]byte, 5000)
+	for i := range data {
+		data[i] = byte(rng.Intn(16))
+		other[i] = byte(rng.Intn(16))
+	}
+
+	assessment := NewAssessment()
+	assessment.SetVerbose(0)
+
+	builds := literalIndexBuilds()
+	iid, err := assessment.AssessIID(data, 4)
+	require.NoError(t, err)
+	nonIID, err := assessment.AssessNonIID(data, 4)
+	require.NoError(t, err)
+	assert.Equal(t, uint64(2), literalIndexBuilds()-builds)
+
+	builds = literalIndexBuilds()
+	results := assessment.AssessBatch([]BatchItem{
+		{Data: data, BitsPerSymbol: 4, TestType: IID},
+		{Data: other, BitsPerSymbol: 4, TestType: NonIID},
+		{Data: data, BitsPerSymbol: 4, TestType: NonIID},
+		{Data: other, BitsPerSymbol: 4, TestType: IID},
+	})
+	for i, res := range results {
+		require.NoError(t, res.Err, "item %d", i)
+	}
+	assert.Equal(t, uint64(2), literalIndexBuilds()-builds)
+
+	assert.Equal(t, nonIID, results[2].Result)
+	assert.Equal(t, iid.Estimators[2], results[0].Result.Estimators[2])
+	assert.Equal(t, "Length of Longest Repeated Substring Test", results[0].Result.Estimators[2].Name)
+}
+
+// sessionStreams returns captures whose bitstrings are long enough for the
+// Compression and MultiMCW estimates, with runs and repeats for the
+// prediction estimates to find. The long one spans more than one stream piece.
+func sessionStreams(rng *rand.Rand) map[string][]byte {
+	uniform := make([]byte, 20000)
+	sticky := make([]byte, 20000)
+	periodic := make([]byte, 20000)
+	long := make([]byte, 70000)
+	for i := range uniform {
+		uniform[i] = byte(rng.Intn(256))
+		if i == 0 || rng.Intn(4) == 0 {
+			sticky[i] = byte(rng.Intn(256))
+		} else {
+			sticky[i] = sticky[i-1]
+		}
+		periodic[i] = byte(i%13) * 17
+		if rng.Intn(8) == 0 {
+			periodic[i] ^= byte(rng.Intn(256))
+		}
+	}
+	for i := range long {
+		long[i] = byte(rng.Intn(256))
+	}
+	return map[string][]byte{"uniform": uniform, "sticky": sticky, "periodic": periodic, "long": long}
+}
+
+// The bitstring estimates a session runs while it is fed match those
+// AssessNonIID computes on the whole capture, however the capture is chunked.
+func TestNonIIDSession_MatchesAssessNonIID(t *testing.T) {
+	rng := rand.New(rand.NewSource(4))
+	assessment := NewAssessment()
+	assessment.SetVerbose(0)
+
+	for name, stream := range sessionStreams(rng) {
+		for _, bitsPerSymbol := range []int{8, 4, 3, 1, 0} {
+			// Crossing a piece takes as many samples at any width
+			if name == "long" && bitsPerSymbol != 1 && bitsPerSymbol != 3 {
+				continue
+			}
+			data := stream
+			if bitsPerSymbol > 0 {
+				data = make([]byte, len(stream))
+				for i, b := range stream {
+					data[i] = b & byte(1<<bitsPerSymbol-1)
+				}
+			}
+			want, err := assessment.AssessNonIID(data, bitsPerSymbol)
+			require.NoError(t, err)
+
+			for _, chunk := range []int{len(data), 1, 7, 4097, -1} {
+				session, err := assessment.NewNonIIDSession(bitsPerSymbol)
+				require.NoError(t, err)
+				for pos := 0; pos < len(data); {
+					size := chunk
+					if size < 0 {
+						size = rng.Intn(9000)
+					}
+					if size > len(data)-pos {
+						size = len(data) - pos
+					}
+					require.NoError(t, session.Feed(data[pos:pos+size]))
+					pos += size
+				}
+				got, err := session.Finalize(context.Background())
+				session.Close()
+				require.NoError(t, err)
+
+				assert.Equal(t, want, got, "stream %s, %d bits, chunks of %d", name, bitsPerSymbol, chunk)
+			}
+		}
+	}
+}
+
+// Cutoffs of the SP 800-90B health tests for alpha = 2^-20, from Section 4.4.1 (C = 1 + ceil(20/H))
+// and Table 2 of Section 4.4.2, with the binary window of 1024 and the non-binary window of 512.
+func TestHealthMonitor_Cutoffs(t *testing.T) {
+	for _, tc := range []struct {
+		h             float64
+		bitsPerSymbol int
+		alphaExponent int
+		rct, apt      uint32
+	}{
+		{0.2, 1, 0, 101, 941},
+		{0.4, 1, 0, 51, 840},
+		{0.5, 1, 0, 41, 793},
+		{0.6, 1, 0, 35, 748},
+		{0.8, 1, 0, 26, 664},
+		{1, 1, 0, 21, 589},
+		{0.5, 8, 0, 41, 410},
+		{1, 8, 0, 21, 311},
+		{2, 8, 0, 11, 177},
+		{3, 8, 0, 8, 103},
+		{4, 8, 0, 6, 62},
+		{5, 8, 0, 5, 39},
+		{6, 8, 0, 5, 25},
+		{7, 8, 0, 4, 18},
+		{8, 8, 0, 4, 13},
+		{1, 8, 30, 31, 325},
+		{0.5, 1, 30, 61, 810},
+	} {
+		monitor, err := NewHealthMonitor(tc.h, tc.bitsPerSymbol, tc.alphaExponent)
+		require.NoError(t, err)
+		counters := monitor.Counters()
+		monitor.Close()
+
+		assert.Equal(t, tc.rct, counters.RCTCutoff, "RCT cutoff for H=%g alpha=2^-%d", tc.h, tc.alphaExponent)
+		assert.Equal(t, tc.apt, counters.APTCutoff, "APT cutoff for H=%g bits=%d alpha=2^-%d", tc.h, tc.bitsPerSymbol, tc.alphaExponent)
+	}
+}
+
+// The smallest min-entropy accepted for an alpha gives the largest cutoff that fits in a uint32, for
+// the Go check and for entropy_health_create alike; the next smaller one is rejected by both.
+func TestHealthMonitor_LargestRCTCutoff(t *testing.T) {
+	for _, alphaExponent := range []int{1, 20, 64} {
+		h := float64(alphaExponent) / (math.MaxUint32 - 1)
+		for float64(alphaExponent)/h > math.MaxUint32-1 {
+			h = math.Nextafter(h, 1)
+		}
+		below := math.Nextafter(h, 0)
+
+		monitor, err := NewHealthMonitor(h, 1, alphaExponent)
+		require.NoError(t, err, "alpha=2^-%d", alphaExponent)
+		alarms, err := monitor.Feed(make([]byte, 1000))
+		require.NoError(t, err)
+		counters := monitor.Counters()
+		monitor.Close()
+		assert.Equal(t, 0, alarms)
+		assert.Equal(t, uint32(math.MaxUint32), counters.RCTCutoff, "alpha=2^-%d", alphaExponent)
+		assert.Equal(t, uint64(1000), counters.LongestRun)
+
+		_, err = NewHealthMonitor(below, 1, alphaExponent)
+		assert.ErrorIs(t, err, ErrInvalidData, "alpha=2^-%d", alphaExponent)
+		_, err = newHealthHandle(below, 1, alphaExponent)
+		assert.Error(t, err, "alpha=2^-%d", alphaExponent)
+	}
+}
+
+// referenceHealth runs the Repetition Count and Adaptive Proportion tests on stream one sample at
+// a time, as written in Sections 4.4.1 and 4.4.2, with the cutoffs of want.
+func referenceHealth(stream []byte, bitsPerSymbol int, want HealthCounters) HealthCounters {
+	mask := byte(1<<bitsPerSymbol - 1)
+	out := HealthCounters{RCTCutoff: want.RCTCutoff, APTCutoff: want.APTCutoff, APTWindow: want.APTWindow}
+	var last, first byte
+	var run uint64
+	var seen, count uint32
+	alarmed := false
+
+	for i, raw := range stream {
+		s := raw & mask
+
+		if i > 0 && s == last {
+			run++
+		} else {
+			last = s
+			run = 1
+		}
+		if run == uint64(out.RCTCutoff) {
+			out.RCTAlarms++
+		}
+		if run > out.LongestRun {
+			out.LongestRun = run
+		}
+
+		if seen == 0 {
+			first = s
+			count = 1
+			alarmed = false
+		} else if s == first {
+			count++
+			if !alarmed && count >= out.APTCutoff {
+				alarmed = true
+				out.APTAlarms++
+			}
+		}
+		seen++
+		if seen == out.APTWindow {
+			out.APTWindows++
+			if count > out.MaxWindowCount {
+				out.MaxWindowCount = count
+			}
+			seen = 0
+		}
+	}
+	out.Samples = uint64(len(stream))
+	return out
+}
+
+// healthStreams returns streams that raise alarms of both tests, with runs and window counts on
+// either side of the cutoffs of an 8-bit source claimed to have 8 bits of min-entropy (RCT C = 4,
+// APT C = 13) and of a binary source claimed to have 1 bit (RCT C = 21, APT C = 589).
+func healthStreams(rng *rand.Rand) map[string][]byte {
+	streams := make(map[string][]byte)
+
+	uniform := make([]byte, 1<<16)
+	rng.Read(uniform)
+	streams["uniform"] = uniform
+
+	// Repeats the previous sample with probability 1/2, so runs of every length up to ~20 occur
+	sticky := make([]byte, 1<<16)
+	for i := range sticky {
+		if i > 0 && rng.Intn(2) == 0 {
+			sticky[i] = sticky[i-1]
+		} else {
+			sticky[i] = byte(rng.Intn(256))
+		}
+	}
+	streams["sticky"] = sticky
+
+	// Runs of cutoff-1 to cutoff+1 and of the vector widths around them, and a run that spans
+	// several 64 sample blocks
+	var runs []byte
+	for n, length := range []int{3, 4, 5, 20, 21, 22, 31, 32, 33, 63, 64, 65, 127, 128, 129, 300, 1, 2} {
+		for j := 0; j < length; j++ {
+			runs = append(runs, byte(n))
+		}
+	}
+	streams["runs"] = runs
+
+	// 512 sample windows whose first sample occurs 12, 13 and 14 times, spread out so that no run
+	// reaches the Repetition Count Test cutoff
+	var windows []byte
+	for _, occurrences := range []int{12, 13, 14, 13} {
+		window := make([]byte, 512)
+		for i := range window {
+			window[i] = byte(1 + i%255)
+		}
+		for j := 0; j < occurrences; j++ {
+			window[j*512/occurrences] = 0
+		}
+		windows = append(windows, window...)
+	}
+	streams["windows"] = windows
+
+	// Bits with a bias and high bits that have to be masked off
+	biased := make([]byte, 1<<15)
+	for i := range biased {
+		biased[i] = byte(rng.Intn(256)) &^ 1
+		if rng.Intn(100) < 60 {
+			biased[i] |= 1
+		}
+	}
+	streams["biased"] = biased
+
+	return streams
+}
+
+// The monitor agrees with the reference for every chunking of the stream. Chunks shorter than the
+// vector widths (32 samples for the APT count, 64 for the RCT blocks) are processed by the scalar
+// kernels alone, and the longer ones by the SIMD kernels and the scalar tails.
+func TestHealthMonitor_MatchesReference(t *testing.T) {
+	rng := rand.New(rand.NewSource(2))
+	chunkings := []int{0, 1, 7, 31, 63, 64, 65, 1000, -1}
+
+	for name, stream := range healthStreams(rng) {
+		for _, bitsPerSymbol := range []int{8, 1} {
+			// A low min-entropy gives an RCT cutoff of 201, above the runs a 64 sample block holds
+			for _, h := range []float64{float64(bitsPerSymbol), 0.1} {
+				for _, chunk := range chunkings {
+					monitor, err := NewHealthMonitor(h, bitsPerSymbol, 0)
+					require.NoError(t, err)
+
+					want := referenceHealth(stream, bitsPerSymbol, monitor.Counters())
+					alarms := 0
+					for pos := 0; pos < len(stream); {
+						size := chunk
+						switch {
+						case chunk == 0:
+							size = len(stream)
+						case chunk < 0:
+							size = 1 + rng.Intn(200)
+						}
+						if pos+size > len(stream) {
+							size = len(stream) - pos
+						}
+						n, err := monitor.Feed(stream[pos : pos+size])
+						require.NoError(t, err)
+						alarms += n
+						pos += size
+					}
+					got := monitor.Counters()
+					monitor.Close()
+
+					assert.Equal(t, want, got, "stream %s, %d bits, H=%g, chunks of %d", name, bitsPerSymbol, h, chunk)
+					assert.Equal(t, int(want.RCTAlarms+want.APTAlarms), alarms, "stream %s, %d bits, H=%g, chunks of %d", name, bitsPerSymbol, h, chunk)
+				}
+			}
+		}
+	}
+}
+
+// After a reset the monitor behaves as a new one.
+func TestHealthMonitor_Reset(t *testing.T) {
+	rng := rand.New(rand.NewSource(3))
+	stream := healthStreams(rng)["sticky"]
+
+	monitor, err := NewHealthMonitor(8, 8, 0)
+	require.NoError(t, err)
+	defer monitor.Close()
+
+	_, err = monitor.Feed(stream[:1001])
+	require.NoError(t, err)
+	monitor.Reset()
+	_, err = monitor.Feed(stream)
+	require.NoError(t, err)
+
+	assert.Equal(t, referenceHealth(stream, 8, monitor.Counters()), monitor.Counters())
+}
@@ -8,7 +8,11 @@
 
 package entropy
 
-import "math"
+import (
+	"context"
+	"math"
+	"sync/atomic"
+)
 
 // stubIIDEstimators returns mock IID estimator results.
 func stubIIDEstimators() []EstimatorResult {
@@ -36,7 +40,10 @@ func stubNonIIDEstimators() []EstimatorResult {
 	}
 }
 
-func calculateIIDEntropy(data []byte, bitsPerSymbol int, verbose int) (*Result, error) {
+func calculateIIDEntropy(ctx context.Context, data []byte, bitsPerSymbol int, verbose int, maxThreads int) (*Result, error) {
+	if err := ctx.Err(); err != nil {
+		return nil, cancelledError("calculateIIDEntropy", err)
+	}
 	if len(data) > 0 && data[0] == 0xFF {
 		return nil, newError("calculateIIDEntropy", ErrInvalidData, "stub failure")
 	}
@@ -51,7 +58,7 @@ func calculateIIDEntropy(data []byte, bitsPerSymbol int, verbose int) (*Result,
 			Estimators:   nil,
 		}, nil
 	}
-	return &Result{
+	return stubInstrument(&Result{
 		MinEntropy:   7.5,
 		HOriginal:    7.6,
 		HBitstring:   7.1,
@@ -59,10 +66,15 @@ func calculateIIDEntropy(data []byte, bitsPerSymbol int, verbose int) (*Result,
 		DataWordSize: bitsPerSymbol,
 		TestType:     IID,
 		Estimators:   stubIIDEstimators(),
-	}, nil
+
+		PermutationSeed: stubPermutationSeed,
+	}), nil
 }
 
-func calculateNonIIDEntropy(data []byte, bitsPerSymbol int, verbose int) (*Result, error) {
+func calculateNonIIDEntropy(ctx context.Context, data []byte, bitsPerSymbol int, verbose int, maxThreads int) (*Result, error) {
+	if err := ctx.Err(); err != nil {
+		return nil, cancelledError("calculateNonIIDEntropy", err)
+	}
 	if len(data) > 0 && data[0] == 0xFF {
 		return nil, newError("calculateNonIIDEntropy", ErrInvalidData, "stub failure")
 	}
@@ -77,7 +89,7 @@ func calculateNonIIDEntropy(data []byte, bitsPerSymbol int, verbose int) (*Resul
 			Estimators:   nil,
 		}, nil
 	}
-	return &Result{
+	return stubInstrument(&Result{
 		MinEntropy:   6.5,
 		HOriginal:    6.6,
 		HBitstring:   6.1,
@@ -85,5 +97,151 @@ func calculateNonIIDEntropy(data []byte, bitsPerSymbol int, verbose int) (*Resul
 		DataWordSize: bitsPerSymbol,
 		TestType:     NonIID,
 		Estimators:   stubNonIIDEstimators(),
-	}, nil
+	}), nil
+}
+
+func calculateBatch(ctx context.Context, items []BatchItem, verbose int, maxThreads int) []BatchResult {
+	results := make([]BatchResult, len(items))
+	for i, item := range items {
+		if item.TestType == NonIID {
+			results[i].Result, results[i].Err = calculateNonIIDEntropy(ctx, item.Data, item.BitsPerSymbol, verbose, maxThreads)
+		} else {
+			results[i].Result, results[i].Err = calculateIIDEntropy(ctx, item.Data, item.BitsPerSymbol, verbose, maxThreads)
+		}
+	}
+	return results
+}
+
+// stubStreamCounts are the outcomes each stub stream adds to the statistics
+// it runs; two streams decide a statistic.
+var stubStreamCounts = [3]int{2, 1, 2}
+
+func calculatePermutationTally(ctx context.Context, data []byte, bitsPerSymbol int, shard PermutationShard, maxThreads int) (*PermutationTally, error) {
+	if err := ctx.Err(); err != nil {
+		return nil, cancelledError("calculatePermutationTally", err)
+	}
+	if len(data) > 0 && data[0] == 0xFF {
+		return nil, newError("calculatePermutationTally", ErrInvalidData, "stub failure")
+	}
+
+	tally := &PermutationTally{}
+	for i, decided := range shard.Decided {
+		if decided {
+			continue
+		}
+		for j := range tally.Counts[i] {
+			tally.Counts[i][j] = shard.StreamCount * stubStreamCounts[j]
+		}
+	}
+	tally.Executed = uint64(shard.StreamCount) * 5
+	return tally, nil
+}
+
+func calculateIIDEntropyWithTally(ctx context.Context, data []byte, bitsPerSymbol int, verbose int, maxThreads int,
+	seed PermutationSeed, tally *PermutationTally) (*Result, error) {
+	res, err := calculateIIDEntropy(ctx, data, bitsPerSymbol, verbose, maxThreads)
+	if err != nil || res.Estimators == nil {
+		return res, err
+	}
+
+	res.PermutationSeed = seed.String()
+	for i := range res.Estimators {
+		if res.Estimators[i].Name == "Permutation Tests" {
+			res.Estimators[i].Passed = tally.AllDecided()
+		}
+	}
+	return res, nil
+}
+
+// sessionHandle buffers the samples of a stub NonIIDSession.
+type sessionHandle struct {
+	data          []byte
+	bitsPerSymbol int
+	verbose       int
+}
+
+func newSessionHandle(bitsPerSymbol int, verbose int) (*sessionHandle, error) {
+	return &sessionHandle{bitsPerSymbol: bitsPerSymbol, verbose: verbose}, nil
+}
+
+func (h *sessionHandle) feed(chunk []byte) error {
+	h.data = append(h.data, chunk...)
+	return nil
+}
+
+func (h *sessionHandle) finalize(ctx context.Context, maxThreads int) (*Result, error) {
+	data := h.data
+	h.data = nil
+	return calculateNonIIDEntropy(ctx, data, h.bitsPerSymbol, h.verbose, maxThreads)
+}
+
+func (h *sessionHandle) free() {
+	h.data = nil
+}
+
+// healthHandle counts the samples of a stub HealthMonitor; it never raises an alarm.
+type healthHandle struct {
+	state HealthCounters
+}
+
+func newHealthHandle(hMin float64, bitsPerSymbol int, alphaExponent int) (*healthHandle, error) {
+	if alphaExponent == 0 {
+		alphaExponent = DefaultHealthAlphaExponent
+	}
+	window := uint32(512)
+	if bitsPerSymbol == 1 {
+		window = 1024
+	}
+	return &healthHandle{state: HealthCounters{
+		RCTCutoff: 1 + uint32(math.Ceil(float64(alphaExponent)/hMin)),
+		APTCutoff: window,
+		APTWindow: window,
+	}}, nil
+}
+
+func (h *healthHandle) feed(chunk []byte) int {
+	h.state.Samples += uint64(len(chunk))
+	return 0
+}
+
+func (h *healthHandle) counters() HealthCounters {
+	return h.state
+}
+
+func (h *healthHandle) reset() {
+	h.state = HealthCounters{RCTCutoff: h.state.RCTCutoff, APTCutoff: h.state.APTCutoff, APTWindow: h.state.APTWindow}
+}
+
+func (h *healthHandle) free() {}
+
+// stubPermutationSeed is the permutation seed reported by stub IID results.
+const stubPermutationSeed = "0000000000000001000000000000000200000000000000030000000000000004"
+
+func toolVersion() string {
+	return "stub"
+}
+
+var stubInstrumentation atomic.Bool
+
+func setInstrumentation(enabled bool) {
+	stubInstrumentation.Store(enabled)
+}
+
+func setThreadBudget(threads int) {}
+
+func setScratchLimit(bytes int64) {}
+
+// stubInstrument attaches mock instrumentation to a stub result while
+// instrumentation is enabled.
+func stubInstrument(res *Result) *Result {
+	if !stubInstrumentation.Load() {
+		return res
+	}
+	for i := range res.Estimators {
+		res.Estimators[i].Stats = &EstimatorStats{WallSeconds: 0.01, CPUSeconds: 0.01, PeakBytes: 4096, Iterations: 4}
+	}
+	if res.TestType == IID {
+		res.Permutation = &PermutationStats{Executed: 12, DecidedAt: map[string]int{"excursion": 6, "compression": -1}}
+	}
+	return res
 }
@@ -1,6 +1,7 @@
 package entropy
 
 import (
+	"context"
 	"fmt"
 	"io"
 	"os"
@@ -12,6 +13,47 @@ const (
 	MinRecommendedSamples = 1000000
 )
 
+// SetInstrumentation enables or disables per-estimator instrumentation for
+// all subsequent assessments in the process. While enabled, every
+// EstimatorResult carries Stats and IID results carry Permutation; while
+// disabled (the default) the C++ library reads no clocks and counts no
+// allocations.
+func SetInstrumentation(enabled bool) {
+	setInstrumentation(enabled)
+}
+
+// SetThreadBudget sets the number of threads shared by all assessments that
+// run concurrently in the process. Each assessment is granted its fair share
+// of the budget when it starts, so concurrent requests do not oversubscribe
+// the host. A value of 0 (the default) uses OMP_NUM_THREADS, or one thread
+// per processor if that is unset.
+func SetThreadBudget(threads int) {
+	if threads < 0 {
+		threads = 0
+	}
+	setThreadBudget(threads)
+}
+
+// SetScratchLimit sets how many bytes of released estimator buffers (suffix
+// and LCP arrays, symbol and bit strings, permutation and compression
+// buffers) the process keeps for later assessments. Reusing them spares
+// steady-state assessments of similar inputs the cost of mapping and
+// faulting in fresh memory. A value of 0 releases and keeps none; the
+// default is 256 MiB.
+func SetScratchLimit(bytes int64) {
+	if bytes < 0 {
+		bytes = 0
+	}
+	setScratchLimit(bytes)
+}
+
+// ToolVersion returns the version of the SP 800-90B reference code that
+// produces the results. Results computed by different versions must not be
+// mixed, so result caches include it in their keys.
+func ToolVersion() string {
+	return toolVersion()
+}
+
 // AssessFile reads a binary file from disk and delegates to AssessReader for
 // entropy assessment using the specified test type and bits-per-symbol value.
 func (a *Assessment) AssessFile(filename string, bitsPerSymbol int, testType TestType) (*Result, error) {
@@ -46,6 +88,14 @@ func (a *Assessment) AssessReader(r io.Reader, bitsPerSymbol int, testType TestT
 // assessment. A bitsPerSymbol value of 0 triggers auto-detection; valid explicit
 // values are 1 through 8. The data slice must be non-empty.
 func (a *Assessment) AssessIID(data []byte, bitsPerSymbol int) (*Result, error) {
+	return a.AssessIIDContext(context.Background(), data, bitsPerSymbol)
+}
+
+// AssessIIDContext is like AssessIID, but abandons the assessment once ctx
+// is cancelled or its deadline passes. The C++ library checks for this at
+// coarse intervals inside its long-running loops, so it stops using CPU
+// shortly after; the returned error then wraps ErrCancelled.
+func (a *Assessment) AssessIIDContext(ctx context.Context, data []byte, bitsPerSymbol int) (*Result, error) {
 	if bitsPerSymbol < 0 || bitsPerSymbol > 8 {
 		return nil, newError("AssessIID", ErrInvalidBitsPerSymbol, fmt.Sprintf("got %d", bitsPerSymbol))
 	}
@@ -58,13 +108,23 @@ func (a *Assessment) AssessIID(data []byte, bitsPerSymbol int) (*Result, error)
 		fmt.Fprintf(os.Stderr, "Warning: data contains less than %d samples\n", MinRecommendedSamples)
 	}
 
-	return calculateIIDEntropy(data, bitsPerSymbol, a.verbose)
+	if err := ctx.Err(); err != nil {
+		return nil, cancelledError("AssessIID", err)
+	}
+
+	return calculateIIDEntropy(ctx, data, bitsPerSymbol, a.verbose, a.maxThreads)
 }
 
 // AssessNonIID performs a Non-IID entropy assessment using the ten estimators
 // defined in NIST SP 800-90B Section 6.3. A bitsPerSymbol value of 0 triggers
 // auto-detection; valid explicit values are 1 through 8.
 func (a *Assessment) AssessNonIID(data []byte, bitsPerSymbol int) (*Result, error) {
+	return a.AssessNonIIDContext(context.Background(), data, bitsPerSymbol)
+}
+
+// AssessNonIIDContext is like AssessNonIID, but abandons the assessment once
+// ctx is done, as described for AssessIIDContext.
+func (a *Assessment) AssessNonIIDContext(ctx context.Context, data []byte, bitsPerSymbol int) (*Result, error) {
 	if bitsPerSymbol < 0 || bitsPerSymbol > 8 {
 		return nil, newError("AssessNonIID", ErrInvalidBitsPerSymbol, fmt.Sprintf("got %d", bitsPerSymbol))
 	}
@@ -77,5 +137,60 @@ func (a *Assessment) AssessNonIID(data []byte, bitsPerSymbol int) (*Result, erro
 		fmt.Fprintf(os.Stderr, "Warning: data contains less than %d samples\n", MinRecommendedSamples)
 	}
 
-	return calculateNonIIDEntropy(data, bitsPerSymbol, a.verbose)
+	if err := ctx.Err(); err != nil {
+		return nil, cancelledError("AssessNonIID", err)
+	}
+
+	return calculateNonIIDEntropy(ctx, data, bitsPerSymbol, a.verbose, a.maxThreads)
+}
+
+// AssessBatch performs the assessments described by items in a single call
+// into the C++ library. Small items are assessed concurrently, which avoids
+// the per-call overhead of many short assessments. Each item is validated
+// like AssessIID or AssessNonIID; results[i] belongs to items[i], and an
+// invalid or failing item does not affect the others.
+func (a *Assessment) AssessBatch(items []BatchItem) []BatchResult {
+	return a.AssessBatchContext(context.Background(), items)
+}
+
+// AssessBatchContext is like AssessBatch, but abandons the batch once ctx is
+// done, as described for AssessIIDContext. Every item that had not finished
+// by then fails with an error wrapping ErrCancelled.
+func (a *Assessment) AssessBatchContext(ctx context.Context, items []BatchItem) []BatchResult {
+	results := make([]BatchResult, len(items))
+	valid := make([]BatchItem, 0, len(items))
+	index := make([]int, 0, len(items))
+
+	for i, item := range items {
+		switch {
+		case item.TestType != IID && item.TestType != NonIID:
+			results[i].Err = newError("AssessBatch", ErrInvalidData, "invalid test type")
+		case item.BitsPerSymbol < 0 || item.BitsPerSymbol > 8:
+			results[i].Err = newError("AssessBatch", ErrInvalidBitsPerSymbol, fmt.Sprintf("got %d", item.BitsPerSymbol))
+		case len(item.Data) == 0:
+			results[i].Err = newError("AssessBatch", ErrInvalidData, "data is empty")
+		default:
+			if len(item.Data) < MinRecommendedSamples && a.verbose > 0 {
+				fmt.Fprintf(os.Stderr, "Warning: data contains less than %d samples\n", MinRecommendedSamples)
+			}
+			valid = append(valid, item)
+			index = append(index, i)
+		}
+	}
+
+	if len(valid) == 0 {
+		return results
+	}
+
+	if err := ctx.Err(); err != nil {
+		for _, i := range index {
+			results[i].Err = cancelledError("AssessBatch", err)
+		}
+		return results
+	}
+
+	for j, res := range calculateBatch(ctx, valid, a.verbose, a.maxThreads) {
+		results[index[j]] = res
+	}
+	return results
 }
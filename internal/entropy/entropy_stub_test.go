@@ -3,6 +3,7 @@
 package entropy
 
 import (
+	"context"
 	"os"
 	"path/filepath"
 	"testing"
@@ -45,3 +46,160 @@ func TestAssessFile_SuccessStub(t *testing.T) {
 	assert.Equal(t, 7.5, res.MinEntropy)
 	assert.Equal(t, IID, res.TestType)
 }
+
+func TestAssessBatch_SuccessStub(t *testing.T) {
+	assessment := NewAssessment()
+	assessment.SetVerbose(0)
+
+	results := assessment.AssessBatch([]BatchItem{
+		{Data: []byte{1, 2, 3, 4}, BitsPerSymbol: 8, TestType: IID},
+		{Data: []byte{}, BitsPerSymbol: 8, TestType: IID},
+		{Data: []byte{1, 2, 3, 4}, BitsPerSymbol: 8, TestType: NonIID},
+		{Data: []byte{0xFF, 1, 2, 3}, BitsPerSymbol: 8, TestType: NonIID},
+	})
+	require.Len(t, results, 4)
+
+	require.NoError(t, results[0].Err)
+	assert.Equal(t, 7.5, results[0].Result.MinEntropy)
+	assert.Equal(t, IID, results[0].Result.TestType)
+
+	assert.ErrorIs(t, results[1].Err, ErrInvalidData)
+
+	require.NoError(t, results[2].Err)
+	assert.Equal(t, 6.5, results[2].Result.MinEntropy)
+	assert.Equal(t, NonIID, results[2].Result.TestType)
+
+	assert.Error(t, results[3].Err)
+	assert.Nil(t, results[3].Result)
+}
+
+func TestAssessContextCancelled_Stub(t *testing.T) {
+	assessment := NewAssessment()
+	assessment.SetVerbose(0)
+	ctx, cancel := context.WithCancel(context.Background())
+	cancel()
+
+	_, err := assessment.AssessIIDContext(ctx, []byte{1, 2, 3, 4}, 8)
+	assert.ErrorIs(t, err, ErrCancelled)
+
+	_, err = assessment.AssessNonIIDContext(ctx, []byte{1, 2, 3, 4}, 8)
+	assert.ErrorIs(t, err, ErrCancelled)
+
+	results := assessment.AssessBatchContext(ctx, []BatchItem{
+		{Data: []byte{1, 2, 3, 4}, BitsPerSymbol: 8, TestType: IID},
+	})
+	require.Len(t, results, 1)
+	assert.ErrorIs(t, results[0].Err, ErrCancelled)
+}
+
+func TestNonIIDSession_Stub(t *testing.T) {
+	assessment := NewAssessment()
+	assessment.SetVerbose(0)
+
+	session, err := assessment.NewNonIIDSession(8)
+	require.NoError(t, err)
+	defer session.Close()
+
+	require.NoError(t, session.Feed([]byte{1, 2}))
+	require.NoError(t, session.Feed(nil))
+	require.NoError(t, session.Feed([]byte{3, 4}))
+	assert.Equal(t, 4, session.Len())
+
+	res, err := session.Finalize(context.Background())
+	require.NoError(t, err)
+	assert.Equal(t, 6.5, res.MinEntropy)
+	assert.Equal(t, NonIID, res.TestType)
+
+	// A finalized session accepts neither samples nor a second Finalize
+	assert.ErrorIs(t, session.Feed([]byte{5}), ErrInvalidData)
+	_, err = session.Finalize(context.Background())
+	assert.ErrorIs(t, err, ErrInvalidData)
+	session.Close()
+}
+
+func TestNonIIDSession_ErrorsStub(t *testing.T) {
+	assessment := NewAssessment()
+	assessment.SetVerbose(0)
+
+	_, err := assessment.NewNonIIDSession(9)
+	assert.ErrorIs(t, err, ErrInvalidBitsPerSymbol)
+
+	empty, err := assessment.NewNonIIDSession(0)
+	require.NoError(t, err)
+	defer empty.Close()
+	_, err = empty.Finalize(context.Background())
+	assert.ErrorIs(t, err, ErrInvalidData)
+
+	cancelled, err := assessment.NewNonIIDSession(8)
+	require.NoError(t, err)
+	defer cancelled.Close()
+	require.NoError(t, cancelled.Feed([]byte{1, 2, 3, 4}))
+	ctx, cancel := context.WithCancel(context.Background())
+	cancel()
+	_, err = cancelled.Finalize(ctx)
+	assert.ErrorIs(t, err, ErrCancelled)
+}
+
+func TestSetInstrumentation_Stub(t *testing.T) {
+	assessment := NewAssessment()
+	assessment.SetVerbose(0)
+
+	SetInstrumentation(true)
+	defer SetInstrumentation(false)
+
+	res, err := assessment.AssessIID([]byte{1, 2, 3, 4}, 8)
+	require.NoError(t, err)
+	require.NotEmpty(t, res.Estimators)
+	for _, est := range res.Estimators {
+		assert.NotNil(t, est.Stats)
+	}
+	require.NotNil(t, res.Permutation)
+	assert.Equal(t, 6, res.Permutation.DecidedAt["excursion"])
+
+	SetInstrumentation(false)
+	res, err = assessment.AssessNonIID([]byte{1, 2, 3, 4}, 8)
+	require.NoError(t, err)
+	assert.Nil(t, res.Estimators[0].Stats)
+	assert.Nil(t, res.Permutation)
+}
+
+func TestPermutationTally_Stub(t *testing.T) {
+	assessment := NewAssessment()
+	shard := PermutationShard{FirstStream: 8, StreamCount: 2}
+	shard.Decided[3] = true
+
+	tally, err := assessment.PermutationTally(context.Background(), []byte{1, 2, 3, 4}, 8, shard)
+	require.NoError(t, err)
+	assert.Equal(t, [3]int{4, 2, 4}, tally.Counts[0])
+	assert.Equal(t, [3]int{}, tally.Counts[3])
+	assert.Equal(t, uint64(10), tally.Executed)
+
+	_, err = assessment.PermutationTally(context.Background(), []byte{0xFF, 1, 2, 3}, 8, shard)
+	assert.ErrorIs(t, err, ErrInvalidData)
+}
+
+func TestAssessIIDWithTally_Stub(t *testing.T) {
+	assessment := NewAssessment()
+	assessment.SetVerbose(0)
+	seed := PermutationSeed{5, 6, 7, 8}
+
+	tally, err := assessment.PermutationTally(context.Background(), []byte{1, 2, 3, 4}, 8, PermutationShard{Seed: seed, StreamCount: 4})
+	require.NoError(t, err)
+
+	res, err := assessment.AssessIIDWithTally(context.Background(), []byte{1, 2, 3, 4}, 8, seed, tally)
+	require.NoError(t, err)
+	assert.Equal(t, seed.String(), res.PermutationSeed)
+	for _, est := range res.Estimators {
+		if est.Name == "Permutation Tests" {
+			assert.True(t, est.Passed)
+		}
+	}
+
+	res, err = assessment.AssessIIDWithTally(context.Background(), []byte{1, 2, 3, 4}, 8, seed, &PermutationTally{})
+	require.NoError(t, err)
+	for _, est := range res.Estimators {
+		if est.Name == "Permutation Tests" {
+			assert.False(t, est.Passed)
+		}
+	}
+}
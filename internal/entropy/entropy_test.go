@@ -92,3 +92,22 @@ func TestAssessNonIID_EmptyData(t *testing.T) {
 	require.Error(t, err)
 	assert.Contains(t, err.Error(), "data is empty")
 }
+
+func TestAssessBatch_ValidationErrors(t *testing.T) {
+	assessment := NewAssessment()
+
+	results := assessment.AssessBatch([]BatchItem{
+		{Data: []byte{}, BitsPerSymbol: 8, TestType: IID},
+		{Data: []byte{1, 2, 3}, BitsPerSymbol: 9, TestType: NonIID},
+		{Data: []byte{1, 2, 3}, BitsPerSymbol: 8, TestType: TestType(99)},
+	})
+	require.Len(t, results, 3)
+	assert.ErrorIs(t, results[0].Err, ErrInvalidData)
+	assert.ErrorIs(t, results[1].Err, ErrInvalidBitsPerSymbol)
+	assert.ErrorIs(t, results[2].Err, ErrInvalidData)
+	for _, res := range results {
+		assert.Nil(t, res.Result)
+	}
+
+	assert.Empty(t, assessment.AssessBatch(nil))
+}
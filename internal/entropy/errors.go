@@ -13,8 +13,13 @@ var (
 	ErrInsufficientData     = errors.New("insufficient data for entropy assessment")
 	ErrCFunction            = errors.New("c library function error")
 	ErrMemoryAllocation     = errors.New("memory allocation failed")
+	ErrCancelled            = errors.New("assessment cancelled")
 )
 
+// codeCancelled is the C library error code of an assessment abandoned
+// because its context was cancelled or its deadline passed.
+const codeCancelled = -3
+
 // EntropyError provides structured error context for entropy assessment failures.
 // It records the operation name, the underlying cause, and an optional message.
 // It implements the error and Unwrap interfaces.
@@ -45,7 +50,17 @@ func newError(op string, err error, msg string) error {
 }
 
 // wrapCError wraps a C library error code and message into an EntropyError
-// with ErrCFunction as the underlying sentinel.
+// with ErrCFunction as the underlying sentinel, or ErrCancelled for
+// cancelled assessments.
 func wrapCError(op string, code int, message string) error {
+	if code == codeCancelled {
+		return newError(op, ErrCancelled, message)
+	}
 	return newError(op, ErrCFunction, fmt.Sprintf("code=%d, message=%s", code, message))
 }
+
+// cancelledError returns the error reported for an assessment whose context
+// is already done when it is requested.
+func cancelledError(op string, err error) error {
+	return newError(op, ErrCancelled, err.Error())
+}
@@ -74,6 +74,13 @@ func TestWrapCError(t *testing.T) {
 	assert.Contains(t, entropyErr.Msg, "memory allocation failed")
 }
 
+func TestWrapCErrorCancelled(t *testing.T) {
+	err := wrapCError("calculate_non_iid_entropy", codeCancelled, "Assessment deadline exceeded")
+
+	assert.ErrorIs(t, err, ErrCancelled)
+	assert.Contains(t, err.Error(), "Assessment deadline exceeded")
+}
+
 func TestPredefinedErrors(t *testing.T) {
 	// Test that predefined errors exist and have correct messages
 	assert.NotNil(t, ErrInvalidData)
@@ -90,4 +97,7 @@ func TestPredefinedErrors(t *testing.T) {
 
 	assert.NotNil(t, ErrMemoryAllocation)
 	assert.Equal(t, "memory allocation failed", ErrMemoryAllocation.Error())
+
+	assert.NotNil(t, ErrCancelled)
+	assert.Equal(t, "assessment cancelled", ErrCancelled.Error())
 }
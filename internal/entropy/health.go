@@ -0,0 +1,121 @@
+package entropy
+
+import (
+	"fmt"
+	"math"
+)
+
+// DefaultHealthAlphaExponent is the -log2 of the false positive probability
+// NewHealthMonitor uses when 0 is passed: alpha = 2^-20, as Section 4.4
+// recommends.
+const DefaultHealthAlphaExponent = 20
+
+// maxHealthAlphaExponent is the largest -log2(alpha) the C++ library accepts.
+const maxHealthAlphaExponent = 64
+
+// maxHealthRCTCutoff is the largest Repetition Count Test cutoff the C++
+// library can hold.
+const maxHealthRCTCutoff = math.MaxUint32
+
+// HealthCounters holds the state of a HealthMonitor.
+type HealthCounters struct {
+	Samples        uint64 // Samples processed
+	RCTAlarms      uint64 // Runs that reached the Repetition Count Test cutoff
+	APTAlarms      uint64 // Windows that reached the Adaptive Proportion Test cutoff
+	APTWindows     uint64 // Adaptive Proportion Test windows completed
+	LongestRun     uint64 // Longest run of identical samples
+	MaxWindowCount uint32 // Largest count of the first sample of a completed window
+	RCTCutoff      uint32 // Repetition Count Test cutoff C
+	APTCutoff      uint32 // Adaptive Proportion Test cutoff C
+	APTWindow      uint32 // Adaptive Proportion Test window size W
+}
+
+// HealthMonitor runs the SP 800-90B Section 4.4 continuous health tests, the
+// Repetition Count Test and the Adaptive Proportion Test, on the live output
+// of one noise source. It keeps constant state however long the stream, and
+// the counters do not depend on how the stream is split into chunks.
+//
+// A HealthMonitor is not safe for concurrent use; different monitors may be
+// fed concurrently. Close must be called once the monitor is no longer
+// needed.
+type HealthMonitor struct {
+	handle *healthHandle
+	closed bool
+}
+
+// NewHealthMonitor starts monitoring a source with min-entropy hMin per
+// sample, such as the HAssessed value of an assessment of the source. Each
+// sample byte is masked to its bitsPerSymbol (1 through 8) low bits; 1 selects
+// the binary Adaptive Proportion Test window of 1024 samples, other widths
+// the window of 512 samples. Each test raises false alarms with probability
+// 2^-alphaExponent (1 through 64), or DefaultHealthAlphaExponent if
+// alphaExponent is 0. hMin must leave the Repetition Count Test cutoff
+// 1 + ceil(alphaExponent / hMin) within a uint32.
+func NewHealthMonitor(hMin float64, bitsPerSymbol int, alphaExponent int) (*HealthMonitor, error) {
+	if bitsPerSymbol < 1 || bitsPerSymbol > 8 {
+		return nil, newError("NewHealthMonitor", ErrInvalidBitsPerSymbol, fmt.Sprintf("got %d", bitsPerSymbol))
+	}
+	if !(hMin > 0) || hMin > float64(bitsPerSymbol) {
+		return nil, newError("NewHealthMonitor", ErrInvalidData, fmt.Sprintf("min-entropy %g is not in (0, %d]", hMin, bitsPerSymbol))
+	}
+	if alphaExponent < 0 || alphaExponent > maxHealthAlphaExponent {
+		return nil, newError("NewHealthMonitor", ErrInvalidData, fmt.Sprintf("alpha exponent %d is not in [0, %d]", alphaExponent, maxHealthAlphaExponent))
+	}
+	if !rctCutoffFits(hMin, alphaExponent) {
+		return nil, newError("NewHealthMonitor", ErrInvalidData, fmt.Sprintf("min-entropy %g gives a Repetition Count Test cutoff above %d", hMin, uint32(maxHealthRCTCutoff)))
+	}
+
+	handle, err := newHealthHandle(hMin, bitsPerSymbol, alphaExponent)
+	if err != nil {
+		return nil, err
+	}
+	return &HealthMonitor{handle: handle}, nil
+}
+
+// rctCutoffFits reports whether the Repetition Count Test cutoff
+// 1 + ceil(alphaExponent / hMin) is at most maxHealthRCTCutoff, with the same
+// floating point test as the C++ library.
+func rctCutoffFits(hMin float64, alphaExponent int) bool {
+	if alphaExponent == 0 {
+		alphaExponent = DefaultHealthAlphaExponent
+	}
+	return float64(alphaExponent)/hMin <= maxHealthRCTCutoff-1
+}
+
+// Feed runs the health tests on the next samples of the source and returns
+// the number of alarms they raised. A run of identical samples raises one
+// alarm when it reaches the Repetition Count Test cutoff, however much
+// longer it gets, and a window raises at most one Adaptive Proportion Test
+// alarm.
+func (m *HealthMonitor) Feed(chunk []byte) (int, error) {
+	if m.closed {
+		return 0, newError("HealthMonitor.Feed", ErrInvalidData, "monitor is closed")
+	}
+	if len(chunk) == 0 {
+		return 0, nil
+	}
+	return m.handle.feed(chunk), nil
+}
+
+// Counters returns the counters and cutoffs of the monitor.
+func (m *HealthMonitor) Counters() HealthCounters {
+	if m.closed {
+		return HealthCounters{}
+	}
+	return m.handle.counters()
+}
+
+// Reset restarts the monitor, as after the source recovered from an alarm:
+// the current run and window are forgotten and the counters zeroed, while
+// the cutoffs are kept.
+func (m *HealthMonitor) Reset() {
+	if !m.closed {
+		m.handle.reset()
+	}
+}
+
+// Close releases the monitor. It is safe to call more than once.
+func (m *HealthMonitor) Close() {
+	m.closed = true
+	m.handle.free()
+}
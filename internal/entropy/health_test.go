@@ -0,0 +1,60 @@
+package entropy
+
+import (
+	"errors"
+	"math"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+func TestNewHealthMonitor_InvalidParameters(t *testing.T) {
+	for _, tc := range []struct {
+		hMin          float64
+		bitsPerSymbol int
+		alphaExponent int
+		want          error
+	}{
+		{1, 0, 0, ErrInvalidBitsPerSymbol},
+		{1, 9, 0, ErrInvalidBitsPerSymbol},
+		{0, 8, 0, ErrInvalidData},
+		{-1, 8, 0, ErrInvalidData},
+		{math.NaN(), 8, 0, ErrInvalidData},
+		{1.5, 1, 0, ErrInvalidData},
+		{1, 8, -1, ErrInvalidData},
+		{1, 8, 65, ErrInvalidData},
+		{1e-9, 8, 0, ErrInvalidData},
+		{math.SmallestNonzeroFloat64, 1, 1, ErrInvalidData},
+	} {
+		monitor, err := NewHealthMonitor(tc.hMin, tc.bitsPerSymbol, tc.alphaExponent)
+		assert.Nil(t, monitor)
+		assert.True(t, errors.Is(err, tc.want), "h=%g bits=%d alpha=%d: %v", tc.hMin, tc.bitsPerSymbol, tc.alphaExponent, err)
+	}
+}
+
+func TestHealthMonitor_Lifecycle(t *testing.T) {
+	monitor, err := NewHealthMonitor(2, 8, 0)
+	require.NoError(t, err)
+
+	alarms, err := monitor.Feed(nil)
+	require.NoError(t, err)
+	assert.Equal(t, 0, alarms)
+
+	_, err = monitor.Feed([]byte{1, 2, 3})
+	require.NoError(t, err)
+	counters := monitor.Counters()
+	assert.Equal(t, uint64(3), counters.Samples)
+	assert.Equal(t, uint32(11), counters.RCTCutoff)
+	assert.Equal(t, uint32(512), counters.APTWindow)
+
+	monitor.Reset()
+	assert.Equal(t, uint64(0), monitor.Counters().Samples)
+	assert.Equal(t, counters.RCTCutoff, monitor.Counters().RCTCutoff)
+
+	monitor.Close()
+	monitor.Close()
+	_, err = monitor.Feed([]byte{1})
+	assert.True(t, errors.Is(err, ErrInvalidData))
+	assert.Equal(t, HealthCounters{}, monitor.Counters())
+}
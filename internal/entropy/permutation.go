@@ -0,0 +1,158 @@
+package entropy
+
+import (
+	"context"
+	"crypto/rand"
+	"encoding/binary"
+	"fmt"
+	"os"
+)
+
+const (
+	// PermutationStreams is the number of RNG streams the rounds of the IID
+	// permutation tests are split into. Stream k runs its own block of
+	// rounds from the seed jumped k * 2^128 calls ahead, so ranges of streams
+	// can be run by different processes and their tallies merged.
+	PermutationStreams = 64
+
+	// PermutationStatistics is the number of statistics evaluated by the IID
+	// permutation tests.
+	PermutationStatistics = 19
+)
+
+// PermutationSeed is the xoshiro256** seed of the IID permutation tests.
+type PermutationSeed [4]uint64
+
+// NewPermutationSeed draws a seed from the operating system's random number
+// generator.
+func NewPermutationSeed() (PermutationSeed, error) {
+	var buf [32]byte
+	var seed PermutationSeed
+
+	if _, err := rand.Read(buf[:]); err != nil {
+		return seed, newError("NewPermutationSeed", err, "failed to read random seed")
+	}
+	for i := range seed {
+		seed[i] = binary.LittleEndian.Uint64(buf[8*i:])
+	}
+	return seed, nil
+}
+
+// String hex-encodes the seed in the format of Result.PermutationSeed.
+func (s PermutationSeed) String() string {
+	return fmt.Sprintf("%016x%016x%016x%016x", s[0], s[1], s[2], s[3])
+}
+
+// PermutationShard selects the permutation test rounds run by
+// PermutationTally: those of streams FirstStream to
+// FirstStream+StreamCount-1 of the tests seeded with Seed.
+type PermutationShard struct {
+	Seed        PermutationSeed
+	FirstStream int
+	StreamCount int
+
+	// Decided flags the statistics that the tallies gathered so far already
+	// decide; they are left out of the rounds. The order is that of the
+	// reference tool output (excursion first, compression last).
+	Decided [PermutationStatistics]bool
+}
+
+// PermutationTally holds the outcomes of the permutation test rounds of some
+// streams. Tallies of disjoint streams of the same data and seed are merged
+// with Add.
+type PermutationTally struct {
+	// Counts[i] counts the rounds in which permuted statistic i was greater
+	// than, equal to and less than the unpermuted one.
+	Counts [PermutationStatistics][3]int
+
+	Executed uint64 // Permutations run
+}
+
+// Add merges the outcomes of other into t.
+func (t *PermutationTally) Add(other *PermutationTally) {
+	for i := range t.Counts {
+		for j := range t.Counts[i] {
+			t.Counts[i][j] += other.Counts[i][j]
+		}
+	}
+	t.Executed += other.Executed
+}
+
+// Decided reports which statistics the tally decides: those whose permuted
+// values were more than 5 times at least as large, and more than 5 times at
+// most as large, as the unpermuted one.
+func (t *PermutationTally) Decided() [PermutationStatistics]bool {
+	var decided [PermutationStatistics]bool
+	for i, c := range t.Counts {
+		decided[i] = c[0]+c[1] > 5 && c[1]+c[2] > 5
+	}
+	return decided
+}
+
+// AllDecided reports whether the tally decides every statistic, in which
+// case the permutation tests pass and no further rounds are needed.
+func (t *PermutationTally) AllDecided() bool {
+	for _, decided := range t.Decided() {
+		if !decided {
+			return false
+		}
+	}
+	return true
+}
+
+// PermutationTally runs the permutation test rounds selected by shard on
+// data, with the thread limit of a. A stream stops early once its own
+// outcomes decide every statistic it runs, so merging the tallies of all
+// PermutationStreams streams decides the same statistics as AssessIID with
+// the same seed. It is abandoned once ctx is done, as described for
+// AssessIIDContext.
+func (a *Assessment) PermutationTally(ctx context.Context, data []byte, bitsPerSymbol int, shard PermutationShard) (*PermutationTally, error) {
+	if bitsPerSymbol < 0 || bitsPerSymbol > 8 {
+		return nil, newError("PermutationTally", ErrInvalidBitsPerSymbol, fmt.Sprintf("got %d", bitsPerSymbol))
+	}
+
+	if len(data) == 0 {
+		return nil, newError("PermutationTally", ErrInvalidData, "data is empty")
+	}
+
+	if shard.FirstStream < 0 || shard.StreamCount < 1 || shard.StreamCount > PermutationStreams-shard.FirstStream {
+		return nil, newError("PermutationTally", ErrInvalidData,
+			fmt.Sprintf("streams %d to %d are out of range", shard.FirstStream, shard.FirstStream+shard.StreamCount-1))
+	}
+
+	if err := ctx.Err(); err != nil {
+		return nil, cancelledError("PermutationTally", err)
+	}
+
+	return calculatePermutationTally(ctx, data, bitsPerSymbol, shard, a.maxThreads)
+}
+
+// AssessIIDWithTally performs an IID assessment whose permutation test
+// rounds were run by PermutationTally with seed, possibly on other hosts.
+// tally holds the merged tallies of all streams, or of the streams run until
+// every statistic was decided. The other tests run as in AssessIID, and the
+// result is that of AssessIID with seed; only the instrumentation differs,
+// as the decision points of the statistics are not known.
+func (a *Assessment) AssessIIDWithTally(ctx context.Context, data []byte, bitsPerSymbol int, seed PermutationSeed, tally *PermutationTally) (*Result, error) {
+	if bitsPerSymbol < 0 || bitsPerSymbol > 8 {
+		return nil, newError("AssessIIDWithTally", ErrInvalidBitsPerSymbol, fmt.Sprintf("got %d", bitsPerSymbol))
+	}
+
+	if len(data) == 0 {
+		return nil, newError("AssessIIDWithTally", ErrInvalidData, "data is empty")
+	}
+
+	if tally == nil {
+		return nil, newError("AssessIIDWithTally", ErrInvalidData, "tally is nil")
+	}
+
+	if len(data) < MinRecommendedSamples && a.verbose > 0 {
+		fmt.Fprintf(os.Stderr, "Warning: data contains less than %d samples\n", MinRecommendedSamples)
+	}
+
+	if err := ctx.Err(); err != nil {
+		return nil, cancelledError("AssessIIDWithTally", err)
+	}
+
+	return calculateIIDEntropyWithTally(ctx, data, bitsPerSymbol, a.verbose, a.maxThreads, seed, tally)
+}
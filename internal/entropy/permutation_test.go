@@ -0,0 +1,86 @@
+package entropy
+
+import (
+	"context"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+func TestPermutationTally_AddAndDecided(t *testing.T) {
+	var tally PermutationTally
+	assert.False(t, tally.AllDecided())
+
+	var part PermutationTally
+	for i := range part.Counts {
+		part.Counts[i] = [3]int{3, 0, 3}
+	}
+	part.Counts[4] = [3]int{6, 0, 0} // Never at most as large
+	part.Executed = 10
+
+	tally.Add(&part)
+	decided := tally.Decided()
+	assert.False(t, decided[0]) // 3 + 0 is not more than 5
+	assert.False(t, tally.AllDecided())
+
+	tally.Add(&part)
+	decided = tally.Decided()
+	assert.True(t, decided[0])
+	assert.False(t, decided[4])
+	assert.False(t, tally.AllDecided())
+	assert.Equal(t, uint64(20), tally.Executed)
+
+	tally.Counts[4] = [3]int{6, 0, 6}
+	assert.True(t, tally.AllDecided())
+}
+
+func TestPermutationSeed(t *testing.T) {
+	seed := PermutationSeed{1, 2, 3, 0xfedcba9876543210}
+	assert.Equal(t, "000000000000000100000000000000020000000000000003fedcba9876543210", seed.String())
+
+	a, err := NewPermutationSeed()
+	require.NoError(t, err)
+	b, err := NewPermutationSeed()
+	require.NoError(t, err)
+	assert.NotEqual(t, a, b)
+}
+
+func TestPermutationTally_Validation(t *testing.T) {
+	assessment := NewAssessment()
+	ctx := context.Background()
+
+	_, err := assessment.PermutationTally(ctx, []byte{1, 2}, 9, PermutationShard{StreamCount: 1})
+	assert.ErrorIs(t, err, ErrInvalidBitsPerSymbol)
+
+	_, err = assessment.PermutationTally(ctx, nil, 8, PermutationShard{StreamCount: 1})
+	assert.ErrorIs(t, err, ErrInvalidData)
+
+	for _, shard := range []PermutationShard{
+		{FirstStream: -1, StreamCount: 1},
+		{FirstStream: 0, StreamCount: 0},
+		{FirstStream: PermutationStreams - 1, StreamCount: 2},
+	} {
+		_, err = assessment.PermutationTally(ctx, []byte{1, 2}, 8, shard)
+		assert.ErrorIs(t, err, ErrInvalidData)
+	}
+
+	cancelled, cancel := context.WithCancel(ctx)
+	cancel()
+	_, err = assessment.PermutationTally(cancelled, []byte{1, 2}, 8, PermutationShard{StreamCount: 1})
+	assert.ErrorIs(t, err, ErrCancelled)
+}
+
+func TestAssessIIDWithTally_Validation(t *testing.T) {
+	assessment := NewAssessment()
+	ctx := context.Background()
+
+	_, err := assessment.AssessIIDWithTally(ctx, []byte{1, 2}, 9, PermutationSeed{}, &PermutationTally{})
+	assert.ErrorIs(t, err, ErrInvalidBitsPerSymbol)
+
+	_, err = assessment.AssessIIDWithTally(ctx, nil, 8, PermutationSeed{}, &PermutationTally{})
+	assert.ErrorIs(t, err, ErrInvalidData)
+
+	_, err = assessment.AssessIIDWithTally(ctx, []byte{1, 2}, 8, PermutationSeed{}, nil)
+	assert.ErrorIs(t, err, ErrInvalidData)
+}
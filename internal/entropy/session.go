@@ -0,0 +1,99 @@
+package entropy
+
+import (
+	"context"
+	"fmt"
+	"os"
+)
+
+// NonIIDSession is a Non-IID assessment whose samples arrive in chunks, for
+// captures that are uploaded or read piece by piece. The chunks are copied
+// into memory owned by the C++ library as they are fed, so the caller does
+// not need to keep them. With an explicit bitsPerSymbol the bitstring MCV,
+// Collision, Markov, Compression, MultiMCW and Lag estimates run as the
+// chunks are fed. The other estimators need the complete capture (the symbol
+// alphabet, the detected word size and all their statistics depend on every
+// sample), so they run when the session is finalized; the result is
+// identical to that of AssessNonIID on the concatenated chunks.
+//
+// A NonIIDSession is not safe for concurrent use. Close must be called once
+// the session is no longer needed, also after Finalize.
+type NonIIDSession struct {
+	handle     *sessionHandle
+	maxThreads int
+	verbose    int
+	length     int
+	finalized  bool
+}
+
+// NewNonIIDSession starts a streaming Non-IID assessment with the verbosity
+// and thread limit of a. A bitsPerSymbol value of 0 triggers auto-detection;
+// valid explicit values are 1 through 8.
+func (a *Assessment) NewNonIIDSession(bitsPerSymbol int) (*NonIIDSession, error) {
+	if bitsPerSymbol < 0 || bitsPerSymbol > 8 {
+		return nil, newError("NewNonIIDSession", ErrInvalidBitsPerSymbol, fmt.Sprintf("got %d", bitsPerSymbol))
+	}
+
+	handle, err := newSessionHandle(bitsPerSymbol, a.verbose)
+	if err != nil {
+		return nil, err
+	}
+
+	return &NonIIDSession{
+		handle:     handle,
+		maxThreads: a.maxThreads,
+		verbose:    a.verbose,
+	}, nil
+}
+
+// Feed appends chunk to the samples of the session. Empty chunks are ignored.
+func (s *NonIIDSession) Feed(chunk []byte) error {
+	if s.finalized {
+		return newError("NonIIDSession.Feed", ErrInvalidData, "session is already finalized")
+	}
+	if len(chunk) == 0 {
+		return nil
+	}
+
+	if err := s.handle.feed(chunk); err != nil {
+		return err
+	}
+	s.length += len(chunk)
+	return nil
+}
+
+// Len returns the number of samples fed so far.
+func (s *NonIIDSession) Len() int {
+	return s.length
+}
+
+// Finalize assesses the samples fed to the session and releases them. It is
+// abandoned once ctx is done, as described for AssessIIDContext. A session
+// can be finalized only once, whether or not the assessment succeeds.
+func (s *NonIIDSession) Finalize(ctx context.Context) (*Result, error) {
+	if s.finalized {
+		return nil, newError("NonIIDSession.Finalize", ErrInvalidData, "session is already finalized")
+	}
+	s.finalized = true
+
+	if s.length == 0 {
+		return nil, newError("NonIIDSession.Finalize", ErrInvalidData, "data is empty")
+	}
+
+	if s.length < MinRecommendedSamples && s.verbose > 0 {
+		fmt.Fprintf(os.Stderr, "Warning: data contains less than %d samples\n", MinRecommendedSamples)
+	}
+
+	if err := ctx.Err(); err != nil {
+		return nil, cancelledError("NonIIDSession.Finalize", err)
+	}
+
+	return s.handle.finalize(ctx, s.maxThreads)
+}
+
+// Close releases the session and any samples it still holds. It is safe to
+// call more than once.
+func (s *NonIIDSession) Close() {
+	s.finalized = true
+	s.handle.free()
+}
@@ -34,6 +34,27 @@ type EstimatorResult struct {
 	EntropyEstimate float64 // Entropy estimate in bits per sample, or -1.0 if not applicable
 	Passed          bool    // Whether the test passed
 	IsEntropyValid  bool    // Indicates whether EntropyEstimate holds a meaningful value
+
+	Stats *EstimatorStats // Instrumentation, nil unless enabled with SetInstrumentation
+}
+
+// EstimatorStats contains the instrumentation of a single estimator. For
+// estimators run on both the bitstring and the literal symbols, times and
+// iterations are summed over both runs and PeakBytes is the larger peak.
+type EstimatorStats struct {
+	WallSeconds float64 // Elapsed wall-clock time
+	CPUSeconds  float64 // CPU time of the thread running the estimator
+	PeakBytes   uint64  // Peak scratch buffer bytes allocated by that thread
+	Iterations  uint64  // Samples processed, or permutations for the permutation tests
+}
+
+// PermutationStats contains the instrumentation of the IID permutation tests.
+type PermutationStats struct {
+	Executed uint64 // Permutations shuffled and tested
+
+	// DecidedAt maps each statistic to the number of permutations counted
+	// when it was decided, or -1 if it never was.
+	DecidedAt map[string]int
 }
 
 // Result contains the aggregate entropy assessment output. HOriginal is the
@@ -49,12 +70,33 @@ type Result struct {
 	TestType     TestType // IID or NonIID
 
 	Estimators []EstimatorResult // Individual estimator results
+
+	Permutation *PermutationStats // IID permutation test instrumentation, nil unless enabled
+
+	// PermutationSeed is the hex-encoded xoshiro256** seed the IID
+	// permutation tests were run with, or empty for Non-IID results.
+	PermutationSeed string
+}
+
+// BatchItem describes one assessment of an AssessBatch call.
+type BatchItem struct {
+	Data          []byte   // Raw sample bytes, one sample per byte
+	BitsPerSymbol int      // Bits per symbol (1-8), or 0 for auto-detection
+	TestType      TestType // IID or NonIID
+}
+
+// BatchResult holds the outcome of one BatchItem. Exactly one of Result and
+// Err is set.
+type BatchResult struct {
+	Result *Result
+	Err    error
 }
 
 // Assessment holds configuration for entropy estimation and serves as the
 // primary entry point for running IID and Non-IID assessments.
 type Assessment struct {
-	verbose int
+	verbose    int
+	maxThreads int
 }
 
 // NewAssessment creates a new Assessment instance with default configuration.
@@ -80,3 +122,18 @@ func (a *Assessment) SetVerbose(level int) {
 func (a *Assessment) GetVerbose() int {
 	return a.verbose
 }
+
+// SetMaxThreads limits the number of threads a single assessment may use.
+// The default of 0 leaves each assessment its fair share of the process-wide
+// thread budget (see SetThreadBudget); negative values are treated as 0.
+func (a *Assessment) SetMaxThreads(threads int) {
+	if threads < 0 {
+		threads = 0
+	}
+	a.maxThreads = threads
+}
+
+// GetMaxThreads returns the per-assessment thread limit, 0 if unlimited.
+func (a *Assessment) GetMaxThreads() int {
+	return a.maxThreads
+}
@@ -51,6 +51,18 @@ func TestAssessment_SetVerbose(t *testing.T) {
 	assert.Equal(t, 3, assessment.GetVerbose())
 }
 
+func TestAssessment_SetMaxThreads(t *testing.T) {
+	assessment := NewAssessment()
+	assert.Equal(t, 0, assessment.GetMaxThreads())
+
+	assessment.SetMaxThreads(4)
+	assert.Equal(t, 4, assessment.GetMaxThreads())
+
+	// Test clamping negative
+	assessment.SetMaxThreads(-2)
+	assert.Equal(t, 0, assessment.GetMaxThreads())
+}
+
 func TestResult(t *testing.T) {
 	result := &Result{
 		MinEntropy:   7.5,
@@ -57,6 +57,70 @@ var (
 		},
 		[]string{"test_type"},
 	)
+
+	// EstimatorDurationSeconds measures the wall-clock time of individual
+	// estimators. Only observed while estimator instrumentation is enabled.
+	EstimatorDurationSeconds = promauto.NewHistogramVec(
+		prometheus.HistogramOpts{
+			Name:    "entropy_estimator_duration_seconds",
+			Help:    "Wall-clock time of individual estimators in seconds",
+			Buckets: prometheus.ExponentialBuckets(0.001, 2, 15), // 1ms to ~16s
+		},
+		[]string{"test_type", "estimator"},
+	)
+
+	// EstimatorCPUSeconds measures the CPU time of individual estimators.
+	EstimatorCPUSeconds = promauto.NewHistogramVec(
+		prometheus.HistogramOpts{
+			Name:    "entropy_estimator_cpu_seconds",
+			Help:    "CPU time of individual estimators in seconds",
+			Buckets: prometheus.ExponentialBuckets(0.001, 2, 15), // 1ms to ~16s
+		},
+		[]string{"test_type", "estimator"},
+	)
+
+	// EstimatorPeakBytes tracks the peak scratch buffer allocation of individual estimators.
+	EstimatorPeakBytes = promauto.NewHistogramVec(
+		prometheus.HistogramOpts{
+			Name:    "entropy_estimator_peak_bytes",
+			Help:    "Peak scratch buffer bytes allocated by individual estimators",
+			Buckets: prometheus.ExponentialBuckets(1024, 4, 12), // 1KB to ~4GB
+		},
+		[]string{"test_type", "estimator"},
+	)
+
+	// EstimatorIterations tracks the samples processed by individual
+	// estimators, or the permutations run by the permutation tests.
+	EstimatorIterations = promauto.NewHistogramVec(
+		prometheus.HistogramOpts{
+			Name:    "entropy_estimator_iterations",
+			Help:    "Samples processed (permutations for the permutation tests) by individual estimators",
+			Buckets: prometheus.ExponentialBuckets(10, 10, 9), // 10 to 1e9
+		},
+		[]string{"test_type", "estimator"},
+	)
+
+	// PermutationDecisionRound tracks after how many permutations each
+	// permutation test statistic was decided. Undecided statistics are not
+	// observed.
+	PermutationDecisionRound = promauto.NewHistogramVec(
+		prometheus.HistogramOpts{
+			Name:    "entropy_permutation_decision_round",
+			Help:    "Permutations counted when a permutation test statistic was decided",
+			Buckets: prometheus.ExponentialBuckets(8, 2, 11), // 8 to 8192
+		},
+		[]string{"statistic"},
+	)
+
+	// CacheLookupsTotal counts result cache lookups, partitioned by test type
+	// and by whether the result was found.
+	CacheLookupsTotal = promauto.NewCounterVec(
+		prometheus.CounterOpts{
+			Name: "entropy_result_cache_lookups_total",
+			Help: "Total number of result cache lookups",
+		},
+		[]string{"test_type", "result"}, // result is hit or miss
+	)
 )
 
 // RecordRequest increments the request counter for the given test type.
@@ -83,3 +147,26 @@ func RecordDataSize(testType string, sizeBytes int) {
 func RecordMinEntropy(testType string, value float64) {
 	MinEntropyValue.WithLabelValues(testType).Observe(value)
 }
+
+// RecordEstimatorStats records the instrumentation of a single estimator.
+func RecordEstimatorStats(testType, estimator string, wallSeconds, cpuSeconds float64, peakBytes, iterations uint64) {
+	EstimatorDurationSeconds.WithLabelValues(testType, estimator).Observe(wallSeconds)
+	EstimatorCPUSeconds.WithLabelValues(testType, estimator).Observe(cpuSeconds)
+	EstimatorPeakBytes.WithLabelValues(testType, estimator).Observe(float64(peakBytes))
+	EstimatorIterations.WithLabelValues(testType, estimator).Observe(float64(iterations))
+}
+
+// RecordPermutationDecision records the permutation after which a permutation
+// test statistic was decided.
+func RecordPermutationDecision(statistic string, round int) {
+	PermutationDecisionRound.WithLabelValues(statistic).Observe(float64(round))
+}
+
+// RecordCacheLookup increments the result cache lookup counter.
+func RecordCacheLookup(testType string, hit bool) {
+	result := "miss"
+	if hit {
+		result = "hit"
+	}
+	CacheLookupsTotal.WithLabelValues(testType, result).Inc()
+}
@@ -72,6 +72,42 @@ func TestRecordMinEntropy(t *testing.T) {
 	assert.True(t, true)
 }
 
+func TestRecordEstimatorStats(t *testing.T) {
+	EstimatorDurationSeconds.Reset()
+	EstimatorCPUSeconds.Reset()
+	EstimatorPeakBytes.Reset()
+	EstimatorIterations.Reset()
+
+	RecordEstimatorStats("Non-IID", "LZ78Y Test", 0.8, 0.3, 7872488, 900000)
+	RecordEstimatorStats("Non-IID", "LZ78Y Test", 0.9, 0.4, 7872488, 900000)
+	RecordEstimatorStats("IID", "Permutation Tests", 2.4, 2.4, 961296, 636)
+
+	assert.Equal(t, 2, testutil.CollectAndCount(EstimatorDurationSeconds))
+	assert.Equal(t, 2, testutil.CollectAndCount(EstimatorCPUSeconds))
+	assert.Equal(t, 2, testutil.CollectAndCount(EstimatorPeakBytes))
+	assert.Equal(t, 2, testutil.CollectAndCount(EstimatorIterations))
+}
+
+func TestRecordPermutationDecision(t *testing.T) {
+	PermutationDecisionRound.Reset()
+
+	RecordPermutationDecision("excursion", 229)
+	RecordPermutationDecision("compression", 12)
+
+	assert.Equal(t, 2, testutil.CollectAndCount(PermutationDecisionRound))
+}
+
+func TestRecordCacheLookup(t *testing.T) {
+	CacheLookupsTotal.Reset()
+
+	RecordCacheLookup("IID", true)
+	RecordCacheLookup("IID", true)
+	RecordCacheLookup("IID", false)
+
+	assert.Equal(t, 2.0, testutil.ToFloat64(CacheLookupsTotal.WithLabelValues("IID", "hit")))
+	assert.Equal(t, 1.0, testutil.ToFloat64(CacheLookupsTotal.WithLabelValues("IID", "miss")))
+}
+
 func TestMetricsInitialization(t *testing.T) {
 	// Verify that all metrics are properly initialized
 	assert.NotNil(t, RequestsTotal)
@@ -79,4 +115,10 @@ func TestMetricsInitialization(t *testing.T) {
 	assert.NotNil(t, ErrorsTotal)
 	assert.NotNil(t, DataSizeBytes)
 	assert.NotNil(t, MinEntropyValue)
+	assert.NotNil(t, EstimatorDurationSeconds)
+	assert.NotNil(t, EstimatorCPUSeconds)
+	assert.NotNil(t, EstimatorPeakBytes)
+	assert.NotNil(t, EstimatorIterations)
+	assert.NotNil(t, PermutationDecisionRound)
+	assert.NotNil(t, CacheLookupsTotal)
 }
@@ -0,0 +1,47 @@
+package middleware
+
+import (
+	"context"
+
+	"google.golang.org/grpc"
+)
+
+// StreamFromUnary adapts a unary interceptor to streaming RPCs, so that
+// request identification, logging and authentication apply to them without
+// a second implementation. The interceptor sees the method name and a nil
+// request, since the messages of a stream are only read by its handler.
+// The context the interceptor passes on becomes the context of the stream.
+func StreamFromUnary(interceptor grpc.UnaryServerInterceptor) grpc.StreamServerInterceptor {
+	return func(
+		srv interface{},
+		ss grpc.ServerStream,
+		info *grpc.StreamServerInfo,
+		handler grpc.StreamHandler,
+	) error {
+		unaryInfo := &grpc.UnaryServerInfo{Server: srv, FullMethod: info.FullMethod}
+		_, err := interceptor(ss.Context(), nil, unaryInfo, func(ctx context.Context, _ interface{}) (interface{}, error) {
+			return nil, handler(srv, &contextStream{ServerStream: ss, ctx: ctx})
+		})
+		return err
+	}
+}
+
+// StreamFromUnaryChain adapts each interceptor of a unary chain with
+// StreamFromUnary, keeping their order.
+func StreamFromUnaryChain(interceptors []grpc.UnaryServerInterceptor) []grpc.StreamServerInterceptor {
+	streams := make([]grpc.StreamServerInterceptor, len(interceptors))
+	for i, interceptor := range interceptors {
+		streams[i] = StreamFromUnary(interceptor)
+	}
+	return streams
+}
+
+// contextStream is a grpc.ServerStream with a replaced context.
+type contextStream struct {
+	grpc.ServerStream
+	ctx context.Context
+}
+
+func (s *contextStream) Context() context.Context {
+	return s.ctx
+}
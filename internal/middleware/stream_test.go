@@ -0,0 +1,58 @@
+package middleware
+
+import (
+	"context"
+	"errors"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+	"google.golang.org/grpc"
+)
+
+// fakeServerStream is a grpc.ServerStream that only carries a context.
+type fakeServerStream struct {
+	grpc.ServerStream
+	ctx context.Context
+}
+
+func (s *fakeServerStream) Context() context.Context {
+	return s.ctx
+}
+
+func TestStreamFromUnaryPassesInterceptorContext(t *testing.T) {
+	interceptor := StreamFromUnary(UnaryRequestIDInterceptor())
+
+	var gotCtx context.Context
+	handler := func(srv interface{}, ss grpc.ServerStream) error {
+		gotCtx = ss.Context()
+		return nil
+	}
+
+	err := interceptor(nil, &fakeServerStream{ctx: context.Background()}, &grpc.StreamServerInfo{FullMethod: "/test.Service/Stream"}, handler)
+	require.NoError(t, err)
+	assert.NotEmpty(t, GetRequestID(gotCtx))
+}
+
+func TestStreamFromUnaryRejects(t *testing.T) {
+	denied := errors.New("denied")
+	var gotMethod string
+	unary := func(ctx context.Context, req interface{}, info *grpc.UnaryServerInfo, handler grpc.UnaryHandler) (interface{}, error) {
+		gotMethod = info.FullMethod
+		assert.Nil(t, req)
+		return nil, denied
+	}
+
+	called := false
+	handler := func(srv interface{}, ss grpc.ServerStream) error {
+		called = true
+		return nil
+	}
+
+	interceptors := StreamFromUnaryChain([]grpc.UnaryServerInterceptor{unary})
+	require.Len(t, interceptors, 1)
+	err := interceptors[0](nil, &fakeServerStream{ctx: context.Background()}, &grpc.StreamServerInfo{FullMethod: "/test.Service/Stream"}, handler)
+	assert.ErrorIs(t, err, denied)
+	assert.False(t, called)
+	assert.Equal(t, "/test.Service/Stream", gotMethod)
+}
@@ -0,0 +1,589 @@
+/**
+ * @file bench_main.cpp
+ * @brief Benchmark harness for the SP 800-90B estimators and the calculate_*
+ *        entry points of the wrapper.
+ *
+ * Every benchmark runs on synthetic uniform samples of the requested sizes
+ * and word sizes, and on the corpus files named on the command line, once per
+ * requested thread count. For each run the harness reports wall and CPU time,
+ * throughput, peak memory and the estimate as JSON, which can be compared
+ * against the output of an earlier build with -b.
+ *
+ * The harness is compiled as a single translation unit with wrapper.cpp. The
+ * reference headers define their functions out of line, so a binary can only
+ * compile them once, and this way each estimator is called exactly as the
+ * wrapper calls it.
+ */
+
+#include "../wrapper/wrapper.cpp"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <json/json.h>
+
+// Seed of the synthetic inputs, so that every build benchmarks the same samples
+#define BENCH_SEED 0x90b5eedULL
+
+/**
+ * @brief What a BenchCase measures.
+ */
+enum BenchKind {
+    BENCH_NON_IID_JOB,       // One view of a Non-IID estimator, as run_non_iid_jobs runs it
+    BENCH_CHI_SQUARE,        // IID chi-square tests
+    BENCH_LRS,               // IID length of the longest repeated substring test
+    BENCH_PERMUTATION,       // IID permutation tests, including calc_stats
+    BENCH_CALCULATE_IID,     // calculate_iid_entropy on the raw samples
+    BENCH_CALCULATE_NON_IID  // calculate_non_iid_entropy on the raw samples
+};
+
+struct BenchCase {
+    const char* name;
+    BenchKind kind;
+    NonIidJob job;  // Job of a BENCH_NON_IID_JOB case
+};
+
+// Every benchmark, in the order they are run and reported
+static const BenchCase bench_cases[] = {
+    {"non_iid/most_common/bitstring", BENCH_NON_IID_JOB, JOB_MCV_BITSTRING},
+    {"non_iid/most_common/literal", BENCH_NON_IID_JOB, JOB_MCV_LITERAL},
+    {"non_iid/collision_test/bitstring", BENCH_NON_IID_JOB, JOB_COLLISION_BITSTRING},
+    {"non_iid/collision_test/literal", BENCH_NON_IID_JOB, JOB_COLLISION_LITERAL},
+    {"non_iid/markov_test/bitstring", BENCH_NON_IID_JOB, JOB_MARKOV_BITSTRING},
+    {"non_iid/markov_test/literal", BENCH_NON_IID_JOB, JOB_MARKOV_LITERAL},
+    {"non_iid/compression_test/bitstring", BENCH_NON_IID_JOB, JOB_COMPRESSION_BITSTRING},
+    {"non_iid/compression_test/literal", BENCH_NON_IID_JOB, JOB_COMPRESSION_LITERAL},
+    {"non_iid/SAalgs/bitstring", BENCH_NON_IID_JOB, JOB_SA_BITSTRING},
+    {"non_iid/SAalgs/literal", BENCH_NON_IID_JOB, JOB_SA_LITERAL},
+    {"non_iid/multi_mcw_test/bitstring", BENCH_NON_IID_JOB, JOB_MCW_BITSTRING},
+    {"non_iid/multi_mcw_test/literal", BENCH_NON_IID_JOB, JOB_MCW_LITERAL},
+    {"non_iid/lag_test/bitstring", BENCH_NON_IID_JOB, JOB_LAG_BITSTRING},
+    {"non_iid/lag_test/literal", BENCH_NON_IID_JOB, JOB_LAG_LITERAL},
+    {"non_iid/multi_mmc_test/bitstring", BENCH_NON_IID_JOB, JOB_MMC_BITSTRING},
+    {"non_iid/multi_mmc_test/literal", BENCH_NON_IID_JOB, JOB_MMC_LITERAL},
+    {"non_iid/LZ78Y_test/bitstring", BENCH_NON_IID_JOB, JOB_LZ78Y_BITSTRING},
+    {"non_iid/LZ78Y_test/literal", BENCH_NON_IID_JOB, JOB_LZ78Y_LITERAL},
+    {"iid/chi_square_tests", BENCH_CHI_SQUARE, NON_IID_JOB_COUNT},
+    {"iid/len_LRS_test", BENCH_LRS, NON_IID_JOB_COUNT},
+    {"iid/permutation_tests", BENCH_PERMUTATION, NON_IID_JOB_COUNT},
+    {"calculate_iid_entropy", BENCH_CALCULATE_IID, NON_IID_JOB_COUNT},
+    {"calculate_non_iid_entropy", BENCH_CALCULATE_NON_IID, NON_IID_JOB_COUNT},
+};
+
+/**
+ * @brief Samples of one benchmark input.
+ */
+struct BenchInput {
+    std::string name;          // "uniform-<bits>bit" or the corpus file name
+    std::vector<uint8_t> samples;
+    int bits_per_symbol;       // As passed to the calculate_* functions, 0 to detect
+};
+
+/**
+ * @brief Outcome of one run of a BenchCase.
+ */
+struct BenchRun {
+    double wall_seconds;
+    double cpu_seconds;
+    uint64_t peak_rss_bytes;
+    uint64_t peak_scratch_bytes;
+    double estimate;
+    long permutations;  // Permutations executed by the permutation tests, -1 for other cases
+    std::string error;
+
+    BenchRun() : wall_seconds(0.0), cpu_seconds(0.0), peak_rss_bytes(0), peak_scratch_bytes(0), estimate(-1.0),
+                 permutations(-1) {}
+};
+
+[[ noreturn ]] void print_usage() {
+    printf("Usage is: ea_bench [-s <sizes>] [-w <bits>] [-t <threads>] [-r <repeats>] [-f <filters>] [-S] [-q] [-o <file>] [-b <baseline>] [corpus_file ...]\n\n");
+    printf("\t -s <sizes>: Comma separated sample counts of the synthetic inputs; K and M suffixes are\n");
+    printf("\t\t multiples of 1000 and 1000000. 1K,100K,1M by default.\n");
+    printf("\t -w <bits>: Comma separated word sizes of the synthetic inputs, 1-8. 1,4,8 by default.\n");
+    printf("\t -t <threads>: Comma separated thread counts. 1 and the powers of two up to the OpenMP\n");
+    printf("\t\t default by default.\n");
+    printf("\t -r <repeats>: Runs of each benchmark; the fastest and the median are reported. 3 by default.\n");
+    printf("\t -f <filters>: Comma separated substrings; only benchmarks whose name contains one of them run.\n");
+    printf("\t -S: Skip the synthetic inputs and only benchmark the corpus files.\n");
+    printf("\t -q: Quiet mode, no progress output on stderr.\n");
+    printf("\t -o <file>: Write the JSON report to file instead of stdout.\n");
+    printf("\t -b <baseline>: Compare against an earlier JSON report and print the change of each benchmark.\n");
+    printf("\t corpus_file: Raw sample files, one sample per byte; the word size is inferred from the data.\n");
+    printf("\n");
+    printf("\t Each run is reported with its wall and CPU time, samples processed per second (of the\n");
+    printf("\t input, also for the bitstring views), the peak resident set size of the process, the peak\n");
+    printf("\t scratch buffer use of the calling thread, the speedup over the single thread run and the\n");
+    printf("\t estimate (1 or 0 for the pass/fail IID tests). The permutation tests also report the number of\n");
+    printf("\t permutations it took to decide every statistic, which depends on their random seed.\n");
+    printf("\n");
+    exit(-1);
+}
+
+// Parses a sample count such as "100K"; returns -1 if it is not one.
+static long parse_size(const std::string& text) {
+    char* end;
+    long value = strtol(text.c_str(), &end, 10);
+
+    if (end == text.c_str() || value <= 0) return -1;
+    if (*end == 'K' || *end == 'k') {
+        value *= 1000L;
+        end++;
+    } else if (*end == 'M' || *end == 'm') {
+        value *= 1000000L;
+        end++;
+    }
+    return (*end == '\0') ? value : -1;
+}
+
+static std::vector<std::string> split_list(const char* text) {
+    std::vector<std::string> items;
+    std::stringstream stream(text);
+    std::string item;
+
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+// Resets the peak resident set size of the process (Linux 4.0 and later).
+static bool reset_peak_rss() {
+    FILE* fp = fopen("/proc/self/clear_refs", "w");
+    if (fp == NULL) return false;
+
+    bool written = fputs("5", fp) >= 0;
+    return (fclose(fp) == 0) && written;
+}
+
+// Peak resident set size of the process since the last reset_peak_rss().
+static uint64_t peak_rss_bytes() {
+    FILE* fp = fopen("/proc/self/status", "r");
+    char line[256];
+    unsigned long long kib = 0;
+
+    if (fp != NULL) {
+        while (fgets(line, sizeof(line), fp) != NULL) {
+            if (sscanf(line, "VmHWM: %llu kB", &kib) == 1) break;
+        }
+        fclose(fp);
+    }
+    if (kib == 0) {
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0) kib = (unsigned long long)usage.ru_maxrss;
+    }
+    return (uint64_t)kib * 1024;
+}
+
+static BenchInput synthetic_input(long samples, int bits_per_symbol) {
+    BenchInput input;
+    std::mt19937_64 rng(BENCH_SEED ^ ((uint64_t)samples << 4) ^ (uint64_t)bits_per_symbol);
+    const uint8_t mask = (uint8_t)((1 << bits_per_symbol) - 1);
+
+    input.name = "uniform-" + std::to_string(bits_per_symbol) + "bit";
+    input.bits_per_symbol = bits_per_symbol;
+    input.samples.resize(samples);
+    for (long i = 0; i < samples; i += 8) {
+        uint64_t word = rng();
+        for (long j = i; j < std::min(i + 8, samples); j++, word >>= 8) input.samples[j] = (uint8_t)word & mask;
+    }
+    return input;
+}
+
+static bool corpus_input(const char* path, BenchInput* input) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    const char* base = strrchr(path, '/');
+    input->name = (base != NULL) ? base + 1 : path;
+    input->bits_per_symbol = 0;
+    input->samples.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return !input->samples.empty();
+}
+
+// Whether the wrapper runs case bc on data like dp in initial entropy mode.
+static bool case_applies(const BenchCase& bc, const data_t* dp) {
+    if (bc.kind != BENCH_NON_IID_JOB) return true;
+
+    // Collision, Markov and Compression only apply to binary literal data
+    switch (bc.job) {
+    case JOB_COLLISION_LITERAL:
+    case JOB_MARKOV_LITERAL:
+    case JOB_COMPRESSION_LITERAL:
+        return dp->alph_size == 2;
+    default:
+        return true;
+    }
+}
+
+static bool selected(const BenchCase& bc, const std::vector<std::string>& filters) {
+    if (filters.empty()) return true;
+    for (size_t i = 0; i < filters.size(); i++) {
+        if (strstr(bc.name, filters[i].c_str()) != NULL) return true;
+    }
+    return false;
+}
+
+static void run_wrapper_case(const BenchCase& bc, const BenchInput& input, int threads, BenchRun* run) {
+    EstimatorStats stats;
+    EntropyResult* result;
+
+    memset(&stats, 0, sizeof(stats));
+    {
+        EstimatorProbe probe(&stats, input.samples.size(), true);
+        if (bc.kind == BENCH_CALCULATE_IID) {
+            result = calculate_iid_entropy(input.samples.data(), input.samples.size(), input.bits_per_symbol, true, 0, threads, NULL);
+        } else {
+            result = calculate_non_iid_entropy(input.samples.data(), input.samples.size(), input.bits_per_symbol, true, 0, threads, NULL);
+        }
+    }
+
+    run->wall_seconds = stats.wall_seconds;
+    run->cpu_seconds = stats.cpu_seconds;
+    run->peak_scratch_bytes = stats.peak_bytes;
+    if (result == NULL) {
+        run->error = "Failed to allocate result";
+        return;
+    }
+    if (result->error_code != 0) {
+        run->error = result->error_message;
+    } else {
+        run->estimate = result->min_entropy;
+    }
+    free_entropy_result(result);
+}
+
+// Whether a job finishes from the summaries of the front end rather than the data itself
+static bool uses_front_end(NonIidJob job) {
+    return job <= JOB_MARKOV_LITERAL || job == JOB_COMPRESSION_LITERAL;
+}
+
+static void run_estimator_case(const BenchCase& bc, data_t* dp, const SampleCounts* counts, int threads, BenchRun* run) {
+    EstimatorStats stats;
+    ThreadLease lease(threads);
+
+    memset(&stats, 0, sizeof(stats));
+    try {
+        EstimatorProbe probe(&stats, 0, true);
+
+        switch (bc.kind) {
+        case BENCH_NON_IID_JOB: {
+            // A job that uses the front end is timed together with the sweep it needs
+            bool literal = (bc.job % 2) == 1;
+            bool summarized = uses_front_end(bc.job);
+            NonIidFrontEnd front_end;
+            summarize_non_iid_data(dp, counts, NULL, summarized && !literal, summarized && literal && dp->alph_size == 2, &front_end);
+
+            NonIidJobResult out;
+            out.value[0] = -1.0;
+            out.value[1] = -1.0;
+            run_non_iid_job(bc.job, dp, &front_end, 0, &out);
+            run->estimate = out.value[0];
+            break;
+        }
+        case BENCH_CHI_SQUARE:
+            run->estimate = chi_square_tests(dp->symbols, dp->len, dp->alph_size, 0) ? 1.0 : 0.0;
+            break;
+        case BENCH_LRS: {
+            run->estimate = len_LRS_test(dp->symbols, dp->len, dp->alph_size, 0, "Literal") ? 1.0 : 0.0;
+            break;
+        }
+        case BENCH_PERMUTATION: {
+            // The seed is random, so the number of permutations it takes to
+            // decide every statistic varies from run to run
+            IidTestCase tc;
+            permutation_stats perm;
+            double rawmean, median;
+            calc_stats(counts->raw, counts->symbols, dp->len, dp->alph_size, rawmean, median);
+            run->estimate = permutation_tests(dp, rawmean, median, 0, tc, &perm) ? 1.0 : 0.0;
+            run->permutations = perm.executed;
+            break;
+        }
+        default:
+            break;
+        }
+    } catch (const std::exception& e) {
+        run->error = e.what();
+    }
+
+    run->wall_seconds = stats.wall_seconds;
+    run->cpu_seconds = stats.cpu_seconds;
+    run->peak_scratch_bytes = stats.peak_bytes;
+}
+
+static BenchRun run_case(const BenchCase& bc, const BenchInput& input, data_t* dp, const SampleCounts* counts, int threads) {
+    BenchRun run;
+
+    reset_peak_rss();
+
+    if (bc.kind == BENCH_CALCULATE_IID || bc.kind == BENCH_CALCULATE_NON_IID) {
+        run_wrapper_case(bc, input, threads, &run);
+    } else {
+        run_estimator_case(bc, dp, counts, threads, &run);
+    }
+
+    run.peak_rss_bytes = peak_rss_bytes();
+    return run;
+}
+
+static std::string result_key(const Json::Value& result) {
+    std::ostringstream key;
+    key << result["benchmark"].asString() << '|' << result["input"].asString() << '|'
+        << result["samples"].asInt64() << '|' << result["threads"].asInt();
+    return key.str();
+}
+
+// Prints the change of every result that also appears in baseline.
+static void compare_reports(const Json::Value& baseline, const Json::Value& report) {
+    std::map<std::string, Json::Value> previous;
+    const Json::Value& old_results = baseline["results"];
+
+    for (Json::ArrayIndex i = 0; i < old_results.size(); i++) {
+        previous[result_key(old_results[i])] = old_results[i];
+    }
+
+    fprintf(stderr, "\n%-36s %-24s %10s %3s %11s %11s %8s\n", "benchmark", "input", "samples", "thr", "baseline", "current", "change");
+    const Json::Value& results = report["results"];
+    for (Json::ArrayIndex i = 0; i < results.size(); i++) {
+        const Json::Value& result = results[i];
+        std::map<std::string, Json::Value>::const_iterator it = previous.find(result_key(result));
+        if (it == previous.end()) continue;
+
+        double before = it->second["wall_seconds_min"].asDouble();
+        double after = result["wall_seconds_min"].asDouble();
+        bool changed = it->second["estimate"].asDouble() != result["estimate"].asDouble();
+
+        fprintf(stderr, "%-36s %-24s %10lld %3d %10.4fs %10.4fs %+7.1f%%%s\n",
+                result["benchmark"].asCString(), result["input"].asCString(),
+                (long long)result["samples"].asInt64(), result["threads"].asInt(), before, after,
+                (before > 0.0) ? 100.0 * (after - before) / before : 0.0,
+                changed ? "  estimate changed" : "");
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<long> sizes;
+    std::vector<int> word_sizes;
+    std::vector<int> thread_counts;
+    std::vector<std::string> filters;
+    std::vector<BenchInput> inputs;
+    std::string output_path, baseline_path;
+    int repeats = 3;
+    bool synthetic = true, quiet = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:w:t:r:f:Sqo:b:")) != -1) {
+        switch (opt) {
+        case 's': {
+            std::vector<std::string> items = split_list(optarg);
+            sizes.clear();
+            for (size_t i = 0; i < items.size(); i++) {
+                long size = parse_size(items[i]);
+                if (size < 0) print_usage();
+                sizes.push_back(size);
+            }
+            break;
+        }
+        case 'w': {
+            std::vector<std::string> items = split_list(optarg);
+            word_sizes.clear();
+            for (size_t i = 0; i < items.size(); i++) {
+                int bits = atoi(items[i].c_str());
+                if (bits < 1 || bits > 8) print_usage();
+                word_sizes.push_back(bits);
+            }
+            break;
+        }
+        case 't': {
+            std::vector<std::string> items = split_list(optarg);
+            thread_counts.clear();
+            for (size_t i = 0; i < items.size(); i++) {
+                int threads = atoi(items[i].c_str());
+                if (threads < 1) print_usage();
+                thread_counts.push_back(threads);
+            }
+            break;
+        }
+        case 'r':
+            repeats = atoi(optarg);
+            if (repeats < 1) print_usage();
+            break;
+        case 'f':
+            filters = split_list(optarg);
+            break;
+        case 'S':
+            synthetic = false;
+            break;
+        case 'q':
+            quiet = true;
+            break;
+        case 'o':
+            output_path = optarg;
+            break;
+        case 'b':
+            baseline_path = optarg;
+            break;
+        default:
+            print_usage();
+        }
+    }
+
+    if (sizes.empty()) {
+        sizes.push_back(1000);
+        sizes.push_back(100000);
+        sizes.push_back(1000000);
+    }
+    if (word_sizes.empty()) {
+        word_sizes.push_back(1);
+        word_sizes.push_back(4);
+        word_sizes.push_back(8);
+    }
+    if (thread_counts.empty()) {
+        int max_threads = omp_get_max_threads();
+        for (int threads = 1; threads < max_threads; threads *= 2) thread_counts.push_back(threads);
+        thread_counts.push_back(max_threads);
+    }
+
+    Json::Value baseline;
+    if (!baseline_path.empty()) {
+        std::ifstream file(baseline_path.c_str());
+        Json::CharReaderBuilder reader;
+        std::string errors;
+        if (!file || !Json::parseFromStream(reader, file, &baseline, &errors)) {
+            fprintf(stderr, "Cannot read baseline %s %s\n", baseline_path.c_str(), errors.c_str());
+            exit(-1);
+        }
+    }
+
+    for (int i = optind; i < argc; i++) {
+        BenchInput input;
+        if (!corpus_input(argv[i], &input)) {
+            fprintf(stderr, "Cannot read corpus file %s\n", argv[i]);
+            exit(-1);
+        }
+        inputs.push_back(input);
+    }
+    if (synthetic) {
+        for (size_t w = 0; w < word_sizes.size(); w++) {
+            for (size_t s = 0; s < sizes.size(); s++) inputs.push_back(synthetic_input(sizes[s], word_sizes[w]));
+        }
+    }
+
+    // The estimators print their warnings on stdout; send them to stderr, so
+    // that stdout only carries the report
+    fflush(stdout);
+    int report_fd = dup(STDOUT_FILENO);
+    if (report_fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+        perror("ea_bench");
+        exit(-1);
+    }
+
+    // Let every lease be granted the thread count it asks for
+    set_entropy_thread_budget(*std::max_element(thread_counts.begin(), thread_counts.end()));
+
+    Json::Value report;
+    report["tool"] = "ea_bench";
+    report["version"] = entropy_tool_version();
+    report["compiler"] = __VERSION__;
+    report["processors"] = omp_get_num_procs();
+    report["repeats"] = repeats;
+    // Without the reset, peak_rss_bytes is the peak of the whole process up to that run
+    report["peak_rss_per_run"] = reset_peak_rss();
+    report["results"] = Json::Value(Json::arrayValue);
+
+    for (size_t n = 0; n < inputs.size(); n++) {
+        const BenchInput& input = inputs[n];
+        EntropyResult scratch;
+        SampleCounts counts;
+        data_t dp;
+
+        memset(&scratch, 0, sizeof(scratch));
+
+        if (!prepare_data(&dp, input.samples.data(), input.samples.size(), input.bits_per_symbol, &counts, &scratch)) {
+            fprintf(stderr, "%s: %s\n", input.name.c_str(), scratch.error_message);
+            exit(-1);
+        }
+        DataGuard guard(&dp, input.samples.data());
+
+        if (dp.alph_size <= 1) {
+            if (!quiet) fprintf(stderr, "%s: only one symbol, skipped\n", input.name.c_str());
+            continue;
+        }
+
+        for (size_t c = 0; c < sizeof(bench_cases) / sizeof(bench_cases[0]); c++) {
+            const BenchCase& bc = bench_cases[c];
+            double single_thread_wall = 0.0;
+
+            if (!selected(bc, filters) || !case_applies(bc, &dp)) continue;
+
+            for (size_t t = 0; t < thread_counts.size(); t++) {
+                std::vector<BenchRun> runs;
+                std::vector<double> walls, cpus;
+                std::vector<long> permutations;
+                uint64_t peak_rss = 0, peak_scratch = 0;
+
+                for (int r = 0; r < repeats; r++) {
+                    runs.push_back(run_case(bc, input, &dp, &counts, thread_counts[t]));
+                    walls.push_back(runs.back().wall_seconds);
+                    cpus.push_back(runs.back().cpu_seconds);
+                    permutations.push_back(runs.back().permutations);
+                    peak_rss = std::max(peak_rss, runs.back().peak_rss_bytes);
+                    peak_scratch = std::max(peak_scratch, runs.back().peak_scratch_bytes);
+                }
+                std::sort(walls.begin(), walls.end());
+                std::sort(cpus.begin(), cpus.end());
+                std::sort(permutations.begin(), permutations.end());
+
+                Json::Value result;
+                result["benchmark"] = bc.name;
+                result["input"] = input.name;
+                result["samples"] = (Json::Int64)dp.len;
+                result["bits_per_symbol"] = dp.word_size;
+                result["alphabet_size"] = dp.alph_size;
+                result["threads"] = thread_counts[t];
+                result["wall_seconds_min"] = walls.front();
+                result["wall_seconds_median"] = walls[walls.size() / 2];
+                result["cpu_seconds_median"] = cpus[cpus.size() / 2];
+                result["samples_per_second"] = (walls.front() > 0.0) ? dp.len / walls.front() : 0.0;
+                result["peak_rss_bytes"] = (Json::UInt64)peak_rss;
+                result["peak_scratch_bytes"] = (Json::UInt64)peak_scratch;
+                if (thread_counts[t] == 1) single_thread_wall = walls.front();
+                if (single_thread_wall > 0.0 && walls.front() > 0.0) {
+                    result["speedup"] = single_thread_wall / walls.front();
+                }
+                result["estimate"] = runs.front().estimate;
+                if (permutations.front() >= 0) result["permutations_median"] = (Json::Int64)permutations[permutations.size() / 2];
+                if (!runs.front().error.empty()) result["error"] = runs.front().error;
+                report["results"].append(result);
+
+                if (!quiet) {
+                    fprintf(stderr, "%-36s %-24s %10ld %2d bits %3d threads %10.4fs %12.4g samples/s %8.1f MiB%s%s\n",
+                            bc.name, input.name.c_str(), dp.len, dp.word_size, thread_counts[t], walls.front(),
+                            result["samples_per_second"].asDouble(), peak_rss / 1048576.0,
+                            runs.front().error.empty() ? "" : "  ", runs.front().error.c_str());
+                }
+            }
+        }
+    }
+
+    Json::StreamWriterBuilder writer;
+    writer["indentation"] = "  ";
+    std::string text = Json::writeString(writer, report) + "\n";
+    FILE* out = output_path.empty() ? fdopen(report_fd, "w") : fopen(output_path.c_str(), "w");
+    if (out == NULL || fputs(text.c_str(), out) < 0 || fclose(out) != 0) {
+        fprintf(stderr, "Cannot write %s\n", output_path.empty() ? "report" : output_path.c_str());
+        exit(-1);
+    }
+
+    if (!baseline_path.empty()) compare_reports(baseline, report);
+    return 0;
+}
@@ -28,10 +28,12 @@
 #include <fenv.h>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 
 [[ noreturn ]] void print_usage() {
     printf("Usage is: ea_conditioning -v [-q] <n_in> <n_out> <nw> <h_in> [-o filename.json]\n");
-    printf("\tor \n\tea_conditioning -n <n_in> <n_out> <nw> <h_in> [h' | -i filename] [-o filename.json]\n\n");
+    printf("\tor \n\tea_conditioning -n <n_in> <n_out> <nw> <h_in> [h' | -i filename] [-o filename.json]\n");
+    printf("\tor \n\tea_conditioning -b batchfile [-q] [-o filename.json]\n\n");
     printf("\t <n_in>: input number of bits to conditioning function.\n");
     printf("\t <n_out>: output number of bits from conditioning function.\n");
     printf("\t <nw>: narrowest internal width of conditioning function.\n");
@@ -40,6 +42,7 @@
     printf("\t <h'>: entropy estimate per bit of conditioned sequential dataset (only for '-n' option).\n");
     printf("\t -q: Quiet mode, less output to screen.\n");
     printf("\t -i: Input file name, to run an entropy assessment on a non-vetted conditioned data file and use that value as h'.\n");
+    printf("\t -b: Batch file name, to assess one configuration per line, each given as [-v|-n] <n_in> <n_out> <nw> <h_in> [h'].\n");
     printf("\n");
     printf("\t This program computes the entropy of the output of a conditioning function 'h_out' (Section 3.1.5).\n");
     printf("\t If the conditioning function is vetted, then\n\n");
@@ -122,20 +125,47 @@ static unsigned int inputUnsignedOption(const char *input, unsigned int low, uns
     return (unsigned int) inint;
 }
 
+/*
+ * The arbitrary precision variables of the Output_Entropy computation. They are kept across the
+ * attempts at increasing precision and across the configurations of a batch; only their precision
+ * is changed, and only when an attempt needs a different one.
+ */
+struct conditioning_engine {
+    mpfr_prec_t precision;
+    mpfr_t ap_h_in, ap_entexp, ap_p_high, ap_p_low, ap_denom, ap_inputSpaceSize, ap_diff, ap_power_term, ap_psi, ap_omega, ap_outputEntropy, ap_nw, ap_n_out;
+    mpfr_t ap_log2, ap_ratio, ap_epsilon;
+};
+
+static void conditioning_engine_init(conditioning_engine *ce) {
+    ce->precision = 0;
+    mpfr_inits2(MPFR_PREC_MIN, ce->ap_h_in, ce->ap_entexp, ce->ap_p_high, ce->ap_p_low, ce->ap_denom, ce->ap_inputSpaceSize, ce->ap_diff, ce->ap_power_term, ce->ap_psi, ce->ap_omega, ce->ap_outputEntropy, ce->ap_nw, ce->ap_n_out, ce->ap_log2, ce->ap_ratio, ce->ap_epsilon, NULL);
+}
+
+static void conditioning_engine_set_precision(conditioning_engine *ce, mpfr_prec_t precision) {
+    if (ce->precision == precision) return;
+
+    mpfr_ptr vars[] = {ce->ap_h_in, ce->ap_entexp, ce->ap_p_high, ce->ap_p_low, ce->ap_denom, ce->ap_inputSpaceSize, ce->ap_diff, ce->ap_power_term, ce->ap_psi, ce->ap_omega, ce->ap_outputEntropy, ce->ap_nw, ce->ap_n_out, ce->ap_log2, ce->ap_ratio, ce->ap_epsilon};
+    for (size_t i = 0; i < sizeof(vars) / sizeof(vars[0]); i++) mpfr_set_prec(vars[i], precision);
+    ce->precision = precision;
+
+    // We're going to need an arbitrary precision version of log(2)
+    mpfr_set_ui(ce->ap_log2, 2U, MPFR_RNDZ);
+    mpfr_log(ce->ap_log2, ce->ap_log2, MPFR_RNDU);
+}
+
+static void conditioning_engine_free(conditioning_engine *ce) {
+    mpfr_clears(ce->ap_h_in, ce->ap_entexp, ce->ap_p_high, ce->ap_p_low, ce->ap_denom, ce->ap_inputSpaceSize, ce->ap_diff, ce->ap_power_term, ce->ap_psi, ce->ap_omega, ce->ap_outputEntropy, ce->ap_nw, ce->ap_n_out, ce->ap_log2, ce->ap_ratio, ce->ap_epsilon, NULL);
+}
+
 /*
  * Check to see how close the provided value is to its maximal value
  * 1 - epsilon = value/max  =>  epsilon = 1 - value/max  =>  -log2(epsilon) = -log2(1 - value/max)
  * To be conservative, round so that -log2(epsilon) epsilon is as small as possible
  * (that is epsilon should be as large as possible)
  */
-static long double calculateEpsilon(mpfr_t calcValue, mpfr_t maxValue, mpfr_prec_t precision) {
-    mpfr_t ratio, output, ap_log2;
-    mpfr_inits2(precision, ratio, output, ap_log2, NULL);
-    long double value;
-
-    // We're going to need an arbitrary precision version of log(2)
-    mpfr_set_ui(ap_log2, 2U, MPFR_RNDZ);
-    mpfr_log(ap_log2, ap_log2, MPFR_RNDU);
+static long double calculateEpsilon(conditioning_engine *ce, mpfr_t calcValue, mpfr_t maxValue) {
+    mpfr_ptr ratio = ce->ap_ratio;
+    mpfr_ptr output = ce->ap_epsilon;
 
     // Calculate the ratio value/max
     mpfr_set(ratio, calcValue, MPFR_RNDU);
@@ -146,36 +176,27 @@ static long double calculateEpsilon(mpfr_t calcValue, mpfr_t maxValue, mpfr_prec
     mpfr_log1p(output, ratio, MPFR_RNDZ);
 
     // Calculate log_2(1 - value/max)
-    mpfr_div(output, output, ap_log2, MPFR_RNDZ);
+    mpfr_div(output, output, ce->ap_log2, MPFR_RNDZ);
 
     // Calculate -log_2(1 - value/max)
     mpfr_neg(output, output, MPFR_RNDZ);
 
     // return this value
-    value = mpfr_get_ld(output, MPFR_RNDZ);
-    mpfr_clears(ratio, output, ap_log2, NULL);
-
-    return value;
+    return mpfr_get_ld(output, MPFR_RNDZ);
 }
 
 // General goal: want to round to cause psi and omega to be as large as possible (to provide a conservative estimate)
-// If any estimate is not appropriate, increase the precision and start again
-
-static long double computeEntropyWithPrecision(mpfr_prec_t precision, long double h_in, unsigned int n_in, unsigned int n, unsigned int n_out, unsigned int nw, long double &noutEpsilonExp, long double &hinEpsilonExp, long double &nwEpsilonExp) {
-    long double value;
+// If any estimate is not appropriate, return false, so that the caller increases the precision and starts again
 
-    // TODO quietmode?
-    printf("Attempting to compute entropy with %ld bits of precision.\n", precision);
-
-    // Initialize all the arbitrary precision values
-    mpfr_t ap_h_in, ap_entexp, ap_p_high, ap_p_low, ap_denom, ap_inputSpaceSize, ap_diff, ap_power_term, ap_psi, ap_omega, ap_outputEntropy, ap_nw, ap_n_out;
-    mpfr_inits2(precision, ap_h_in, ap_entexp, ap_p_high, ap_p_low, ap_denom, ap_inputSpaceSize, ap_diff, ap_power_term, ap_psi, ap_omega, ap_outputEntropy, ap_nw, ap_n_out, NULL);
+static bool computeEntropyWithPrecision(conditioning_engine *ce, long double h_in, unsigned int n_in, unsigned int n, unsigned int n_out, unsigned int nw, long double &value, long double &noutEpsilonExp, long double &hinEpsilonExp, long double &nwEpsilonExp) {
+    mpfr_ptr ap_h_in = ce->ap_h_in, ap_entexp = ce->ap_entexp, ap_p_high = ce->ap_p_high, ap_p_low = ce->ap_p_low;
+    mpfr_ptr ap_denom = ce->ap_denom, ap_inputSpaceSize = ce->ap_inputSpaceSize, ap_diff = ce->ap_diff, ap_power_term = ce->ap_power_term;
+    mpfr_ptr ap_psi = ce->ap_psi, ap_omega = ce->ap_omega, ap_outputEntropy = ce->ap_outputEntropy, ap_nw = ce->ap_nw, ap_n_out = ce->ap_n_out;
 
     // Initialize arbitrary precision versions of h_in
     // We want to make sure not to lose precision here.
     if (mpfr_set_ld(ap_h_in, h_in, MPFR_RNDZ) != 0) {
-        mpfr_clears(ap_h_in, ap_entexp, ap_p_high, ap_p_low, ap_denom, ap_inputSpaceSize, ap_diff, ap_power_term, ap_psi, ap_omega, ap_outputEntropy, ap_nw, ap_n_out, NULL);
-        return computeEntropyWithPrecision(precision * 2, h_in, n_in, n, n_out, nw, noutEpsilonExp, hinEpsilonExp, nwEpsilonExp);
+        return false;
     }
 
     // Compute Output Entropy (Section 3.1.5.1.2)
@@ -187,13 +208,11 @@ static long double computeEntropyWithPrecision(mpfr_prec_t precision, long doubl
 
     // p_high must be in the interval (0,1)
     if (mpfr_cmp_ui(ap_p_high, 0UL) <= 0) {
-        mpfr_clears(ap_h_in, ap_entexp, ap_p_high, ap_p_low, ap_denom, ap_inputSpaceSize, ap_diff, ap_power_term, ap_psi, ap_omega, ap_outputEntropy, ap_nw, ap_n_out, NULL);
-        return computeEntropyWithPrecision(precision * 2, h_in, n_in, n, n_out, nw, noutEpsilonExp, hinEpsilonExp, nwEpsilonExp);
+        return false;
     }
 
     if (mpfr_cmp_ui(ap_p_high, 1UL) >= 0) {
-        mpfr_clears(ap_h_in, ap_entexp, ap_p_high, ap_p_low, ap_denom, ap_inputSpaceSize, ap_diff, ap_power_term, ap_psi, ap_omega, ap_outputEntropy, ap_nw, ap_n_out, NULL);
-        return computeEntropyWithPrecision(precision * 2, h_in, n_in, n, n_out, nw, noutEpsilonExp, hinEpsilonExp, nwEpsilonExp);
+        return false;
     }
 
     // p_low = 1 - p_high
@@ -202,8 +221,7 @@ static long double computeEntropyWithPrecision(mpfr_prec_t precision, long doubl
     // This is an integer value, and should be exact
     // ap_inputSpaceSize = 2^(n_in)
     if (mpfr_ui_pow_ui(ap_inputSpaceSize, 2UL, n_in, MPFR_RNDZ) != 0) {
-        mpfr_clears(ap_h_in, ap_entexp, ap_p_high, ap_p_low, ap_denom, ap_inputSpaceSize, ap_diff, ap_power_term, ap_psi, ap_omega, ap_outputEntropy, ap_nw, ap_n_out, NULL);
-        return computeEntropyWithPrecision(precision * 2, h_in, n_in, n, n_out, nw, noutEpsilonExp, hinEpsilonExp, nwEpsilonExp);
+        return false;
     }
 
     // ap_denom = 2^(n_in) - 1
@@ -213,8 +231,7 @@ static long double computeEntropyWithPrecision(mpfr_prec_t precision, long doubl
     mpfr_sub(ap_diff, ap_inputSpaceSize, ap_denom, MPFR_RNDZ);
     if (mpfr_cmp_ui(ap_diff, 1UL) != 0) {
         // Evidently not. Increase the precision.
-        mpfr_clears(ap_h_in, ap_entexp, ap_p_high, ap_p_low, ap_denom, ap_inputSpaceSize, ap_diff, ap_power_term, ap_psi, ap_omega, ap_outputEntropy, ap_nw, ap_n_out, NULL);
-        return computeEntropyWithPrecision(precision * 2, h_in, n_in, n, n_out, nw, noutEpsilonExp, hinEpsilonExp, nwEpsilonExp);
+        return false;
     }
 
     // p_low = (1-p_high)/(2^(n_in)-1)
@@ -222,21 +239,18 @@ static long double computeEntropyWithPrecision(mpfr_prec_t precision, long doubl
 
     // p_low must be in the interval (0,1)
     if (mpfr_cmp_ui(ap_p_low, 0UL) <= 0) {
-        mpfr_clears(ap_h_in, ap_entexp, ap_p_high, ap_p_low, ap_denom, ap_inputSpaceSize, ap_diff, ap_power_term, ap_psi, ap_omega, ap_outputEntropy, ap_nw, ap_n_out, NULL);
-        return computeEntropyWithPrecision(precision * 2, h_in, n_in, n, n_out, nw, noutEpsilonExp, hinEpsilonExp, nwEpsilonExp);
+        return false;
     }
 
     if (mpfr_cmp_ui(ap_p_low, 1UL) >= 0) {
-        mpfr_clears(ap_h_in, ap_entexp, ap_p_high, ap_p_low, ap_denom, ap_inputSpaceSize, ap_diff, ap_power_term, ap_psi, ap_omega, ap_outputEntropy, ap_nw, ap_n_out, NULL);
-        return computeEntropyWithPrecision(precision * 2, h_in, n_in, n, n_out, nw, noutEpsilonExp, hinEpsilonExp, nwEpsilonExp);
+        return false;
     }
 
     // Prior to moving on, calculate a reused power term
     // This is an integer value, and should be exact
     // power_term = 2^(n_in - n)
     if (mpfr_ui_pow_ui(ap_power_term, 2UL, n_in - n, MPFR_RNDU) != 0) {
-        mpfr_clears(ap_h_in, ap_entexp, ap_p_high, ap_p_low, ap_denom, ap_inputSpaceSize, ap_diff, ap_power_term, ap_psi, ap_omega, ap_outputEntropy, ap_nw, ap_n_out, NULL);
-        return computeEntropyWithPrecision(precision * 2, h_in, n_in, n, n_out, nw, noutEpsilonExp, hinEpsilonExp, nwEpsilonExp);
+        return false;
     }
 
     // Step 3: Calculate Psi
@@ -248,8 +262,7 @@ static long double computeEntropyWithPrecision(mpfr_prec_t precision, long doubl
 
     // h_in > 0 so Psi > P_high. If this isn't so, then we're doing the calculation at too low of a precision.
     if (mpfr_cmp(ap_p_high, ap_psi) >= 0) {
-        mpfr_clears(ap_h_in, ap_entexp, ap_p_high, ap_p_low, ap_denom, ap_inputSpaceSize, ap_diff, ap_power_term, ap_psi, ap_omega, ap_outputEntropy, ap_nw, ap_n_out, NULL);
-        return computeEntropyWithPrecision(precision * 2, h_in, n_in, n, n_out, nw, noutEpsilonExp, hinEpsilonExp, nwEpsilonExp);
+        return false;
     }
 
     // Psi > 0 is expected
@@ -257,8 +270,7 @@ static long double computeEntropyWithPrecision(mpfr_prec_t precision, long doubl
 
     // If we have equality, then we didn't use adaquate precision.
     if (mpfr_cmp_ui(ap_psi, 0UL) == 0) {
-        mpfr_clears(ap_h_in, ap_entexp, ap_p_high, ap_p_low, ap_denom, ap_inputSpaceSize, ap_diff, ap_power_term, ap_psi, ap_omega, ap_outputEntropy, ap_nw, ap_n_out, NULL);
-        return computeEntropyWithPrecision(precision * 2, h_in, n_in, n, n_out, nw, noutEpsilonExp, hinEpsilonExp, nwEpsilonExp);
+        return false;
     }
 
     // Is psi > 1?
@@ -268,15 +280,8 @@ static long double computeEntropyWithPrecision(mpfr_prec_t precision, long doubl
         mpfr_set_ui(ap_psi, 1UL, MPFR_RNDZ);
     }
 
-    // We're going to need an arbitrary precision version of log(2)
-    // omega = 2
-    if (mpfr_set_ui(ap_omega, 2U, MPFR_RNDZ) != 0) {
-        mpfr_clears(ap_h_in, ap_entexp, ap_p_high, ap_p_low, ap_denom, ap_inputSpaceSize, ap_diff, ap_power_term, ap_psi, ap_omega, ap_outputEntropy, ap_nw, ap_n_out, NULL);
-        return computeEntropyWithPrecision(precision * 2, h_in, n_in, n, n_out, nw, noutEpsilonExp, hinEpsilonExp, nwEpsilonExp);
-    }
-
     // omega = log(2)
-    mpfr_log(ap_omega, ap_omega, MPFR_RNDU);
+    mpfr_set(ap_omega, ce->ap_log2, MPFR_RNDU);
 
     // Step 4: Calculate U (goes into the ap_omega variable)
     mpfr_mul(ap_omega, ap_omega, ap_power_term, MPFR_RNDU); //omega = log(2) 2^(n_in - n)
@@ -292,8 +297,7 @@ static long double computeEntropyWithPrecision(mpfr_prec_t precision, long doubl
 
     if (mpfr_cmp_ui(ap_omega, 0UL) == 0) {
         // Omega is expected to be non-zero for all parameters
-        mpfr_clears(ap_h_in, ap_entexp, ap_p_high, ap_p_low, ap_denom, ap_inputSpaceSize, ap_diff, ap_power_term, ap_psi, ap_omega, ap_outputEntropy, ap_nw, ap_n_out, NULL);
-        return computeEntropyWithPrecision(precision * 2, h_in, n_in, n, n_out, nw, noutEpsilonExp, hinEpsilonExp, nwEpsilonExp);
+        return false;
     }
 
     // Is omega > 1?
@@ -319,14 +323,12 @@ static long double computeEntropyWithPrecision(mpfr_prec_t precision, long doubl
     // Could outputEntropy be valid?
     // We know that n_out > ap_outputEntropy for all finite inputs...
     if (mpfr_cmp_ui(ap_outputEntropy, n_out) >= 0) {
-        mpfr_clears(ap_h_in, ap_entexp, ap_p_high, ap_p_low, ap_denom, ap_inputSpaceSize, ap_diff, ap_power_term, ap_psi, ap_omega, ap_outputEntropy, ap_nw, ap_n_out, NULL);
-        return computeEntropyWithPrecision(precision * 2, h_in, n_in, n, n_out, nw, noutEpsilonExp, hinEpsilonExp, nwEpsilonExp);
+        return false;
     }
 
     //We know that h_in > ap_outputEntropy for all finite inputs...
     if (mpfr_cmp(ap_outputEntropy, ap_h_in) >= 0) {
-        mpfr_clears(ap_h_in, ap_entexp, ap_p_high, ap_p_low, ap_denom, ap_inputSpaceSize, ap_diff, ap_power_term, ap_psi, ap_omega, ap_outputEntropy, ap_nw, ap_n_out, NULL);
-        return computeEntropyWithPrecision(precision * 2, h_in, n_in, n, n_out, nw, noutEpsilonExp, hinEpsilonExp, nwEpsilonExp);
+        return false;
     }
 
     // Check to see if meets the definition of "full entropy".
@@ -334,21 +336,39 @@ static long double computeEntropyWithPrecision(mpfr_prec_t precision, long doubl
     // To be conservative, round so that -log2(epsilon) epsilon is as small as possible
     // (that is epsilon should be as large as possible)
     mpfr_set_ui(ap_n_out, n_out, MPFR_RNDZ);
-    noutEpsilonExp = calculateEpsilon(ap_outputEntropy, ap_n_out, precision);
+    noutEpsilonExp = calculateEpsilon(ce, ap_outputEntropy, ap_n_out);
 
     // We may also be interested in other ways that this output may have been limited.
-    hinEpsilonExp = calculateEpsilon(ap_outputEntropy, ap_h_in, precision);
+    hinEpsilonExp = calculateEpsilon(ce, ap_outputEntropy, ap_h_in);
 
     mpfr_set_ui(ap_nw, nw, MPFR_RNDZ);
-    nwEpsilonExp = calculateEpsilon(ap_outputEntropy, ap_nw, precision);
+    nwEpsilonExp = calculateEpsilon(ce, ap_outputEntropy, ap_nw);
 
     // If we get here, then adequate precision was used
     // Extract a value for display.
     // Note, this may round up, but we'll deal with this later.
     value =  mpfr_get_ld(ap_outputEntropy, MPFR_RNDN);
-    mpfr_clears(ap_h_in, ap_entexp, ap_p_high, ap_p_low, ap_denom, ap_inputSpaceSize, ap_diff, ap_power_term, ap_psi, ap_omega, ap_outputEntropy, ap_nw, ap_n_out, NULL);
 
-    return value;
+    return true;
+}
+
+/*
+ * Compute Output_Entropy, starting at the given precision and doubling it until an attempt succeeds.
+ * At a precision p with h_in <= 2^(-p), 1 - 2^(-h_in) < h_in ln(2) < 2^(-p), so 2^(-h_in) rounds up
+ * to 1 and the attempt is bound to fail; such precisions are skipped without being attempted.
+ */
+static long double computeEntropy(conditioning_engine *ce, mpfr_prec_t precision, long double h_in, unsigned int n_in, unsigned int n, unsigned int n_out, unsigned int nw, long double &noutEpsilonExp, long double &hinEpsilonExp, long double &nwEpsilonExp) {
+    long double value;
+
+    for (;; precision *= 2) {
+        if (h_in <= ldexpl(1.0L, -(int) std::min(precision, (mpfr_prec_t) INT_MAX))) continue;
+
+        // TODO quietmode?
+        printf("Attempting to compute entropy with %ld bits of precision.\n", precision);
+
+        conditioning_engine_set_precision(ce, precision);
+        if (computeEntropyWithPrecision(ce, h_in, n_in, n, n_out, nw, value, noutEpsilonExp, hinEpsilonExp, nwEpsilonExp)) return value;
+    }
 }
 
 //This function performs statistical testing on the bitwise input data.
@@ -441,13 +461,14 @@ static long double computeEntropyOfConditionedData(string inputfilename, bool ii
     return h_bitstring;
 }
 
-int main(int argc, char* argv[]) {
-    bool vetted, quietMode = false, iid = false;
-    long double h_p = -1.0L;
-    long double h_in, h_out;
-    unsigned int n_in, n_out, nw, n;
+/*
+ * Compute h_out for one conditioning configuration, print the results unless in quiet mode, and record
+ * them in tc. h_p is only used for non-vetted conditioning functions.
+ */
+static long double assessConditioning(conditioning_engine *ce, bool vetted, bool quietMode, unsigned int n_in, unsigned int n_out, unsigned int nw, long double h_in, long double h_p, NonIidTestCase &tc) {
+    long double h_out;
+    unsigned int n;
     mpfr_prec_t precision;
-    int opt;
     unsigned int maxval;
 
     long double noutEpsilonExp = -1.0L;
@@ -455,6 +476,180 @@ int main(int argc, char* argv[]) {
     long double nwEpsilonExp = -1.0L;
     long double outputEntropy = -1.0L;
 
+    // Step 2 is invariant, and not subject to precision problems.
+    nw = std::min(nw, n_in); // By 90B Appendix E
+    n = std::min(n_out, nw);
+
+    // Print out the inputs
+    if (!quietMode) {
+        printf("n_in = %u\n", n_in);
+        printf("n_out = %u\n", n_out);
+        printf("nw = %u\n", nw);
+        printf("h_in = %.22Lg\n", h_in);
+        if (!vetted) printf("h' = %.22Lg\n", h_p);
+    }
+
+    // Establish the maximum precision that ought to be necessary
+    // If something goes wrong, we can increase this precision automatically.
+    maxval = 53; // Always be large enough to faithfully represent h_in.
+    maxval = (maxval > n_in) ? maxval : n_in;
+    maxval = (maxval > n_out) ? maxval : n_out;
+    maxval = (maxval > nw) ? maxval : nw;
+    precision = 2 * maxval;
+
+    // Check to see if this environment is going to support the needed exponent range
+    assert(mpfr_get_emax() > maxval);
+    assert(mpfr_get_emin() < -maxval);
+
+    // Compute entropy
+    outputEntropy = computeEntropy(ce, precision, h_in, n_in, n, n_out, nw, noutEpsilonExp, hinEpsilonExp, nwEpsilonExp);
+
+    // Check some basic bounds.
+    assert(outputEntropy <= (long double) n_out);
+    assert(outputEntropy <= h_in);
+    assert(outputEntropy <= (long double) nw);
+    assert(outputEntropy >= 0.0L);
+
+    // We're done with the calculation. Now print results.
+    if (!quietMode) {
+
+        printf("Output_Entropy(*) = %.22Lg", outputEntropy);
+
+        if (outputEntropy == (long double) n_out) {
+            // outputEntropy rounded to full entropy, so the difference between this and full entropy is less than 1/2 ULP.
+            printf("; Close to n_out (epsilon = 2^(-%.22Lg))", noutEpsilonExp);
+        }
+        
+        if (outputEntropy == h_in) {
+            // outputEntropy rounded to the input entropy, so the difference between this and the input entropy is less than 1/2 ULP.
+            printf("; Close to h_in (epsilon = 2^(-%.22Lg))", hinEpsilonExp);
+        }
+
+        if (outputEntropy == (long double) nw) {
+            // outputEntropy rounded to the nw, so the difference between this and nw is less than 1/2 ULP.
+            printf("; Close to nw (epsilon = 2^(-%.22Lg))", nwEpsilonExp);
+        }
+
+        printf("\n");
+    }
+
+    if (vetted) {
+
+        if (!quietMode)
+            printf("(Vetted) h_out = %.22Lg\n", outputEntropy);
+
+        h_out = outputEntropy;
+
+        if (outputEntropy > 0.999L * ((long double) n_out)) {
+
+            //h_out = (1 - epsilon) * n_out
+            if (!quietMode) {
+                printf("epsilon = 2^(-%.22Lg)", noutEpsilonExp);
+
+                //Should this qualify as "full entropy" under FIPS 140-3 IG D.K Resolution 19
+		if (h_in >= n_out + 64.0) {
+                    printf(": FIPS 140-3 IG D.K Resolution 19 Full Entropy if the conditioning component security strength is >= %u", n_out);
+		}
+                printf("\n");
+            }
+        }
+    } else {
+        long double bound90B = 0.999L * ((long double) n_out);
+        long double statBound = h_p * ((long double) n_out);
+
+        //Note, we can't assess as full entropy in this case.
+        if (!quietMode) {
+            printf("0.999 * n_out = %.22Lg\n", bound90B);
+            printf("h' * n_out = %.22Lg\n", statBound);
+        }
+
+        h_out = std::min(outputEntropy, std::min(bound90B, statBound));
+
+        if (!quietMode)
+            printf("(Non-vetted) h_out = %.22Lg\n", h_out);
+    }
+
+    //tc.vetted = vetted;
+    tc.n_in = n_in;
+    tc.n_out = n_out;
+    tc.nw = nw;
+    tc.h_in = h_in;
+    tc.h_out = h_out;
+    tc.h_p = h_p;
+
+    return h_out;
+}
+
+/*
+ * Assess every configuration of a batch file, one per line in the form of the command line arguments:
+ * [-v|-n] <n_in> <n_out> <nw> <h_in> [h']. Empty lines and lines starting with '#' are skipped.
+ */
+static void assessBatch(conditioning_engine *ce, const string &batchfilename, bool quietMode, NonIidTestRun &testRun) {
+    ifstream batch(batchfilename);
+    string line;
+    unsigned int lineNumber = 0;
+
+    if (!batch.is_open()) {
+        printf("Can't open batch file %s\n", batchfilename.c_str());
+        print_usage();
+    }
+
+    while (getline(batch, line)) {
+        vector<string> args;
+        string arg;
+        istringstream tokens(line);
+        bool vetted = true;
+        long double h_p = -1.0L;
+
+        lineNumber++;
+        while (tokens >> arg) args.push_back(arg);
+        if (args.empty() || args[0][0] == '#') continue;
+
+        if (args[0] == "-v" || args[0] == "-n") {
+            vetted = (args[0] == "-v");
+            args.erase(args.begin());
+        }
+
+        if (args.size() != (vetted ? 4U : 5U)) {
+            printf("Incorrect configuration on line %u of %s.\n", lineNumber, batchfilename.c_str());
+            print_usage();
+        }
+
+        const string where = " on line " + to_string(lineNumber);
+        const unsigned int n_in = inputUnsignedOption(args[0].c_str(), 1, UINT_MAX, ("n_in" + where).c_str());
+        const unsigned int n_out = inputUnsignedOption(args[1].c_str(), 1, UINT_MAX, ("n_out" + where).c_str());
+        const unsigned int nw = inputUnsignedOption(args[2].c_str(), 1, UINT_MAX, ("nw" + where).c_str());
+        const long double h_in = inputLongDoubleOption(args[3].c_str(), 0.0L, (long double) n_in, ("h_in" + where).c_str());
+        if (h_in <= 0.0L) {
+            printf("h_in%s must be greater than 0.\n", where.c_str());
+            print_usage();
+        }
+
+        if (!vetted) {
+            h_p = inputLongDoubleOption(args[4].c_str(), 0.0L, 1.0L, ("h_p" + where).c_str());
+            if (h_p <= 0.0L) {
+                printf("h_p%s must be greater than 0.\n", where.c_str());
+                print_usage();
+            }
+        }
+
+        NonIidTestCase tc;
+        const long double h_out = assessConditioning(ce, vetted, quietMode, n_in, n_out, nw, h_in, h_p, tc);
+        tc.testCaseNumber = to_string(testRun.testCases.size() + 1);
+        printf("Configuration %s (line %u): h_out = %.22Lg\n", tc.testCaseNumber.c_str(), lineNumber, h_out);
+        if (!quietMode) printf("\n");
+
+        testRun.testCases.push_back(tc);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bool vetted, quietMode = false, iid = false;
+    long double h_p = -1.0L;
+    long double h_in;
+    unsigned int n_in, n_out, nw;
+    int opt;
+
     // Setting this rounding method helps prevent us from overestimating the input parameters
     fesetround(FE_TOWARDZERO);
 
@@ -464,6 +659,7 @@ int main(int argc, char* argv[]) {
     string timestamp = getCurrentTimestamp();
     string outputfilename;
     string inputfilename;
+    string batchfilename;
     char *file_path;
     string commandline = recreateCommandLine(argc, argv);
     
@@ -475,7 +671,7 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    while ((opt = getopt(argc, argv, "vnqo:i:c:")) != -1) {
+    while ((opt = getopt(argc, argv, "vnqo:i:c:b:")) != -1) {
         switch (opt) {
             case 'v':
                 vetted = true;
@@ -497,6 +693,9 @@ int main(int argc, char* argv[]) {
             case 'c':
                 iid = (strcmp(optarg, "iid") == 0);
                 break;
+            case 'b':
+                batchfilename = optarg;
+                break;
             default:
                 print_usage();
         }
@@ -511,6 +710,30 @@ int main(int argc, char* argv[]) {
     testRunNonIid.type = "Conditioning";
     testRunNonIid.timestamp = timestamp;
     testRunNonIid.commandline = commandline;
+
+    conditioning_engine engine;
+    conditioning_engine_init(&engine);
+
+    if (!batchfilename.empty()) {
+        if (argc != 0 || !inputfilename.empty()) {
+            printf("Incorrect usage.\n");
+            print_usage();
+        }
+
+        assessBatch(&engine, batchfilename, quietMode, testRunNonIid);
+        conditioning_engine_free(&engine);
+
+        testRunNonIid.errorLevel = 0;
+
+        if (jsonOutput) {
+            ofstream output;
+            output.open(outputfilename);
+            output << testRunNonIid.GetAsJson();
+            output.close();
+        }
+
+        return 0;
+    }
     
     if(!inputfilename.empty()) {
         testRunNonIid.filename = inputfilename;
@@ -577,109 +800,11 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    // Step 2 is invariant, and not subject to precision problems.
-    nw = std::min(nw, n_in); // By 90B Appendix E
-    n = std::min(n_out, nw);
-
-    // Print out the inputs
-    if (!quietMode) {
-        printf("n_in = %u\n", n_in);
-        printf("n_out = %u\n", n_out);
-        printf("nw = %u\n", nw);
-        printf("h_in = %.22Lg\n", h_in);
-        if (!vetted) printf("h' = %.22Lg\n", h_p);
-    }
-
-    // Establish the maximum precision that ought to be necessary
-    // If something goes wrong, we can increase this precision automatically.
-    maxval = 53; // Always be large enough to faithfully represent h_in.
-    maxval = (maxval > n_in) ? maxval : n_in;
-    maxval = (maxval > n_out) ? maxval : n_out;
-    maxval = (maxval > nw) ? maxval : nw;
-    precision = 2 * maxval;
-
-    // Check to see if this environment is going to support the needed exponent range
-    assert(mpfr_get_emax() > maxval);
-    assert(mpfr_get_emin() < -maxval);
-
-    // Compute entropy
-    outputEntropy = computeEntropyWithPrecision(precision, h_in, n_in, n, n_out, nw, noutEpsilonExp, hinEpsilonExp, nwEpsilonExp);
-
-    // Check some basic bounds.
-    assert(outputEntropy <= (long double) n_out);
-    assert(outputEntropy <= h_in);
-    assert(outputEntropy <= (long double) nw);
-    assert(outputEntropy >= 0.0L);
-
-    // We're done with the calculation. Now print results.
-    if (!quietMode) {
-
-        printf("Output_Entropy(*) = %.22Lg", outputEntropy);
-
-        if (outputEntropy == (long double) n_out) {
-            // outputEntropy rounded to full entropy, so the difference between this and full entropy is less than 1/2 ULP.
-            printf("; Close to n_out (epsilon = 2^(-%.22Lg))", noutEpsilonExp);
-        }
-        
-        if (outputEntropy == h_in) {
-            // outputEntropy rounded to the input entropy, so the difference between this and the input entropy is less than 1/2 ULP.
-            printf("; Close to h_in (epsilon = 2^(-%.22Lg))", hinEpsilonExp);
-        }
-
-        if (outputEntropy == (long double) nw) {
-            // outputEntropy rounded to the nw, so the difference between this and nw is less than 1/2 ULP.
-            printf("; Close to nw (epsilon = 2^(-%.22Lg))", nwEpsilonExp);
-        }
-
-        printf("\n");
-    }
-
-    if (vetted) {
-
-        if (!quietMode)
-            printf("(Vetted) h_out = %.22Lg\n", outputEntropy);
-
-        h_out = outputEntropy;
-
-        if (outputEntropy > 0.999L * ((long double) n_out)) {
-
-            //h_out = (1 - epsilon) * n_out
-            if (!quietMode) {
-                printf("epsilon = 2^(-%.22Lg)", noutEpsilonExp);
-
-                //Should this qualify as "full entropy" under FIPS 140-3 IG D.K Resolution 19
-		if (h_in >= n_out + 64.0) {
-                    printf(": FIPS 140-3 IG D.K Resolution 19 Full Entropy if the conditioning component security strength is >= %u", n_out);
-		}
-                printf("\n");
-            }
-        }
-    } else {
-        long double bound90B = 0.999L * ((long double) n_out);
-        long double statBound = h_p * ((long double) n_out);
-
-        //Note, we can't assess as full entropy in this case.
-        if (!quietMode) {
-            printf("0.999 * n_out = %.22Lg\n", bound90B);
-            printf("h' * n_out = %.22Lg\n", statBound);
-        }
-
-        h_out = std::min(outputEntropy, std::min(bound90B, statBound));
-
-        if (!quietMode)
-            printf("(Non-vetted) h_out = %.22Lg\n", h_out);
-    }
-
     NonIidTestCase tcOverallnonIid;
+    assessConditioning(&engine, vetted, quietMode, n_in, n_out, nw, h_in, h_p, tcOverallnonIid);
+    conditioning_engine_free(&engine);
 
     tcOverallnonIid.testCaseNumber = "Overall";
-    //tcOverallnonIid.vetted = vetted;
-    tcOverallnonIid.n_in = n_in;
-    tcOverallnonIid.n_out = n_out;
-    tcOverallnonIid.nw = nw;
-    tcOverallnonIid.h_in = h_in;
-    tcOverallnonIid.h_out = h_out;
-    tcOverallnonIid.h_p = h_p;
 
     testRunNonIid.testCases.push_back(tcOverallnonIid);
     testRunNonIid.errorLevel = 0;
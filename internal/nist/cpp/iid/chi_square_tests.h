@@ -374,59 +374,181 @@ double chi_square_pvalue(double x, double k){
 * 	  HELPERS FOR CHI_SQUARE_INDEPENDENCE
 * ---------------------------------------------
 */
-struct tupleTranslateEntry {
-        uint16_t  tuple; //a tuple is rendered into a single value
-        double expectation;
-        int bin;
+
+// Largest tuple table (in entries) that the independence counting kernel still spreads over
+// four sub-histograms. Larger tables stay well out of L1, and repeated tuples are rare there.
+#define CHI_SQUARE_REPLICATED_TUPLES 4096
+
+// The bins of one non-binary test: bin[t] is the bin of tuple (or symbol) t, and bin_exp[b]
+// is the expected count of bin b.
+struct chi_square_binning {
+	vector<uint16_t> bin;
+	vector<double> bin_exp;
+};
+
+// The binning of both non-binary tests depends only on the symbol proportions and the sample
+// size, so it is computed once per probability vector and can be shared by datasets with the
+// same symbol counts (such as the rows and columns of a restart dataset).
+struct chi_square_plan {
+	int sample_size;
+	int alphabet_size;
+	chi_square_binning tuples;
+	chi_square_binning symbols;
 };
 
-void independence_calc_expectations(const vector<double> &p, vector<struct tupleTranslateEntry> &e, const int sample_size){
-	uint16_t index;
+void independence_calc_expectations(const vector<double> &p, vector<double> &e, const int sample_size){
 	assert(p.size() <= UINT8_MAX + 1);
 	for(unsigned long i = 0; i < p.size(); i++){
 		for(unsigned long j = 0; j < p.size(); j++){
-			index = (uint16_t) ((i*p.size()) + j);
-			e[index].tuple = index;
-			e[index].expectation = p[i] * p[j] * floor(sample_size * 0.5);
-			e[index].bin = -1;
+			e[(i*p.size()) + j] = p[i] * p[j] * floor(sample_size * 0.5);
 		}
 	}
 }
 
-void allocate_bins(vector<struct tupleTranslateEntry> &e, vector<double> &bin_exp){
+// Orders the entries by expectation, from smallest to largest, and on ties by index. The
+// expectations are non-negative, so their bit patterns sort as unsigned integers, and a stable
+// LSD radix sort of the indices (which start out in index order) yields exactly this order.
+// Passes on a byte that all the keys share are skipped.
+static void order_by_expectation(const vector<double> &e, vector<uint16_t> &order){
+	const size_t n = e.size();
+	vector<uint64_t> key(n), next_key(n);
+	vector<uint16_t> next_order(n);
+
+	assert(n <= UINT16_MAX + 1);
+	order.resize(n);
+	for(size_t i = 0; i < n; i++){
+		memcpy(&key[i], &e[i], sizeof(uint64_t));
+		order[i] = (uint16_t)i;
+	}
+
+	for(int shift = 0; shift < 64; shift += 8){
+		size_t pos[256] = {0};
+		size_t start = 0;
+
+		for(size_t i = 0; i < n; i++) pos[(key[i] >> shift) & 0xff]++;
+		if(pos[(key[0] >> shift) & 0xff] == n) continue;
+
+		for(int d = 0; d < 256; d++){
+			size_t count = pos[d];
+			pos[d] = start;
+			start += count;
+		}
+
+		for(size_t i = 0; i < n; i++){
+			size_t dst = pos[(key[i] >> shift) & 0xff]++;
+			next_key[dst] = key[i];
+			next_order[dst] = order[i];
+		}
+
+		key.swap(next_key);
+		order.swap(next_order);
+	}
+}
+
+// Allocates the entries, taken in expectation order, into bins with an expected count of at least 5
+void allocate_bins(const vector<double> &e, const vector<uint16_t> &order, chi_square_binning &b){
 	int current_bin = 0;
 	double current_expectation = 0.0;
 
-	for(unsigned int i = 0; i < e.size(); i++){
+	b.bin.assign(e.size(), 0);
+	b.bin_exp.clear();
+
+	for(unsigned int i = 0; i < order.size(); i++){
 		if(current_expectation >= 5.0) {
-			bin_exp.push_back(current_expectation);
+			b.bin_exp.push_back(current_expectation);
 			current_bin ++;
 			current_expectation = 0.0;
 		}
 
-		e[i].bin = current_bin;
-		current_expectation += e[i].expectation;
+		b.bin[order[i]] = current_bin;
+		current_expectation += e[order[i]];
 	}
 
 	//If the current_bin is 0, we can't combine anything
 	if((current_bin != 0) && (current_expectation < 5.0)) {
 		//Combine the last two bins
-		for(unsigned int i =  e.size() - 1; e[i].bin == current_bin; i--) {
-			e[i].bin = current_bin - 1;
+		for(unsigned int i =  order.size() - 1; b.bin[order[i]] == current_bin; i--) {
+			b.bin[order[i]] = current_bin - 1;
 		}
-		bin_exp[current_bin-1] += current_expectation;
+		b.bin_exp[current_bin-1] += current_expectation;
 	} else {
-		bin_exp.push_back(current_expectation);
+		b.bin_exp.push_back(current_expectation);
 	}
 }
 
-void independence_calc_observed(const uint8_t data[], const vector<struct tupleTranslateEntry> &e, vector<int> &o, const int sample_size, const int alphabet_size){
-	for(int j = 0; j < sample_size-1; j+=2){
-		uint16_t index = (uint16_t)((data[j] * alphabet_size) + data[j+1]);
-		o[e[index].bin]++;
+void chi_square_plan_init(chi_square_plan *plan, const uint8_t data[], const int sample_size, const int alphabet_size){
+	plan->sample_size = sample_size;
+	plan->alphabet_size = alphabet_size;
+	plan->tuples.bin.clear();
+	plan->tuples.bin_exp.clear();
+	plan->symbols.bin.clear();
+	plan->symbols.bin_exp.clear();
+
+	// The binary tests bin nothing
+	if(alphabet_size == 2) return;
+
+	// Proportion of each element to the entire set
+	vector<double> p(alphabet_size, 0.0);
+	calc_proportions(data, p, sample_size);
+
+	vector<double> e(alphabet_size*alphabet_size);
+	vector<uint16_t> order;
+
+	// Independence: the expected number of occurrences of each possible pair of symbols
+	independence_calc_expectations(p, e, sample_size);
+	order_by_expectation(e, order);
+	allocate_bins(e, order, plan->tuples);
+
+	// Goodness of fit: the expected number of occurrences of each symbol in each tenth of the data
+	e.resize(alphabet_size);
+	for(long int j=0; j < alphabet_size; j++) {
+		e[j] = p[j] * floor((double) sample_size / 10.0);
+	}
+	order_by_expectation(e, order);
+	allocate_bins(e, order, plan->symbols);
+}
+
+// Counts the non-overlapping pairs of symbols by tuple. K is the alphabet size when it is known at
+// compile time (so the tuple index of the common alphabets is a shift), or 0 to use alphabet_size.
+// Small tables are counted in four sub-histograms, so that runs of the same tuple do not wait on
+// each other's increments, and merged at the end.
+template <int K> static void independence_count_tuples(const uint8_t data[], vector<int> &counts, const int sample_size, const int alphabet_size){
+	const int k = (K > 0) ? K : alphabet_size;
+	const int tuples = k*k;
+	const int pairs = sample_size / 2;
+	int j = 0;
+
+	if(tuples <= CHI_SQUARE_REPLICATED_TUPLES){
+		vector<int> sub(4*tuples, 0);
+		int *h0 = sub.data(), *h1 = h0 + tuples, *h2 = h1 + tuples, *h3 = h2 + tuples;
+
+		for(; j + 4 <= pairs; j += 4){
+			const uint8_t *s = data + 2*j;
+			h0[(s[0] * k) + s[1]]++;
+			h1[(s[2] * k) + s[3]]++;
+			h2[(s[4] * k) + s[5]]++;
+			h3[(s[6] * k) + s[7]]++;
+		}
+
+		for(int t = 0; t < tuples; t++) counts[t] += h0[t] + h1[t] + h2[t] + h3[t];
+	}
+
+	for(; j < pairs; j++){
+		counts[(data[2*j] * k) + data[2*j+1]]++;
 	}
 }
 
+void independence_calc_observed(const uint8_t data[], const chi_square_binning &b, vector<int> &o, const int sample_size, const int alphabet_size){
+	vector<int> counts(b.bin.size(), 0);
+
+	assert(b.bin.size() == (size_t)(alphabet_size*alphabet_size));
+	if(alphabet_size == 16) independence_count_tuples<16>(data, counts, sample_size, alphabet_size);
+	else if(alphabet_size == 256) independence_count_tuples<256>(data, counts, sample_size, alphabet_size);
+	else independence_count_tuples<0>(data, counts, sample_size, alphabet_size);
+
+	for(unsigned int t = 0; t < b.bin.size(); t++) o[b.bin[t]] += counts[t];
+}
+
 double calc_T(const vector<double> &bin_expectations, const vector<int> &o){
 	double T = 0.0;
 
@@ -442,9 +564,22 @@ double calc_T(const vector<double> &bin_expectations, const vector<int> &o){
 	return T;
 }
 
-void goodness_of_fit_calc_observed(const uint8_t data[], const vector<struct tupleTranslateEntry> &e, vector<int> &o, const int sample_size){
-	for(int j = 0; j < sample_size; j++){
-		o[e[data[j]].bin]++;
+// Counts the symbols in four sub-histograms (as independence_count_tuples does), then adds them up by bin
+void goodness_of_fit_calc_observed(const uint8_t data[], const chi_square_binning &b, vector<int> &o, const int sample_size){
+	int sub[4][UINT8_MAX + 1] = {{0}};
+	int j = 0;
+
+	assert(b.bin.size() <= UINT8_MAX + 1);
+	for(; j + 4 <= sample_size; j += 4){
+		sub[0][data[j]]++;
+		sub[1][data[j+1]]++;
+		sub[2][data[j+2]]++;
+		sub[3][data[j+3]]++;
+	}
+	for(; j < sample_size; j++) sub[0][data[j]]++;
+
+	for(unsigned int s = 0; s < b.bin.size(); s++){
+		o[b.bin[s]] += sub[0][s] + sub[1][s] + sub[2][s] + sub[3][s];
 	}
 }
 
@@ -519,42 +654,18 @@ void binary_chi_square_independence(const uint8_t data[], double &score, int &df
 	df = pow(2, m) - 2;
 }
 
-bool expectationOrder(const struct tupleTranslateEntry &a, const struct tupleTranslateEntry &b){
-	if(a.expectation != b.expectation) return a.expectation < b.expectation;
-	else return a.tuple < b.tuple;
-}
-
-bool tupleOrder(const struct tupleTranslateEntry &a, const struct tupleTranslateEntry &b){
-	return a.tuple < b.tuple;
-}
-
-void chi_square_independence(const uint8_t data[], double &score, int &df,  const int sample_size, const int alphabet_size){
-	// Proportion of each element to the entire set
-	vector<double> p(alphabet_size, 0.0);
-	calc_proportions(data, p, sample_size);
-
-	// Calculate the expected number of occurrences for each possible pair of symbols
-	vector<struct tupleTranslateEntry> e(alphabet_size*alphabet_size);
-	independence_calc_expectations(p, e, sample_size);
-	//Sort by expectation, from smallest to largest. Secondary sort on tuple value, from smallest to largest
-	sort(e.begin(), e.end(), expectationOrder);
-
-	// Allocate sorted expected values into bins and accumulate corresponding expected values of entire bins
-	vector<double> bin_expectations;
-	allocate_bins(e, bin_expectations);
+void chi_square_independence(const chi_square_plan *plan, const uint8_t data[], double &score, int &df){
+	const chi_square_binning &b = plan->tuples;
 
-	//Sort by tuple, from smallest to largest, so we can use this as a lookup table
-	sort(e.begin(), e.end(), tupleOrder);
-	
-	// Calculate the observed frequency of each pair of symbols
-	vector<int> o(bin_expectations.size(), 0);
-	independence_calc_observed(data, e, o, sample_size, alphabet_size);
+	// Calculate the observed frequency of each bin of pairs of symbols
+	vector<int> o(b.bin_exp.size(), 0);
+	independence_calc_observed(data, b, o, plan->sample_size, plan->alphabet_size);
 
 	// Calcualte T 
-	score = calc_T(bin_expectations, o);
+	score = calc_T(b.bin_exp, o);
 
 	// Return score and degrees of freedom
-	df = bin_expectations.size() - alphabet_size;
+	df = b.bin_exp.size() - plan->alphabet_size;
 }
 
 void binary_goodness_of_fit(const uint8_t data[], double &score, int &df, const int sample_size){
@@ -593,47 +704,31 @@ void binary_goodness_of_fit(const uint8_t data[], double &score, int &df, const
 	df = 9;
 }
 
-void goodness_of_fit(const uint8_t data[], double &score, int &df, const int sample_size, const int alphabet_size){
-        vector<double> p(alphabet_size, 0.0);
-        calc_proportions(data, p, sample_size);
-
-        // Calculate the expected number of occurrences for each possible pair of symbols
-        // Calculate the expected number of occurrences for each possible pair of symbols
-        vector<struct tupleTranslateEntry> e(alphabet_size);
-	for(long int j=0; j < alphabet_size; j++) {
-		e[j].tuple = j;
-		e[j].expectation = p[j] * floor((double) sample_size / 10.0);
-		e[j].bin = -1;
-	}
 
-        //Sort by expectation, from smallest to largest. Secondary sort on tuple value, from smallest to largest
-        sort(e.begin(), e.end(), expectationOrder);
-
-        // Allocate sorted expected values into bins and accumulate corresponding expected values of entire bins
-        vector<double> bin_expectations;
-        allocate_bins(e, bin_expectations);
-
-        //Sort by tuple, from smallest to largest, so we can use this as a lookup table
-        sort(e.begin(), e.end(), tupleOrder);
+void goodness_of_fit(const chi_square_plan *plan, const uint8_t data[], double &score, int &df){
+	const chi_square_binning &b = plan->symbols;
 
 	// Calculate the observed frequency of each symbol in each subset
-	int block_size = sample_size/10;
+	int block_size = plan->sample_size/10;
 	double T = 0.0;
-	vector<int> o(bin_expectations.size());
+	vector<int> o(b.bin_exp.size());
 
 	for(int j=0; j<10; j++) {
 		for(unsigned int i=0; i<o.size(); i++) o[i] = 0;
-		goodness_of_fit_calc_observed(data+j*block_size, e, o, block_size);
-		T += calc_T(bin_expectations, o);
+		goodness_of_fit_calc_observed(data+j*block_size, b, o, block_size);
+		T += calc_T(b.bin_exp, o);
 	}
 
 	// Return score and degrees of freedom
 	score = T;
-	df = 9*(bin_expectations.size()-1);
+	df = 9*(b.bin_exp.size()-1);
 }
 
-bool chi_square_tests(const uint8_t data[], const int sample_size, const int alphabet_size, const int verbose){
+// Runs both chi-square tests on data[], which must have the symbol counts the plan was computed from
+bool chi_square_tests(const chi_square_plan *plan, const uint8_t data[], const int verbose){
 
+	const int sample_size = plan->sample_size;
+	const int alphabet_size = plan->alphabet_size;
 	double score = 0.0;
 	double pvalue;
 	int df = 0;
@@ -643,7 +738,7 @@ bool chi_square_tests(const uint8_t data[], const int sample_size, const int alp
 	if(alphabet_size == 2){
 		binary_chi_square_independence(data, score, df, sample_size);
 	}else{
-		chi_square_independence(data, score, df, sample_size, alphabet_size);
+		chi_square_independence(plan, data, score, df);
 	}
 
 	pvalue = chi_square_pvalue(score, df);
@@ -673,7 +768,7 @@ bool chi_square_tests(const uint8_t data[], const int sample_size, const int alp
 	if(alphabet_size == 2){
 		binary_goodness_of_fit(data, score, df, sample_size);
 	}else{
-		goodness_of_fit(data, score, df, sample_size, alphabet_size);
+		goodness_of_fit(plan, data, score, df);
 	}
 
 	pvalue = chi_square_pvalue(score, df);
@@ -697,3 +792,10 @@ bool chi_square_tests(const uint8_t data[], const int sample_size, const int alp
 
 	return result;
 }
+
+bool chi_square_tests(const uint8_t data[], const int sample_size, const int alphabet_size, const int verbose){
+	chi_square_plan plan;
+
+	chi_square_plan_init(&plan, data, sample_size, alphabet_size);
+	return chi_square_tests(&plan, data, verbose);
+}
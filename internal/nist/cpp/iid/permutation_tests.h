@@ -11,8 +11,28 @@
 const unsigned int num_tests = 19;
 const string test_names[] = {"excursion","numDirectionalRuns","lenDirectionalRuns","numIncreasesDecreases","numRunsMedian","lenRunsMedian","avgCollision","maxCollision","periodicity(1)","periodicity(2)","periodicity(8)","periodicity(16)","periodicity(32)","covariance(1)","covariance(2)","covariance(8)","covariance(16)","covariance(32)","compression"};
 
+// Largest number of permutations a thread runs between merges into the shared counters
+#define PERM_CHUNK_MAX 64
+
+// Number of RNG streams the permutation rounds are split into. Stream k jumps the seed k * 2^128
+// calls ahead and runs its own contiguous block of rounds starting from the unpermuted data, so
+// the permutations tried depend only on the seed, not on how many threads share the streams.
+#define PERM_STREAMS 64
+
+// Outcome of a permuted statistic relative to the unpermuted one; doubles as the column of C
+#define PERM_OUTCOME_GREATER 0
+#define PERM_OUTCOME_EQUAL 1
+#define PERM_OUTCOME_LESS 2
+#define PERM_OUTCOME_SKIPPED 3
+
 using namespace std;
 
+// Optional instrumentation of a permutation_tests() run
+struct permutation_stats {
+	long executed;              // Permutations shuffled and tested, summed over all threads
+	int decided_at[num_tests];  // Permutations counted when the statistic was decided, -1 if it never was
+};
+
 /*
  * ---------------------------------------------
  * 	  TASKS FOR PERMUTATION TESTS
@@ -279,182 +299,520 @@ unsigned long int covariance(const uint8_t data[], const unsigned int p, const u
 	return T;
 }
 
+// Number of bzip2 work areas that can be cached by a compression_arena.
+// A compressor needs four of them (state, arr1, arr2 and ftab).
+#define BZ_ARENA_SLOTS 8
+
+// Scratch space for the compression test, reused across permutations.
+// Holds the decimal text, the output buffer and the bzip2 work areas, so that
+// after the first call no memory is allocated (or page-faulted in) per permutation.
+// Each thread must use its own arena.
+struct compression_arena {
+	char *msg;
+	size_t msg_cap;
+	char *dest;
+	size_t dest_cap;
+	void *bz_block[BZ_ARENA_SLOTS];
+	size_t bz_size[BZ_ARENA_SLOTS];
+	bool bz_used[BZ_ARENA_SLOTS];
+};
+
+void compression_arena_init(compression_arena *ca){
+	ca->msg = NULL;
+	ca->msg_cap = 0;
+	ca->dest = NULL;
+	ca->dest_cap = 0;
+	for(int i = 0; i < BZ_ARENA_SLOTS; ++i){
+		ca->bz_block[i] = NULL;
+		ca->bz_size[i] = 0;
+		ca->bz_used[i] = false;
+	}
+}
+
+void compression_arena_free(compression_arena *ca){
+	scratch_free(ca->msg);
+	scratch_free(ca->dest);
+	for(int i = 0; i < BZ_ARENA_SLOTS; ++i) scratch_free(ca->bz_block[i]);
+	compression_arena_init(ca);
+}
+
+// bzip2 allocator callbacks that hand out (and take back) the arena's cached work areas.
+// bzip2 only requires malloc semantics, so a recycled block is as good as a fresh one.
+void *compression_arena_bzalloc(void *opaque, int items, int size){
+	compression_arena *ca = (compression_arena *)opaque;
+	size_t bytes = (size_t)items * (size_t)size;
+	int empty = -1;
+
+	for(int i = 0; i < BZ_ARENA_SLOTS; ++i){
+		if(ca->bz_used[i]) continue;
+		if((ca->bz_block[i] != NULL) && (ca->bz_size[i] == bytes)){
+			ca->bz_used[i] = true;
+			return ca->bz_block[i];
+		}
+		if((ca->bz_block[i] == NULL) && (empty < 0)) empty = i;
+	}
+
+	// Sizes only change if the compressor parameters do; fall back to the heap if the cache is full
+	if(empty < 0) return scratch_alloc(bytes);
+
+	ca->bz_block[empty] = scratch_alloc(bytes);
+	if(ca->bz_block[empty] == NULL) return NULL;
+	ca->bz_size[empty] = bytes;
+	ca->bz_used[empty] = true;
+	return ca->bz_block[empty];
+}
+
+void compression_arena_bzfree(void *opaque, void *addr){
+	compression_arena *ca = (compression_arena *)opaque;
+
+	if(addr == NULL) return;
+	for(int i = 0; i < BZ_ARENA_SLOTS; ++i){
+		if(ca->bz_block[i] == addr){
+			ca->bz_used[i] = false;
+			return;
+		}
+	}
+	scratch_free(addr);
+}
+
 // 5.1.11 Compression Test
 // Compresses the data using bzip2 and determines the length
 // of the resulting compressed data
 //
 // Can handle binary and non-binary data
-unsigned int compression(const uint8_t data[], const int sample_size, const uint8_t max_symbol){
-	char *msg;
+unsigned int compression(const uint8_t data[], const int sample_size, const uint8_t max_symbol, compression_arena *ca){
 	unsigned int curlen = 0;
 	char *curmsg;
+	size_t needed;
 
 	assert(max_symbol > 0);
 
 	// Build string of bytes
 	// Reserve the necessary size sample_size*(floor(log10(max_symbol))+2)
 	// This is "worst case" and accounts for the space at the end of the number, as well.
-	msg = new char[(size_t)(floor(log10(max_symbol))+2.0)*sample_size+1];
-	msg[0] = '\0';
-	curmsg = msg;
+	needed = (size_t)(floor(log10(max_symbol))+2.0)*sample_size+1;
+	if(ca->msg_cap < needed){
+		scratch_free(ca->msg);
+		ca->msg = scratch_array<char>(needed);
+		ca->msg_cap = needed;
+	}
+	curmsg = ca->msg;
 
+	// Same text as sprintf(curmsg, "%u ", data[i])
 	for(int i = 0; i < sample_size; ++i) {
-		int res;
-		res = sprintf(curmsg, "%u ", data[i]);
-		assert(res >= 2);
-		curlen += res;
-		curmsg += res;
+		uint8_t v = data[i];
+		if(v >= 100){
+			*curmsg++ = '0' + v/100;
+			*curmsg++ = '0' + (v/10)%10;
+		}else if(v >= 10){
+			*curmsg++ = '0' + v/10;
+		}
+		*curmsg++ = '0' + v%10;
+		*curmsg++ = ' ';
 	}
+	curlen = curmsg - ca->msg;
 
 	if(curlen > 0) {
 		// Remove the extra ' ' at the end
-		assert(curmsg > msg);
-		curmsg--;
-		*curmsg = '\0';
 		curlen--;
 	}
+	ca->msg[curlen] = '\0';
 
 	// Set up structures for compression
 	unsigned int dest_len = ceil(1.01*curlen) + 600;
-	char* dest = new char[dest_len];
+	if(ca->dest_cap < dest_len){
+		scratch_free(ca->dest);
+		ca->dest = scratch_array<char>(dest_len);
+		ca->dest_cap = dest_len;
+	}
+
+	// Compress and capture the size of the compressed data.
+	// This is BZ2_bzBuffToBuffCompress(dest, &dest_len, msg, curlen, 5, 0, 0) with the arena as allocator.
+	bz_stream strm;
+	int rc;
+
+	strm.bzalloc = compression_arena_bzalloc;
+	strm.bzfree = compression_arena_bzfree;
+	strm.opaque = ca;
+
+	rc = BZ2_bzCompressInit(&strm, 5, 0, 0);
+	if(rc != BZ_OK) return 0;
 
-	// Compress and capture the size of the compressed data
-	int rc = BZ2_bzBuffToBuffCompress(dest, &dest_len, msg, curlen, 5, 0, 0);
+	strm.next_in = ca->msg;
+	strm.next_out = ca->dest;
+	strm.avail_in = curlen;
+	strm.avail_out = dest_len;
 
-	// Free memory
-	delete[](dest);
-	delete[](msg);
+	rc = BZ2_bzCompress(&strm, BZ_FINISH);
+	dest_len -= strm.avail_out;
+	BZ2_bzCompressEnd(&strm);
 
 	// Return with proper return code
-	if(rc == BZ_OK){
+	if(rc == BZ_STREAM_END){
 		return dest_len;
 	}else{
 		return 0;
 	}
 }
 
+unsigned int compression(const uint8_t data[], const int sample_size, const uint8_t max_symbol){
+	compression_arena ca;
+	unsigned int ret;
+
+	compression_arena_init(&ca);
+	ret = compression(data, sample_size, max_symbol, &ca);
+	compression_arena_free(&ca);
+
+	return ret;
+}
+
 /*
  * ---------------------------------------------
  * 	  HELPERS FOR PERMUTATION TEST ITERATION
  * ---------------------------------------------
  */
 
-void excursion_test(const uint8_t data[], const double rawmean, const int sample_size, long double* stats, const bool *test_status){
+// Lags used by the periodicity (5.1.9) and covariance (5.1.10) tests
+const unsigned int num_lags = 5;
+const unsigned int test_lags[num_lags] = {1, 2, 8, 16, 32};
 
-	if(test_status[0]) stats[0] = excursion(data, rawmean, sample_size);
-}
+// Largest entry of test_lags
+#define MAX_LAG 32
 
-void directional_tests(const uint8_t data[], const int alphabet_size, const int sample_size, long double *stats, const bool *test_status){
+// Number of positions handed to a lag kernel at a time. The block and its history stay in L1,
+// and the kernels' 32-bit per-block accumulators cannot overflow.
+#define LAG_BLOCK 4096
 
-	vector<int> alt_seq;
+// Adds the 5.1.9 and 5.1.10 terms for positions 0 .. count-1 of sym / val to period and cov, for
+// every lag in test_lags. sym and val must be readable from index -MAX_LAG on.
+typedef void (*lag_kernel)(const uint8_t sym[], const uint8_t val[], const unsigned int count, unsigned int period[], unsigned long int cov[]);
 
-	if(test_status[1] || test_status[2] || test_status[3]) {
-		if(alphabet_size == 2){
-			vector<uint8_t> cs1 = conversion1(data, sample_size);
-			alt_seq = alt_sequence1(cs1.data(), cs1.size());		// conversion1 reduces the total size by a factor of 8
-		}else{
-			alt_seq = alt_sequence1(data, sample_size);
+void lag_kernel_scalar(const uint8_t sym[], const uint8_t val[], const unsigned int count, unsigned int period[], unsigned long int cov[]){
+	for(unsigned int l = 0; l < num_lags; ++l){
+		const int p = test_lags[l];
+		unsigned int T = 0;
+		unsigned int C = 0;
+
+		for(unsigned int j = 0; j < count; ++j){
+			T += (sym[j] == sym[(int)j-p]);
+			C += val[j] * val[(int)j-p];
 		}
 
-		if(test_status[1]) stats[1] = num_directional_runs(alt_seq);
-		if(test_status[2]) stats[2] = len_directional_runs(alt_seq);
-		if(test_status[3]) stats[3] = num_increases_decreases(alt_seq);
+		period[l] += T;
+		cov[l] += C;
 	}
 }
 
-void consecutive_runs_tests(const uint8_t data[], const double median, const int alphabet_size, const int sample_size, long double *stats, const bool *test_status){
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
 
-	vector<int> alt_seq;
+// Handles 32 positions per step for all five lags. Built for AVX2 regardless of the compiler
+// flags; select_lag_kernel only hands it out when the CPU supports it.
+__attribute__((target("avx2,popcnt")))
+void lag_kernel_avx2(const uint8_t sym[], const uint8_t val[], const unsigned int count, unsigned int period[], unsigned long int cov[]){
+	__m256i acc[num_lags];
+	unsigned int T[num_lags];
+	unsigned int j = 0;
 
-	if(test_status[4] || test_status[5]) {
-		if(alphabet_size == 2){
-			alt_seq = alt_sequence2(data, 0.5, sample_size);
-		}else{
-			alt_seq = alt_sequence2(data, median, sample_size);
+	assert(count <= LAG_BLOCK);
+
+	for(unsigned int l = 0; l < num_lags; ++l){
+		acc[l] = _mm256_setzero_si256();
+		T[l] = 0;
+	}
+
+	for(; j + 32 <= count; j += 32){
+		const __m256i s = _mm256_loadu_si256((const __m256i *)(sym + j));
+		const __m256i vlo = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(val + j)));
+		const __m256i vhi = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(val + j + 16)));
+
+		for(unsigned int l = 0; l < num_lags; ++l){
+			const int p = test_lags[l];
+			const __m256i t = _mm256_loadu_si256((const __m256i *)(sym + j - p));
+			const __m256i ulo = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(val + j - p)));
+			const __m256i uhi = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(val + j + 16 - p)));
+
+			T[l] += __builtin_popcount((unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(s, t)));
+			acc[l] = _mm256_add_epi32(acc[l], _mm256_madd_epi16(vlo, ulo));
+			acc[l] = _mm256_add_epi32(acc[l], _mm256_madd_epi16(vhi, uhi));
 		}
+	}
 
-		if(test_status[4]) stats[4] = num_directional_runs(alt_seq);
-		if(test_status[5]) stats[5] = len_directional_runs(alt_seq);
+	for(unsigned int l = 0; l < num_lags; ++l){
+		uint32_t lanes[8];
+		_mm256_storeu_si256((__m256i *)lanes, acc[l]);
+		for(unsigned int k = 0; k < 8; ++k) cov[l] += lanes[k];
+		period[l] += T[l];
 	}
+
+	if(j < count) lag_kernel_scalar(sym + j, val + j, count - j, period, cov);
 }
+#endif
 
-void collision_tests(const uint8_t data[], const int alphabet_size, const int sample_size, long double *stats, const bool *test_status){
+#if defined(__aarch64__)
+#include <arm_neon.h>
 
-	vector<unsigned int> col_seq;
+// Handles 16 positions per step for all five lags. NEON is part of the AArch64 baseline.
+void lag_kernel_neon(const uint8_t sym[], const uint8_t val[], const unsigned int count, unsigned int period[], unsigned long int cov[]){
+	const uint8x16_t one = vdupq_n_u8(1);
+	uint32x4_t acc[num_lags];
+	unsigned int T[num_lags];
+	unsigned int j = 0;
 
-	if(test_status[7] || test_status[6]) {
-		if(alphabet_size == 2){
-			vector<uint8_t> cs2 = conversion2(data, sample_size);
-			col_seq = find_collisions(cs2.data(), cs2.size(), 256);		// conversion2 reduces the total size by a factor of 8
-		}else{
-			col_seq = find_collisions(data, sample_size, alphabet_size);
+	assert(count <= LAG_BLOCK);
+
+	for(unsigned int l = 0; l < num_lags; ++l){
+		acc[l] = vdupq_n_u32(0);
+		T[l] = 0;
+	}
+
+	for(; j + 16 <= count; j += 16){
+		const uint8x16_t s = vld1q_u8(sym + j);
+		const uint8x16_t v = vld1q_u8(val + j);
+
+		for(unsigned int l = 0; l < num_lags; ++l){
+			const int p = test_lags[l];
+			const uint8x16_t t = vld1q_u8(sym + j - p);
+			const uint8x16_t u = vld1q_u8(val + j - p);
+
+			T[l] += vaddvq_u8(vandq_u8(vceqq_u8(s, t), one));
+			acc[l] = vpadalq_u16(acc[l], vmull_u8(vget_low_u8(v), vget_low_u8(u)));
+			acc[l] = vpadalq_u16(acc[l], vmull_high_u8(v, u));
 		}
+	}
 
-		if(test_status[6]) stats[6] = avg_collision(col_seq);
-		if(test_status[7]) stats[7] = max_collision(col_seq);
+	for(unsigned int l = 0; l < num_lags; ++l){
+		cov[l] += vaddvq_u32(acc[l]);
+		period[l] += T[l];
 	}
-}
 
-void periodicity_tests(const uint8_t data[], const int alphabet_size, const int sample_size,long double *stats, const bool *test_status){
+	if(j < count) lag_kernel_scalar(sym + j, val + j, count - j, period, cov);
+}
+#endif
+
+// Picks the widest lag kernel the running CPU supports
+lag_kernel select_lag_kernel(){
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) return lag_kernel_avx2;
+#elif defined(__aarch64__)
+	return lag_kernel_neon;
+#endif
+	return lag_kernel_scalar;
+}
 
-	if(test_status[8] || test_status[9] || test_status[10] || test_status[11] || test_status[12]) {
-		if(alphabet_size == 2){
-			vector<uint8_t> cs1 = conversion1(data, sample_size);
-			if(test_status[8]) stats[8] = periodicity(cs1.data(), 1, cs1.size());
-			if(test_status[9]) stats[9] = periodicity(cs1.data(), 2, cs1.size());
-			if(test_status[10]) stats[10] = periodicity(cs1.data(), 8, cs1.size());
-			if(test_status[11]) stats[11] = periodicity(cs1.data(), 16, cs1.size());
-			if(test_status[12]) stats[12] = periodicity(cs1.data(), 32, cs1.size());
-		}else{
-			if(test_status[8]) stats[8] = periodicity(data, 1, sample_size);
-			if(test_status[9]) stats[9] = periodicity(data, 2, sample_size);
-			if(test_status[10]) stats[10] = periodicity(data, 8, sample_size);
-			if(test_status[11]) stats[11] = periodicity(data, 16, sample_size);
-			if(test_status[12]) stats[12] = periodicity(data, 32, sample_size);
+// Adds the 5.1.9 and 5.1.10 terms for positions first .. first+count-1 of a sequence to period
+// and cov. sym and val point at position first, and must be readable from min(first, MAX_LAG)
+// positions before it; lags that reach before the start of the sequence are skipped.
+void lag_tests(const uint8_t sym[], const uint8_t val[], const unsigned long int first, const unsigned int count, unsigned int period[], unsigned long int cov[]){
+	static const lag_kernel kernel = select_lag_kernel();
+	unsigned int j = 0;
+
+	for(; (j < count) && (first + j < MAX_LAG); ++j){
+		for(unsigned int l = 0; l < num_lags; ++l){
+			if(first + j >= test_lags[l]){
+				if(sym[j] == sym[(long int)j-test_lags[l]]) ++period[l];
+				cov[l] += val[j] * val[(long int)j-test_lags[l]];
+			}
 		}
 	}
+
+	if(j < count) kernel(sym + j, val + j, count - j, period, cov);
+}
+
+// Streaming equivalent of num_directional_runs, len_directional_runs and
+// num_increases_decreases, fed one alt_sequence value at a time.
+struct run_state {
+	unsigned int len;
+	unsigned int num_runs;
+	unsigned int max_run;
+	unsigned int run;
+	unsigned int pos;
+	int last;
+};
+
+void run_init(run_state *rs){
+	rs->len = 0;
+	rs->num_runs = 0;
+	rs->max_run = 0;
+	rs->run = 1;
+	rs->pos = 0;
+	rs->last = 0;
+}
+
+void run_push(run_state *rs, const int v){
+	if(rs->len == 0){
+		rs->num_runs = 1;
+	}else if(v == rs->last){
+		++rs->run;
+	}else{
+		++rs->num_runs;
+		if(rs->run > rs->max_run) rs->max_run = rs->run;
+		rs->run = 1;
+	}
+
+	if(v == 1) ++rs->pos;
+	rs->last = v;
+	++rs->len;
 }
 
-void covariance_tests(const uint8_t data[], const int alphabet_size, const int sample_size, long double *stats, const bool *test_status){
+unsigned int run_longest(const run_state *rs){
+	return max(rs->max_run, rs->run);
+}
 
-	if(test_status[13] || test_status[14] || test_status[15] || test_status[16] || test_status[17]) {
-		if(alphabet_size == 2){
-			vector<uint8_t> cs1 = conversion1(data, sample_size);
-			if(test_status[13]) stats[13] = covariance(cs1.data(), 1, cs1.size());		// top should be cs1
-			if(test_status[14]) stats[14]  = covariance(cs1.data(), 2, cs1.size());
-			if(test_status[15]) stats[15]  = covariance(cs1.data(), 8, cs1.size());
-			if(test_status[16]) stats[16]  = covariance(cs1.data(), 16, cs1.size());
-			if(test_status[17]) stats[17]  = covariance(cs1.data(), 32, cs1.size());
-		}else{
-			if(test_status[13]) stats[13]  = covariance(data, 1, sample_size);
-			if(test_status[14]) stats[14] = covariance(data, 2, sample_size);
-			if(test_status[15]) stats[15] = covariance(data, 8, sample_size);
-			if(test_status[16]) stats[16] = covariance(data, 16, sample_size);
-			if(test_status[17]) stats[17] = covariance(data, 32, sample_size);
+// Streaming equivalent of find_collisions, keeping only what 5.1.7 and 5.1.8 need.
+// Symbols seen in the current window are marked with the window's generation number,
+// so starting a new window never needs to clear the table.
+struct collision_state {
+	unsigned int seen[256];
+	unsigned int gen;
+	unsigned int cur;
+	unsigned int count;
+	unsigned int total;
+	unsigned int max;
+};
+
+void collision_init(collision_state *cs){
+	memset(cs->seen, 0, sizeof(cs->seen));
+	cs->gen = 1;
+	cs->cur = 0;
+	cs->count = 0;
+	cs->total = 0;
+	cs->max = 0;
+}
+
+void collision_push(collision_state *cs, const uint8_t v){
+	if(cs->seen[v] == cs->gen){
+		++cs->cur;
+		++cs->count;
+		cs->total += cs->cur;
+		if(cs->max < cs->cur) cs->max = cs->cur;
+		++cs->gen;
+		cs->cur = 0;
+	}else{
+		cs->seen[v] = cs->gen;
+		++cs->cur;
+	}
+}
+
+// Computes statistics 0 through 17 (everything except compression) in one pass over the sequence.
+// Produces the same values as excursion, the alt_sequence based run tests, find_collisions,
+// periodicity and covariance applied to the inputs chosen in 5.1 (conversion I / II for binary data),
+// without building any intermediate sequences.
+void fused_tests(const data_t *dp, const uint8_t data[], const uint8_t rawdata[], const double rawmean, const double median, long double *stats, const bool *test_status){
+	const long int n = dp->len;
+	const bool binary = (dp->alph_size == 2);
+	bool any = false;
+
+	for(unsigned int j = 0; j < num_tests - 1; ++j) any = any || test_status[j];
+	if(!any) return;
+
+	// 5.1.1
+	double running_sum = 0;
+	double max_excursion = 0;
+	double d_i;
+
+	// 5.1.2 - 5.1.6
+	run_state dir_runs, median_runs;
+	run_init(&dir_runs);
+	run_init(&median_runs);
+
+	// 5.1.7, 5.1.8
+	collision_state col;
+	collision_init(&col);
+
+	// 5.1.9, 5.1.10
+	unsigned int period[num_lags] = {0, 0, 0, 0, 0};
+	unsigned long int cov[num_lags] = {0, 0, 0, 0, 0};
+
+	// Number of values in the sequence the directional, periodicity and covariance tests see
+	unsigned long int m;
+
+	if(binary){
+		// Conversion I and II are built one 8-bit block at a time. The conversion I values are
+		// collected behind the last MAX_LAG values of the previous block for lag_tests.
+		uint8_t cs1_buf[MAX_LAG + LAG_BLOCK];
+		uint8_t *cs1_block = cs1_buf + MAX_LAG;
+		unsigned int k = 0;
+		uint8_t cs1 = 0;
+		uint8_t cs2 = 0;
+		m = 0;
+
+		for(long int i = 0; i < n; ++i){
+			running_sum += rawdata[i];
+			d_i = abs(running_sum - ((i+1) * rawmean));
+			if(d_i > max_excursion) max_excursion = d_i;
+
+			run_push(&median_runs, (data[i] < 0.5) ? -1 : 1);
+
+			cs1 += data[i];
+			cs2 += data[i] << (7 - i%8);
+
+			if((i%8 == 7) || (i == n-1)){
+				if(m > 0) run_push(&dir_runs, (cs1_block[(int)k-1] > cs1) ? -1 : 1);
+				collision_push(&col, cs2);
+
+				cs1_block[k++] = cs1;
+				++m;
+				cs1 = 0;
+				cs2 = 0;
+
+				if((k == LAG_BLOCK) || (i == n-1)){
+					lag_tests(cs1_block, cs1_block, m-k, k, period, cov);
+					if(k >= MAX_LAG) memcpy(cs1_buf, cs1_block + k - MAX_LAG, MAX_LAG);
+					k = 0;
+				}
+			}
 		}
+	}else{
+		m = n;
+
+		for(long int start = 0; start < n; start += LAG_BLOCK){
+			const long int end = min(n, start + LAG_BLOCK);
+
+			for(long int i = start; i < end; ++i){
+				running_sum += rawdata[i];
+				d_i = abs(running_sum - ((i+1) * rawmean));
+				if(d_i > max_excursion) max_excursion = d_i;
+
+				if(i > 0) run_push(&dir_runs, (data[i-1] > data[i]) ? -1 : 1);
+				run_push(&median_runs, (data[i] < median) ? -1 : 1);
+				collision_push(&col, data[i]);
+			}
+
+			// Periodicity uses the (translated) symbols, covariance uses the raw values
+			lag_tests(data + start, rawdata + start, start, end - start, period, cov);
+		}
+	}
+
+	if(test_status[0]) stats[0] = max_excursion;
+	if(test_status[1]) stats[1] = dir_runs.num_runs;
+	if(test_status[2]) stats[2] = run_longest(&dir_runs);
+	if(test_status[3]) stats[3] = max(dir_runs.pos, dir_runs.len - dir_runs.pos);
+	if(test_status[4]) stats[4] = median_runs.num_runs;
+	if(test_status[5]) stats[5] = run_longest(&median_runs);
+	if(test_status[6]) stats[6] = divide(col.total, col.count);
+	if(test_status[7]) stats[7] = col.max;
+	for(unsigned int l = 0; l < num_lags; ++l){
+		if(test_status[8+l]){
+			assert(m >= test_lags[l]);
+			stats[8+l] = period[l];
+		}
+		if(test_status[13+l]) stats[13+l] = cov[l];
 	}
 }
 
-void compression_test(const uint8_t data[], const int sample_size, long double *stats, const uint8_t max_symbol, const bool *test_status){
+void compression_test(const uint8_t data[], const int sample_size, long double *stats, const uint8_t max_symbol, const bool *test_status, compression_arena *ca){
 
-	if(test_status[18]) stats[18] = compression(data, sample_size, max_symbol);
+	if(test_status[18]) stats[18] = compression(data, sample_size, max_symbol, ca);
 }
 
-void run_tests(const data_t *dp, const uint8_t data[], const uint8_t rawdata[], const double rawmean, const double median, long double *stats, const bool *test_status){
+void run_tests(const data_t *dp, const uint8_t data[], const uint8_t rawdata[], const double rawmean, const double median, long double *stats, const bool *test_status, compression_arena *ca){
 
 	// Perform tests
-	excursion_test(rawdata, rawmean, dp->len, stats, test_status);
-	directional_tests(data, dp->alph_size, dp->len, stats, test_status);
-	consecutive_runs_tests(data, median, dp->alph_size, dp->len, stats, test_status);
-	collision_tests(data, dp->alph_size, dp->len, stats, test_status);
-	periodicity_tests(data, dp->alph_size, dp->len, stats, test_status);
-	if(dp->alph_size == 2) {
-		//The two conversions only make sense if the two symbols are 0 and 1.
-		covariance_tests(data, dp->alph_size, dp->len, stats, test_status);
-	} else {
-		covariance_tests(rawdata, dp->alph_size, dp->len, stats, test_status);
-	}
-	compression_test(rawdata, dp->len, stats, dp->maxsymbol, test_status);
+	//For binary data, the two conversions only make sense if the two symbols are 0 and 1,
+	//so the lagged tests use the translated symbols there and the raw values otherwise.
+	fused_tests(dp, data, rawdata, rawmean, median, stats, test_status);
+	compression_test(rawdata, dp->len, stats, dp->maxsymbol, test_status, ca);
 }
 
 /*
@@ -463,12 +821,31 @@ void run_tests(const data_t *dp, const uint8_t data[], const uint8_t rawdata[],
  * ---------------------------------------------
  */
 
+// A statistic is decided once its permuted values were more than 5 times at least as large, and
+// more than 5 times at most as large, as the unpermuted one; counts is its row of C.
+static inline bool permutation_decided(const int counts[3]){
+	return (counts[0] + counts[1] > 5) && (counts[1] + counts[2] > 5);
+}
+
+// The block of permutation rounds run by an RNG stream, from begin up to but excluding end
+static inline void permutation_stream_rounds(const int stream, int &begin, int &end){
+	int block = PERMS / PERM_STREAMS;
+	int extra = PERMS % PERM_STREAMS;
+
+	if(stream < extra){
+		block++;
+		extra = 0;
+	}
+	begin = block * stream + extra;
+	end = begin + block;
+}
+
 void print_results(int C[][3], const int verbose){
 	cout << endl << endl;
 	cout << "                statistic  C[i][0]  C[i][1]  C[i][2]" << endl;
 	cout << "----------------------------------------------------" << endl;
 	for(unsigned int i = 0; i < num_tests; ++i){
-		if((C[i][0] + C[i][1] <= 5) || C[i][1] + C[i][2] <= 5){
+		if(!permutation_decided(C[i])){
 			cout << setw(24) << test_names[i] << "*";
 		}else{
 			cout << setw(25) << test_names[i];
@@ -572,7 +949,7 @@ void populateTestCase(IidTestCase &tc, int C[][3]){
     tc.testResults.push_back(tr2);
 }
 
-bool permutation_tests(const data_t *dp, const double rawmean, const double median, const int verbose, IidTestCase &tc){
+bool permutation_tests(const data_t *dp, const double rawmean, const double median, const int verbose, IidTestCase &tc, permutation_stats *stats = NULL, uint64_t *seed_used = NULL){
 	uint64_t xoshiro256starstarMainSeed[4];
 	bool istty;
 
@@ -598,11 +975,20 @@ bool permutation_tests(const data_t *dp, const double rawmean, const double medi
 		test_status[i] = true;
 	}
 
+	if(stats != NULL) {
+		stats->executed = 0;
+		for(unsigned int i = 0; i < num_tests; ++i) stats->decided_at[i] = -1;
+	}
+
 	// Run initial tests
 	if(verbose == 2) cout << "Beginning initial tests..." << endl;
 	seed(xoshiro256starstarMainSeed);
+	if(seed_used != NULL) memcpy(seed_used, xoshiro256starstarMainSeed, sizeof(xoshiro256starstarMainSeed));
 
-	run_tests(dp, dp->symbols, dp->rawsymbols, rawmean, median, t, test_status);
+	compression_arena initial_arena;
+	compression_arena_init(&initial_arena);
+	run_tests(dp, dp->symbols, dp->rawsymbols, rawmean, median, t, test_status, &initial_arena);
+	compression_arena_free(&initial_arena);
 
 	if(verbose == 2) {
 		cout << endl << "Initial test results" << endl;
@@ -619,61 +1005,111 @@ bool permutation_tests(const data_t *dp, const double rawmean, const double medi
 	
 	if(verbose == 2) cout << "Beginning permutation tests... these may take some time" << endl;
 
+	// Worker threads do not see the caller's cancellation token, so they poll it explicitly and
+	// leave their loops; the exception is thrown once the parallel region has been left.
+	const cancel_token *token = active_cancel_token;
+	bool abandoned = false;
+	check_cancelled(token);
+
 	#pragma omp parallel
 	{
-		uint8_t *data;
-		uint8_t *rawdata;
+		shuffle_engine shuffle;
 		uint64_t xoshiro256starstarSeed[4];
 		long double tp[num_tests];
 		int passed_count;
+		compression_arena arena;
 
-		data = new uint8_t[dp->len];
-		rawdata = new uint8_t[dp->len];
+		shuffle_engine_init(&shuffle, dp);
+		compression_arena_init(&arena);
 
 		// Init results
 		for(unsigned int i = 0; i < num_tests; ++i){
 			tp[i] = -1;
 		}
 
-		for(int i = 0; i < dp->len; ++i){
-			data[i] = dp->symbols[i];
-			rawdata[i] = dp->rawsymbols[i];
-		}
+		// Statistics this thread still computes; refreshed each time its results are merged.
+		bool local_status[num_tests];
+		// Outcome of each statistic for each permutation in the current chunk (see PERM_OUTCOME_*)
+		uint8_t outcome[PERM_CHUNK_MAX][num_tests];
+
+		// Threads pick up whole streams, so a stream always steps its jumped RNG state through
+		// consecutive shuffles of its own block, whichever thread runs it.
+		#pragma omp for schedule(dynamic, 1)
+		for(int stream = 0; stream < PERM_STREAMS; stream++) {
+			int begin, end;
+			int chunk = 1;
+			int todo = 0;
+
+			permutation_stream_rounds(stream, begin, end);
+
+			#pragma omp critical(resultUpdate)
+			{
+				memcpy(local_status, test_status, sizeof(local_status));
+				passed_count = 0;
+				for(unsigned int j=0; j < num_tests; j++) if(!test_status[j]) passed_count++;
+			}
+
+			// Every statistic is decided; the remaining streams have nothing to do.
+			if(passed_count >= (int)num_tests) continue;
 
-		passed_count = 0;
-		memcpy(xoshiro256starstarSeed, xoshiro256starstarMainSeed, sizeof(xoshiro256starstarMainSeed));
-		//Cause the RNG to jump omp_get_thread_num() * 2^128 calls
-		xoshiro_jump(omp_get_thread_num(), xoshiro256starstarSeed);
+			shuffle_engine_reset(&shuffle, dp);
 
-		#pragma omp for
-		for(int i = 0; i < PERMS; ++i) {
-			if(passed_count < 19) {
+			memcpy(xoshiro256starstarSeed, xoshiro256starstarMainSeed, sizeof(xoshiro256starstarMainSeed));
+			//Cause the RNG to jump stream * 2^128 calls
+			xoshiro_jump(stream, xoshiro256starstarSeed);
+
+			for(int i = begin; (i < end) && (passed_count < (int)num_tests); i += todo) {
 				char statusMessage[1024];
 				size_t statusMessageLength = 0;
 
-				FYshuffle(data, rawdata, dp->len, xoshiro256starstarSeed);
-				run_tests(dp, data, rawdata, rawmean, median, tp, test_status);
+				if(cancel_requested(token)) {
+					#pragma omp atomic write
+					abandoned = true;
+					break;
+				}
+
+				// Merge rarely decides anything late in the run, so the chunk grows as we go.
+				if(i > begin) chunk = min(2 * chunk, PERM_CHUNK_MAX);
+				todo = min(chunk, end - i);
+
+				for(int k = 0; k < todo; ++k){
+					shuffle_engine_round(&shuffle, xoshiro256starstarSeed);
+					run_tests(dp, shuffle.data, shuffle.rawdata, rawmean, median, tp, local_status, &arena);
+
+					for(unsigned int j = 0; j < num_tests; ++j){
+						if(!local_status[j]){
+							outcome[k][j] = PERM_OUTCOME_SKIPPED;
+						} else if(tp[j] > t[j]){
+							outcome[k][j] = PERM_OUTCOME_GREATER;
+						} else if(tp[j] == t[j]){
+							outcome[k][j] = PERM_OUTCOME_EQUAL;
+						} else {
+							outcome[k][j] = PERM_OUTCOME_LESS;
+						}
+					}
+				}
 
-				// Aggregate results into the counters
+				// Aggregate results into the counters. The chunk is replayed in order, one permutation at
+				// a time, so each statistic stops counting at exactly the permutation that decided it.
 				#pragma omp critical(resultUpdate)
 				{
-					for(unsigned int j = 0; j < num_tests; ++j){
-						if(test_status[j]) {
-							if(tp[j] > t[j]){
-								C[j][0]++;
-							} else if(tp[j] == t[j]){
-								C[j][1]++;
-							} else {
-								C[j][2]++;
-							}
-							if((C[j][0] + C[j][1] > 5) && (C[j][1] + C[j][2] > 5)) {
-								test_status[j] = false;
+					for(int k = 0; k < todo; ++k){
+						for(unsigned int j = 0; j < num_tests; ++j){
+							if(test_status[j]) {
+								// A statistic only leaves test_status, so local_status was a superset
+								assert(outcome[k][j] != PERM_OUTCOME_SKIPPED);
+								C[j][outcome[k][j]]++;
+								if(permutation_decided(C[j])) {
+									test_status[j] = false;
+									if(stats != NULL) stats->decided_at[j] = C[j][0] + C[j][1] + C[j][2];
+								}
 							}
 						}
 					}
+					memcpy(local_status, test_status, sizeof(local_status));
 					passed_count = 0;
 					for(unsigned int j=0; j < num_tests; j++) if(!test_status[j]) passed_count++;
-					completed ++;
+					completed += todo;
 				} // end resultUpdate
 
 				if(verbose == 2) {
@@ -714,26 +1150,141 @@ bool permutation_tests(const data_t *dp, const double rawmean, const double medi
 						fflush(stdout);
 					}
 				}
-			} else {
-				//We don't have a lock for this branch, so make one to update the completed count.
-				#pragma omp atomic
-				completed ++;
 			}
-
 		}
-        	delete[](data);
-        	delete[](rawdata);
+		shuffle_engine_free(&shuffle);
+		compression_arena_free(&arena);
 	} //end parallel
 
+	if(abandoned) check_cancelled(token);
+
+	if(stats != NULL) stats->executed = completed;
+
 	if(verbose > 1) print_results(C, verbose);
         
     populateTestCase(tc, C);
 	
     for(unsigned int i = 0; i < num_tests; ++i){
-		if((C[i][0] + C[i][1] <= 5) || (C[i][1] + C[i][2] <= 5)){
+		if(!permutation_decided(C[i])){
 			return false;
 	 	}
 	}
 
 	return true;
 }
+
+/*
+ * Runs the permutation rounds of RNG streams first_stream to first_stream+stream_count-1 of the
+ * permutation tests seeded with seed, for the statistics flagged in undecided, and adds the outcomes
+ * to C. This lets the rounds of one assessment be split between several processes: each stream
+ * stops once its own outcomes decide every statistic it runs, so the sum of the tallies of all the
+ * streams decides exactly the statistics that permutation_tests decides with the same seed, and
+ * holds the same counts for every statistic that is not decided. A statistic may be flagged as
+ * decided as soon as the tallies gathered so far decide it.
+ * Returns the number of permutations run.
+ */
+long permutation_tally(const data_t *dp, const double rawmean, const double median, const uint64_t seed[4], const int first_stream, const int stream_count, const bool undecided[num_tests], int C[][3]){
+	long executed = 0;
+	long double t[num_tests];
+	bool pending = false;
+
+	assert((first_stream >= 0) && (stream_count >= 0) && (first_stream + stream_count <= PERM_STREAMS));
+
+	for(unsigned int i = 0; i < num_tests; ++i){
+		C[i][0] = 0;
+		C[i][1] = 0;
+		C[i][2] = 0;
+
+		t[i] = -1;
+		pending = pending || undecided[i];
+	}
+	if(!pending || (stream_count == 0)) return 0;
+
+	compression_arena initial_arena;
+	compression_arena_init(&initial_arena);
+	run_tests(dp, dp->symbols, dp->rawsymbols, rawmean, median, t, undecided, &initial_arena);
+	compression_arena_free(&initial_arena);
+
+	// As in permutation_tests, the workers poll the caller's token and leave their loops
+	const cancel_token *token = active_cancel_token;
+	bool abandoned = false;
+	check_cancelled(token);
+
+	#pragma omp parallel
+	{
+		shuffle_engine shuffle;
+		uint64_t xoshiro256starstarSeed[4];
+		long double tp[num_tests];
+		compression_arena arena;
+
+		shuffle_engine_init(&shuffle, dp);
+		compression_arena_init(&arena);
+		for(unsigned int i = 0; i < num_tests; ++i) tp[i] = -1;
+
+		#pragma omp for schedule(dynamic, 1)
+		for(int stream = first_stream; stream < first_stream + stream_count; stream++) {
+			// Outcomes of this stream, and the statistics it still runs
+			int SC[num_tests][3];
+			bool local_status[num_tests];
+			int remaining = 0;
+			int begin, end;
+			long ran = 0;
+
+			for(unsigned int j = 0; j < num_tests; ++j){
+				SC[j][0] = 0;
+				SC[j][1] = 0;
+				SC[j][2] = 0;
+				local_status[j] = undecided[j];
+				if(undecided[j]) remaining++;
+			}
+
+			shuffle_engine_reset(&shuffle, dp);
+
+			memcpy(xoshiro256starstarSeed, seed, sizeof(xoshiro256starstarSeed));
+			xoshiro_jump(stream, xoshiro256starstarSeed);
+
+			permutation_stream_rounds(stream, begin, end);
+			for(int i = begin; (i < end) && (remaining > 0); i++) {
+				if(cancel_requested(token)) {
+					#pragma omp atomic write
+					abandoned = true;
+					break;
+				}
+
+				shuffle_engine_round(&shuffle, xoshiro256starstarSeed);
+				run_tests(dp, shuffle.data, shuffle.rawdata, rawmean, median, tp, local_status, &arena);
+				ran++;
+
+				for(unsigned int j = 0; j < num_tests; ++j){
+					if(!local_status[j]) continue;
+
+					if(tp[j] > t[j]) SC[j][PERM_OUTCOME_GREATER]++;
+					else if(tp[j] == t[j]) SC[j][PERM_OUTCOME_EQUAL]++;
+					else SC[j][PERM_OUTCOME_LESS]++;
+
+					if(permutation_decided(SC[j])) {
+						local_status[j] = false;
+						remaining--;
+					}
+				}
+			}
+
+			#pragma omp critical(tallyUpdate)
+			{
+				for(unsigned int j = 0; j < num_tests; ++j){
+					C[j][0] += SC[j][0];
+					C[j][1] += SC[j][1];
+					C[j][2] += SC[j][2];
+				}
+				executed += ran;
+			}
+		}
+
+		shuffle_engine_free(&shuffle);
+		compression_arena_free(&arena);
+	} //end parallel
+
+	if(abandoned) check_cancelled(token);
+
+	return executed;
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "../shared/utils.h"
+#include "../shared/bitstring_summary.h"
 
 // Computed using efficient implementation in Appendix G.1.1
 double F(double q){
@@ -12,29 +13,11 @@ double col_exp(double p){
 	return (p/(q*q))*(1.0 + 0.5*(1.0/p - 1.0/q))*F(q) - (p/q)*0.5*(1.0/p - 1.0/q);
 }
 
-// Section 6.3.2 - Collision Estimate
-// data is assumed to be binary (e.g., bit string)
-double collision_test(uint8_t* data, long len, const int verbose, const char *label){
-	long v, i;
-	int t_v;
-	double X, s, p;
+// v is the number of collisions, i is the sum of the wait times and s is the sum of their squares
+static double collision_estimate(long v, long i, double s, const int verbose, const char *label){
+	double X, p;
 	double entEst;
 
-	i = 0;
-	v = 0;
-	s = 0.0;
-
-	// compute wait times until collisions
-	while(i < len-1){
-		if(data[i] == data[i+1]) t_v = 2; // 00 or 11
-		else if(i < len-2) t_v = 3; // 101, 011, 100, or 101
-		else break;
-		
-		v++;
-		s += t_v*t_v;
-		i += t_v;
-	}
-
 	// X is mean of t_v's, s is sample stdev, where
 	// s^2 = (sum(t_v^2) - sum(t_v)^2/v) / (v-1)
 	X = i / (double)v;
@@ -79,3 +62,24 @@ double collision_test(uint8_t* data, long len, const int verbose, const char *la
 
 	return entEst;
 }
+
+// Section 6.3.2 - Collision Estimate, finished from the summary of the bit string
+double collision_test(const bitstring_summary &bs, const int verbose, const char *label){
+	return collision_estimate(bs.collisions, bs.collision_end, bs.collision_squares, verbose, label);
+}
+
+// bits is a packed bit string (see pack_bitstring).
+double collision_test(const uint64_t* bits, long len, const int verbose, const char *label){
+	bitstring_summary bs;
+
+	bitstring_summary_init(&bs, bits, len);
+	return collision_test(bs, verbose, label);
+}
+
+// data is assumed to be binary (e.g., bit string)
+double collision_test(uint8_t* data, long len, const int verbose, const char *label){
+	vector<uint64_t, scratch_allocator<uint64_t> > bits(packed_word_count(len));
+
+	pack_bitstring(data, len, 1, bits.data());
+	return collision_test(bits.data(), len, verbose, label);
+}
@@ -10,121 +10,175 @@ inline void kahan_add(double &sum, double &comp, double in){
 	sum = t;
 }
 
+// log2l(i) for i = 1, 2, ..., computed on first use. A compression estimate evaluates G() for
+// up to 2*ITERMAX arguments, and each evaluation walks the same sequence of logarithms, so the
+// table computes every value once per estimate instead of once per evaluation.
+class Log2Table {
+public:
+	// Returns the table, holding at least the entries up to n
+	const long double *upto(long n){
+		long i = (long)values.size();
+		if(i <= n){
+			values.resize(n+1);
+			for(i = max(i, 1L); i <= n; i++) values[i] = log2l((long double)i);
+		}
+		return values.data();
+	}
+
+	long last() const {
+		return (long)values.size() - 1;
+	}
+
+private:
+	vector<long double, scratch_allocator<long double> > values;
+};
+
 //There is some cleverness associated with this calculation of G; in particular,
 //one doesn't need to calculate all the terms independently (they are inter-related!)
 //See UL's implementation comments here: https://bit.ly/UL90BCOM 
 //Look in the section "Compression Estimate G Function Calculation"
-double G(double z, int d, long num_blocks){
-	double Ai=0.0, Ai_comp=0.0;
-	double firstSum=0.0, firstSum_comp=0.0;
-	long v = num_blocks - d;
+//G is evaluated in three parts, G_begin, G_step and G_end, so that com_exp can interleave its two
+//evaluations; each of them still performs exactly the operations of the plain loop, in order.
+struct GState {
+	double z;
+	double Ai, Ai_comp;
+	double firstSum, firstSum_comp;
 	double Ad1;
-
 	long double Bi;
 	long double Bterm;
-	long double ai;
-	long double aiScaled;
 	bool underflowTruncate;
+};
 
+static inline void G_begin(GState &g, double z, int d, long num_blocks, const long double *log2i){
 	assert(d>0);
 	assert(num_blocks>d);
 
+	g.z = z;
+	g.Ai = 0.0;
+	g.Ai_comp = 0.0;
+	g.firstSum = 0.0;
+	g.firstSum_comp = 0.0;
+
 	//i=2
-	Bterm = (1.0L-(long double)z);
+	g.Bterm = (1.0L-(long double)z);
 	//Note: B_1 isn't needed, as a_1 = 0
 	//B_2
-	Bi = Bterm;
+	g.Bi = g.Bterm;
 
 	//Calculate A_{d+1}
 	for(int i=2; i<=d; i++) {
 		//calculate the a_i term
-		kahan_add(Ai, Ai_comp, log2l((long double)i)*Bi);
+		kahan_add(g.Ai, g.Ai_comp, log2i[i]*g.Bi);
 
 		//Calculate B_{i+1}
-		Bi *= Bterm;
+		g.Bi *= g.Bterm;
 	}
 
 	//Store A_{d+1}
-	Ad1 = Ai;
+	g.Ad1 = g.Ai;
+	g.underflowTruncate = false;
+}
 
-	underflowTruncate = false;
-	//Now calculate A_{num_blocks} and the sum of sums term (firstsum)
-	for(long i=d+1; i<=num_blocks-1; i++) {
-		//calculate the a_i term
-		ai = log2l((long double)i)*Bi;
-
-		//Calculate A_{i+1}
-		kahan_add(Ai, Ai_comp, (double)ai);
-		//Sum in A_{i+1} into the firstSum
-
-		//Calculate the tail of the sum of sums term (firstsum)
-		aiScaled = (long double)(num_blocks-i) * ai;
-		if((double)aiScaled > 0.0) {
-			kahan_add(firstSum, firstSum_comp, (double)aiScaled);
-		} else {
-			underflowTruncate = true;
-			break;
-		}
+//Adds term i (d+1 <= i <= num_blocks-1) to A and to the sum of sums term (firstsum).
+//Returns false once the terms have underflowed, and no further terms may be added.
+static inline bool G_step(GState &g, long i, long num_blocks, const long double *log2i){
+	long double ai;
+	long double aiScaled;
 
-		//Calculate B_{i+1}
-		Bi *= Bterm;
+	//calculate the a_i term
+	ai = log2i[i]*g.Bi;
+
+	//Calculate A_{i+1}
+	kahan_add(g.Ai, g.Ai_comp, (double)ai);
+	//Sum in A_{i+1} into the firstSum
+
+	//Calculate the tail of the sum of sums term (firstsum)
+	aiScaled = (long double)(num_blocks-i) * ai;
+	if((double)aiScaled > 0.0) {
+		kahan_add(g.firstSum, g.firstSum_comp, (double)aiScaled);
+	} else {
+		g.underflowTruncate = true;
+		return false;
 	}
 
+	//Calculate B_{i+1}
+	g.Bi *= g.Bterm;
+	return true;
+}
+
+static inline double G_end(GState &g, int d, long num_blocks, Log2Table &table){
+	long v = num_blocks - d;
+
 	//Ai now contains A_{num_blocks} and firstsum contains the tail
 	//finalize the calculation of firstsum
-	kahan_add(firstSum, firstSum_comp, ((double)(num_blocks-d))*Ad1);
+	kahan_add(g.firstSum, g.firstSum_comp, ((double)(num_blocks-d))*g.Ad1);
 
 	//Calculate A_{num_blocks+1}
-	if(!underflowTruncate) {
-		ai = log2l((long double)num_blocks)*Bi;
-		kahan_add(Ai, Ai_comp, (double)ai);
+	if(!g.underflowTruncate) {
+		long double ai = table.upto(num_blocks)[num_blocks]*g.Bi;
+		kahan_add(g.Ai, g.Ai_comp, (double)ai);
 	}
 
-	return 1/(double)v * z*(z*firstSum + (Ai - Ad1));
+	return 1/(double)v * g.z*(g.z*g.firstSum + (g.Ai - g.Ad1));
+}
+
+// Makes sure log2i covers term i of G, growing the table geometrically up to num_blocks
+static inline const long double *G_log2_upto(Log2Table &table, const long double *log2i, long i, long num_blocks){
+	if(i <= table.last()) return log2i;
+	return table.upto(min(num_blocks, max(2*table.last(), i)));
 }
 
-double com_exp(double p, unsigned int alph_size, int d, long num_blocks){
+// Evaluates G(p) + (alph_size-1)G(q). The two series are summed in one loop while both are
+// still running, as they are independent chains of dependent operations that a core can overlap.
+double com_exp(double p, unsigned int alph_size, int d, long num_blocks, Log2Table &table){
 	double q = (1.0-p)/((double)alph_size-1.0);
-        return G(p, d, num_blocks) + ((double)alph_size-1.0) * G(q, d, num_blocks);
+	GState gp, gq;
+	const long double *log2i = table.upto(d);
+	bool p_running = true, q_running = true;
+	long i;
+
+	G_begin(gp, p, d, num_blocks, log2i);
+	G_begin(gq, q, d, num_blocks, log2i);
+
+	for(i=d+1; (i<=num_blocks-1) && p_running && q_running; i++) {
+		log2i = G_log2_upto(table, log2i, i, num_blocks);
+		p_running = G_step(gp, i, num_blocks, log2i);
+		q_running = G_step(gq, i, num_blocks, log2i);
+	}
+	for(; (i<=num_blocks-1) && p_running; i++) {
+		log2i = G_log2_upto(table, log2i, i, num_blocks);
+		p_running = G_step(gp, i, num_blocks, log2i);
+	}
+	for(; (i<=num_blocks-1) && q_running; i++) {
+		log2i = G_log2_upto(table, log2i, i, num_blocks);
+		q_running = G_step(gq, i, num_blocks, log2i);
+	}
+
+	return G_end(gp, d, num_blocks, table) + ((double)alph_size-1.0) * G_end(gq, d, num_blocks, table);
 }
 
-// Section 6.3.4 - Compression Estimate
-// data is assumed to be binary (e.g., bit string)
-double compression_test(uint8_t* data, long len, const int verbose, const char *label){
-	int j, d, b = 6;
-	long i, num_blocks, v;
-	unsigned int block, alph_size = 1 << b; 
-	unsigned int dict[alph_size];
-	double X=0.0, X_comp=0.0;
-	double sigma=0.0, sigma_comp=0.0;
-	double p, entEst;
-	double ldomain, hdomain, lbound, hbound, lvalue, hvalue, pVal, lastP;
+// Distances between repeats of a 6-bit block are nearly always below this, and their log2 is
+// looked up rather than computed
+#define COMPRESSION_LOG2_DISTANCES 4096
 
-	d = 1000;
-	num_blocks = len/b;
+struct compression_log2_table {
+	double values[COMPRESSION_LOG2_DISTANCES];
 
-	if(num_blocks <= d){
-		printf("\t*** Warning: not enough samples to run compression test (need more than %d) ***\n", d);
-		return -1.0;
+	compression_log2_table(){
+		values[0] = 0.0;
+		for(long i = 1; i < COMPRESSION_LOG2_DISTANCES; i++) values[i] = log2((double)i);
 	}
+};
 
-	// create dictionary
-	for(i = 0; i < alph_size; i++) dict[i] = 0;
-	for(i = 0; i < d; i++){
-		block = 0;
-		for(j = 0; j < b; j++) block |= (data[i*b + j] & 0x1) << (b-j-1);
-		dict[block] = i+1;
-	}
+static const compression_log2_table compression_log2;
 
-	// test data against dictionary
-	v = num_blocks - d;
-	for(i = d; i < num_blocks; i++){
-		block = 0;
-		for(j = 0; j < b; j++) block |= (data[i*b + j] & 0x1) << (b-j-1);
-		kahan_add(X, X_comp, log2(i+1-dict[block]));
-		kahan_add(sigma, sigma_comp, log2(i+1-dict[block])*log2(i+1-dict[block]));
-		dict[block] = i+1;
-	}
+// X and sigma are the sums of the log2 distances (and their squares) over the v test blocks
+static double compression_estimate(double X, double sigma, long v, int d, long num_blocks, int b, const int verbose, const char *label){
+	int j;
+	unsigned int alph_size = 1 << b;
+	double p, entEst;
+	double ldomain, hdomain, lbound, hbound, lvalue, hvalue, pVal, lastP;
+	Log2Table log2_table;
 
 	// compute mean and stdev
 	X /= v;
@@ -143,7 +197,7 @@ double compression_test(uint8_t* data, long len, const int verbose, const char *
 
 	if(verbose == 3) printf("%s Compression Estimate: X-bar' = %.17g\n", label, X);
 
-	if(com_exp(1.0/(double)alph_size, alph_size, d, num_blocks) > X) {
+	if(com_exp(1.0/(double)alph_size, alph_size, d, num_blocks, log2_table) > X) {
 		ldomain = 1.0 / (double)alph_size;
 		hdomain = 1.0;
 
@@ -156,7 +210,7 @@ double compression_test(uint8_t* data, long len, const int verbose, const char *
 		//Note that the bounds are in [0,1], so overflows aren't an issue
 		//But underflows are.
 		p = (lbound + hbound) / 2.0;
-		pVal = com_exp(p, alph_size, d, num_blocks);
+		pVal = com_exp(p, alph_size, d, num_blocks, log2_table);
 
 		//We don't need the initial pVal invariant, as our initial bounds are infinite.
 		//We don't need the initial bounds, as they are set to the domain bounds
@@ -213,7 +267,7 @@ double compression_test(uint8_t* data, long len, const int verbose, const char *
 			}
 	#pragma GCC diagnostic pop
 
-			pVal = com_exp(p, alph_size, d, num_blocks);
+			pVal = com_exp(p, alph_size, d, num_blocks, log2_table);
 
 			//invariant: If this isn't true, then this isn't loosely monotonic
 			if(!INCLOSEDINTERVAL(pVal, lvalue, hvalue)) {
@@ -243,3 +297,76 @@ double compression_test(uint8_t* data, long len, const int verbose, const char *
 
         return entEst;
 }
+
+// Bits per block, and the blocks that initialize the dictionary
+#define COMPRESSION_BLOCK_BITS 6
+#define COMPRESSION_DICTIONARY_BLOCKS 1000
+
+// The dictionary and the sums of the compression estimate over the blocks read so far, so that the
+// blocks of a bit string that arrives in pieces can be read as they arrive
+struct compression_stream {
+	long blocks;				// blocks read so far
+	unsigned int dict[1 << COMPRESSION_BLOCK_BITS];	// 1 + the index of the latest occurrence of each block
+	double X, X_comp;
+	double sigma, sigma_comp;
+
+	compression_stream() : blocks(0), X(0.0), X_comp(0.0), sigma(0.0), sigma_comp(0.0) {
+		for(int i = 0; i < (1 << COMPRESSION_BLOCK_BITS); i++) dict[i] = 0;
+	}
+};
+
+// Reads the blocks that lie within the first avail bits of the string. bits[0] holds bit first of
+// the string, which is a multiple of PACKED_WORD_BITS and at most the first bit not read yet.
+void compression_update(compression_stream *cs, const uint64_t *bits, long first, long avail){
+	const int b = COMPRESSION_BLOCK_BITS, d = COMPRESSION_DICTIONARY_BLOCKS;
+	long i, distance;
+	unsigned int block;
+	double log2_distance;
+
+	assert(first <= cs->blocks*b);
+
+	// The first d blocks make up the dictionary, the others are tested against it
+	for(i = cs->blocks; (i+1)*b <= avail; i++){
+		block = packed_bits(bits, i*b - first, b);
+		if(i >= d){
+			distance = i+1-cs->dict[block];
+			log2_distance = (distance < COMPRESSION_LOG2_DISTANCES) ? compression_log2.values[distance] : log2(distance);
+			kahan_add(cs->X, cs->X_comp, log2_distance);
+			kahan_add(cs->sigma, cs->sigma_comp, log2_distance*log2_distance);
+		}
+		cs->dict[block] = i+1;
+	}
+	cs->blocks = i;
+}
+
+// Section 6.3.4 - Compression Estimate of a bit string of len bits, all of whose blocks were read
+double compression_test(const compression_stream &cs, long len, const int verbose, const char *label){
+	int d = COMPRESSION_DICTIONARY_BLOCKS, b = COMPRESSION_BLOCK_BITS;
+	long num_blocks = len/b;
+
+	assert(cs.blocks == num_blocks);
+
+	if(num_blocks <= d){
+		printf("\t*** Warning: not enough samples to run compression test (need more than %d) ***\n", d);
+		return -1.0;
+	}
+
+	return compression_estimate(cs.X, cs.sigma, num_blocks - d, d, num_blocks, b, verbose, label);
+}
+
+// Section 6.3.4 - Compression Estimate
+// bits is a packed bit string (see pack_bitstring).
+double compression_test(const uint64_t* bits, long len, const int verbose, const char *label){
+	compression_stream cs;
+
+	compression_update(&cs, bits, 0, len);
+	return compression_test(cs, len, verbose, label);
+}
+
+// data is assumed to be binary (e.g., bit string)
+double compression_test(uint8_t* data, long len, const int verbose, const char *label){
+	vector<uint64_t, scratch_allocator<uint64_t> > bits(packed_word_count(len));
+
+	pack_bitstring(data, len, 1, bits.data());
+	return compression_test(bits.data(), len, verbose, label);
+}
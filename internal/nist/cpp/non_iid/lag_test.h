@@ -19,6 +19,133 @@ struct lagBuf {
 	long buf[D_LAG];
 };
 
+// Alphabets up to this size are assessed by denseLagPredictionEstimate
+#define LAG_DENSE_MAX_ALPH 16
+
+// Samples denseLagPredictionEstimate widens to 32 bits at a time
+#define LAG_BLOCK 4096
+
+/* State of the lag prediction estimate (6.3.8) for small alphabets.
+ * With few symbols most of the last D_LAG samples match the current one, so the ring buffers of
+ * lag_test would be walked almost completely at every step. Instead all the lags are compared at
+ * once. The scores are kept in reverse order (rev[q] is the score of lag D_LAG-1-q, whose prediction
+ * is S[i-D_LAG+q]), so that the prior samples are compared front to back. Both the samples and the
+ * scores are 32 bit values, which lets the compiler turn each pass over the lags into vector code.
+ * lag_test raises the matching lags from the shortest to the longest, and a lag becomes the winner
+ * whenever its new score is at least the high score, which is always the largest score on the board.
+ * After each step the winner is therefore the longest matching lag with the new high score, if a
+ * matching lag reached it, and that is how it is found here.
+ * The prior samples are kept in the state, so the samples can be read in pieces as they arrive.
+ */
+struct dense_lag_stream {
+	long i;				// samples read so far
+	long blockStart;		// index of the sample in hist[D_LAG]
+	// hist[j] is S[blockStart-D_LAG+j]; positions before the first sample never match
+	int32_t hist[D_LAG + LAG_BLOCK];
+	int32_t rev[D_LAG];
+	int32_t highScore;
+	long winner;
+	long curRunOfCorrects;
+	long maxRunOfCorrects;
+	long correctCount;
+
+	dense_lag_stream() : i(0), blockStart(0), highScore(0), winner(0), curRunOfCorrects(0), maxRunOfCorrects(0), correctCount(0) {
+		for (int q = 0; q < (int)D_LAG; q++) {
+			hist[q] = -1;
+			rev[q] = 0;
+		}
+	}
+};
+
+// Reads samples S[s->i] ... S[end-1]; there may be at most INT32_MAX samples in all.
+template <typename Samples> static void dense_lag_update(dense_lag_stream *s, const Samples &S, long end) {
+	// The scores are worked on in a local copy, which the compiler knows no prior sample aliases
+	int32_t rev[D_LAG];
+	int32_t lagPlusOne[D_LAG];
+	int32_t highScore = s->highScore;
+	long winner = s->winner;
+	long curRunOfCorrects = s->curRunOfCorrects;
+	long maxRunOfCorrects = s->maxRunOfCorrects;
+	long correctCount = s->correctCount;
+	long i;
+
+	assert(end <= INT32_MAX);
+
+	for (int q = 0; q < (int)D_LAG; q++) {
+		rev[q] = s->rev[q];
+		lagPlusOne[q] = (int32_t)D_LAG - q;
+	}
+
+	for (i = s->i; i < end; i++) {
+		// Samples widen to 32 bits LAG_BLOCK at a time
+		if (i - s->blockStart == LAG_BLOCK) {
+			memmove(s->hist, s->hist + LAG_BLOCK, D_LAG * sizeof(int32_t));
+			s->blockStart += LAG_BLOCK;
+		}
+
+		const int32_t *prior = s->hist + (i - s->blockStart);
+		const int32_t curSymbol = S[i];
+		int32_t top = 0;
+
+		s->hist[D_LAG + i - s->blockStart] = curSymbol;
+
+		// The first sample has no prediction, but is a prior sample for the others
+		if (i == 0) continue;
+
+		// Check the prediction first
+		if (curSymbol == prior[D_LAG - 1 - winner]) {
+			correctCount++;
+			curRunOfCorrects++;
+			if (curRunOfCorrects > maxRunOfCorrects) {
+				maxRunOfCorrects = curRunOfCorrects;
+			}
+		} else {
+			curRunOfCorrects = 0;
+		}
+
+		// Raise the score of every matching lag, and find the highest score among them
+		for (int q = 0; q < (int)D_LAG; q++) {
+			const int32_t match = -(int32_t)(prior[q] == curSymbol);
+			rev[q] -= match;
+			top = max(top, rev[q] & match);
+		}
+
+		// Matching scores are at least 1, so top is 0 if no lag matched
+		if ((top > 0) && (top >= highScore)) {
+			int32_t longest = 0;
+
+			for (int q = 0; q < (int)D_LAG; q++) {
+				const int32_t reached = -(int32_t)((prior[q] == curSymbol) & (rev[q] == top));
+				longest = max(longest, lagPlusOne[q] & reached);
+			}
+			winner = longest - 1;
+			highScore = top;
+		}
+	}
+
+	for (int q = 0; q < (int)D_LAG; q++) s->rev[q] = rev[q];
+	s->i = i;
+	s->highScore = highScore;
+	s->winner = winner;
+	s->curRunOfCorrects = curRunOfCorrects;
+	s->maxRunOfCorrects = maxRunOfCorrects;
+	s->correctCount = correctCount;
+}
+
+// Section 6.3.8 - Lag Prediction Estimate of the samples read by s, from an alphabet of k symbols
+double lag_test(const dense_lag_stream &s, int k, const int verbose, const char *label) {
+	assert(s.i > 2);
+
+	return predictionEstimate(s.correctCount, s.i-1, s.maxRunOfCorrects, k, "Lag", verbose, label);
+}
+
+template <typename Samples> static double denseLagPredictionEstimate(const Samples &S, long L, int k, const int verbose, const char *label) {
+	dense_lag_stream s;
+
+	dense_lag_update(&s, S, L);
+	return lag_test(s, k, verbose, label);
+}
+
 /* Lag prediction estimate (6.3.8)
  * This is a somewhat counter-intuitive approach to this test; the original idea for this approach is due
  * to David Oksner. The straight forward way is simply to check j symbols back for each case (where j runs
@@ -28,7 +155,7 @@ struct lagBuf {
  * For this, one needs only check and update the current symbol's ring buffer, and we only need to spend
  * time looking at values that correspond to counters that must be updated.
  */
-double lag_test(uint8_t *S, long L, int k, const int verbose, const char *label) {
+template <typename Samples> static double ringLagPredictionEstimate(const Samples &S, long L, int k, const int verbose, const char *label) {
 	long scoreboard[D_LAG] = {0};
 	int winner = 0;
 	long curRunOfCorrects = 0;
@@ -37,11 +164,7 @@ double lag_test(uint8_t *S, long L, int k, const int verbose, const char *label)
 	lagBuf *ringBuffers;
 	long highScore = 0;
 
-	assert(S != NULL);
-	assert(L > 2);
-	assert(k >= 2);
-
-	ringBuffers = new lagBuf[k];
+	ringBuffers = scratch_array<lagBuf>(k);
 
 	//Flag all the rings as empty
 	for (int j = 0; j < k; j++) {
@@ -105,7 +228,29 @@ double lag_test(uint8_t *S, long L, int k, const int verbose, const char *label)
 		assert((uint8_t)(curRingBuffer->end - curRingBuffer->start) <= D_LAG);
 	}
 
-	delete[] ringBuffers;
+	scratch_free(ringBuffers);
 
 	return predictionEstimate(correctCount, L-1, maxRunOfCorrects, k, "Lag", verbose, label);
 }
+
+// Section 6.3.8 - Lag Prediction Estimate. Small alphabets, where most of the counters are updated
+// anyway, go to denseLagPredictionEstimate.
+double lag_test(uint8_t *S, long L, int k, const int verbose, const char *label) {
+	assert(S != NULL);
+	assert(L > 2);
+	assert(k >= 2);
+
+	if ((k <= LAG_DENSE_MAX_ALPH) && (L <= INT32_MAX)) return denseLagPredictionEstimate(S, L, k, verbose, label);
+	return ringLagPredictionEstimate(S, L, k, verbose, label);
+}
+
+// Section 6.3.8 - Lag Prediction Estimate of the L bit packed bitstring bits
+double lag_test(const uint64_t *bits, long L, const int verbose, const char *label) {
+	const packed_samples view = {bits, 0};
+
+	assert(bits != NULL);
+	assert(L > 2);
+
+	if (L <= INT32_MAX) return denseLagPredictionEstimate(view, L, 2, verbose, label);
+	return ringLagPredictionEstimate(view, L, 2, verbose, label);
+}
@@ -4,7 +4,8 @@
 #define B_len 16
 #define MAX_DICTIONARY_SIZE 65536
 
-static double binaryLZ78YPredictionEstimate(const uint8_t *S, long L, const int verbose, const char *label)
+//S is a packed bit string (see pack_bitstring)
+static double binaryLZ78YPredictionEstimate(const uint64_t *S, long L, const int verbose, const char *label)
 {
    long *binaryDict[B_len];
    long curRunOfCorrects=0;
@@ -23,17 +24,17 @@ static double binaryLZ78YPredictionEstimate(const uint8_t *S, long L, const int
       //For a length m prefix, we need 2^m sets of length 2 arrays.
       //Here, j+1 is the length of the prefix, so we need 2^(j+1) prefixes, or 2*2^(j+1) = 2^(j+2) storage total.
       //Note: 2^(j+2) = 1<<(j+2).
-      binaryDict[j] = new long[1U<<(j+2)];
+      binaryDict[j] = scratch_array<long>(1U<<(j+2));
 
       memset(binaryDict[j], 0, sizeof(long)*(1U<<(j+2)));
    }
 
    // initialize B counts with {(S[15]), S[16]}, {(S[14], S[15]), S[16]}, ..., {(S[0]), S[1], ..., S[15]), S[16]},
    for(j=0; j<B_len; j++) {
-      curPattern = curPattern | (((uint32_t)(S[B_len - j - 1]&1)) << j);
+      curPattern = curPattern | (((uint32_t)packed_bit(S, B_len - j - 1)) << j);
 
       //This is necessarily the first symbol of this length
-      (BINARYDICTLOC(j+1, curPattern))[S[B_len]&0x1] = 1;
+      (BINARYDICTLOC(j+1, curPattern))[packed_bit(S, B_len)] = 1;
       dictElems++;
    }
 
@@ -42,12 +43,17 @@ static double binaryLZ78YPredictionEstimate(const uint8_t *S, long L, const int
    for(i=B_len+1; i<L; i++) {
       bool found_x;
       bool havePrediction = false;
+
+      // Stop early if cancelled; the dictionary is released before check_cancelled() throws
+      if(((i & CANCEL_POLL_MASK) == 0) && cancel_requested()) break;
+
       uint8_t roundPrediction=2;
       uint8_t curPrediction=2;
       long maxCount = 0;
+      uint8_t nextBit = packed_bit(S, i);
 
       //But the first B bits into curPattern
-      curPattern = compressedBitSymbols(S+i-B_len, B_len);
+      curPattern = packed_bits(S, i-B_len, B_len);
 
       //j is the length of the prefix to be used
       for(j=B_len; j>0; j--) {
@@ -85,17 +91,17 @@ static double binaryLZ78YPredictionEstimate(const uint8_t *S, long L, const int
                curPrediction = roundPrediction;
             }
 
-            binaryDictEntry[S[i]&1]++;
+            binaryDictEntry[nextBit]++;
          } else if(dictElems < MAX_DICTIONARY_SIZE) {
             //We didn't find the x prefix, so (x,y) surely can't have occurred.
             //We're allowed to make a new entry. Do so.
-            binaryDictEntry[S[i]&1]=1;
+            binaryDictEntry[nextBit]=1;
             dictElems++;
          }
       }
 
       // Check to see if the current prediction is correct.
-      if(havePrediction && (curPrediction == S[i])) {
+      if(havePrediction && (curPrediction == nextBit)) {
             correctCount++;
             curRunOfCorrects++;
             if(curRunOfCorrects > maxRunOfCorrects) maxRunOfCorrects = curRunOfCorrects;
@@ -105,9 +111,10 @@ static double binaryLZ78YPredictionEstimate(const uint8_t *S, long L, const int
    }
 
    for(j=0; j<B_len; j++) {
-      delete[](binaryDict[j]);
+      scratch_free(binaryDict[j]);
       binaryDict[j] = NULL;
    }
+   check_cancelled();
 
    return(predictionEstimate(correctCount, L-B_len-1, maxRunOfCorrects, 2, "LZ78Y", verbose, label));
 }
@@ -116,17 +123,25 @@ static double binaryLZ78YPredictionEstimate(const uint8_t *S, long L, const int
 double LZ78Y_test(uint8_t *data, long len, int alph_size, const int verbose, const char *label) {
 	int dict_size;
 	long i, j, N, C, run_len, max_run_len;
-	array<uint8_t, B_len> x;
+	uint64_t h[B_len+1];
 
-	if(alph_size==2) return binaryLZ78YPredictionEstimate(data, len, verbose, label);
+	if(alph_size==2) {
+		vector<uint64_t, scratch_allocator<uint64_t> > bits(packed_word_count(len));
 
-	array<map<array<uint8_t, B_len>, PostfixDictionary>, B_len> D;
+		pack_bitstring(data, len, 1, bits.data());
+		return binaryLZ78YPredictionEstimate(bits.data(), len, verbose, label);
+	}
 
 	if(len < B_len+2){	
 		printf("\t*** Warning: not enough samples to run LZ78Y test (need more than %d) ***\n", B_len+2);
 		return -1.0;
 	}
 
+	assert(B_len <= PREFIX_DICTIONARY_MAXLEN);
+
+	//At most MAX_DICTIONARY_SIZE prefixes (and at most B_len per symbol); postfixes are not capped
+	PrefixDictionary D(min((long)MAX_DICTIONARY_SIZE, B_len*len), 2*min((long)MAX_DICTIONARY_SIZE, B_len*len));
+
 	N = len-B_len-1;
 	C = 0;
 	run_len = 0;
@@ -134,11 +149,9 @@ double LZ78Y_test(uint8_t *data, long len, int alph_size, const int verbose, con
 
 	// initialize dictionary counts
 	dict_size = 0;
-	memset(x.data(), 0, B_len);
 	// initialize LZ78Y counts with {(S[15]), S[16]}, {(S[14], S[15]), S[16]}, ..., {(S[0]), S[1], ..., S[15]), S[16]}
 	for(j = 1; j <= B_len; j++){
-		memcpy(x.data(), data+B_len-j, j);
-		D[j-1][x].incrementPostfix(data[B_len], true);
+		D.incrementPostfix(D.findOrInsert(data+B_len-j, j, prefixHash(data+B_len-j, j)), data[B_len], true);
 		dict_size++;
 	}
 
@@ -149,17 +162,21 @@ double LZ78Y_test(uint8_t *data, long len, int alph_size, const int verbose, con
 		uint8_t prediction = 0;
 		long max_count = 0;
 
+		if((i & CANCEL_POLL_MASK) == 0) check_cancelled();
+
+		//h[j] is the hash of the j-tuple (S[i-j] ... S[i-1])
+		h[0] = PREFIX_HASH_BASIS;
+		for(j = 1; j <= B_len; j++) h[j] = extendPrefixHash(h[j-1], data[i-j]);
+
 		for(j = B_len; j > 0; j--) {
-			map<array<uint8_t, B_len>, PostfixDictionary>::iterator curp;
+			long curp;
 
 			// check if x has been previously seen. 
 			//For the prediction, roundPrediction is the max across all pairs
 			//The prefix string should contain the j-tuple (S[i-j] ... S[i-1])
-			memset(x.data(), 0, B_len);
-			memcpy(x.data(), data+i-j, j);
-			curp = D[j-1].find(x);
+			curp = D.find(data+i-j, j, h[j]);
 
-			if(curp == D[j-1].end()) found_x = false;
+			if(curp < 0) found_x = false;
 			else found_x = true;
 
 			if(found_x) {
@@ -168,7 +185,7 @@ double LZ78Y_test(uint8_t *data, long len, int alph_size, const int verbose, con
 
 				// x has occurred, find max (x,y) pair across all y's
 				// Check to see if the current prediction is correct.
-				y = (curp->second).predict(count);
+				y = D.predict(curp, count);
 
 				if(count > max_count){
 					max_count = count;
@@ -176,12 +193,12 @@ double LZ78Y_test(uint8_t *data, long len, int alph_size, const int verbose, con
 					have_prediction = true;
 				}
 				//x exists as a prefix, so we always increment (and perhaps add a new postfix)
-				(curp->second).incrementPostfix(data[i], true);
+				D.incrementPostfix(curp, data[i], true);
 			} else if(dict_size < MAX_DICTIONARY_SIZE) {
 				//We didn't find the x prefix, so (x,y) surely can't have occurred.
                                 //We're allowed to make a new entry. Do so.
                                 //curp isn't populated here, because it wasn't found
-				D[j-1][x].incrementPostfix(data[i], true);
+				D.incrementPostfix(D.findOrInsert(data+i-j, j, h[j]), data[i], true);
 				dict_size++;
 			}
 		}
@@ -196,3 +213,8 @@ double LZ78Y_test(uint8_t *data, long len, int alph_size, const int verbose, con
 
 	return(predictionEstimate(C, N, max_run_len, alph_size, "LZ78Y", verbose, label));
 }
+
+// Section 6.3.10 - LZ78Y Prediction Estimate for a packed bit string (see pack_bitstring)
+double LZ78Y_test(const uint64_t *bits, long len, const int verbose, const char *label) {
+	return binaryLZ78YPredictionEstimate(bits, len, verbose, label);
+}
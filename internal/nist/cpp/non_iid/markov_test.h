@@ -1,30 +1,14 @@
 #pragma once
 #include "../shared/utils.h"
+#include "../shared/bitstring_summary.h"
 
-// Section 6.3.3 - Markov Estimate
-// data is assumed to be binary (e.g., bit string)
-double markov_test(uint8_t* data, long len, const int verbose, const char *label){
-	long i, C_0, C_1, C_00, C_10;
+// C_0, C_00 and C_10 count 0 bits, 00 pairs and 10 pairs among the first len-1 bits;
+// last is the final bit.
+static double markov_estimate(long len, long C_0, long C_00, long C_10, uint8_t last, const int verbose, const char *label){
+	long C_1;
 	double H_min, tmp_min_entropy, P_0, P_1, P_00, P_01, P_10, P_11, entEst;
 
-	C_0 = 0;
-	C_00 = 0;
-	C_10 = 0;
-
-	//Less than 2 symbols don't make sense for a Markov model.
-	assert(len > 1);
-
-	// get counts for unconditional and transition probabilities
-	for(i = 0; i < len-1; i++){
-		if(data[i] == 0){
-			C_0++;
-			if(data[i+1] == 0) C_00++;
-		}
-		else if(data[i+1] == 0) C_10++;
-	}
-
-	//C_0 is now  the number of 0 bits from S[0] to S[len-2]
-	
+	//C_0 is the number of 0 bits from S[0] to S[len-2]
 	C_1 = len - 1 - C_0; //C_1 is the number of 1 bits from S[0] to S[len-2]
 
 	//Note that P_X1 = C_X1 / C_X = (C_X - C_X0)/C_X = 1.0 - C_X0/C_X = 1.0 - P_X0 
@@ -45,7 +29,7 @@ double markov_test(uint8_t* data, long len, const int verbose, const char *label
 	}
 
 	// account for the last symbol
-	if(data[len-1] == 0) C_0++;
+	if(last == 0) C_0++;
 	//C_0 is now  the number of 0 bits from S[0] to S[len-1]
 
 	P_0 = C_0 / (double)len;
@@ -112,3 +96,27 @@ double markov_test(uint8_t* data, long len, const int verbose, const char *label
 
 	return entEst;
 }
+
+// Section 6.3.3 - Markov Estimate, finished from the summary of the bit string
+double markov_test(const bitstring_summary &bs, const int verbose, const char *label){
+	//Less than 2 symbols don't make sense for a Markov model.
+	assert(bs.len > 1);
+
+	return markov_estimate(bs.len, bs.C_0, bs.C_00, bs.C_10, bs.last, verbose, label);
+}
+
+// bits is a packed bit string (see pack_bitstring).
+double markov_test(const uint64_t* bits, long len, const int verbose, const char *label){
+	bitstring_summary bs;
+
+	bitstring_summary_init(&bs, bits, len);
+	return markov_test(bs, verbose, label);
+}
+
+// data is assumed to be binary (e.g., bit string)
+double markov_test(uint8_t* data, long len, const int verbose, const char *label){
+	vector<uint64_t, scratch_allocator<uint64_t> > bits(packed_word_count(len));
+
+	pack_bitstring(data, len, 1, bits.data());
+	return markov_test(bits.data(), len, verbose, label);
+}
@@ -3,42 +3,215 @@
 
 #define NUM_WINS 4
 
+/* Per window state for the MultiMCW estimate.
+ * Each symbol is on the circular doubly linked list of its count in the window. Nodes 0 ... alph_size-1
+ * are the symbols, and node alph_size+c is the list head for count c, so the maximum count is tracked
+ * incrementally and moving a symbol between counts takes no branches. When the most frequent symbol
+ * leaves the window the new one is the most recently seen symbol of the new highest count, and only
+ * that list has to be looked at instead of the whole alphabet.
+ */
+struct mcwWindow {
+	vector<int> cnts;
+	vector<long> poses;
+	vector<int> next;
+	vector<int> prev;
+	int alph_size;
+	int maxCnt;
+	uint8_t frequent;
+};
+
+static void mcwInit(mcwWindow &w, int alph_size, int windowSize) {
+	int nodes = alph_size + windowSize + 2;
+
+	w.cnts.assign(alph_size, 0);
+	w.poses.assign(alph_size, 0);
+	w.next.resize(nodes);
+	w.prev.resize(nodes);
+	w.alph_size = alph_size;
+	w.maxCnt = 0;
+	w.frequent = 0;
+
+	//All the lists start out empty, except the one for count 0, which holds every symbol
+	for(int c = alph_size; c < nodes; c++) {
+		w.next[c] = c;
+		w.prev[c] = c;
+	}
+	for(int k = alph_size-1; k >= 0; k--) {
+		w.prev[k] = alph_size;
+		w.next[k] = w.next[alph_size];
+		w.prev[w.next[alph_size]] = k;
+		w.next[alph_size] = k;
+	}
+}
+
+// Changes the count of sym by delta (+1 or -1), moving it to the matching list
+static inline void mcwAdjust(mcwWindow &w, uint8_t sym, int delta) {
+	int head;
+
+	w.next[w.prev[sym]] = w.next[sym];
+	w.prev[w.next[sym]] = w.prev[sym];
+
+	w.cnts[sym] += delta;
+	head = w.alph_size + w.cnts[sym];
+
+	w.prev[sym] = head;
+	w.next[sym] = w.next[head];
+	w.prev[w.next[head]] = sym;
+	w.next[head] = sym;
+}
+
+static inline bool mcwCountPresent(const mcwWindow &w, int cnt) {
+	return w.next[w.alph_size + cnt] != w.alph_size + cnt;
+}
+
+// The most frequent symbol has just left the window: find the highest count now present
+// (the incoming symbol may have moved one above it), then its most recently seen symbol.
+static void mcwReselect(mcwWindow &w) {
+	int head;
+	long pos = -1;
+
+	if(mcwCountPresent(w, w.maxCnt+1)) w.maxCnt++;
+	else if(!mcwCountPresent(w, w.maxCnt)) w.maxCnt--;
+	assert((w.maxCnt > 0) && mcwCountPresent(w, w.maxCnt));
+
+	head = w.alph_size + w.maxCnt;
+	for(int k = w.next[head]; k != head; k = w.next[k]) {
+		if(w.poses[k] > pos) {
+			pos = w.poses[k];
+			w.frequent = k;
+		}
+	}
+}
+
+// Window sizes of the MultiMCW estimate
+static const int mcw_windows[NUM_WINS] = {63, 255, 1023, 4095};
+
+/* State of the MultiMCW estimate for binary data.
+ * The window sizes are odd and a window is only used once it is full, so its most frequent symbol
+ * is never tied and is 1 exactly when more than half of the window is 1. Counting the ones is all
+ * the state a window needs. The samples can be read in pieces as they arrive, given the last
+ * mcw_windows[NUM_WINS-1] samples before each piece.
+ */
+struct binary_mcw_stream {
+	long i;				// samples read so far
+	int winner;
+	long C, run_len, max_run_len;
+	long scoreboard[NUM_WINS];
+	long ones[NUM_WINS];
+	uint8_t frequent[NUM_WINS];
+
+	binary_mcw_stream() : i(0), winner(0), C(0), run_len(0), max_run_len(0) {
+		for(int j = 0; j < NUM_WINS; j++){
+			scoreboard[j] = 0;
+			ones[j] = 0;
+			frequent[j] = 0;
+		}
+	}
+};
+
+// Reads samples x[s->i] ... x[end-1]. Windows are filled first and then slid, and predictions
+// start once the smallest one is full.
+template <typename Samples> static void binary_mcw_update(binary_mcw_stream *s, const Samples &x, long end){
+	const int *W = mcw_windows;
+	long i, j;
+
+	for(i = s->i; i < end; i++){
+		const uint8_t cur = x[i];
+
+		if(i >= W[0]){
+			// test prediction of winner
+			if(s->frequent[s->winner] == cur){
+				s->C++;
+				if(++s->run_len > s->max_run_len) s->max_run_len = s->run_len;
+			}
+			else s->run_len = 0;
+
+			// update scoreboard and select new winner
+			for(j = 0; j < NUM_WINS; j++){
+				if((i >= W[j]) && (s->frequent[j] == cur)){
+					if(++s->scoreboard[j] >= s->scoreboard[s->winner]) s->winner = j;
+				}
+			}
+		}
+
+		// fill the windows, then slide the full ones
+		for(j = 0; j < NUM_WINS; j++){
+			if(i >= W[j]) s->ones[j] += cur - x[i-W[j]];
+			else s->ones[j] += cur;
+			if(i >= W[j]-1) s->frequent[j] = (2*s->ones[j] > W[j]);
+		}
+	}
+	s->i = i;
+}
+
+// MultiMCW estimate of the len samples of a binary_mcw_stream that read them all
+static double binaryMultiMcwPredictionEstimate(const binary_mcw_stream &s, long len, const int verbose, const char *label){
+	return(predictionEstimate(s.C, len-mcw_windows[0], s.max_run_len, 2, "MultiMCW", verbose, label));
+}
+
+// Section 6.3.7 - MultiMCW Prediction Estimate of the len samples of binary data read by s
+double multi_mcw_test(const binary_mcw_stream &s, long len, const int verbose, const char *label){
+	assert(s.i == len);
+
+	if(len < mcw_windows[NUM_WINS-1]+1){
+		printf("\t*** Warning: not enough samples to run multiMCW test (need more than %d) ***\n", mcw_windows[NUM_WINS-1]+1);
+		return -1.0;
+	}
+
+	return binaryMultiMcwPredictionEstimate(s, len, verbose, label);
+}
+
+// Section 6.3.7 - MultiMCW Prediction Estimate of the len bit packed bitstring bits
+double multi_mcw_test(const uint64_t *bits, long len, const int verbose, const char *label){
+	const packed_samples view = {bits, 0};
+	binary_mcw_stream s;
+
+	if(len < mcw_windows[NUM_WINS-1]+1){
+		printf("\t*** Warning: not enough samples to run multiMCW test (need more than %d) ***\n", mcw_windows[NUM_WINS-1]+1);
+		return -1.0;
+	}
+
+	binary_mcw_update(&s, view, len);
+	return binaryMultiMcwPredictionEstimate(s, len, verbose, label);
+}
+
 // Section 6.3.7 - Multi Most Common in Window (MCW) Prediction Estimate
 double multi_mcw_test(uint8_t *data, long len, int alph_size, const int verbose, const char *label){
 	int winner;
-	int W[NUM_WINS] = {63, 255, 1023, 4095};
-	long i, j, k, N, C, run_len, max_run_len, max_pos; 
+	const int *W = mcw_windows;
+	long i, j, N, C, run_len, max_run_len;
 	long scoreboard[NUM_WINS] = {0};
-	long max_cnts[NUM_WINS] = {0};
-	long win_cnts[NUM_WINS][alph_size], win_poses[NUM_WINS][alph_size]; 
-	uint8_t frequent[NUM_WINS];
+	mcwWindow win[NUM_WINS];
 	
 	if(len < W[NUM_WINS-1]+1){	
 		printf("\t*** Warning: not enough samples to run multiMCW test (need more than %d) ***\n", W[NUM_WINS-1]+1);
 		return -1.0;
 	}
 
+	if(alph_size == 2){
+		binary_mcw_stream s;
+
+		binary_mcw_update(&s, data, len);
+		return binaryMultiMcwPredictionEstimate(s, len, verbose, label);
+	}
+
 	N = len-W[0];
 	winner = 0;
 	C = 0;
 	run_len = 0;
 	max_run_len = 0;
-	for(i = 0; i < NUM_WINS; i++){
-		for(j = 0; j < alph_size; j++){
-			win_cnts[i][j] = 0;
-			win_poses[i][j] = 0;
-		}
-	}
+	for(j = 0; j < NUM_WINS; j++) mcwInit(win[j], alph_size, W[j]);
 
 	// compute initial window counts
 	for(i = 0; i < W[NUM_WINS-1]; i++){
 		for(j = 0; j < NUM_WINS; j++){
 			if(i < W[j]){
-				if(max_cnts[j] <= ++win_cnts[j][data[i]]){
-					max_cnts[j] = win_cnts[j][data[i]];
-					frequent[j] = data[i];
+				mcwAdjust(win[j], data[i], 1);
+				if(win[j].maxCnt <= win[j].cnts[data[i]]){
+					win[j].maxCnt = win[j].cnts[data[i]];
+					win[j].frequent = data[i];
 				}
-				win_poses[j][data[i]] = i;
+				win[j].poses[data[i]] = i;
 			}
 		}
 	}
@@ -46,7 +219,7 @@ double multi_mcw_test(uint8_t *data, long len, int alph_size, const int verbose,
 	// perform predictions
 	for (i = W[0]; i < len; i++){
 		// test prediction of winner
-		if(frequent[winner] == data[i]){
+		if(win[winner].frequent == data[i]){
 			C++;
 			if(++run_len > max_run_len) max_run_len = run_len;
 		}
@@ -54,7 +227,7 @@ double multi_mcw_test(uint8_t *data, long len, int alph_size, const int verbose,
 
 		// update scoreboard and select new winner
 		for(j = 0; j < NUM_WINS; j++){
-			if((i >= W[j]) && (frequent[j] == data[i])){
+			if((i >= W[j]) && (win[j].frequent == data[i])){
 				if(++scoreboard[j] >= scoreboard[winner]) winner = j;
 			}
 		}
@@ -62,25 +235,19 @@ double multi_mcw_test(uint8_t *data, long len, int alph_size, const int verbose,
 		// update window counts and select new frequents
 		for(j = 0; j < NUM_WINS; j++){
 			if(i >= W[j]){
-				win_cnts[j][data[i-W[j]]]--;
-				win_cnts[j][data[i]]++;
-				win_poses[j][data[i]] = i;
-				if((data[i-W[j]] != frequent[j]) && (max_cnts[j] <= win_cnts[j][data[i]])){
-					max_cnts[j] = win_cnts[j][data[i]];
-					frequent[j] = data[i];
+				mcwWindow &w = win[j];
+				uint8_t out = data[i-W[j]];
+
+				if(out != data[i]){
+					mcwAdjust(w, out, -1);
+					mcwAdjust(w, data[i], 1);
 				}
-				else if(data[i-W[j]] == frequent[j]){
-					max_cnts[j]--;
-					// search for possible new frequent
-					max_pos = i-W[j];
-					for(k = 0; k < alph_size; k++){
-						if((max_cnts[j] < win_cnts[j][k]) || ((max_cnts[j] == win_cnts[j][k]) && (max_pos <= win_poses[j][k]))){
-							max_cnts[j] = win_cnts[j][k];
-							frequent[j] = k;
-							max_pos = win_poses[j][k];
-						}
-					}
+				w.poses[data[i]] = i;
+				if((out != w.frequent) && (w.maxCnt <= w.cnts[data[i]])){
+					w.maxCnt = w.cnts[data[i]];
+					w.frequent = data[i];
 				}
+				else if(out == w.frequent) mcwReselect(w);
 			}
 		}
 	}
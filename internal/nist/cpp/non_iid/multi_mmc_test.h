@@ -4,7 +4,8 @@
 #define D_MMC 16
 #define MAX_ENTRIES 100000
 
-static double binaryMultiMMCPredictionEstimate(const uint8_t *S, long L, const int verbose, const char *label)
+//S is a packed bit string (see pack_bitstring)
+static double binaryMultiMMCPredictionEstimate(const uint64_t *S, long L, const int verbose, const char *label)
 {
 
    long scoreboard[D_MMC] = {0};
@@ -16,6 +17,9 @@ static double binaryMultiMMCPredictionEstimate(const uint8_t *S, long L, const i
    long correctCount = 0;
    long j, d, i;
    uint32_t curPattern=0;
+   uint32_t history;
+   long historyLen;
+   uint8_t nextBit;
    long dictElems[D_MMC] = {0};
 
    assert(L>3);
@@ -26,16 +30,16 @@ static double binaryMultiMMCPredictionEstimate(const uint8_t *S, long L, const i
       //For a length m prefix, we need 2^m sets of length 2 arrays.
       //Here, j+1 is the length of the prefix, so we need 2^(j+1) prefixes, or 2*2^(j+1) = 2^(j+2) storage total.
       //Note: 2^(j+2) = 1<<(j+2).
-      binaryDict[j] = new long[1U<<(j+2)];
+      binaryDict[j] = scratch_array<long>(1U<<(j+2));
       memset(binaryDict[j], 0, sizeof(long)*(1U<<(j+2)));
    }
 
    // initialize MMC counts
    for(d=0; d<D_MMC; d++) {
-      curPattern = ((curPattern << 1) | (S[d]&1));
+      curPattern = ((curPattern << 1) | packed_bit(S, d));
 
       //This is necessarily the first symbol of this length
-      (BINARYDICTLOC(d+1, curPattern))[S[d+1]&1] = 1;
+      (BINARYDICTLOC(d+1, curPattern))[packed_bit(S, d+1)] = 1;
       dictElems[d] = 1;
    }
 
@@ -45,8 +49,16 @@ static double binaryMultiMMCPredictionEstimate(const uint8_t *S, long L, const i
    for(i=2; i<L; i++) {
       bool found_x = false;
 
+      // Stop early if cancelled; the dictionary is released before check_cancelled() throws
+      if(((i & CANCEL_POLL_MASK) == 0) && cancel_requested()) break;
+
       curWinner = winner;
-      curPattern = 0;
+      nextBit = packed_bit(S, i);
+
+      //history holds the longest prefix used this round, (S[i-historyLen] ... S[i-1]),
+      //with S[i-1] as its low bit, so each shorter prefix is just its low bits.
+      historyLen = min((long)D_MMC, i-1);
+      history = packed_bits(S, i-historyLen, (int)historyLen);
 
       //d+1 is the number of symbols used by the predictor
       for(d=0; (d<D_MMC) && (d<=i-2); d++) {
@@ -54,8 +66,7 @@ static double binaryMultiMMCPredictionEstimate(const uint8_t *S, long L, const i
          long curCount;
          long *binaryDictEntry;
 
-         //Add S[i-d-1] to the start of curPattern
-         curPattern = (curPattern | (((uint32_t)(S[i-d-1]&1))<<d));
+         curPattern = history & ((1U<<(d+1))-1);
          //curPattern should contain the d-tuple (S[i-d-1] ... S[i-1])
 
          binaryDictEntry = BINARYDICTLOC(d+1, curPattern);
@@ -83,7 +94,7 @@ static double binaryMultiMMCPredictionEstimate(const uint8_t *S, long L, const i
          if(found_x) {
             // x is present as a prefix.
             // Check to see if the current prediction is correct.
-            if(curPrediction == S[i]) {
+            if(curPrediction == nextBit) {
                // prediction is correct, update scoreboard and (the next round's) winner
                scoreboard[d]++;
                if(scoreboard[d] >= scoreboard[winner]) winner = d;
@@ -101,29 +112,30 @@ static double binaryMultiMMCPredictionEstimate(const uint8_t *S, long L, const i
             }
 
             //Now check to see in (x,y) needs to be counted or (x,y) added to the dictionary
-            if(binaryDictEntry[S[i]&1] != 0) {
+            if(binaryDictEntry[nextBit] != 0) {
                //The (x,y) tuple has already been encountered.
                //Increment the existing entry
-               binaryDictEntry[S[i]&1]++;
+               binaryDictEntry[nextBit]++;
             } else if(dictElems[d] < MAX_ENTRIES) {
                //The x prefix has been encountered, but not (x,y)
                //We're allowed to make a new entry. Do so.
-               binaryDictEntry[S[i]&1]=1;
+               binaryDictEntry[nextBit]=1;
                dictElems[d]++;
             }
          } else if(dictElems[d] < MAX_ENTRIES) {
             //We didn't find the x prefix, so (x,y) surely can't have occurred.
             //We're allowed to make a new entry. Do so.
-            binaryDictEntry[S[i]&1]=1;
+            binaryDictEntry[nextBit]=1;
             dictElems[d]++;
          }
       }
    }
 
    for(j=0; j<D_MMC; j++) {
-      delete[](binaryDict[j]);
+      scratch_free(binaryDict[j]);
       binaryDict[j] = NULL;
    }
+   check_cancelled();
 
    return(predictionEstimate(correctCount, L-2, maxRunOfCorrects, 2, "MultiMMC", verbose, label));
 }
@@ -149,17 +161,25 @@ double multi_mmc_test(uint8_t *data, long len, int alph_size, const int verbose,
 	int entries[D_MMC];
 	long i, d, N, C, run_len, max_run_len;
 	long scoreboard[D_MMC] = {0};
-	array<uint8_t, D_MMC> x;
+	uint64_t h;
 
-	if(alph_size == 2) return binaryMultiMMCPredictionEstimate(data, len, verbose, label);
+	if(alph_size == 2) {
+		vector<uint64_t, scratch_allocator<uint64_t> > bits(packed_word_count(len));
 
-	array<map<array<uint8_t, D_MMC>, PostfixDictionary>, D_MMC> M;
+		pack_bitstring(data, len, 1, bits.data());
+		return binaryMultiMMCPredictionEstimate(bits.data(), len, verbose, label);
+	}
 
 	if(len < 3){	
 		printf("\t*** Warning: not enough samples to run multiMMC test (need more than %d) ***\n", 3);
 		return -1.0;
 	}
 
+	assert(D_MMC <= PREFIX_DICTIONARY_MAXLEN);
+
+	//Each prefix length gets at most MAX_ENTRIES new entries (and at most one per symbol)
+	PrefixDictionary M(D_MMC*min((long)MAX_ENTRIES, len), D_MMC*min((long)MAX_ENTRIES, len));
+
 	//Step 1
 	N = len-2;
 
@@ -173,11 +193,9 @@ double multi_mmc_test(uint8_t *data, long len, int alph_size, const int verbose,
 
 	// initialize MMC counts
 	// this performs step 4.a and 4.b for the () case
-	memset(x.data(), 0, D_MMC);
 	for(d = 0; d < D_MMC; d++){
 		if(d < N){
-			memcpy(x.data(), data, d+1);
-			(M[d][x]).incrementPostfix(data[d+1], true);
+			M.incrementPostfix(M.findOrInsert(data, d+1, prefixHash(data, d+1)), data[d+1], true);
 			entries[d] = 1;
 		}
 	}
@@ -187,10 +205,15 @@ double multi_mmc_test(uint8_t *data, long len, int alph_size, const int verbose,
 	for (i = 2; i < len; i++){
 		bool found_x = false;
 		cur_winner = winner;
-		memset(x.data(), 0, D_MMC);
+		h = PREFIX_HASH_BASIS;
+
+		if((i & CANCEL_POLL_MASK) == 0) check_cancelled();
 
 		for(d = 0; (d < D_MMC) && (i-2 >= d); d++) {
-			map<array<uint8_t, D_MMC>, PostfixDictionary>::iterator curp;
+			long curp = -1;
+
+			//h is now the hash of the d-tuple (S[i-d-1], ..., S[i-1])
+			h = extendPrefixHash(h, data[i-d-1]);
 			// check if x has been previously seen as a prefix. If the prefix x has not occurred,
 			// then do not make a prediction for current d and larger d's
 			// as well, since it will not occur for them either. In other words,
@@ -203,9 +226,8 @@ double multi_mmc_test(uint8_t *data, long len, int alph_size, const int verbose,
 
 				//This populates the curp for the later increment
 
-				memcpy(x.data(), data+i-d-1, d+1);
-				curp = M[d].find(x);
-				if(curp == M[d].end()) found_x = false;
+				curp = M.find(data+i-d-1, d+1, h);
+				if(curp < 0) found_x = false;
 				else found_x = true;
 			}
 
@@ -213,7 +235,7 @@ double multi_mmc_test(uint8_t *data, long len, int alph_size, const int verbose,
 				long predictCount;
 				// x has occurred, find max (x,y) pair across all y's
 				// Check to see if the current prediction is correct.
-				if((curp->second).predict(predictCount) == data[i]){
+				if(M.predict(curp, predictCount) == data[i]){
 					// prediction is correct, update scoreboard and winner
 					if(++scoreboard[d] >= scoreboard[winner]) winner = d;
 					if(d == cur_winner){
@@ -228,7 +250,7 @@ double multi_mmc_test(uint8_t *data, long len, int alph_size, const int verbose,
 				}
 
 				//Now check to see in (x,y) needs to be counted or (x,y) added to the dictionary
-				if((curp->second).incrementPostfix(data[i], entries[d] < MAX_ENTRIES)) {
+				if(M.incrementPostfix(curp, data[i], entries[d] < MAX_ENTRIES)) {
 					//We had to make a new entry. Count this.
 					entries[d]++;
 				}
@@ -236,8 +258,7 @@ double multi_mmc_test(uint8_t *data, long len, int alph_size, const int verbose,
 				//We didn't find the x prefix, so (x,y) surely can't have occurred.
 				//We're allowed to make a new entry. Do so.
 				//curp isn't populated here, because it wasn't found
-				memcpy(x.data(), data+i-d-1, d+1);
-				(M[d][x]).incrementPostfix(data[i], true);
+				M.incrementPostfix(M.findOrInsert(data+i-d-1, d+1, h), data[i], true);
 				entries[d]++;
 			}
 		}
@@ -245,3 +266,8 @@ double multi_mmc_test(uint8_t *data, long len, int alph_size, const int verbose,
 
 	return(predictionEstimate(C, N, max_run_len, alph_size, "MultiMMC", verbose, label));
 }
+
+// Section 6.3.9 - MultiMMC Prediction Estimate for a packed bit string (see pack_bitstring)
+double multi_mmc_test(const uint64_t *bits, long len, const int verbose, const char *label){
+	return binaryMultiMMCPredictionEstimate(bits, len, verbose, label);
+}
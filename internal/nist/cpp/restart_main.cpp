@@ -3,6 +3,7 @@
 #include "shared/utils.h"
 #include "shared/most_common.h"
 #include "shared/lrs_test.h"
+#include "shared/transpose.h"
 #include "non_iid/non_iid_test_run.h"
 #include "iid/iid_test_run.h"
 #include "shared/TestRunUtils.h"
@@ -83,22 +84,29 @@
 // Note that if floor(1/p) = ceil(1/p) = 1/p, then there is no "residual" symbol, only 1/p most likely symbols.
 //
 // The array is 0-indexed, so we can use this map to establish the index directly.
-uint16_t simulateCount(int k_effective, double p, uint64_t *xoshiro256starstarState) {
-    uint16_t counts[256] = {0};
-    uint16_t max_count = 0;
+//
+// simulateCounts() runs XOSHIRO_LANES of these rounds at once, one per generator lane, and each lane keeps its
+// own histogram. The results are the largest counts of each round.
+void simulateCounts(int k_effective, double p, uint64_t laneState[4][XOSHIRO_LANES], uint16_t max_counts[XOSHIRO_LANES]) {
+    uint16_t counts[XOSHIRO_LANES][256] = {{0}};
+    uint64_t draws[XOSHIRO_LANES];
 
     for (int j = 0; j < 1000; j++) {
-        // Note that (int)floor(randomUnit(xoshiro256starstarState) / p) is the index map discussed in the above comments.
-        counts[(int)floor(randomUnit(xoshiro256starstarState) / p)]++;
+        xoshiro256starstarLanes(laneState, draws);
+        for (int l = 0; l < XOSHIRO_LANES; l++) {
+            // Note that this is the index map discussed in the above comments, applied to randomUnit() of this lane.
+            counts[l][(int)floor(((draws[l] >> 11) * 1.1102230246251565e-16) / p)]++;
+        }
     }
 
     // We could have tracked this during the above loop, but that would yield 1000 comparisons,
     // rather than k_effective (<= 256) comparisons, as here.
-    for (int j = 0; j < k_effective; j++) {
-        if (max_count < counts[j]) max_count = counts[j];
+    for (int l = 0; l < XOSHIRO_LANES; l++) {
+        max_counts[l] = 0;
+        for (int j = 0; j < k_effective; j++) {
+            if (max_counts[l] < counts[l][j]) max_counts[l] = counts[l][j];
+        }
     }
-
-    return max_count;
 }
 
 //This returns the bound (cutoff) for the test. Counts equal to this value should pass.
@@ -106,23 +114,18 @@ uint16_t simulateCount(int k_effective, double p, uint64_t *xoshiro256starstarSt
 
 int simulateBound(double alpha, int k, double H_I, unsigned long int simulation_rounds) {
     uint64_t xoshiro256starstarMainSeed[4];
-    uint16_t *results;
-    long int returnIndex;
+    // Each round's result is a count in 0 ... 1000, so the rounds are only tallied by result,
+    // and the quantile is read off the tallies (a counting sort) rather than from a sorted
+    // array of all the results.
+    unsigned long int results[1001] = {0};
+    unsigned long int returnIndex, seen;
+    unsigned long int blocks;
     double p;
     int k_effective;
     int returnValue;
 
     assert((k > 1) && (k <= 256));
 
-    // A few constraints:
-    // This array may be very large (many gigabytes) so can't go onto the stack
-    // Many of the C++ STL-derived types are not thread safe. Our mode of access is
-    // quite straight forward, but there are clearly issues in some cases.
-    // In C, calloc is possibly faster, but this is probably the best we can do
-    // using somewhat idiomatic C++.
-    results = new uint16_t[simulation_rounds];
-    memset(results, 0, sizeof(uint16_t)*simulation_rounds);
-
     //The probability of the most likely symbol (MLS) only needs to be calculated once...
     p = pow(2.0, -H_I);
 
@@ -134,30 +137,43 @@ int simulateBound(double alpha, int k, double H_I, unsigned long int simulation_
 
     seed(xoshiro256starstarMainSeed);
 
+    blocks = (simulation_rounds + XOSHIRO_LANES - 1) / XOSHIRO_LANES;
+
 #pragma omp parallel
     {
-        uint64_t xoshiro256starstarSeed[4];
+        uint64_t laneState[4][XOSHIRO_LANES];
+        unsigned long int localResults[1001] = {0};
+        uint16_t max_counts[XOSHIRO_LANES];
 
-        memcpy(xoshiro256starstarSeed, xoshiro256starstarMainSeed, sizeof (xoshiro256starstarMainSeed));
-        //Cause the RNG to jump omp_get_thread_num() * 2^128 calls
-        xoshiro_jump(omp_get_thread_num(), xoshiro256starstarSeed);
+        //Cause the RNG lanes to jump (omp_get_thread_num() * XOSHIRO_LANES + lane) * 2^128 calls
+        xoshiro_lanes_init(omp_get_thread_num() * XOSHIRO_LANES, xoshiro256starstarMainSeed, laneState);
 
 #pragma omp for
-        for (unsigned long int i = 0; i < simulation_rounds; i++) {
-            results[i] = simulateCount(k_effective, p, xoshiro256starstarSeed);
+        for (unsigned long int i = 0; i < blocks; i++) {
+            simulateCounts(k_effective, p, laneState, max_counts);
+            for (unsigned long int l = 0; (l < XOSHIRO_LANES) && (i * XOSHIRO_LANES + l < simulation_rounds); l++) {
+                localResults[max_counts[l]]++;
+            }
+        }
+
+#pragma omp critical(simulationResults)
+        {
+            for (int j = 0; j <= 1000; j++) results[j] += localResults[j];
         }
     }
 
-    sort(results, results+simulation_rounds);
-    assert((results[0] >= (1000 / k)) && (results[0] <= 1000));
-    assert((results[simulation_rounds - 1] >= (1000 / k)) && (results[simulation_rounds - 1] <= 1000));
+    for (int j = 0; j < (1000 / k); j++) assert(results[j] == 0);
 
     returnIndex = ((size_t) floor((1.0 - alpha) * ((double) simulation_rounds))) - 1;
-    assert((returnIndex >= 0) && (returnIndex < simulation_rounds));
+    assert(returnIndex < simulation_rounds);
 
-    returnValue = (int)results[returnIndex];
-
-    delete results;
+    //Find the result that would have been at returnIndex in the sorted list of results
+    seen = 0;
+    for (returnValue = 0; returnValue <= 1000; returnValue++) {
+        seen += results[returnValue];
+        if (seen > returnIndex) break;
+    }
+    assert(returnValue <= 1000);
 
     return returnValue;
 }
@@ -456,15 +472,15 @@ int main(int argc, char* argv[]) {
     }
 
     // construct column data from row data and get maximum column count
+    transpose_block(rdata, cdata, r, c);
     X_c = 0;
     for (j = 0; j < c; j++) { //columns
         memset(counts, 0, 256 * sizeof (int));
         X_i = 0;
         for (i = 0; i < r; i++) {
-            //[i*r+j] is row i, column j
+            //[j*r+i] is row i, column j
             //So, we're fixing a column and iterating through various rows
-            cdata[j * c + i] = rdata[i * r + j];
-            if (++counts[cdata[j * c + i]] > X_i) X_i = counts[cdata[j * c + i]];
+            if (++counts[cdata[j * r + i]] > X_i) X_i = counts[cdata[j * r + i]];
         }
         if (X_i > X_c) X_c = X_i;
     }
@@ -735,9 +751,11 @@ int main(int argc, char* argv[]) {
 
     } else { /* IID tests */
 
-        // Compute chi square stats
-        bool chi_square_test_pass_row = chi_square_tests(rdata, sample_size, alphabet_size, verbose);
-        bool chi_square_test_pass_col = chi_square_tests(cdata, sample_size, alphabet_size, verbose);
+        // Compute chi square stats. The columns hold the same symbols as the rows, so both share one binning.
+        chi_square_plan chi_square_binning_plan;
+        chi_square_plan_init(&chi_square_binning_plan, rdata, sample_size, alphabet_size);
+        bool chi_square_test_pass_row = chi_square_tests(&chi_square_binning_plan, rdata, verbose);
+        bool chi_square_test_pass_col = chi_square_tests(&chi_square_binning_plan, cdata, verbose);
         bool chi_square_test_pass = chi_square_test_pass_row && chi_square_test_pass_col;
 
         tcOverallIid.passed_chi_square_tests = chi_square_test_pass;
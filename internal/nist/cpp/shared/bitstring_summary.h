@@ -0,0 +1,207 @@
+#pragma once
+#include "utils.h"
+
+// One sweep over a packed bit string (see pack_bitstring) collects everything the Most Common
+// Value, Collision and Markov estimates take from the bits, so that they run on the counts
+// instead of each walking the bits again. The sweep runs in chunks of whole words, which run in
+// parallel for long bit strings and are reduced in order. A bit string that arrives in pieces can
+// be swept as they arrive (see bitstring_summary_stream).
+
+// Fewest words in a chunk; shorter bit strings are swept in a single chunk
+#define BITSTRING_SUMMARY_CHUNK_WORDS (1L << 14)
+
+struct bitstring_summary {
+	long len;
+	long ones;			// one bits (Most Common Value)
+	long C_0, C_00, C_10;		// 0 bits, 00 pairs and 10 pairs among the first len-1 bits (Markov)
+	uint8_t last;			// the final bit
+	long collisions;		// wait times until a collision (Collision)
+	long collision_end;		// sum of the wait times, which is where the walk stopped
+	double collision_squares;	// sum of the squared wait times
+};
+
+// The collision walk advances 2 bits from a pair of equal bits and 3 from a pair of different
+// bits, so its steps within a byte only depend on the bit it enters the byte at and on the
+// byte and the bit after it. steps[o][x] describes the steps that start in a byte entered at
+// bit o, where x holds the byte followed by the next bit: bits 0-2 count the waits of 2,
+// bits 3-4 the waits of 3 and bits 5-6 are the bit the walk enters the next byte at.
+struct collision_step_table {
+	uint8_t steps[3][512];
+
+	collision_step_table(){
+		for(int o = 0; o < 3; o++){
+			for(int x = 0; x < 512; x++){
+				int i = o, twos = 0, threes = 0;
+
+				while(i < 8){
+					if(((x >> (8-i)) & 1) == ((x >> (7-i)) & 1)){
+						twos++;
+						i += 2;
+					}else{
+						threes++;
+						i += 3;
+					}
+				}
+				steps[o][x] = (uint8_t)(twos | (threes << 3) | ((i-8) << 5));
+			}
+		}
+	}
+};
+
+static const collision_step_table collision_steps;
+
+// Counts of the words w0 ... w1-1 of a bit string. The collision walk is followed through the
+// bytes of these words for each of the bits 0, 1 and 2 that it can enter the first byte at.
+struct bitstring_chunk {
+	long ones, C_0, C_00, C_10;
+	long twos[3], threes[3];
+	int exit[3];			// the bit of the byte after the chunk that the walk enters at
+};
+
+// walk_bytes is the number of leading bytes in which no step of the walk can reach the end of
+// the bits; the walk is only followed through those.
+static void bitstring_chunk_count(const uint64_t *bits, long len, long w0, long w1, long walk_bytes, bitstring_chunk *c){
+	long w, p, rem, pairs = len - 1;
+	uint64_t cur, next, valid;
+	int o[3] = {0, 1, 2};
+
+	c->ones = 0;
+	c->C_0 = 0;
+	c->C_00 = 0;
+	c->C_10 = 0;
+
+	// next holds the bit after each bit of cur, as in the Markov transition counts
+	for(w = w0; w < w1; w++){
+		cur = bits[w];
+		next = (cur << 1) | (bits[w+1] >> (PACKED_WORD_BITS - 1));
+
+		rem = len - w*PACKED_WORD_BITS;
+		valid = (rem >= PACKED_WORD_BITS) ? ~0ULL : ~0ULL << (PACKED_WORD_BITS - rem);
+		c->ones += __builtin_popcountll(cur & valid);
+
+		rem = pairs - w*PACKED_WORD_BITS;
+		if(rem <= 0) continue;
+		valid = (rem >= PACKED_WORD_BITS) ? ~0ULL : ~0ULL << (PACKED_WORD_BITS - rem);
+		c->C_0 += __builtin_popcountll(~cur & valid);
+		c->C_00 += __builtin_popcountll(~cur & ~next & valid);
+		c->C_10 += __builtin_popcountll(cur & ~next & valid);
+	}
+
+	for(int e = 0; e < 3; e++){
+		c->twos[e] = 0;
+		c->threes[e] = 0;
+	}
+
+	// The three walks are independent, so they overlap rather than run one after another
+	for(p = w0*8; p < min(w1*8, walk_bytes); p++){
+		uint32_t x = packed_bits(bits, p*8, 9);
+
+		for(int e = 0; e < 3; e++){
+			uint8_t s = collision_steps.steps[o[e]][x];
+
+			c->twos[e] += s & 7;
+			c->threes[e] += (s >> 3) & 3;
+			o[e] = s >> 5;
+		}
+	}
+
+	for(int e = 0; e < 3; e++) c->exit[e] = o[e];
+}
+
+// A sweep of a bit string that arrives in pieces: the counts of the words swept so far, with the
+// collision walk through them followed from the start of the string
+struct bitstring_summary_stream {
+	long words;			// words swept so far
+	long ones, C_0, C_00, C_10;
+	long twos, threes;
+	int o;				// the bit of the next byte that the walk enters at
+
+	bitstring_summary_stream() : words(0), ones(0), C_0(0), C_00(0), C_10(0), twos(0), threes(0), o(0) {}
+};
+
+// The walk enters each chunk at the bit that the previous one left it at
+static void bitstring_summary_add(bitstring_summary_stream *s, const bitstring_chunk *c){
+	s->ones += c->ones;
+	s->C_0 += c->C_0;
+	s->C_00 += c->C_00;
+	s->C_10 += c->C_10;
+
+	s->twos += c->twos[s->o];
+	s->threes += c->threes[s->o];
+	s->o = c->exit[s->o];
+}
+
+// Sweeps the words of the first avail bits of the string whose sweep does not depend on the bits
+// that follow: a word is counted along with the first bit after it, and the walk through a byte
+// reads the next bit as well and may step 2 bits past it. bits[0] holds word first_word of the
+// string, which is at most the first word not swept yet.
+void bitstring_summary_update(bitstring_summary_stream *s, const uint64_t *bits, long first_word, long avail){
+	const long w1 = (avail >= 2) ? (avail - 2) / PACKED_WORD_BITS : 0;
+	bitstring_chunk c;
+
+	assert(first_word <= s->words);
+	if(w1 <= s->words) return;
+
+	// Counted in the coordinates of bits; the bits before it take no part
+	bitstring_chunk_count(bits, avail - first_word*PACKED_WORD_BITS, s->words - first_word, w1 - first_word, (w1 - first_word)*8, &c);
+	bitstring_summary_add(s, &c);
+	s->words = w1;
+}
+
+// Sweeps the rest of the len bits of the string and fills in bs. bits[0] holds word first_word of
+// the string, as for bitstring_summary_update.
+void bitstring_summary_finish(bitstring_summary *bs, bitstring_summary_stream *s, const uint64_t *bits, long first_word, long len){
+	const long base = first_word*PACKED_WORD_BITS;
+	long words = (len + PACKED_WORD_BITS - 1) / PACKED_WORD_BITS;
+	long walk_bytes = (len > 2) ? (len - 2) / 8 : 0;
+	long chunks = 1, rest, i;
+
+	assert(len > 0);
+	assert(first_word <= s->words);
+
+	rest = words - s->words;
+	if(rest >= 2*BITSTRING_SUMMARY_CHUNK_WORDS) chunks = min((long)omp_get_max_threads(), rest / BITSTRING_SUMMARY_CHUNK_WORDS);
+	vector<bitstring_chunk> counts(chunks);
+
+	#pragma omp parallel for schedule(static) if(chunks > 1)
+	for(long c = 0; c < chunks; c++){
+		bitstring_chunk_count(bits, len - base, s->words - first_word + rest*c/chunks, s->words - first_word + rest*(c+1)/chunks, walk_bytes - first_word*8, &counts[c]);
+	}
+	for(long c = 0; c < chunks; c++) bitstring_summary_add(s, &counts[c]);
+	s->words = words;
+
+	bs->len = len;
+	bs->ones = s->ones;
+	bs->C_0 = s->C_0;
+	bs->C_00 = s->C_00;
+	bs->C_10 = s->C_10;
+	bs->last = packed_bit(bits, len-1 - base);
+
+	// The last steps may run into the end of the bits, so they are taken one at a time
+	i = walk_bytes*8 + s->o;
+	while(i < len-1){
+		uint32_t pair = packed_bits(bits, i - base, 2);
+
+		if((pair == 0) || (pair == 3)){
+			s->twos++; // 00 or 11
+			i += 2;
+		}else if(i < len-2){
+			s->threes++; // 010, 011, 100, or 101
+			i += 3;
+		}else{
+			break;
+		}
+	}
+
+	// Every partial sum of the squares is an integer well below 2^53, so this is the sum the
+	// reference tool accumulates one wait time at a time
+	bs->collisions = s->twos + s->threes;
+	bs->collision_end = i;
+	bs->collision_squares = 4.0*(double)s->twos + 9.0*(double)s->threes;
+}
+
+void bitstring_summary_init(bitstring_summary *bs, const uint64_t *bits, long len){
+	bitstring_summary_stream s;
+
+	bitstring_summary_finish(bs, &s, bits, 0, len);
+}
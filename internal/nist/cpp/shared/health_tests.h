@@ -0,0 +1,316 @@
+#pragma once
+#include <climits>
+#include "../shared/utils.h"
+
+// Continuous health tests of SP 800-90B Section 4.4, run on the live output of a noise source. Each
+// source keeps a health_state of fixed size: the tests only need the current run and the current
+// window, so streams of any length are processed in constant memory.
+
+// Window sizes of the Adaptive Proportion Test (Section 4.4.2)
+#define APT_WINDOW_BINARY 1024
+#define APT_WINDOW_NON_BINARY 512
+
+// Upper limit on -log2(alpha); Section 4.4 recommends 20 <= -log2(alpha) <= 40
+#define HEALTH_MAX_ALPHA_EXPONENT 64
+
+// Largest Repetition Count Test cutoff; it is kept in an unsigned int
+#define HEALTH_MAX_RCT_CUTOFF UINT_MAX
+
+struct health_state {
+	uint8_t mask;			// bits of a byte that form the sample
+	unsigned int rct_cutoff;	// C of the Repetition Count Test
+	unsigned int apt_cutoff;	// C of the Adaptive Proportion Test
+	unsigned int apt_window;	// W of the Adaptive Proportion Test
+
+	// Repetition Count Test
+	bool started;			// whether a sample was seen
+	uint8_t last;			// A, the most recent sample
+	uint64_t run;			// B, the number of consecutive samples equal to A
+
+	// Adaptive Proportion Test
+	unsigned int apt_seen;		// samples of the current window seen so far, 0 before its first
+	uint8_t apt_first;		// A, the first sample of the current window
+	unsigned int apt_count;		// B, the samples of the current window equal to A
+	bool apt_alarmed;		// whether the current window already raised its alarm
+
+	uint64_t samples;
+	uint64_t rct_alarms;
+	uint64_t apt_alarms;
+	uint64_t apt_windows;		// completed windows
+	uint64_t longest_run;
+	unsigned int max_window_count;	// largest B of a completed window
+};
+
+// Whether the Repetition Count Test cutoff for min-entropy h is at most HEALTH_MAX_RCT_CUTOFF. As
+// HEALTH_MAX_RCT_CUTOFF - 1 is an integer, ceil(x) <= HEALTH_MAX_RCT_CUTOFF - 1 exactly if x is.
+bool rct_cutoff_fits(const double h, const int alpha_exponent){
+	return (h > 0.0) && (alpha_exponent / h <= (double)(HEALTH_MAX_RCT_CUTOFF - 1));
+}
+
+// Repetition Count Test cutoff: C = 1 + ceil(-log2(alpha) / H)
+unsigned int rct_cutoff(const double h, const int alpha_exponent){
+	assert(rct_cutoff_fits(h, alpha_exponent));
+	return 1 + (unsigned int)ceil(alpha_exponent / h);
+}
+
+// Adaptive Proportion Test cutoff: C = 1 + CRITBINOM(W, 2^-H, 1 - alpha), the smallest C such that
+// B >= C has probability at most alpha. The binomial tail is summed from the top, so that
+// 1 - alpha does not need to be represented.
+unsigned int apt_cutoff(const double h, const int alpha_exponent, const unsigned int window){
+	const long double p = powl(2.0L, -(long double)h);
+	const long double alpha = ldexpl(1.0L, -alpha_exponent);
+	const long double lgw = lgammal(window + 1.0L);
+	long double tail = 0.0L;
+	unsigned int k;
+
+	// tail = P(X > k - 1) for X ~ Binomial(W, p) once k drops below W + 1
+	for(k = window; k > 0; k--){
+		const long double pmf = expl(lgw - lgammal(k + 1.0L) - lgammal(window - k + 1.0L) + k * logl(p) + (window - k) * log1pl(-p));
+		if(tail + pmf > alpha) break;
+		tail += pmf;
+	}
+
+	// P(X > k) <= alpha and P(X > k - 1) > alpha: CRITBINOM is k
+	return 1 + k;
+}
+
+// Sets up the tests of a source with min-entropy h per sample (0 < h <= bits_per_symbol) and false
+// positive probability alpha = 2^-alpha_exponent per test.
+void health_state_init(health_state *hs, const double h, const int bits_per_symbol, const int alpha_exponent){
+	memset(hs, 0, sizeof(*hs));
+	hs->mask = (uint8_t)((1U << bits_per_symbol) - 1);
+	hs->apt_window = (bits_per_symbol == 1) ? APT_WINDOW_BINARY : APT_WINDOW_NON_BINARY;
+	hs->rct_cutoff = rct_cutoff(h, alpha_exponent);
+	hs->apt_cutoff = apt_cutoff(h, alpha_exponent, hs->apt_window);
+}
+
+// Forgets the current run and window and zeroes the counters, keeping the cutoffs.
+void health_state_reset(health_state *hs){
+	health_state fresh;
+
+	memset(&fresh, 0, sizeof(fresh));
+	fresh.mask = hs->mask;
+	fresh.rct_cutoff = hs->rct_cutoff;
+	fresh.apt_cutoff = hs->apt_cutoff;
+	fresh.apt_window = hs->apt_window;
+	*hs = fresh;
+}
+
+// Extends the current run by k samples, raising one alarm for a run that reaches the cutoff.
+static inline void rct_extend(health_state *hs, const uint64_t k){
+	if((hs->run < hs->rct_cutoff) && (hs->run + k >= hs->rct_cutoff)) hs->rct_alarms++;
+	hs->run += k;
+	if(hs->run > hs->longest_run) hs->longest_run = hs->run;
+}
+
+// Repetition Count Test (Section 4.4.1) of count samples, one sample at a time. A run that goes on
+// past the cutoff raises a single alarm.
+void rct_kernel_scalar(health_state *hs, const uint8_t x[], const size_t count){
+	for(size_t i = 0; i < count; ++i){
+		const uint8_t s = x[i] & hs->mask;
+
+		if(hs->started && (s == hs->last)){
+			rct_extend(hs, 1);
+		}else{
+			hs->started = true;
+			hs->last = s;
+			hs->run = 0;
+			rct_extend(hs, 1);
+		}
+	}
+}
+
+// Whether the mask has a run of at least len set bits. Bit i of m stays set while bits i to
+// i + found - 1 are; found doubles each step, so the loop takes log2(len) steps whatever the data.
+static inline bool has_bit_run(uint64_t m, const uint64_t len){
+	uint64_t found = 1;
+
+	if(len == 0) return true;
+	if(len > 64) return false;
+	for(; 2 * found <= len; found *= 2) m &= m >> found;
+	if(found < len) m &= m >> (len - found);
+	return m != 0;
+}
+
+// Applies a block of width samples to the Repetition Count Test, given the mask eq whose bit j is
+// set if sample j of the block equals the one before it. Runs that start and end inside the block
+// can only raise an alarm or a new longest run if eq has a long enough run of set bits; such
+// (rare) blocks are gone through one sample at a time.
+static inline void rct_block(health_state *hs, const uint8_t x[], const uint64_t eq, const unsigned int width){
+	const uint64_t all = (width == 64) ? ~0ULL : ((1ULL << width) - 1);
+
+	if(eq == all){
+		rct_extend(hs, width);
+	}else if(has_bit_run(eq, min<uint64_t>(hs->rct_cutoff, hs->longest_run + 1) - 1)){
+		rct_kernel_scalar(hs, x, width);
+	}else{
+		// The run carried in ends at the first sample that differs; the run carried out starts
+		// after the last one.
+		rct_extend(hs, __builtin_ctzll(~eq));
+		hs->run = 1 + __builtin_clzll(~(eq << (64 - width)));
+		hs->last = x[width - 1] & hs->mask;
+	}
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+
+// Compares 64 samples per step with the samples before them. Built for AVX2 regardless of the
+// compiler flags; select_rct_kernel only hands it out when the CPU supports it.
+__attribute__((target("avx2")))
+void rct_kernel_avx2(health_state *hs, const uint8_t x[], const size_t count){
+	const __m256i mask = _mm256_set1_epi8((char)hs->mask);
+	size_t i = 0;
+
+	// The first sample is compared with the last one of the previous chunk, the others with the
+	// sample before them
+	if(count > 0) rct_kernel_scalar(hs, x, ++i);
+
+	for(; i + 64 <= count; i += 64){
+		const __m256i s0 = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(x + i)), mask);
+		const __m256i t0 = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(x + i - 1)), mask);
+		const __m256i s1 = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(x + i + 32)), mask);
+		const __m256i t1 = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(x + i + 31)), mask);
+		const uint64_t eq0 = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(s0, t0));
+		const uint64_t eq1 = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(s1, t1));
+
+		rct_block(hs, x + i, eq0 | (eq1 << 32), 64);
+	}
+
+	if(i < count) rct_kernel_scalar(hs, x + i, count - i);
+}
+
+// Counts the samples equal to a, 32 per step
+__attribute__((target("avx2,popcnt")))
+uint64_t apt_count_avx2(const uint8_t x[], const size_t count, const uint8_t a, const uint8_t m){
+	const __m256i mask = _mm256_set1_epi8((char)m);
+	const __m256i target = _mm256_set1_epi8((char)a);
+	uint64_t c = 0;
+	size_t i = 0;
+
+	for(; i + 32 <= count; i += 32){
+		const __m256i s = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(x + i)), mask);
+		c += __builtin_popcount((unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(s, target)));
+	}
+
+	for(; i < count; ++i) c += ((x[i] & m) == a);
+	return c;
+}
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+
+// Bit j of the result is set if byte j of v is 0xFF
+static inline uint64_t neon_movemask(const uint8x16_t v){
+	static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+	const uint8x16_t bits = vandq_u8(v, vld1q_u8(weights));
+
+	return vaddv_u8(vget_low_u8(bits)) | ((uint64_t)vaddv_u8(vget_high_u8(bits)) << 8);
+}
+
+// Compares 16 samples per step with the samples before them. NEON is part of the AArch64 baseline.
+void rct_kernel_neon(health_state *hs, const uint8_t x[], const size_t count){
+	const uint8x16_t mask = vdupq_n_u8(hs->mask);
+	size_t i = 0;
+
+	if(count > 0) rct_kernel_scalar(hs, x, ++i);
+
+	for(; i + 16 <= count; i += 16){
+		const uint8x16_t s = vandq_u8(vld1q_u8(x + i), mask);
+		const uint8x16_t t = vandq_u8(vld1q_u8(x + i - 1), mask);
+
+		rct_block(hs, x + i, neon_movemask(vceqq_u8(s, t)), 16);
+	}
+
+	if(i < count) rct_kernel_scalar(hs, x + i, count - i);
+}
+
+// Counts the samples equal to a, 16 per step
+uint64_t apt_count_neon(const uint8_t x[], const size_t count, const uint8_t a, const uint8_t m){
+	const uint8x16_t mask = vdupq_n_u8(m);
+	const uint8x16_t target = vdupq_n_u8(a);
+	const uint8x16_t one = vdupq_n_u8(1);
+	uint64_t c = 0;
+	size_t i = 0;
+
+	for(; i + 16 <= count; i += 16){
+		c += vaddvq_u8(vandq_u8(vceqq_u8(vandq_u8(vld1q_u8(x + i), mask), target), one));
+	}
+
+	for(; i < count; ++i) c += ((x[i] & m) == a);
+	return c;
+}
+#endif
+
+uint64_t apt_count_scalar(const uint8_t x[], const size_t count, const uint8_t a, const uint8_t m){
+	uint64_t c = 0;
+
+	for(size_t i = 0; i < count; ++i) c += ((x[i] & m) == a);
+	return c;
+}
+
+typedef void (*rct_kernel)(health_state *hs, const uint8_t x[], const size_t count);
+typedef uint64_t (*apt_count_kernel)(const uint8_t x[], const size_t count, const uint8_t a, const uint8_t m);
+
+// Picks the widest health test kernels the running CPU supports
+rct_kernel select_rct_kernel(){
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	if(__builtin_cpu_supports("avx2")) return rct_kernel_avx2;
+#elif defined(__aarch64__)
+	return rct_kernel_neon;
+#endif
+	return rct_kernel_scalar;
+}
+
+apt_count_kernel select_apt_count_kernel(){
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) return apt_count_avx2;
+#elif defined(__aarch64__)
+	return apt_count_neon;
+#endif
+	return apt_count_scalar;
+}
+
+// Adaptive Proportion Test (Section 4.4.2) of count samples. A window raises at most one alarm, at
+// the sample that brings B to the cutoff.
+void apt_process(health_state *hs, const uint8_t x[], const size_t count){
+	static const apt_count_kernel kernel = select_apt_count_kernel();
+	size_t i = 0;
+
+	while(i < count){
+		if(hs->apt_seen == 0){
+			hs->apt_first = x[i++] & hs->mask;
+			hs->apt_count = 1;
+			hs->apt_seen = 1;
+			hs->apt_alarmed = false;
+			continue;
+		}
+
+		const size_t take = min((size_t)(hs->apt_window - hs->apt_seen), count - i);
+		hs->apt_count += (unsigned int)kernel(x + i, take, hs->apt_first, hs->mask);
+		if(!hs->apt_alarmed && (hs->apt_count >= hs->apt_cutoff)){
+			hs->apt_alarmed = true;
+			hs->apt_alarms++;
+		}
+
+		hs->apt_seen += (unsigned int)take;
+		i += take;
+
+		if(hs->apt_seen == hs->apt_window){
+			hs->apt_windows++;
+			if(hs->apt_count > hs->max_window_count) hs->max_window_count = hs->apt_count;
+			hs->apt_seen = 0;
+		}
+	}
+}
+
+// Runs both tests on the next count samples of a source. Chunks may be of any size; the outcome
+// does not depend on how the stream is split.
+void health_process(health_state *hs, const uint8_t x[], const size_t count){
+	static const rct_kernel kernel = select_rct_kernel();
+
+	kernel(hs, x, count);
+	apt_process(hs, x, count);
+	hs->samples += count;
+}
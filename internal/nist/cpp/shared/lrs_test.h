@@ -1,123 +1,231 @@
 #pragma once
 
 #include "utils.h"
+#include <atomic>
 #include <climits>
+#include <mutex>
 #include <divsufsort.h>
 #include <divsufsort64.h>
 
 #define SAINDEX_MAX INT32_MAX
 #define SAINDEX64_MAX INT64_MAX
 
-//Using the Kasai (et al.) O(n) time "13n space" algorithm.
+// Suffix and LCP arrays are the largest buffers of an assessment, so they live in scratch buffers
+typedef vector<saidx_t, scratch_allocator<saidx_t> > saidx_vector;
+typedef vector<saidx64_t, scratch_allocator<saidx64_t> > saidx64_vector;
+
+//Using the Kasai (et al.) O(n) time algorithm.
 //"Linear-Time Longest-Common-Prefix Computation in Suffix Arrays and Its Applications", by Kasai, Lee, Arimura, Arikawa, and Park
 //https://doi.org/10.1007/3-540-48194-X_17
 //http://web.cs.iastate.edu/~cs548/references/linear_lcp.pdf
+//This runs in place: the inverse suffix array (rank) is overwritten by the permuted LCP array (PLCP) as it is
+//consumed, and the LCP array then overwrites the suffix array. This is "9n space" rather than "13n space".
+//On return, sa holds the LCP array (lcp[0] = -1, lcp[1] = 0).
 //The default implementation uses 4 byte indexes
-static void sa2lcp32(const uint8_t text[], long int n, const vector<saidx_t> &sa, vector<saidx_t> &lcp) {
+static void sa2lcp32(const uint8_t text[], long int n, saidx_vector &sa) {
 	saidx_t h;
-	vector<saidx_t> rank(n+1,-1);
+	saidx_vector plcp(n+1,-1); //holds rank = sa^{-1} until each entry is consumed
 
 	assert(n>1);
 
-	lcp[0] = -1;
-	lcp[1] = 0;
-
 	// compute rank = sa^{-1}
 	for(saidx_t i=0; i<=(saidx_t)n; i++) {
-		rank[sa[i]] = i;
+		plcp[sa[i]] = i;
 	}
 
 	// traverse suffixes in rank order
 	h=0;
 
 	for(saidx_t i=0; i<(saidx_t)n; i++) {
-		saidx_t k = rank[i]; // rank of s[i ... n-1]
+		saidx_t k = plcp[i]; // rank of s[i ... n-1]
+		plcp[i] = 0;
 		if(k>1) {
 			saidx_t j = sa[k-1]; // predecessor of s[i ... n-1]
 			while((i+h<(saidx_t)n) && (j+h<(saidx_t)n) && (text[i+h]==text[j+h])) {
 				h++;
 			}
 
-			lcp[k] = h;
+			plcp[i] = h;
 		}
 		if(h>0) {
 			h--;
 		}
 	}
+
+	// lcp[k] = plcp[sa[k]]; each sa[k] is read before it is overwritten
+	plcp[n] = -1;
+	for(saidx_t k=0; k<=(saidx_t)n; k++) {
+		sa[k] = plcp[sa[k]];
+	}
 }
 
-//Using the Kasai (et al.) O(n) time "25n space" algorithm (with 64-bit indicies)
-static void sa2lcp64(const uint8_t text[], long int n, const vector<saidx64_t> &sa, vector<saidx64_t> &lcp) {
+//Using the same in place algorithm (with 64-bit indicies), "17n space" rather than "25n space"
+static void sa2lcp64(const uint8_t text[], long int n, saidx64_vector &sa) {
 	saidx64_t h;
-	vector<saidx64_t> rank(n+1,-1);
+	saidx64_vector plcp(n+1,-1); //holds rank = sa^{-1} until each entry is consumed
 
 	assert(n>1);
 
-	lcp[0] = -1;
-	lcp[1] = 0;
-
 	// compute rank = sa^{-1}
 	for(saidx64_t i=0; i<=(saidx64_t)n; i++) {
-		rank[sa[i]] = i;
+		plcp[sa[i]] = i;
 	}
 
 	// traverse suffixes in rank order
 	h=0;
 
 	for(saidx64_t i=0; i<(saidx64_t)n; i++) {
-		saidx64_t k = rank[i]; // rank of s[i ... n-1]
+		saidx64_t k = plcp[i]; // rank of s[i ... n-1]
+		plcp[i] = 0;
 		if(k>1) {
 			saidx64_t j = sa[k-1]; // predecessor of s[i ... n-1]
 			while((i+h<(saidx64_t)n) && (j+h<(saidx64_t)n) && (text[i+h]==text[j+h])) {
 				h++;
 			}
 
-			lcp[k] = h;
+			plcp[i] = h;
 		}
 		if(h>0) {
 			h--;
 		}
 	}
-}
 
+	// lcp[k] = plcp[sa[k]]; each sa[k] is read before it is overwritten
+	plcp[n] = -1;
+	for(saidx64_t k=0; k<=(saidx64_t)n; k++) {
+		sa[k] = plcp[sa[k]];
+	}
+}
 
-void calcSALCP32(const uint8_t text[], long int n, vector<saidx_t> &sa, vector<saidx_t> &lcp) {
+//On return, lcp holds n+1 LCP entries; reserve is the number of entries to reserve
+//so that the caller can extend the array without reallocating.
+void calcLCP32(const uint8_t text[], long int n, saidx_vector &lcp, long int reserve) {
 	int32_t res;
 
 	assert(n < SAINDEX_MAX);
 	assert(n > 0); 
-	assert(sa.size() == (size_t)(n+1));
-	assert(sa.size() == (size_t)(n+1));
+	assert(reserve >= n+1);
 
-	sa[0] = (saidx_t)n;
+	lcp.reserve(reserve);
+	lcp.assign(n+1, -1);
+	lcp[0] = (saidx_t)n;
 
-	res=divsufsort((const sauchar_t *)text, (saidx_t *)(sa.data()+1), (saidx_t)n);
+	res=divsufsort((const sauchar_t *)text, (saidx_t *)(lcp.data()+1), (saidx_t)n);
 	assert(res==0);
-   	sa2lcp32(text, n, sa, lcp);
+   	sa2lcp32(text, n, lcp);
 }
 
-void calcSALCP64(const uint8_t text[], long int n, vector<saidx64_t> &sa, vector<saidx64_t> &lcp) {
+void calcLCP64(const uint8_t text[], long int n, saidx64_vector &lcp, long int reserve) {
 	int32_t res;
 
 	assert(n < SAINDEX64_MAX);
 	assert(n > 0);
-	assert(sa.size() == (size_t)(n+1));
-	assert(sa.size() == (size_t)(n+1));
+	assert(reserve >= n+1);
 
-	sa[0] = (saidx64_t)n;
+	lcp.reserve(reserve);
+	lcp.assign(n+1, -1);
+	lcp[0] = (saidx64_t)n;
 
-	res=divsufsort64((const sauchar_t *)text, (saidx64_t *)(sa.data()+1), (saidx64_t)n);
+	res=divsufsort64((const sauchar_t *)text, (saidx64_t *)(lcp.data()+1), (saidx64_t)n);
 	assert(res==0);
-   	sa2lcp64(text, n, sa, lcp);
+   	sa2lcp64(text, n, lcp);
 }
+
+// The LCP array of one text, built once and shared by every test that needs it
+// (t-Tuple and LRS estimates, and the IID length of the longest repeated substring test).
+// The suffix array is only needed to construct the LCP array, so it is not kept.
+// 4 byte indexes are used whenever the text is short enough.
+class SuffixIndex {
+	long int n;
+	long int lrs;
+	saidx_vector lcp32;
+	saidx64_vector lcp64;
+
+	void build(const uint8_t text[]) {
+		// lcp[i] is the LCP of sorted suffixes i-1 and i (with the empty suffix at sa[0]);
+		// lcp[n+1] is an extra 0 so that lcp+1 is the whole array in Kaufer's convention.
+		if(wide()) {
+			calcLCP64(text, n, lcp64, n+2);
+			lcp64.push_back(0);
+			for(long int j = 0; j <= n; j++) if(lcp64[j] > lrs) lrs = lcp64[j];
+		} else {
+			calcLCP32(text, n, lcp32, n+2);
+			lcp32.push_back(0);
+			for(long int j = 0; j <= n; j++) if(lcp32[j] > lrs) lrs = lcp32[j];
+		}
+	}
+public:
+	SuffixIndex(const uint8_t text[], long int len) : n(len), lrs(-1) {
+		build(text);
+	}
+
+	// Index of the len bit packed bitstring bits (see pack_bitstring). The bitstring is only
+	// unpacked to one byte per bit while the index is built.
+	SuffixIndex(const uint64_t bits[], long int len) : n(len), lrs(-1) {
+		vector<uint8_t, scratch_allocator<uint8_t> > text(len);
+
+		for(long int i = 0; i < len; i++) text[i] = packed_bit(bits, i);
+		build(text.data());
+	}
+
+	long int size() const {return n;}
+	bool wide() const {return n >= SAINDEX_MAX;}
+
+	// The length of the longest repeated substring
+	long int lrs_len() const {return lrs;}
+
+	// LCP array using Kaufer's conventions: L[0] = L[n] = 0, and L[i] is the LCP of
+	// the (i-1)th and ith non-empty suffixes in sorted order.
+	const saidx_t *kaufer32() const {assert(!wide()); return lcp32.data()+1;}
+	const saidx64_t *kaufer64() const {assert(wide()); return lcp64.data()+1;}
+};
+
+// The SuffixIndex of one text, shared by the assessments of that text in one call. The first
+// of them to need the index builds it, and it is freed once they have all released it.
+class SharedSuffixIndex {
+	std::mutex mutex;
+	SuffixIndex *index;
+	int users;
+public:
+	explicit SharedSuffixIndex(int users) : index(NULL), users(users) {}
+	~SharedSuffixIndex() {delete index;}
+
+	// The index of text, which must be the same text for every user
+	const SuffixIndex &get(const uint8_t text[], long int len) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if(index == NULL) {
+			index = new SuffixIndex(text, len);
+			builds().fetch_add(1, std::memory_order_relaxed);
+		}
+		assert(index->size() == len);
+		return *index;
+	}
+
+	// Called once by each user when it no longer needs the index
+	void release() {
+		std::lock_guard<std::mutex> lock(mutex);
+		assert(users > 0);
+		if(--users == 0) {
+			delete index;
+			index = NULL;
+		}
+	}
+
+	// Number of indexes built by SharedSuffixIndex in this process
+	static std::atomic<unsigned long> &builds() {
+		static std::atomic<unsigned long> count(0);
+		return count;
+	}
+
+	SharedSuffixIndex(const SharedSuffixIndex &) = delete;
+	SharedSuffixIndex &operator=(const SharedSuffixIndex &) = delete;
+};
+
 /* Based on the algorithm outlined by Aaron Kaufer
  * This is described here:
  * http://www.untruth.org/~josh/sp80090b/Kaufer%20Further%20Improvements%20for%20SP%20800-90B%20Tuple%20Counts.pdf
  */
-void SAalgs32(const uint8_t text[], long int n, int k, double &t_tuple_res, double &lrs_res, const int verbose, const char *label) {
-	vector <saidx_t> sa(n+1, -1); //each value is at most n-1
-	vector <saidx_t> L(n+2, -1); //each value is at most n-1
-
+void SAalgs32(const saidx_t L[], long int n, int k, double &t_tuple_res, double &lrs_res, const int verbose, const char *label) {
    	long int u; //The length of a string: 1 <= u <= v+1 <= n
    	long int v; //The length of the LRS. 1 <= v <= n-1
 	long int c; //contains a count from A
@@ -132,12 +240,9 @@ void SAalgs32(const uint8_t text[], long int n, int k, double &t_tuple_res, doub
 	assert(n < SAINDEX_MAX);
 	assert((UINT64_MAX / (uint64_t)n) >= ((uint64_t)n+1U)); // (mult assert)
 
-	calcSALCP32(text, n, sa, L);
-
-	//to conform with Kaufer's conventions
-	L.erase(L.begin());
-	L[n] = 0;
+	//L follows Kaufer's conventions
 	assert(L[0] == 0);
+	assert(L[n] == 0);
 
 	//Find the length of the LRS, v
 
@@ -159,6 +264,8 @@ void SAalgs32(const uint8_t text[], long int n, int k, double &t_tuple_res, doub
 
 	j = 0;
 	for(long int i = 1; i <= n; i++) {
+		if((i & CANCEL_POLL_MASK) == 0) check_cancelled();
+
 		c = 0;
 		//Note L[0] is already verified to be 0
 		assert(L[i] >= 0);
@@ -264,6 +371,8 @@ void SAalgs32(const uint8_t text[], long int n, int k, double &t_tuple_res, doub
 		memset(A.data(), 0, sizeof(saidx_t)*((size_t)v+2));
 
 		for(long int i = 1; i <= n; i++) {
+			if((i & CANCEL_POLL_MASK) == 0) check_cancelled();
+
 			if((L[i-1] >= u) && (L[i] < L[i-1])) {
 				saidx_t b = L[i];
 
@@ -335,11 +444,8 @@ void SAalgs32(const uint8_t text[], long int n, int k, double &t_tuple_res, doub
 	return;
 }
 
-void SAalgs64(const uint8_t text[], long int n, int k, double &t_tuple_res, double &lrs_res, const int verbose, const char *label)
+void SAalgs64(const saidx64_t L[], long int n, int k, double &t_tuple_res, double &lrs_res, const int verbose, const char *label)
 {
-	vector <saidx64_t> sa(n+1, -1); //each value is at most n-1
-	vector <saidx64_t> L(n+2, -1); //each value is at most n-1
-
    	long int u; //The length of a string: 1 <= u <= v+1 <= n
    	long int v; //The length of the LRS. 1 <= v <= n-1
 	long int c; //contains a count from A
@@ -354,12 +460,9 @@ void SAalgs64(const uint8_t text[], long int n, int k, double &t_tuple_res, doub
 	assert(n <= SAINDEX64_MAX - 1);
 	assert((UINT128_MAX / (uint128_t)n) >= ((uint128_t)n+1U)); // (mult assert)
 
-	calcSALCP64(text, n, sa, L);
-
-	//to conform with Kaufer's conventions
-	L.erase(L.begin());
-	L[n] = 0;
+	//L follows Kaufer's conventions
 	assert(L[0] == 0);
+	assert(L[n] == 0);
 
 	//Find the length of the LRS, v
 
@@ -381,6 +484,8 @@ void SAalgs64(const uint8_t text[], long int n, int k, double &t_tuple_res, doub
 
 	j = 0;
 	for(long int i = 1; i <= n; i++) {
+		if((i & CANCEL_POLL_MASK) == 0) check_cancelled();
+
 		c = 0;
 		//Note L[0] is already verified to be 0
 		assert(L[i] >= 0);
@@ -486,6 +591,8 @@ void SAalgs64(const uint8_t text[], long int n, int k, double &t_tuple_res, doub
 		memset(A.data(), 0, sizeof(saidx64_t)*((size_t)v+2));
 
 		for(long int i = 1; i <= n; i++) {
+			if((i & CANCEL_POLL_MASK) == 0) check_cancelled();
+
 			if((L[i-1] >= u) && (L[i] < L[i-1])) {
 				saidx64_t b = L[i];
 
@@ -558,41 +665,25 @@ void SAalgs64(const uint8_t text[], long int n, int k, double &t_tuple_res, doub
 	return;
 }
 
-void SAalgs(const uint8_t text[], long int n, int k, double &t_tuple_res, double &lrs_res, const int verbose, const char *label) {
-	if(n<SAINDEX_MAX) {
-		SAalgs32(text, n, k, t_tuple_res, lrs_res, verbose, label);
+void SAalgs(const SuffixIndex &index, int k, double &t_tuple_res, double &lrs_res, const int verbose, const char *label) {
+	if(!index.wide()) {
+		SAalgs32(index.kaufer32(), index.size(), k, t_tuple_res, lrs_res, verbose, label);
 	} else {
-		SAalgs64(text, n, k, t_tuple_res, lrs_res, verbose, label);
+		SAalgs64(index.kaufer64(), index.size(), k, t_tuple_res, lrs_res, verbose, label);
 	}
 }
 
-long int len_LRS32(const uint8_t text[], const int sample_size){
-	vector <saidx_t> sa(sample_size+1, -1);
-	vector <saidx_t> lcp(sample_size+1, -1);
-	saidx_t lrs_len = -1;
-
-	calcSALCP32(text, sample_size, sa, lcp);
-
-	for(saidx_t j = 0; j <= sample_size; j++) {
-		if(lcp[j] > lrs_len) lrs_len = lcp[j];
-	}
-
-	return(lrs_len);
+void SAalgs(const uint8_t text[], long int n, int k, double &t_tuple_res, double &lrs_res, const int verbose, const char *label) {
+	SuffixIndex index(text, n);
+	SAalgs(index, k, t_tuple_res, lrs_res, verbose, label);
 }
 
-long int len_LRS64(const uint8_t text[], const int sample_size){
-	vector <saidx64_t> sa(sample_size+1, -1);
-	vector <saidx64_t> lcp(sample_size+1, -1);
-	saidx64_t lrs_len = -1;
-
-	calcSALCP64(text, sample_size, sa, lcp);
-
-	for(saidx64_t j = 0; j <= sample_size; j++) {
-		if(lcp[j] > lrs_len) lrs_len = lcp[j];
-	}
-
-	return(lrs_len);
+// t-Tuple and LRS estimates of the n bit packed bitstring bits
+void SAalgs(const uint64_t bits[], long int n, double &t_tuple_res, double &lrs_res, const int verbose, const char *label) {
+	SuffixIndex index(bits, n);
+	SAalgs(index, 2, t_tuple_res, lrs_res, verbose, label);
 }
+
 /*
 * ---------------------------------------------
 *			 HELPER FUNCTIONS
@@ -614,7 +705,9 @@ void calc_collision_proportion(const vector<double> &p, long double &p_col){
 * ---------------------------------------------
 */
 
-bool len_LRS_test(const uint8_t data[], const int L, const int k, const int verbose, const char *label) {
+// The LCP array of data is only asked of index once it is known to be needed; if index is NULL
+// it is built here.
+bool len_LRS_test(const uint8_t data[], const int L, const int k, const int verbose, const char *label, SharedSuffixIndex *index) {
 	// p_col is the probability of collision on a per-symbol basis under an IID assumption (this is related to the collision entropy).
 	// p_col >= 1/k, which bounds this.
 	// Note, for SP 800-90B k<=256, so we can bound p_col >= 2^-8.
@@ -641,10 +734,10 @@ bool len_LRS_test(const uint8_t data[], const int L, const int k, const int verb
 
 	// The length of the longest repeated substring (LRS) for the supplied data is W.
 	long int W;
-	if(L<SAINDEX_MAX) {
-		W = len_LRS32(data, L);
+	if(index != NULL) {
+		W = index->get(data, L).lrs_len();
 	} else {
-		W = len_LRS64(data, L);
+		W = SuffixIndex(data, L).lrs_len();
 	}
 
 	// p_col^W is the probability of collision of a W-length string under an IID assumption;
@@ -714,3 +807,7 @@ bool len_LRS_test(const uint8_t data[], const int L, const int k, const int verb
 	// iff log(0.999) >= N*log1p(-p_col^W)
 	return logl(0.999L) >= ((long double)N)* logProbNoColsPerPair;
 }
+
+bool len_LRS_test(const uint8_t data[], const int L, const int k, const int verbose, const char *label) {
+	return len_LRS_test(data, L, k, verbose, label, NULL);
+}
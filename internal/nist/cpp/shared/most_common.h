@@ -1,26 +1,13 @@
 #pragma once
 #include "../shared/utils.h"
+#include "../shared/bitstring_summary.h"
 #include "../shared/test_case_base.h"
 #include <string>
 
-// Section 6.3.1 - Most Common Value Estimate
-double most_common(uint8_t* data, const long len, const int alph_size, const int verbose, const char *label, TestCaseBase &tc){
-
-	long counts[alph_size];
-	long i, mode;
+static double most_common_estimate(const long mode, const long len, const int verbose, const char *label, TestCaseBase &tc){
 	double pmax, ubound;
 	double entEst;
 
-	assert(len > 1);
-
-	for(i = 0; i < alph_size; i++) counts[i] = 0;
-	for (i = 0; i < len; i++) counts[data[i]]++;
-
-	mode = 0;
-	for(i = 0; i < alph_size; i++){
-		if(counts[i] > mode) mode = counts[i];
-	}
-
 	pmax = mode/(double)len;
 
 	ubound = min(1.0,pmax + ZALPHA*sqrt(pmax*(1.0-pmax)/(len-1.0)));
@@ -42,6 +29,51 @@ double most_common(uint8_t* data, const long len, const int alph_size, const int
 	return entEst;
 }
 
+// Section 6.3.1 - Most Common Value Estimate from the histogram of the symbols
+double most_common(const long* counts, const long len, const int alph_size, const int verbose, const char *label, TestCaseBase &tc){
+
+	long i, mode;
+
+	assert(len > 1);
+
+	mode = 0;
+	for(i = 0; i < alph_size; i++){
+		if(counts[i] > mode) mode = counts[i];
+	}
+
+	return most_common_estimate(mode, len, verbose, label, tc);
+}
+
+// Section 6.3.1 - Most Common Value Estimate
+double most_common(uint8_t* data, const long len, const int alph_size, const int verbose, const char *label, TestCaseBase &tc){
+
+	long counts[256];
+
+	byte_histogram(data, len, counts);
+
+	return most_common(counts, len, alph_size, verbose, label, tc);
+}
+
+// Section 6.3.1 - Most Common Value Estimate for a packed bit string (see pack_bitstring)
+double most_common(const uint64_t* bits, const long len, const int verbose, const char *label, TestCaseBase &tc){
+
+	long ones;
+
+	assert(len > 1);
+
+	ones = packed_popcount(bits, len);
+
+	return most_common_estimate(max(ones, len - ones), len, verbose, label, tc);
+}
+
+// Section 6.3.1 - Most Common Value Estimate, finished from the summary of a bit string
+double most_common(const bitstring_summary &bs, const int verbose, const char *label, TestCaseBase &tc){
+
+	assert(bs.len > 1);
+
+	return most_common_estimate(max(bs.ones, bs.len - bs.ones), bs.len, verbose, label, tc);
+}
+
 //Wrapper method needed because some runs do not get output as JSON currently
 //and therefore do not have a TestCase object to send (restart tests)
 double most_common(uint8_t* data, const long len, const int alph_size, const int verbose, const char *label){
@@ -50,3 +82,24 @@ double most_common(uint8_t* data, const long len, const int alph_size, const int
    return most_common(data, len, alph_size, verbose, label, dummy);    
    
 }
+
+double most_common(const uint64_t* bits, const long len, const int verbose, const char *label){
+
+   TestCaseBase dummy;
+   return most_common(bits, len, verbose, label, dummy);
+
+}
+
+double most_common(const long* counts, const long len, const int alph_size, const int verbose, const char *label){
+
+   TestCaseBase dummy;
+   return most_common(counts, len, alph_size, verbose, label, dummy);
+
+}
+
+double most_common(const bitstring_summary &bs, const int verbose, const char *label){
+
+   TestCaseBase dummy;
+   return most_common(bs, verbose, label, dummy);
+
+}
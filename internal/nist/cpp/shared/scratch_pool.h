@@ -0,0 +1,192 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>		// std::atomic
+#include <mutex>		// std::mutex
+#include <new>			// std::bad_alloc
+#include <sys/mman.h>	// mmap, madvise
+
+// Scratch buffers of the estimators (suffix and LCP arrays, symbol and bit strings, the
+// permutation and compression buffers) come from a process-wide pool. Buffers of at least
+// SCRATCH_POOLED_BYTES are mapped pages that are kept for the next request once released,
+// up to a limit on the retained bytes, so a long-lived process that assesses inputs of
+// similar sizes reaches a steady state with no mmap/munmap calls and no page faults on them.
+// Smaller requests go to malloc, whose per-thread caches already serve them well.
+
+// Smallest request served from the pool, and the granularity of the buffers below a huge page
+#define SCRATCH_POOLED_BYTES ((size_t)1 << 16)
+// Buffers of at least this size are rounded up to whole huge pages, start on a huge page
+// boundary and are advised to be backed by transparent huge pages.
+#define SCRATCH_HUGE_PAGE_BYTES ((size_t)1 << 21)
+// Most idle buffers the pool keeps, and the default limit on their size
+#define SCRATCH_POOL_SLOTS 64
+#define SCRATCH_POOL_DEFAULT_LIMIT ((size_t)1 << 28)
+
+// Bytes of scratch buffers held under a meter, and the most it held at once. A buffer is
+// charged to the meter installed on the thread that allocates it and credited back to the
+// same meter by whichever thread frees it, so the meter has to outlive its buffers.
+struct scratch_meter {
+	std::atomic<long long> current;
+	std::atomic<long long> peak;
+
+	scratch_meter() : current(0), peak(0) {}
+};
+
+// The meter charged with the buffers allocated on this thread, or NULL
+static thread_local scratch_meter *scratch_thread_meter = NULL;
+
+// Precedes every scratch buffer; 64 bytes so the buffer itself stays cache line aligned
+struct scratch_header {
+	size_t mapped;		// bytes mapped for the buffer, header included, or 0 if it came from malloc
+	size_t capacity;	// usable bytes
+	scratch_meter *meter;	// meter the buffer is charged to, or NULL
+	uint64_t pad[5];
+};
+
+static_assert(sizeof(scratch_header) == 64, "scratch buffers must stay cache line aligned");
+
+struct scratch_pool_state {
+	std::mutex lock;
+	size_t limit;		// most bytes kept in idle buffers
+	size_t retained;	// bytes kept in idle buffers
+	int count;
+	scratch_header *idle[SCRATCH_POOL_SLOTS];
+
+	scratch_pool_state() : limit(SCRATCH_POOL_DEFAULT_LIMIT), retained(0), count(0) {}
+};
+
+static scratch_pool_state scratch_pool;
+
+static void scratch_meter_charge(scratch_meter *m, long long bytes){
+	const long long now = m->current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	long long peak = m->peak.load(std::memory_order_relaxed);
+	while((now > peak) && !m->peak.compare_exchange_weak(peak, now, std::memory_order_relaxed)){}
+}
+
+static scratch_header *scratch_map(size_t bytes){
+	const size_t align = (bytes + sizeof(scratch_header) >= SCRATCH_HUGE_PAGE_BYTES) ? SCRATCH_HUGE_PAGE_BYTES : SCRATCH_POOLED_BYTES;
+	const size_t mapped = (bytes + sizeof(scratch_header) + align - 1) & ~(align - 1);
+	// Huge buffers are mapped one huge page larger and trimmed to a huge page boundary
+	const size_t slack = (align == SCRATCH_HUGE_PAGE_BYTES) ? align : 0;
+
+	void *area = mmap(NULL, mapped + slack, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(area == MAP_FAILED) return NULL;
+
+	uint8_t *base = (uint8_t *)area;
+	uint8_t *start = base;
+	if(slack > 0){
+		start = (uint8_t *)(((uintptr_t)base + align - 1) & ~(uintptr_t)(align - 1));
+		if(start > base) munmap(base, start - base);
+		if(base + slack > start) munmap(start + mapped, (base + slack) - start);
+#ifdef MADV_HUGEPAGE
+		madvise(start, mapped, MADV_HUGEPAGE);
+#endif
+	}
+
+	scratch_header *h = (scratch_header *)start;
+	h->mapped = mapped;
+	h->capacity = mapped - sizeof(scratch_header);
+	return h;
+}
+
+// Returns a buffer of at least bytes bytes with malloc semantics (its contents are undefined), or NULL.
+void *scratch_alloc(size_t bytes){
+	scratch_header *h = NULL;
+
+	if(bytes < SCRATCH_POOLED_BYTES){
+		h = (scratch_header *)malloc(sizeof(scratch_header) + bytes);
+		if(h == NULL) return NULL;
+		h->mapped = 0;
+		h->capacity = bytes;
+	}else{
+		// The smallest idle buffer that fits, unless it would waste more than half of itself
+		{
+			std::lock_guard<std::mutex> guard(scratch_pool.lock);
+			int best = -1;
+			for(int i = 0; i < scratch_pool.count; i++){
+				const size_t cap = scratch_pool.idle[i]->capacity;
+				if((cap >= bytes) && (cap / 2 <= bytes) && ((best < 0) || (cap < scratch_pool.idle[best]->capacity))) best = i;
+			}
+			if(best >= 0){
+				h = scratch_pool.idle[best];
+				scratch_pool.idle[best] = scratch_pool.idle[--scratch_pool.count];
+				scratch_pool.retained -= h->mapped;
+			}
+		}
+		if(h == NULL) h = scratch_map(bytes);
+		if(h == NULL) return NULL;
+	}
+
+	h->meter = scratch_thread_meter;
+	if(h->meter != NULL) scratch_meter_charge(h->meter, (long long)h->capacity);
+	return h + 1;
+}
+
+// Releases a buffer of scratch_alloc; it is kept for reuse if the pool has room for it.
+void scratch_free(void *p){
+	if(p == NULL) return;
+
+	scratch_header *h = (scratch_header *)p - 1;
+	if(h->meter != NULL) h->meter->current.fetch_sub((long long)h->capacity, std::memory_order_relaxed);
+
+	if(h->mapped == 0){
+		free(h);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(scratch_pool.lock);
+		if((scratch_pool.count < SCRATCH_POOL_SLOTS) && (scratch_pool.retained + h->mapped <= scratch_pool.limit)){
+			scratch_pool.idle[scratch_pool.count++] = h;
+			scratch_pool.retained += h->mapped;
+			return;
+		}
+	}
+	munmap(h, h->mapped);
+}
+
+// Sets the most bytes the pool keeps in idle buffers, unmapping what exceeds it; 0 keeps none.
+void scratch_pool_set_limit(size_t bytes){
+	scratch_header *evicted[SCRATCH_POOL_SLOTS];
+	int n = 0;
+
+	{
+		std::lock_guard<std::mutex> guard(scratch_pool.lock);
+		scratch_pool.limit = bytes;
+		while(scratch_pool.retained > scratch_pool.limit){
+			scratch_header *h = scratch_pool.idle[--scratch_pool.count];
+			scratch_pool.retained -= h->mapped;
+			evicted[n++] = h;
+		}
+	}
+	for(int i = 0; i < n; i++) munmap(evicted[i], evicted[i]->mapped);
+}
+
+// Bytes held in idle buffers
+size_t scratch_pool_retained(){
+	std::lock_guard<std::mutex> guard(scratch_pool.lock);
+	return scratch_pool.retained;
+}
+
+// new T[n] for trivial types, from the pool; release with scratch_free
+template <typename T> T *scratch_array(size_t n){
+	void *p = scratch_alloc(n * sizeof(T));
+	if(p == NULL) throw std::bad_alloc();
+	return (T *)p;
+}
+
+// Allocator that puts the storage of a vector in a scratch buffer
+template <typename T> struct scratch_allocator {
+	typedef T value_type;
+
+	scratch_allocator() {}
+	template <typename U> scratch_allocator(const scratch_allocator<U> &) {}
+
+	T *allocate(size_t n) {return scratch_array<T>(n);}
+	void deallocate(T *p, size_t) {scratch_free(p);}
+};
+
+template <typename T, typename U> bool operator==(const scratch_allocator<T> &, const scratch_allocator<U> &) {return true;}
+template <typename T, typename U> bool operator!=(const scratch_allocator<T> &, const scratch_allocator<U> &) {return false;}
@@ -0,0 +1,80 @@
+#pragma once
+#include <stdint.h>
+#include <omp.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Side of the square tiles transpose_block works through; a 64x64 tile of the source and the
+// matching tile of the destination stay in L1 together.
+#define TRANSPOSE_TILE 64
+
+// Matrices with fewer samples than this are transposed on the calling thread only, as the
+// transpose is memory bound and a 1000x1000 restart matrix takes well under a millisecond.
+#define TRANSPOSE_PARALLEL_MIN (1L << 22)
+
+// Transposes the 8x8 block at src, whose rows are src_stride apart, into dst, whose rows are
+// dst_stride apart.
+static inline void transpose_8x8(const uint8_t *src, const long src_stride, uint8_t *dst, const long dst_stride){
+#if defined(__SSE2__)
+	__m128i a0, a1, a2, a3, b0, b1, b2, b3, c;
+
+	// Interleave rows pairwise, then the pairs, then the quads; each step doubles the run of
+	// samples from one column that sit next to each other
+	a0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(src)), _mm_loadl_epi64((const __m128i *)(src + src_stride)));
+	a1 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(src + 2*src_stride)), _mm_loadl_epi64((const __m128i *)(src + 3*src_stride)));
+	a2 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(src + 4*src_stride)), _mm_loadl_epi64((const __m128i *)(src + 5*src_stride)));
+	a3 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(src + 6*src_stride)), _mm_loadl_epi64((const __m128i *)(src + 7*src_stride)));
+
+	b0 = _mm_unpacklo_epi16(a0, a1);	// Columns 0-3 of rows 0-3
+	b1 = _mm_unpackhi_epi16(a0, a1);	// Columns 4-7 of rows 0-3
+	b2 = _mm_unpacklo_epi16(a2, a3);	// Columns 0-3 of rows 4-7
+	b3 = _mm_unpackhi_epi16(a2, a3);	// Columns 4-7 of rows 4-7
+
+	c = _mm_unpacklo_epi32(b0, b2);
+	_mm_storel_epi64((__m128i *)(dst), c);
+	_mm_storel_epi64((__m128i *)(dst + dst_stride), _mm_srli_si128(c, 8));
+	c = _mm_unpackhi_epi32(b0, b2);
+	_mm_storel_epi64((__m128i *)(dst + 2*dst_stride), c);
+	_mm_storel_epi64((__m128i *)(dst + 3*dst_stride), _mm_srli_si128(c, 8));
+	c = _mm_unpacklo_epi32(b1, b3);
+	_mm_storel_epi64((__m128i *)(dst + 4*dst_stride), c);
+	_mm_storel_epi64((__m128i *)(dst + 5*dst_stride), _mm_srli_si128(c, 8));
+	c = _mm_unpackhi_epi32(b1, b3);
+	_mm_storel_epi64((__m128i *)(dst + 6*dst_stride), c);
+	_mm_storel_epi64((__m128i *)(dst + 7*dst_stride), _mm_srli_si128(c, 8));
+#else
+	for(int i = 0; i < 8; i++){
+		for(int j = 0; j < 8; j++) dst[j*dst_stride + i] = src[i*src_stride + j];
+	}
+#endif
+}
+
+// Writes the transpose of the rows x cols row-major matrix src to dst, so that row j of dst holds
+// column j of src: dst[j*rows + i] = src[i*cols + j]. The matrix is processed in cache tiles of
+// 8x8 blocks that are transposed in registers; large matrices are split across threads.
+void transpose_block(const uint8_t *src, uint8_t *dst, const long rows, const long cols){
+	const long row_tiles = (rows + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE;
+	const long col_tiles = (cols + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE;
+
+	#pragma omp parallel for collapse(2) schedule(static) if(rows*cols >= TRANSPOSE_PARALLEL_MIN)
+	for(long ti = 0; ti < row_tiles; ti++){
+		for(long tj = 0; tj < col_tiles; tj++){
+			const long i0 = ti*TRANSPOSE_TILE, i1 = (i0 + TRANSPOSE_TILE < rows) ? i0 + TRANSPOSE_TILE : rows;
+			const long j0 = tj*TRANSPOSE_TILE, j1 = (j0 + TRANSPOSE_TILE < cols) ? j0 + TRANSPOSE_TILE : cols;
+			long i = i0;
+
+			for(; i + 8 <= i1; i += 8){
+				long j = j0;
+				for(; j + 8 <= j1; j += 8) transpose_8x8(src + i*cols + j, cols, dst + j*rows + i, rows);
+				for(; j < j1; j++){
+					for(long k = i; k < i + 8; k++) dst[j*rows + k] = src[k*cols + j];
+				}
+			}
+			for(; i < i1; i++){
+				for(long j = j0; j < j1; j++) dst[j*rows + i] = src[i*cols + j];
+			}
+		}
+	}
+}
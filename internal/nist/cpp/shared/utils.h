@@ -19,10 +19,18 @@
 #include <omp.h>		// openmp 4.0 with gcc 4.9
 #include <bitset>
 #include <mutex>		// std::mutex
+#include <atomic>		// std::atomic
+#include <chrono>		// std::chrono::steady_clock
+#include <stdexcept>	// std::runtime_error
 #include <assert.h>
 #include <cfloat>
 #include <math.h>
+#include <fcntl.h>		// open
+#include <unistd.h>		// read, close
+#include <sys/mman.h>	// mmap, madvise
+#include <sys/stat.h>	// fstat
 #include "test_run_base.h"
+#include "scratch_pool.h"
 
 #define SWAP(x, y) do { int s = x; x = y; y = s; } while(0)
 #define INOPENINTERVAL(x, a, b) (((a)>(b))?(((x)>(b))&&((x)<(a))):(((x)>(a))&&((x)<(b))))
@@ -60,14 +68,75 @@ struct data_t{
 	uint8_t *rawsymbols; 	// raw data words
 	uint8_t *symbols; 		// data words
 	uint8_t *bsymbols; 	// data words as binary string
+	uint64_t *pbsymbols; 	// data words as a packed binary string (see pack_bitstring), or NULL
 	long len; 		// number of words in data
 	long blen; 		// number of bits in data
+	void *map_base;		// file mapping that rawsymbols points into (see read_file_subset), or NULL
+	size_t map_len;		// length of the mapping
 };
 
 
 
 using namespace std;
 
+// Cooperative cancellation of long-running estimators. A caller that may abandon an assessment
+// installs a cancel_token on the thread running it (see cancel_scope). Long loops poll
+// cancel_requested() every CANCEL_POLL_MASK+1 iterations, release what they hold and throw
+// assessment_cancelled. Without an installed token, polling is a single thread-local load.
+#define CANCEL_POLL_MASK 0xFFFF
+
+class assessment_cancelled : public std::runtime_error {
+public:
+	explicit assessment_cancelled(const char *what) : std::runtime_error(what) {}
+};
+
+struct cancel_token {
+	std::atomic<bool> cancelled;	// set by cancel() from any thread
+	bool has_deadline;
+	std::chrono::steady_clock::time_point deadline;
+
+	// A timeout_seconds of 0 or less means no deadline
+	explicit cancel_token(double timeout_seconds) : cancelled(false), has_deadline(timeout_seconds > 0) {
+		if(has_deadline) {
+			deadline = std::chrono::steady_clock::now() +
+				std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeout_seconds));
+		}
+	}
+
+	void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+
+	bool expired() const {
+		return has_deadline && (std::chrono::steady_clock::now() >= deadline);
+	}
+};
+
+// Token of the assessment running on this thread, or NULL. Parallel regions read it before
+// forking and poll it explicitly, since worker threads do not inherit it.
+static thread_local const cancel_token *active_cancel_token = NULL;
+
+// Installs a token on the current thread for the lifetime of the scope.
+class cancel_scope {
+public:
+	explicit cancel_scope(const cancel_token *token) : previous(active_cancel_token) { active_cancel_token = token; }
+	~cancel_scope() { active_cancel_token = previous; }
+
+private:
+	const cancel_token *previous;
+	cancel_scope(const cancel_scope&);
+	cancel_scope& operator=(const cancel_scope&);
+};
+
+static inline bool cancel_requested(const cancel_token *token = active_cancel_token) {
+	return (token != NULL) && (token->cancelled.load(std::memory_order_relaxed) || token->expired());
+}
+
+// Throws assessment_cancelled if token asks its assessment to stop.
+static inline void check_cancelled(const cancel_token *token = active_cancel_token) {
+	if(token == NULL) return;
+	if(token->cancelled.load(std::memory_order_relaxed)) throw assessment_cancelled("Assessment cancelled");
+	if(token->expired()) throw assessment_cancelled("Assessment deadline exceeded");
+}
+
 //This generally performs a check for relative closeness, but (if that check would be nonsense)
 //it can check for an absolute separation, using either the distance between the numbers, or
 //the number of ULPs that separate the two numbers.
@@ -163,313 +232,187 @@ bool relEpsilonEqual(double A, double B, double maxAbsFactor, double maxRelFacto
 }
 
 
-void free_data(data_t *dp){
-	if(dp->symbols != NULL) free(dp->symbols);
-	if(dp->rawsymbols != NULL) free(dp->rawsymbols);
-	if((dp->word_size > 1) && (dp->bsymbols != NULL)) free(dp->bsymbols);
-} 
-
-
-// Read in binary file to test
-bool read_file_subset(const char *file_path, data_t *dp, unsigned long subsetIndex, unsigned long subsetSize, TestRunBase *testRun) {
-
-	FILE *file; 
-	int mask, j, max_symbols;
-	long rc, i;
-	long fileLen;
-
-	file = fopen(file_path, "rb");
-	if(!file){
-                testRun->errorLevel = -1;
-                testRun->errorMsg = "Error: could not open '%s'\n", file_path;
-		printf("Error: could not open '%s'\n", file_path);
-		return false;
-	}
+// Non-mappable inputs (pipes, character devices) are read in chunks of this many bytes
+#define READ_CHUNK_SIZE (1L << 20)
 
-	rc = (long)fseek(file, 0, SEEK_END);
-	if(rc < 0) {
-    testRun->errorLevel = -1;
-    testRun->errorMsg = "Error: fseek failed";
-    printf("Error: fseek failed\n");
-		fclose(file);
-		return false;
-	}
+// Samples a thread spreads into bsymbols at a time
+#define BSYMBOLS_BLOCK (1L << 16)
 
-	fileLen = ftell(file);
-	if(fileLen < 0){
-    testRun->errorLevel = -1;
-    testRun->errorMsg = "Error: ftell failed";
-    printf("Error: ftell failed\n");
-		fclose(file);
-		return false;
-	}
-
-	rewind(file);
-
-	if(subsetSize == 0) {
-		dp->len = fileLen;
-	} else {
-		rc = (long)fseek(file, subsetIndex*subsetSize, SEEK_SET);
-		if(rc < 0){
-                        testRun->errorLevel = -1;
-                        testRun->errorMsg = "Error: fseek failed";
-			printf("Error: fseek failed\n");
-			fclose(file);
-			return false;
-		}
-
-		dp->len = min(fileLen - subsetIndex*subsetSize, subsetSize);
-	}
+void free_data(data_t *dp){
+	if((dp->symbols != NULL) && (dp->symbols != dp->rawsymbols)) scratch_free(dp->symbols);
+	if(dp->map_base != NULL) munmap(dp->map_base, dp->map_len);
+	else if(dp->rawsymbols != NULL) free(dp->rawsymbols);
+	if((dp->word_size > 1) && (dp->bsymbols != NULL)) scratch_free(dp->bsymbols);
+	if(dp->pbsymbols != NULL) scratch_free(dp->pbsymbols);
+} 
 
-	if(dp->len == 0){
-    testRun->errorLevel = -1;
-    testRun->errorMsg = "Error: '%s' is empty\n", file_path;
-    printf("Error: '%s' is empty\n", file_path);
-		fclose(file);
-		return false;
-	}
+// Releases whatever a failed read_file_subset has set up so far
+static void discard_data(data_t *dp){
+	free_data(dp);
+	dp->symbols = NULL;
+	dp->rawsymbols = NULL;
+	dp->bsymbols = NULL;
+	dp->map_base = NULL;
+	dp->map_len = 0;
+	dp->len = 0;
+}
 
-	dp->symbols = (uint8_t*)malloc(sizeof(uint8_t)*dp->len);
-	dp->rawsymbols = (uint8_t*)malloc(sizeof(uint8_t)*dp->len);
-	if((dp->symbols == NULL) || (dp->rawsymbols == NULL)){
-    testRun->errorLevel = -1;
-    testRun->errorMsg = "Error: failure to initialize memory for symbols";
-    printf("Error: failure to initialize memory for symbols\n");
-		fclose(file);
-		if(dp->symbols != NULL) {
-			free(dp->symbols);
-			dp->symbols = NULL;
+// Reads up to maxlen bytes (everything if maxlen is 0) starting offset bytes into fd into a
+// malloced rawsymbols, READ_CHUNK_SIZE bytes at a time. Used when fd can't be mapped.
+static bool read_chunks(int fd, unsigned long offset, unsigned long maxlen, data_t *dp){
+	vector<uint8_t> skip;
+	size_t cap = 0;
+	ssize_t rc;
+
+	dp->len = 0;
+
+	if((offset > 0) && (lseek(fd, offset, SEEK_SET) < 0)){
+		// Not seekable: read and drop the leading bytes
+		skip.resize(READ_CHUNK_SIZE);
+		while(offset > 0){
+			rc = read(fd, skip.data(), min(offset, (unsigned long)READ_CHUNK_SIZE));
+			if(rc < 0) return false;
+			if(rc == 0) return true;
+			offset -= rc;
 		}
-		if(dp->rawsymbols != NULL) {
-			free(dp->rawsymbols);
-			dp->rawsymbols = NULL;
-		}
-		return false;
-	}
-
-	rc = fread(dp->symbols, sizeof(uint8_t), dp->len, file);
-	if(rc != dp->len){
-    testRun->errorLevel = -1;
-    testRun->errorMsg = "Error: file read failure";
-    printf("Error: file read failure\n");
-		fclose(file);
-		free(dp->symbols);
-		dp->symbols = NULL;
-		free(dp->rawsymbols);
-		dp->rawsymbols = NULL;
-		return false;
 	}
-	fclose(file);
-
-	//Do we need to establish the word size?
-	if(dp->word_size == 0) {
-		uint8_t datamask = 0;
-		uint8_t curbit = 0x80;
-
-		for(i = 0; i < dp->len; i++) {
-			datamask = datamask | dp->symbols[i];
-		}
-
-		for(i=8; (i>0) && ((datamask & curbit) == 0); i--) {
-			curbit = curbit >> 1;
-		}
-
-		dp->word_size = i;
-	} else {
-		uint8_t datamask = 0;
-		uint8_t curbit = 0x80;
 
-		for(i = 0; i < dp->len; i++) {
-			datamask = datamask | dp->symbols[i];
+	while((maxlen == 0) || ((unsigned long)dp->len < maxlen)){
+		if(cap - dp->len < READ_CHUNK_SIZE){
+			uint8_t *grown = (uint8_t*)realloc(dp->rawsymbols, cap + max(cap, (size_t)READ_CHUNK_SIZE));
+			if(grown == NULL) return false;
+			dp->rawsymbols = grown;
+			cap += max(cap, (size_t)READ_CHUNK_SIZE);
 		}
 
-		for(i=8; (i>0) && ((datamask & curbit) == 0); i--) {
-			curbit = curbit >> 1;
-		}
+		size_t want = READ_CHUNK_SIZE;
+		if(maxlen != 0) want = min(want, (size_t)(maxlen - dp->len));
 
-		if( i < dp->word_size ) {
-			printf("Warning: Symbols appear to be narrower than described.\n");
-                        testRun->errorMsg = "Warning: Symbols appear to be narrower than described.";
-		} else if( i > dp->word_size ) {
-                        testRun->errorLevel = -1;
-                        testRun->errorMsg = "Error: Incorrect bit width specification: Data (" + std::to_string(i) + ") does not fit within described bit width: " + std::to_string(dp->word_size) + ".";
-			printf("Incorrect bit width specification: Data (%ld) does not fit within described bit width: %d.\n",i,dp->word_size); 
-                        free(dp->symbols);
-			dp->symbols = NULL;
-			free(dp->rawsymbols);
-			dp->rawsymbols = NULL;
-			return false;
-		}
+		rc = read(fd, dp->rawsymbols + dp->len, want);
+		if(rc < 0) return false;
+		if(rc == 0) break;
+		dp->len += rc;
 	}
 
-	memcpy(dp->rawsymbols, dp->symbols, sizeof(uint8_t)* dp->len);
-	dp->maxsymbol = 0;
+	return true;
+}
 
-	max_symbols = 1 << dp->word_size;
-	int symbol_map_down_table[max_symbols];
+// Read in binary file to test
+// Regular files are mapped (only the requested block in subset mode) instead of read into memory;
+// rawsymbols then points into the mapping, and symbols does too unless masking to the word size or
+// mapping down the alphabet changes some byte.
+bool read_file_subset(const char *file_path, data_t *dp, unsigned long subsetIndex, unsigned long subsetSize, TestRunBase *testRun) {
 
-	// create symbols (samples) and check if they need to be mapped down
-	dp->alph_size = 0;
-	memset(symbol_map_down_table, 0, max_symbols*sizeof(int));
-	mask = max_symbols-1;
-	for(i = 0; i < dp->len; i++){ 
-		dp->symbols[i] &= mask;
-		if(dp->symbols[i] > dp->maxsymbol) dp->maxsymbol = dp->symbols[i];
-		if(symbol_map_down_table[dp->symbols[i]] == 0) symbol_map_down_table[dp->symbols[i]] = 1;
+	struct stat st;
+	int fd, mask, max_symbols;
+	long i;
+	const unsigned long offset = subsetIndex*subsetSize;
+
+	dp->symbols = NULL;
+	dp->rawsymbols = NULL;
+	dp->bsymbols = NULL;
+	dp->pbsymbols = NULL;
+	dp->map_base = NULL;
+	dp->map_len = 0;
+	dp->len = 0;
+
+	fd = open(file_path, O_RDONLY);
+	if(fd < 0){
+                testRun->errorLevel = -1;
+                testRun->errorMsg = "Error: could not open '" + string(file_path) + "'";
+		printf("Error: could not open '%s'\n", file_path);
+		return false;
 	}
 
-	for(i = 0; i < max_symbols; i++){
-		if(symbol_map_down_table[i] != 0) symbol_map_down_table[i] = (uint8_t)dp->alph_size++;
+	if(fstat(fd, &st) < 0){
+                testRun->errorLevel = -1;
+                testRun->errorMsg = "Error: fstat failed";
+		printf("Error: fstat failed\n");
+		close(fd);
+		return false;
 	}
 
-	// create bsymbols (bitstring) using the non-mapped data
-	dp->blen = dp->len * dp->word_size;
-	if(dp->word_size == 1) dp->bsymbols = dp->symbols;
-	else{
-		dp->bsymbols = (uint8_t*)malloc(dp->blen);
-		if(dp->bsymbols == NULL){
-			printf("Error: failure to initialize memory for bsymbols\n");
-			free(dp->symbols);
-			dp->symbols = NULL;
-			free(dp->rawsymbols);
-			dp->rawsymbols = NULL;
+	if(S_ISREG(st.st_mode)){
+		const unsigned long fileLen = st.st_size;
 
-			return false;
-		}
+		if(offset < fileLen) dp->len = (subsetSize == 0) ? fileLen - offset : min(fileLen - offset, subsetSize);
 
-		for(i = 0; i < dp->len; i++){
-			for(j = 0; j < dp->word_size; j++){
-				dp->bsymbols[i*dp->word_size+j] = (dp->symbols[i] >> (dp->word_size-1-j)) & 0x1;
+		if(dp->len > 0){
+			// The mapping has to start on a page boundary
+			const unsigned long base = offset - offset % sysconf(_SC_PAGESIZE);
+
+			// Writable copy-on-write pages, so callers may still treat the buffers as their own
+			dp->map_len = dp->len + (offset - base);
+			dp->map_base = mmap(NULL, dp->map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, base);
+			if(dp->map_base == MAP_FAILED){
+				dp->map_base = NULL;
+				dp->map_len = 0;
+			}else{
+				dp->rawsymbols = (uint8_t*)dp->map_base + (offset - base);
+				madvise(dp->map_base, dp->map_len, MADV_SEQUENTIAL);
 			}
 		}
 	}
 
-	// map down symbols if less than 2^bits_per_word unique symbols
-	if(dp->alph_size < dp->maxsymbol + 1){
-		for(i = 0; i < dp->len; i++) dp->symbols[i] = (uint8_t)symbol_map_down_table[dp->symbols[i]];
-	} 
-
-	return true;
-}
-
-bool read_file(const char *file_path, data_t *dp, TestRunBase *testRun){
-
-	FILE *file; 
-	int mask, j, max_symbols;
-	long rc, i;
-
-	file = fopen(file_path, "rb");
-	if(!file){
+	if((dp->map_base == NULL) && (!S_ISREG(st.st_mode) || (dp->len > 0)) && !read_chunks(fd, offset, S_ISREG(st.st_mode) ? dp->len : subsetSize, dp)){
                 testRun->errorLevel = -1;
-                testRun->errorMsg = "Error: could not open '%s'\n", file_path;
-		printf("Error: could not open '%s'\n", file_path);
+                testRun->errorMsg = "Error: file read failure";
+		printf("Error: file read failure\n");
+		close(fd);
+		discard_data(dp);
 		return false;
 	}
+	close(fd);
 
-	rc = (long)fseek(file, 0, SEEK_END);
-	if(rc < 0){
+	if(dp->len == 0){
                 testRun->errorLevel = -1;
-                testRun->errorMsg = "Error: fseek failed";
-		printf("Error: fseek failed\n");
-		fclose(file);
+                testRun->errorMsg = "Error: '" + string(file_path) + "' is empty";
+		printf("Error: '%s' is empty\n", file_path);
+		discard_data(dp);
 		return false;
 	}
 
-	dp->len = ftell(file);
-	if(dp->len < 0){
-                testRun->errorLevel = -1;
-                testRun->errorMsg = "Error: ftell failed";
-		printf("Error: ftell failed\n");
-		fclose(file);
-		return false;
-	}
+	// One pass over the samples collects every byte value present. The word size,
+	// the alphabet and the largest symbol all follow from that set.
+	bool present[256] = {false};
 
-	rewind(file);
+	#pragma omp parallel
+	{
+		bool local_present[256] = {false};
 
-	if(dp->len == 0){
-                testRun->errorLevel = -1;
-                testRun->errorMsg = "Error: '%s' is empty\n", file_path;
-		printf("Error: '%s' is empty\n", file_path);
-		fclose(file);
-		return false;
+		#pragma omp for
+		for(i = 0; i < dp->len; i++) local_present[dp->rawsymbols[i]] = true;
+
+		#pragma omp critical(readFilePresent)
+		for(int v = 0; v < 256; v++) present[v] = present[v] || local_present[v];
 	}
 
-	dp->symbols = (uint8_t*)malloc(sizeof(uint8_t)*dp->len);
-	dp->rawsymbols = (uint8_t*)malloc(sizeof(uint8_t)*dp->len);
-        if((dp->symbols == NULL) || (dp->rawsymbols == NULL)){
-                testRun->errorLevel = -1;
-                testRun->errorMsg = "Error: failure to initialize memory for symbols";
-                printf("Error: failure to initialize memory for symbols\n");
-                fclose(file);
-                if(dp->symbols != NULL) {
-                        free(dp->symbols);
-                        dp->symbols = NULL;
-                }
-                if(dp->rawsymbols != NULL) {
-                        free(dp->rawsymbols);
-                        dp->rawsymbols = NULL;
-                }
-                return false;
-        }
+	uint8_t datamask = 0;
+	uint8_t curbit = 0x80;
 
-	rc = fread(dp->symbols, sizeof(uint8_t), dp->len, file);
-	if(rc != dp->len){
-                testRun->errorLevel = -1;
-                testRun->errorMsg = "Error: file read failure";       
-		printf("Error: file read failure\n");
-		fclose(file);
-		free(dp->symbols);
-		dp->symbols = NULL;
-		free(dp->rawsymbols);
-		dp->rawsymbols = NULL;
-		return false;
+	for(int v = 0; v < 256; v++){
+		if(present[v]) datamask = datamask | v;
+	}
+
+	for(i=8; (i>0) && ((datamask & curbit) == 0); i--) {
+		curbit = curbit >> 1;
 	}
-	fclose(file);
 
 	//Do we need to establish the word size?
 	if(dp->word_size == 0) {
 		//Yes. Establish the word size using the highest order bit in use
-		uint8_t datamask = 0;
-		uint8_t curbit = 0x80;
-
-		for(i = 0; i < dp->len; i++) {
-			datamask = datamask | dp->symbols[i];
-		}
-
-		for(i=8; (i>0) && ((datamask & curbit) == 0); i--) {
-			curbit = curbit >> 1;
-		}
-
 		dp->word_size = i;
-       } else {
-                uint8_t datamask = 0;
-		uint8_t curbit = 0x80;
-
-                for(i = 0; i < dp->len; i++) {
-                        datamask = datamask | dp->symbols[i];
-                }
-
-                for(i=8; (i>0) && ((datamask & curbit) == 0); i--) {
-                        curbit = curbit >> 1;
-                }
-
-                if( i < dp->word_size ) {
-                        printf("Warning: Symbols appear to be narrower than described.\n");
-                        testRun->errorMsg = "Warning: Symbols appear to be narrower than described.";                  
-                } else if( i > dp->word_size ) {
-                        testRun->errorLevel = -1;
-                        testRun->errorMsg = "Error: Incorrect bit width specification: Data (" + std::to_string(i) + ") does not fit within described bit width: " + std::to_string(dp->word_size) + ".";
-			printf("Incorrect bit width specification: Data (%ld) does not fit within described bit width: %d.\n",i,dp->word_size);
-                        free(dp->symbols);
-                        dp->symbols = NULL;
-                        free(dp->rawsymbols);
-                        dp->rawsymbols = NULL;
-                        return false;
-                }
-        }
-
+	} else if( i < dp->word_size ) {
+		printf("Warning: Symbols appear to be narrower than described.\n");
+                testRun->errorMsg = "Warning: Symbols appear to be narrower than described.";
+	} else if( i > dp->word_size ) {
+                testRun->errorLevel = -1;
+                testRun->errorMsg = "Error: Incorrect bit width specification: Data (" + std::to_string(i) + ") does not fit within described bit width: " + std::to_string(dp->word_size) + ".";
+		printf("Incorrect bit width specification: Data (%ld) does not fit within described bit width: %d.\n",i,dp->word_size);
+		discard_data(dp);
+		return false;
+	}
 
-	memcpy(dp->rawsymbols, dp->symbols, sizeof(uint8_t)* dp->len);
 	dp->maxsymbol = 0;
 
 	max_symbols = 1 << dp->word_size;
@@ -479,47 +422,85 @@ bool read_file(const char *file_path, data_t *dp, TestRunBase *testRun){
 	dp->alph_size = 0;
 	memset(symbol_map_down_table, 0, max_symbols*sizeof(int));
 	mask = max_symbols-1;
-	for(i = 0; i < dp->len; i++){ 
-		dp->symbols[i] &= mask;
-		if(dp->symbols[i] > dp->maxsymbol) dp->maxsymbol = dp->symbols[i];
-		if(symbol_map_down_table[dp->symbols[i]] == 0) symbol_map_down_table[dp->symbols[i]] = 1;
+	for(int v = 0; v < 256; v++){
+		if(!present[v]) continue;
+		if((v & mask) > dp->maxsymbol) dp->maxsymbol = v & mask;
+		symbol_map_down_table[v & mask] = 1;
 	}
 
 	for(i = 0; i < max_symbols; i++){
 		if(symbol_map_down_table[i] != 0) symbol_map_down_table[i] = (uint8_t)dp->alph_size++;
 	}
 
+	// map down symbols if less than 2^bits_per_word unique symbols
+	const bool masked = (datamask & ~mask) != 0;
+	const bool mapped = dp->alph_size < dp->maxsymbol + 1;
+
+	if(masked || mapped){
+		dp->symbols = (uint8_t*)scratch_alloc(sizeof(uint8_t)*dp->len);
+		if(dp->symbols == NULL){
+                        testRun->errorLevel = -1;
+                        testRun->errorMsg = "Error: failure to initialize memory for symbols";
+			printf("Error: failure to initialize memory for symbols\n");
+			discard_data(dp);
+			return false;
+		}
+
+		#pragma omp parallel for
+		for(i = 0; i < dp->len; i++){
+			const uint8_t symbol = dp->rawsymbols[i] & mask;
+			dp->symbols[i] = mapped ? (uint8_t)symbol_map_down_table[symbol] : symbol;
+		}
+	}else{
+		dp->symbols = dp->rawsymbols;
+	}
+
 	// create bsymbols (bitstring) using the non-mapped data
 	dp->blen = dp->len * dp->word_size;
 	if(dp->word_size == 1) dp->bsymbols = dp->symbols;
 	else{
-		dp->bsymbols = (uint8_t*)malloc(dp->blen);
+		dp->bsymbols = (uint8_t*)scratch_alloc(dp->blen);
 		if(dp->bsymbols == NULL){
                         testRun->errorLevel = -1;
                         testRun->errorMsg = "Error: failure to initialize memory for bsymbols";
 			printf("Error: failure to initialize memory for bsymbols\n");
-                        free(dp->symbols);
-			dp->symbols = NULL;
-			free(dp->rawsymbols);
-			dp->rawsymbols = NULL;
+			discard_data(dp);
 			return false;
 		}
 
-		for(i = 0; i < dp->len; i++){
-			for(j = 0; j < dp->word_size; j++){
-				dp->bsymbols[i*dp->word_size+j] = (dp->symbols[i] >> (dp->word_size-1-j)) & 0x1;
+		// spread[v] holds the word_size bitstring bytes of v, followed by zeros
+		uint64_t spread[256];
+		for(int v = 0; v < 256; v++){
+			uint8_t bits[8] = {0};
+			for(int j = 0; j < dp->word_size; j++) bits[j] = (v >> (dp->word_size-1-j)) & 0x1;
+			memcpy(&spread[v], bits, sizeof(bits));
+		}
+
+		// Each sample stores 8 bytes and the next one overwrites the zeros. That only holds in
+		// order, so the threads take whole blocks and the last sample of each block is written
+		// exactly, to stay inside its block
+		const long blocks = (dp->len + BSYMBOLS_BLOCK - 1) / BSYMBOLS_BLOCK;
+		#pragma omp parallel for
+		for(long b = 0; b < blocks; b++){
+			const long start = b * BSYMBOLS_BLOCK;
+			const long end = std::min(start + BSYMBOLS_BLOCK, dp->len);
+			for(long j = start; j < end - 1; j++){
+				memcpy(dp->bsymbols + j*dp->word_size, &spread[dp->rawsymbols[j]], sizeof(uint64_t));
 			}
+			memcpy(dp->bsymbols + (end-1)*dp->word_size, &spread[dp->rawsymbols[end-1]], dp->word_size);
 		}
 	}
 
-	// map down symbols if less than 2^bits_per_word unique symbols
-	if(dp->alph_size < dp->maxsymbol + 1){
-		for(i = 0; i < dp->len; i++) dp->symbols[i] = (uint8_t)symbol_map_down_table[dp->symbols[i]];
-	} 
+	// The estimators revisit the samples in no particular order
+	if(dp->map_base != NULL) madvise(dp->map_base, dp->map_len, MADV_NORMAL);
 
 	return true;
 }
 
+bool read_file(const char *file_path, data_t *dp, TestRunBase *testRun){
+	return read_file_subset(file_path, dp, 0, 0, testRun);
+}
+
 /* This is xoshiro256** 1.0*/
 /*This implementation is derived from David Blackman and Sebastiano Vigna, which they placed into
 the public domain. See http://xoshiro.di.unimi.it/xoshiro256starstar.c
@@ -574,6 +555,45 @@ void xoshiro_jump(unsigned int jump_count, uint64_t *xoshiro256starstarState) {
 	}
 }
 
+/* Several xoshiro256** generators stepped together, one per lane, with the state stored lane-minor
+ * (state[word][lane]) so that the compiler can keep each state word of all the lanes in one vector register.
+ * Lane l starts from the provided state advanced by xoshiro_jump(first_jump + l), in the same way that
+ * the OpenMP threads elsewhere start from xoshiro_jump(thread number).
+ */
+#define XOSHIRO_LANES 4
+
+void xoshiro_lanes_init(unsigned int first_jump, const uint64_t *xoshiro256starstarState, uint64_t laneState[4][XOSHIRO_LANES]) {
+	uint64_t cur[4];
+
+	for(int l = 0; l < XOSHIRO_LANES; l++) {
+		memcpy(cur, xoshiro256starstarState, sizeof(cur));
+		xoshiro_jump(first_jump + l, cur);
+		for(int w = 0; w < 4; w++) laneState[w][l] = cur[w];
+	}
+}
+
+//Produces the next output of every lane; out[l] is what xoshiro256starstar() would return for lane l.
+static inline void xoshiro256starstarLanes(uint64_t laneState[4][XOSHIRO_LANES], uint64_t out[XOSHIRO_LANES])
+{
+	for(int l = 0; l < XOSHIRO_LANES; l++) {
+		const uint64_t s1 = laneState[1][l];
+		const uint64_t x = (s1 << 2) + s1; // s1 * 5
+		const uint64_t r = rotl(x, 7);
+		const uint64_t t = s1 << 17;
+
+		out[l] = (r << 3) + r; // r * 9
+
+		laneState[2][l] ^= laneState[0][l];
+		laneState[3][l] ^= s1;
+		laneState[1][l] ^= laneState[2][l];
+		laneState[0][l] ^= laneState[3][l];
+
+		laneState[2][l] ^= t;
+
+		laneState[3][l] = rotl(laneState[3][l], 45);
+	}
+}
+
 //This seeds using an external source
 //We use /dev/urandom here. 
 //We could alternately use the RdRand (or some other OS or HW source of pseudo-random numbers)
@@ -651,19 +671,121 @@ double randomUnit(uint64_t *xoshiro256starstarState) {
 	return((xoshiro256starstar(xoshiro256starstarState) >> 11) * 1.1102230246251565e-16);
 }
 
-// Fisher-Yates Fast (in place) shuffle algorithm
-void FYshuffle(uint8_t data[], uint8_t rawdata[], const int sample_size, uint64_t *xoshiro256starstarState) {
-	long int r;
-	static mutex shuffle_mutex;
-	unique_lock<mutex> lock(shuffle_mutex);
+// Arrays of at least this many bytes (about the size of L2) are shuffled with batched draws, so that
+// the swap targets of a batch are prefetched before the first of them is touched.
+#define SHUFFLE_PREFETCH_BYTES (1L << 21)
+#define SHUFFLE_BATCH 128
+
+// Fisher-Yates Fast (in place) shuffle algorithm. The swap indices are drawn in the same order as
+// by the scalar loop, so a given RNG state always yields the same permutation.
+template<typename T>
+void FYshuffle(T a[], const long sample_size, uint64_t *xoshiro256starstarState) {
+	if(sample_size * (long)sizeof(T) < SHUFFLE_PREFETCH_BYTES) {
+		for (long int i = sample_size - 1; i > 0; --i) {
+			const long int r = (long int)randomRange64((uint64_t)i, xoshiro256starstarState);
+			SWAP(a[r], a[i]);
+		}
+		return;
+	}
+
+	uint64_t r[SHUFFLE_BATCH];
+	for (long int i = sample_size - 1; i > 0; ) {
+		const int count = (int)min((long int)SHUFFLE_BATCH, i);
 
-	for (long int i = sample_size - 1; i > 0; --i) {
-		r = (long int)randomRange64((uint64_t)i, xoshiro256starstarState);
-		SWAP(data[r], data[i]);
-		SWAP(rawdata[r], rawdata[i]);
+		for (int k = 0; k < count; ++k) {
+			r[k] = randomRange64((uint64_t)(i - k), xoshiro256starstarState);
+			__builtin_prefetch(&a[r[k]], 1);
+		}
+		for (int k = 0; k < count; ++k) SWAP(a[r[k]], a[i - k]);
+
+		i -= count;
 	}
 }
 
+// How a shuffle_engine keeps the symbols and raw symbols of the current permutation
+enum shuffle_layout {
+	SHUFFLE_SHARED,	// one array; symbols and raw symbols are the same
+	SHUFFLE_MAPPED,	// the symbols are shuffled and the raw symbols looked up from them
+	SHUFFLE_PAIRED	// symbol/raw symbol pairs are shuffled and then split
+};
+
+// Per-thread state of the permutation rounds: the symbols and raw symbols permuted so far. Both
+// arrays are permuted together, so what is shuffled is the smallest array they can be derived from.
+struct shuffle_engine {
+	shuffle_layout layout;
+	long len;
+	uint8_t *data;		// symbols of the current permutation
+	uint8_t *rawdata;	// raw symbols of the current permutation; data when SHUFFLE_SHARED
+	uint16_t *pairs;	// SHUFFLE_PAIRED: symbol | raw symbol << 8
+	uint8_t rawmap[256];	// SHUFFLE_MAPPED: the raw symbol of each symbol
+};
+
+void shuffle_engine_init(shuffle_engine *se, const data_t *dp){
+	se->len = dp->len;
+	se->pairs = NULL;
+	se->data = scratch_array<uint8_t>(dp->len);
+
+	if(dp->symbols == dp->rawsymbols){
+		se->layout = SHUFFLE_SHARED;
+		se->rawdata = se->data;
+		return;
+	}
+
+	// Without masking, mapping symbols down is a bijection and the raw symbols follow from them.
+	bool seen[256] = {false};
+	se->layout = SHUFFLE_MAPPED;
+	for(long i = 0; i < dp->len; ++i){
+		const uint8_t symbol = dp->symbols[i];
+		if(!seen[symbol]){
+			seen[symbol] = true;
+			se->rawmap[symbol] = dp->rawsymbols[i];
+		}else if(se->rawmap[symbol] != dp->rawsymbols[i]){
+			se->layout = SHUFFLE_PAIRED;
+			break;
+		}
+	}
+
+	se->rawdata = scratch_array<uint8_t>(dp->len);
+	if(se->layout == SHUFFLE_PAIRED) se->pairs = scratch_array<uint16_t>(dp->len);
+}
+
+// Restores the unpermuted data, ahead of the first round of a stream.
+void shuffle_engine_reset(shuffle_engine *se, const data_t *dp){
+	memcpy(se->data, dp->symbols, se->len);
+	if(se->layout == SHUFFLE_SHARED) return;
+
+	memcpy(se->rawdata, dp->rawsymbols, se->len);
+	if(se->layout == SHUFFLE_PAIRED){
+		for(long i = 0; i < se->len; ++i) se->pairs[i] = (uint16_t)(dp->symbols[i] | (dp->rawsymbols[i] << 8));
+	}
+}
+
+// Applies one more random permutation to the data and raw data.
+void shuffle_engine_round(shuffle_engine *se, uint64_t *xoshiro256starstarState){
+	switch(se->layout){
+	case SHUFFLE_SHARED:
+		FYshuffle(se->data, se->len, xoshiro256starstarState);
+		break;
+	case SHUFFLE_MAPPED:
+		FYshuffle(se->data, se->len, xoshiro256starstarState);
+		for(long i = 0; i < se->len; ++i) se->rawdata[i] = se->rawmap[se->data[i]];
+		break;
+	case SHUFFLE_PAIRED:
+		FYshuffle(se->pairs, se->len, xoshiro256starstarState);
+		for(long i = 0; i < se->len; ++i){
+			se->data[i] = (uint8_t)se->pairs[i];
+			se->rawdata[i] = (uint8_t)(se->pairs[i] >> 8);
+		}
+		break;
+	}
+}
+
+void shuffle_engine_free(shuffle_engine *se){
+	if(se->rawdata != se->data) scratch_free(se->rawdata);
+	scratch_free(se->data);
+	scratch_free(se->pairs);
+}
+
 // Quick sum array  // TODO
 long int sum(const uint8_t arr[], const int sample_size) {
 	long int sum = 0;
@@ -696,33 +818,80 @@ T sum(const vector<T> &v) {
 	return sum;
 }
 
-// Calculate baseline statistics
-// Finds mean, median, and whether or not the data is binary
-void calc_stats(const data_t *dp, double &rawmean, double &median) {
+// Bytes counted by one chunk of byte_histogram
+#define HISTOGRAM_CHUNK_BYTES (1L << 20)
+
+// Counts the occurrences of each byte value in data. Chunks of the data are counted in
+// parallel, each into four sub-histograms so that runs of one value don't serialize on a
+// single counter.
+static void byte_histogram(const uint8_t *data, long len, long counts[256]){
+	long chunks = (len + HISTOGRAM_CHUNK_BYTES - 1) / HISTOGRAM_CHUNK_BYTES;
+
+	for(int v = 0; v < 256; v++) counts[v] = 0;
+
+	#pragma omp parallel for schedule(static) if(chunks > 1)
+	for(long c = 0; c < chunks; c++){
+		uint32_t sub[4][256] = {{0}};
+		long i = c*HISTOGRAM_CHUNK_BYTES;
+		long end = min(len, i + HISTOGRAM_CHUNK_BYTES);
+
+		for(; i + 4 <= end; i += 4){
+			sub[0][data[i]]++;
+			sub[1][data[i+1]]++;
+			sub[2][data[i+2]]++;
+			sub[3][data[i+3]]++;
+		}
+		for(; i < end; i++) sub[0][data[i]]++;
+
+		#pragma omp critical(byteHistogram)
+		for(int v = 0; v < 256; v++) counts[v] += (long)sub[0][v] + sub[1][v] + sub[2][v] + sub[3][v];
+	}
+}
 
-	// Calculate mean
-	rawmean = sum(dp->rawsymbols, dp->len) / (double)dp->len;
+// The value at index k of the sorted samples with the given histogram
+static uint8_t histogram_select(const long counts[256], long k){
+	int v = 0;
 
-	// Sort in a vector for median/min/max
-	vector<uint8_t> v(dp->symbols, dp->symbols + dp->len);
-	sort(v.begin(), v.end());
+	for(long seen = counts[0]; seen <= k; seen += counts[v]) v++;
+	return (uint8_t)v;
+}
+
+// Calculate baseline statistics from the histograms of rawsymbols (raw_counts) and of
+// symbols (counts); these are the mean and median that sorting the samples gives.
+void calc_stats(const long raw_counts[256], const long counts[256], long len, int alph_size, double &rawmean, double &median) {
+	long total = 0;
+
+	for(int v = 0; v < 256; v++) total += v*raw_counts[v];
+	rawmean = total / (double)len;
 
-	long int half = dp->len / 2;
-	if(dp->alph_size == 2) {
+	long int half = len / 2;
+	if(alph_size == 2) {
 		//This isn't necessarily true, but we are supposed to set it this way.
 		//See 5.1.5, 5.1.6.
 		median = 0.5;
 	} else {
-		if((dp->len & 1) == 1) {
+		if((len & 1) == 1) {
 			//the length is odd
-			median = v[half];
+			median = histogram_select(counts, half);
 		} else {
 			//the length is even
-			median = (v[half] + v[half - 1]) / 2.0;
+			median = (histogram_select(counts, half) + histogram_select(counts, half - 1)) / 2.0;
 		}
 	}
 }
 
+// Calculate baseline statistics
+// Finds mean, median, and whether or not the data is binary
+void calc_stats(const data_t *dp, double &rawmean, double &median) {
+	long raw_counts[256], counts[256];
+
+	byte_histogram(dp->rawsymbols, dp->len, raw_counts);
+	if(dp->symbols == dp->rawsymbols) memcpy(counts, raw_counts, sizeof(counts));
+	else byte_histogram(dp->symbols, dp->len, counts);
+
+	calc_stats(raw_counts, counts, dp->len, dp->alph_size, rawmean, median);
+}
+
 
 // Map initialization for integers
 void map_init(map<uint8_t, int> &m) {
@@ -992,21 +1161,112 @@ double predictionEstimate(long C, long N, long max_run_len, long k, const char *
 //We then multiply this by 2 (as each pattern is associated with a length-2 array) by left shifting by 1.
 #define BINARYDICTLOC(d, b) (binaryDict[(d)-1] + (((b) & ((1U << (d)) - 1))<<1))
 
-static uint32_t compressedBitSymbols(const uint8_t *S, long length)
+//Packed bit strings hold 64 bits per word, most significant bit first: bit i of the
+//string is bit (63 - i%64) of word i/64, so consecutive bits read left to right.
+//Unused bits of the last word are zero, and a spare zero word follows it so that
+//a window starting at any valid index can always read two words.
+#define PACKED_WORD_BITS 64
+
+static inline long packed_word_count(long blen)
+{
+   return blen/PACKED_WORD_BITS + 2;
+}
+
+static inline uint8_t packed_bit(const uint64_t *P, long i)
 {
-   uint32_t retPattern;
-   long j;
+   return (uint8_t)((P[i/PACKED_WORD_BITS] >> (PACKED_WORD_BITS - 1 - i%PACKED_WORD_BITS)) & 1U);
+}
+
+//Returns bits i ... i+length-1 as a length-bit integer: bit i is its most significant bit
+//and bit i+length-1 its least significant one.
+static inline uint32_t packed_bits(const uint64_t *P, long i, int length)
+{
+   long w = i/PACKED_WORD_BITS;
+   int off = i%PACKED_WORD_BITS;
+   uint64_t x;
+
+   assert((length > 0) && (length <= 32));
 
-   assert(length<=32);
+   x = P[w] << off;
+   if(off > 0) x |= P[w+1] >> (PACKED_WORD_BITS - off);
 
-   retPattern = 0;
+   return (uint32_t)(x >> (PACKED_WORD_BITS - length));
+}
+
+//Bits of a packed bit string read as one sample per bit, such as x[i] of a binary symbol array.
+//bits holds the string from bit first on; first is a multiple of PACKED_WORD_BITS.
+struct packed_samples {
+   const uint64_t *bits;
+   long first;
+
+   uint8_t operator[](long i) const {return packed_bit(bits, i - first);}
+};
+
+//Bits of a packed bit string whose values arrive in pieces that have not yet filled a word
+struct bitstring_packer {
+   uint64_t cur;     //the bits, right aligned
+   int used;         //number of bits in cur
 
-   for(j=0; j<length; j++) {
-      assert(S[j] <= 1);
-      retPattern = (retPattern << 1) | S[j];
+   bitstring_packer() : cur(0), used(0) {}
+
+   //The word being filled, as it will be stored once complete (its unused bits are zero)
+   uint64_t partial() const {return (used > 0) ? cur << (PACKED_WORD_BITS - used) : 0;}
+};
+
+//Appends the low word_size bits of each of the len values in S to the bits of pk, and stores
+//the words this completes in P[0], P[1], ..., returning how many there are.
+static long pack_bitstring_append(bitstring_packer *pk, const uint8_t *S, long len, int word_size, uint64_t *P)
+{
+   uint64_t cur = pk->cur;
+   long w = 0;
+   int used = pk->used;
+   uint8_t mask = (uint8_t)((1U << word_size) - 1);
+
+   assert((word_size > 0) && (word_size <= 8));
+
+   for(long i = 0; i < len; i++) {
+      uint64_t v = S[i] & mask;
+
+      if(used + word_size < PACKED_WORD_BITS) {
+         cur = (cur << word_size) | v;
+         used += word_size;
+      } else {
+         //This symbol completes the current word (and may spill into the next one)
+         int spill = used + word_size - PACKED_WORD_BITS;
+         P[w++] = (cur << (word_size - spill)) | (v >> spill);
+         cur = v & ((1U << spill) - 1);
+         used = spill;
+      }
    }
 
-   return retPattern;
+   pk->cur = cur;
+   pk->used = used;
+   return w;
+}
+
+//Packs the low word_size bits of each of the len values in S (most significant bit first)
+//into P, which is the same bit string that read_file() builds in bsymbols.
+//P must hold packed_word_count(len*word_size) words.
+static void pack_bitstring(const uint8_t *S, long len, int word_size, uint64_t *P)
+{
+   bitstring_packer pk;
+   long w = pack_bitstring_append(&pk, S, len, word_size, P);
+
+   if(pk.used > 0) P[w++] = pk.partial();
+   while(w < packed_word_count(len*word_size)) P[w++] = 0;
+}
+
+//Returns the number of one bits among bits 0 ... len-1.
+static long packed_popcount(const uint64_t *P, long len)
+{
+   long count = 0;
+   long full = len/PACKED_WORD_BITS;
+   int rem = len%PACKED_WORD_BITS;
+
+   for(long w = 0; w < full; w++) count += __builtin_popcountll(P[w]);
+   if(rem > 0) count += __builtin_popcountll(P[full] >> (PACKED_WORD_BITS - rem));
+
+   return count;
 }
 
 static void printVersion(string name) {
@@ -1031,35 +1291,198 @@ static string recreateCommandLine(int argc, char* argv[]) {
     return commandLine;
 }
 
-class PostfixDictionary {
-	map<uint8_t, long> postfixes;
-	long curBest;
-	uint8_t curPrediction;
+//Dictionary of prefixes (strings of up to PREFIX_DICTIONARY_MAXLEN symbols) together with the
+//counts of the symbols seen after each of them, as used by the non-binary MultiMMC and LZ78Y estimators.
+//Prefixes are appended to a pre-sized record array and found through an open addressing table;
+//(prefix, postfix) counts live in a second open addressing table. Nothing is allocated per entry.
+//
+//Prefix hashes are built from the last symbol backwards (see extendPrefixHash), so the hash of
+//(S[i-d-1] ... S[i-1]) follows from the one of (S[i-d] ... S[i-1]) in a single step.
+#define PREFIX_DICTIONARY_MAXLEN 16
+#define PREFIX_HASH_BASIS 0xcbf29ce484222325ULL
+
+static inline uint64_t extendPrefixHash(uint64_t h, uint8_t symbol)
+{
+	return (h ^ symbol) * 0x100000001b3ULL;
+}
+
+//Hash of the len symbols starting at x
+static inline uint64_t prefixHash(const uint8_t *x, int len)
+{
+	uint64_t h = PREFIX_HASH_BASIS;
+
+	for(int j = len-1; j >= 0; j--) h = extendPrefixHash(h, x[j]);
+	return h;
+}
+
+static inline uint64_t mixHash(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+class PrefixDictionary {
+	struct Prefix {
+		uint8_t symbols[PREFIX_DICTIONARY_MAXLEN];
+		uint64_t hash;
+		long curBest;
+		uint8_t len;
+		uint8_t curPrediction;
+	};
+
+	struct PrefixSlot {
+		uint32_t tag;
+		int32_t id;	// -1 if empty
+	};
+
+	struct PostfixSlot {
+		int64_t key;	// prefix id * 256 + postfix, or -1 if empty
+		long count;
+	};
+
+	vector<Prefix, scratch_allocator<Prefix> > prefixes;
+	vector<PrefixSlot, scratch_allocator<PrefixSlot> > prefixSlots;
+	vector<PostfixSlot, scratch_allocator<PostfixSlot> > postfixSlots;
+	long postfixCount;
+
+	static size_t tableSize(long entries) {
+		size_t size = 16;
+
+		while(size < 2*(size_t)entries) size <<= 1;
+		return size;
+	}
+
+	static uint64_t slotHash(uint64_t h, int len) {
+		return mixHash(h + (uint64_t)len * 0x9e3779b97f4a7c15ULL);
+	}
+
+	void placePrefix(int32_t id) {
+		uint64_t h = slotHash(prefixes[id].hash, prefixes[id].len);
+		size_t mask = prefixSlots.size() - 1;
+		size_t pos = h & mask;
+
+		while(prefixSlots[pos].id >= 0) pos = (pos + 1) & mask;
+		prefixSlots[pos].tag = (uint32_t)(h >> 32);
+		prefixSlots[pos].id = id;
+	}
+
+	void growPrefixes() {
+		PrefixSlot empty = {0, -1};
+
+		prefixSlots.assign(2*prefixSlots.size(), empty);
+		for(size_t id = 0; id < prefixes.size(); id++) placePrefix((int32_t)id);
+	}
+
+	PostfixSlot *findPostfix(int64_t key) {
+		size_t mask = postfixSlots.size() - 1;
+		size_t pos = mixHash((uint64_t)key) & mask;
+
+		while((postfixSlots[pos].key >= 0) && (postfixSlots[pos].key != key)) pos = (pos + 1) & mask;
+		return &postfixSlots[pos];
+	}
+
+	void growPostfixes() {
+		vector<PostfixSlot, scratch_allocator<PostfixSlot> > old;
+		PostfixSlot empty = {-1, 0};
+
+		old.swap(postfixSlots);
+		postfixSlots.assign(2*old.size(), empty);
+		for(size_t j = 0; j < old.size(); j++) {
+			if(old[j].key >= 0) *findPostfix(old[j].key) = old[j];
+		}
+	}
+
 public:
-	PostfixDictionary() { curBest = 0; curPrediction = 0;}
-	uint8_t predict(long &count) {assert(curBest > 0); count = curBest; return curPrediction;}
-	bool incrementPostfix(uint8_t in, bool makeNew) {
-		map<uint8_t, long>::iterator curp = postfixes.find(in);
+	//maxPrefixes and maxPostfixes are the expected number of entries; the tables grow past them if needed.
+	PrefixDictionary(long maxPrefixes, long maxPostfixes) {
+		PrefixSlot emptyPrefix = {0, -1};
+		PostfixSlot emptyPostfix = {-1, 0};
+
+		prefixes.reserve(maxPrefixes);
+		prefixSlots.assign(tableSize(maxPrefixes), emptyPrefix);
+		postfixSlots.assign(tableSize(maxPostfixes), emptyPostfix);
+		postfixCount = 0;
+	}
+
+	//Returns the id of the len symbols starting at x (whose prefixHash is h), or -1 if they are not present
+	long find(const uint8_t *x, int len, uint64_t h) const {
+		uint64_t sh = slotHash(h, len);
+		uint32_t tag = (uint32_t)(sh >> 32);
+		size_t mask = prefixSlots.size() - 1;
+		size_t pos = sh & mask;
+
+		while(prefixSlots[pos].id >= 0) {
+			const Prefix &p = prefixes[prefixSlots[pos].id];
+
+			if((prefixSlots[pos].tag == tag) && (p.len == len) && (memcmp(p.symbols, x, len) == 0)) return prefixSlots[pos].id;
+			pos = (pos + 1) & mask;
+		}
+
+		return -1;
+	}
+
+	//As find, but adds the prefix (with no postfixes) if it is not present
+	long findOrInsert(const uint8_t *x, int len, uint64_t h) {
+		long id = find(x, len, h);
+		Prefix p;
+
+		if(id >= 0) return id;
+
+		assert((len > 0) && (len <= PREFIX_DICTIONARY_MAXLEN));
+		memset(p.symbols, 0, PREFIX_DICTIONARY_MAXLEN);
+		memcpy(p.symbols, x, len);
+		p.hash = h;
+		p.curBest = 0;
+		p.len = (uint8_t)len;
+		p.curPrediction = 0;
+
+		id = (long)prefixes.size();
+		assert(id < INT32_MAX);
+		prefixes.push_back(p);
+
+		if(2*prefixes.size() > prefixSlots.size()) growPrefixes();
+		else placePrefix((int32_t)id);
+
+		return id;
+	}
+
+	uint8_t predict(long id, long &count) const {
+		assert(prefixes[id].curBest > 0);
+		count = prefixes[id].curBest;
+		return prefixes[id].curPrediction;
+	}
+
+	//Counts the postfix in after prefix id. A new (prefix, postfix) pair is only created if makeNew is set.
+	//Returns true if a new pair was created.
+	bool incrementPostfix(long id, uint8_t in, bool makeNew) {
+		Prefix &p = prefixes[id];
+		PostfixSlot *slot = findPostfix(id*256 + in);
 		long curCount;
 		bool newEntry=false;
 
-		if(curp != postfixes.end()) {
+		if(slot->key >= 0) {
 			//The entry is already there. We always increment in this case.
-			curCount = ++(curp->second);
+			curCount = ++(slot->count);
 		} else if(makeNew) {
 			//The entry is not here, but we are allowed to create a new entry
 			newEntry = true;
-			curCount = postfixes[in] = 1;
+			slot->key = id*256 + in;
+			curCount = slot->count = 1;
+			if(2*(++postfixCount) > (long)postfixSlots.size()) growPostfixes();
 		} else {
 			//The entry is not here, we are not allowed to create a new entry
 			return false;
 		}
 
 		//Only instances where curCount is set and an increment was performed get here
-		if((curCount > curBest) || ((curCount == curBest) && (in > curPrediction))) { 
-			curPrediction = in; 
-			curBest = curCount; 
-		} 
+		if((curCount > p.curBest) || ((curCount == p.curBest) && (in > p.curPrediction))) {
+			p.curPrediction = in;
+			p.curBest = curCount;
+		}
 
 		return newEntry;
 	}
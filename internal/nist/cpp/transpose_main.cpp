@@ -1,6 +1,7 @@
 /* VERSION information is kept in utils.h. Please update when a new version is released */
 
 #include "shared/utils.h"
+#include "shared/transpose.h"
 #include "iid/iid_test_run.h"
 #include <stdio.h>
 #include <cstdlib>
@@ -19,6 +20,7 @@
     printf("\t [-v]: Increase verbosity.\n");
     printf("\t [-l <index>]\t Read the <index> substring of 1000000 samples.\n");
     printf("\t <file>: File with (blocks of) 1000 sets of restart data, each set being 1000 samples.\n");
+    printf("\t Without -l, every block of the file is transposed, and the blocks are written in order.\n");
     printf("\t The result is saved in <file>.column\n");
     printf("\t This program computes the transpose of the restart matrix, and produces column data appropriate testing with the other tools.\n");
     printf("\t This helps to support the testing described in SP800-90B Section 3.1.2 #3\n");
@@ -89,27 +91,38 @@ int main(int argc, char* argv[]) {
 
     if (verbose > 1) printf("Loaded %ld samples of %d distinct %d-bit-wide symbols\n", data.len, data.alph_size, data.word_size);
 
-    if (data.len != r * c) {
-        printf("Data must be %d samples.\n", r * c);
+    const long block = (long) r * c;
+    if ((data.len == 0) || (data.len % block != 0) || ((subsetSize != 0) && (data.len != block))) {
+        printf("Data must be %s%d samples.\n", (subsetSize == 0) ? "a multiple of " : "", r * c);
         print_usage();
     }
 
+    uint8_t *columns = (uint8_t *) malloc(data.len);
+    if (columns == NULL) {
+        printf("Error: failure to initialize memory for columns\n");
+        exit(-1);
+    }
+
+    // Blocks are independent, so a multi-block file is spread over the threads block by block
+    const long blocks = data.len / block;
+    #pragma omp parallel for schedule(static) if(blocks > 1)
+    for (long b = 0; b < blocks; b++) {
+        transpose_block(data.rawsymbols + b * block, columns + b * block, r, c);
+    }
+
     if (verbose > 1) printf("Opening output file: '%s'\n", argv[1]);
     if ((fp = fopen(argv[1], "wb")) == NULL) {
         perror("Can't open output file");
         print_usage();
     }
 
-    for (int i = 0; i < c; i++) {
-        for (int j = 0; j < r; j++) {
-            if (fwrite(data.rawsymbols + c * j + i, sizeof (uint8_t), 1, fp) != 1) {
-                perror("Can't write output");
-                exit(-1);
-            }
-        }
+    if (fwrite(columns, sizeof (uint8_t), data.len, fp) != (size_t) data.len) {
+        perror("Can't write output");
+        exit(-1);
     }
 
     fclose(fp);
+    free(columns);
     free_data(&data);
     return 0;
 }
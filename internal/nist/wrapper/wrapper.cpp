@@ -18,7 +18,9 @@
 
 #include "../cpp/shared/utils.h"
 #include "../cpp/shared/most_common.h"
+#include "../cpp/shared/bitstring_summary.h"
 #include "../cpp/shared/lrs_test.h"
+#include "../cpp/shared/health_tests.h"
 #include "../cpp/iid/iid_test_run.h"
 #include "../cpp/iid/permutation_tests.h"
 #include "../cpp/iid/chi_square_tests.h"
@@ -32,16 +34,92 @@
 #include "../cpp/non_iid/markov_test.h"
 
 #include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <sys/mman.h> // mmap, mremap
+#include <time.h>   // clock_gettime
+
+// Largest job that calculate_entropy_batch runs on a single thread alongside
+// other jobs; larger jobs get all threads for the estimators of that job.
+#define BATCH_SMALL_JOB_MAX (1L << 18)
+
+static_assert(PERMUTATION_STATISTICS == num_tests, "PERMUTATION_STATISTICS must match num_tests");
+static_assert(PERMUTATION_STREAMS == PERM_STREAMS, "PERMUTATION_STREAMS must match PERM_STREAMS");
+
+// Whether new assessments fill in the instrumentation fields of EntropyResult
+static std::atomic<bool> instrumentation_enabled(false);
+
+static_assert(ENTROPY_SCRATCH_DEFAULT_LIMIT == SCRATCH_POOL_DEFAULT_LIMIT,
+              "wrapper.h documents the scratch pool default");
+
+static double cpu_clock_seconds(clockid_t clock) {
+    struct timespec ts;
+    if (clock_gettime(clock, &ts) != 0) return 0.0;
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Measures one estimator run, adding it to an EstimatorStats. Does
+ *        nothing when constructed with NULL stats.
+ *
+ * CPU time is that of the calling thread, except for estimators that start
+ * an OpenMP team of their own (own_team), which are charged the CPU time of
+ * the whole process. Peak bytes are those of the scratch buffers the calling
+ * thread allocates while the probe is alive.
+ */
+class EstimatorProbe {
+public:
+    EstimatorProbe(EstimatorStats* stats, uint64_t iterations, bool own_team = false)
+        : stats_(stats), clock_(own_team ? CLOCK_PROCESS_CPUTIME_ID : CLOCK_THREAD_CPUTIME_ID),
+          saved_(NULL), wall_(0.0), cpu_(0.0) {
+        if (!stats_) return;
+        stats_->iterations += iterations;
+        saved_ = scratch_thread_meter;
+        scratch_thread_meter = &meter_;
+        wall_ = omp_get_wtime();
+        cpu_ = cpu_clock_seconds(clock_);
+    }
+    ~EstimatorProbe() {
+        if (!stats_) return;
+        stats_->cpu_seconds += cpu_clock_seconds(clock_) - cpu_;
+        stats_->wall_seconds += omp_get_wtime() - wall_;
+        const long long peak = meter_.peak.load(std::memory_order_relaxed);
+        if (peak > 0 && (uint64_t)peak > stats_->peak_bytes) {
+            stats_->peak_bytes = (uint64_t)peak;
+        }
+        scratch_thread_meter = saved_;
+    }
+
+    // Non-copyable
+    EstimatorProbe(const EstimatorProbe&) = delete;
+    EstimatorProbe& operator=(const EstimatorProbe&) = delete;
+private:
+    EstimatorStats* stats_;
+    clockid_t clock_;
+    scratch_meter meter_;
+    scratch_meter* saved_;
+    double wall_;
+    double cpu_;
+};
 
 /**
  * @brief RAII guard for data_t that guarantees free_data() is called on scope
  *        exit, preventing memory leaks when NIST library functions throw.
+ *
+ * Buffers that point at the caller's samples (see prepare_data) are detached
+ * before free_data() so that only memory owned by the data_t is freed.
  */
 class DataGuard {
 public:
-    explicit DataGuard(data_t* dp) : dp_(dp), released_(false) {}
+    DataGuard(data_t* dp, const uint8_t* borrowed) : dp_(dp), borrowed_(borrowed), released_(false) {}
     ~DataGuard() {
         if (!released_ && dp_) {
+            if (dp_->symbols == borrowed_) dp_->symbols = NULL;
+            if (dp_->rawsymbols == borrowed_) dp_->rawsymbols = NULL;
             free_data(dp_);
         }
     }
@@ -52,29 +130,547 @@ public:
     DataGuard& operator=(const DataGuard&) = delete;
 private:
     data_t* dp_;
+    const uint8_t* borrowed_;
     bool released_;
 };
 
+/**
+ * @brief One estimator run on one view of the data (bitstring or literal).
+ *
+ * The order of the enumerators is the order in which the reference tool
+ * runs (and prints) the estimators, and the order in which results are
+ * folded into the EntropyResult.
+ */
+enum NonIidJob {
+    JOB_MCV_BITSTRING,
+    JOB_MCV_LITERAL,
+    JOB_COLLISION_BITSTRING,
+    JOB_COLLISION_LITERAL,
+    JOB_MARKOV_BITSTRING,
+    JOB_MARKOV_LITERAL,
+    JOB_COMPRESSION_BITSTRING,
+    JOB_COMPRESSION_LITERAL,
+    JOB_SA_BITSTRING,
+    JOB_SA_LITERAL,
+    JOB_MCW_BITSTRING,
+    JOB_MCW_LITERAL,
+    JOB_LAG_BITSTRING,
+    JOB_LAG_LITERAL,
+    JOB_MMC_BITSTRING,
+    JOB_MMC_LITERAL,
+    JOB_LZ78Y_BITSTRING,
+    JOB_LZ78Y_LITERAL,
+    NON_IID_JOB_COUNT
+};
+
+// Order in which jobs are handed out when they run concurrently: the
+// longest running ones first, so that the slowest job starts right away.
+static const NonIidJob non_iid_parallel_order[NON_IID_JOB_COUNT] = {
+    JOB_SA_BITSTRING, JOB_SA_LITERAL,
+    JOB_MMC_BITSTRING, JOB_LZ78Y_BITSTRING,
+    JOB_MMC_LITERAL, JOB_LZ78Y_LITERAL,
+    JOB_MCW_BITSTRING, JOB_LAG_BITSTRING,
+    JOB_MCW_LITERAL, JOB_LAG_LITERAL,
+    JOB_COMPRESSION_BITSTRING, JOB_COMPRESSION_LITERAL,
+    JOB_COLLISION_BITSTRING, JOB_COLLISION_LITERAL,
+    JOB_MARKOV_BITSTRING, JOB_MARKOV_LITERAL,
+    JOB_MCV_BITSTRING, JOB_MCV_LITERAL
+};
+
+/**
+ * @brief Output slot of a NonIidJob.
+ *
+ * value[0] is the entropy estimate; the t-Tuple/LRS job also fills value[1]
+ * with the LRS estimate. An exception thrown by the job is kept in error and
+ * rethrown once all jobs have finished. stats is only filled in when the
+ * jobs run instrumented.
+ */
+struct NonIidJobResult {
+    bool enabled;
+    double value[2];
+    EstimatorStats stats;
+    std::exception_ptr error;
+};
+
+/**
+ * @brief Histograms of the samples, taken by prepare_data.
+ *
+ * raw counts each byte of the input and symbols each symbol after masking to
+ * the word size and mapping down the alphabet. The literal MCV estimate and
+ * the permutation test statistics are finished from them rather than taking
+ * passes of their own over the samples.
+ */
+struct SampleCounts {
+    long raw[256];
+    long symbols[256];
+};
+
+// Samples a BitstringStream packs and reads at a time
+#define BITSTRING_STREAM_PIECE (1L << 16)
+
+/**
+ * @brief The bitstring estimators of a session that run while its samples
+ *        are fed.
+ *
+ * Once the word size is known the bitstring of each sample is known as soon
+ * as the sample arrives. Every piece is packed onto a window of the bitstring,
+ * and the front-end sweep, the Compression estimate and the binary MultiMCW
+ * and Lag estimates read it right away. The window only keeps the bits they
+ * have yet to read, at most the last MultiMCW window, so finalizing leaves
+ * them the last few bits and their formulas. The Lag estimate goes back to
+ * the whole bitstring if it outgrows the 32-bit scores of its dense form.
+ */
+struct BitstringStream {
+    int word_size;
+    long bits;                  // bits packed so far
+    long first_word;            // word of the bitstring held in window[0]
+    bitstring_packer packer;
+    std::vector<uint64_t, scratch_allocator<uint64_t> > window;
+    bitstring_summary_stream summary;
+    compression_stream compression;
+    binary_mcw_stream mcw;
+    dense_lag_stream lag;
+    bool lag_streamed;
+
+    explicit BitstringStream(int bits_per_symbol)
+        : word_size(bits_per_symbol), bits(0), first_word(0), lag_streamed(true) {}
+
+    void feed(const uint8_t* samples, size_t length) {
+        while (length > 0) {
+            const long n = (long)std::min(length, (size_t)BITSTRING_STREAM_PIECE);
+            const long held = bits / PACKED_WORD_BITS - first_word;
+
+            // The bits of the packer complete at most one word more than the piece fills, and
+            // the completed words are followed by the partial one and a zero word, as in every
+            // packed bitstring
+            const long words = held + n * word_size / PACKED_WORD_BITS + 3;
+            if ((long)window.size() < words) window.resize(words);
+            const long complete = pack_bitstring_append(&packer, samples, n, word_size, window.data() + held);
+            window[held + complete] = packer.partial();
+            window[held + complete + 1] = 0;
+            bits += n * word_size;
+
+            const long first = first_word * PACKED_WORD_BITS;
+            const packed_samples view = {window.data(), first};
+            bitstring_summary_update(&summary, window.data(), first_word, bits);
+            compression_update(&compression, window.data(), first, bits);
+            binary_mcw_update(&mcw, view, bits);
+            if (bits > INT32_MAX) lag_streamed = false;
+            if (lag_streamed) dense_lag_update(&lag, view, bits);
+
+            // Drop the words that no estimator reads again
+            long keep = std::min(summary.words * PACKED_WORD_BITS, compression.blocks * COMPRESSION_BLOCK_BITS);
+            keep = std::min(keep, std::max(mcw.i - mcw_windows[NUM_WINS - 1], 0L));
+            const long drop = keep / PACKED_WORD_BITS - first_word;
+            if (drop > 0) {
+                window.erase(window.begin(), window.begin() + drop);
+                first_word += drop;
+            }
+
+            samples += n;
+            length -= (size_t)n;
+        }
+    }
+};
+
+/**
+ * @brief What the front-end pass over the data leaves for the non-IID jobs.
+ *
+ * The MCV, Collision and Markov jobs finish from these summaries instead of
+ * each taking a pass over the data. bitstring summarizes dp->pbsymbols and
+ * is only filled in when the bitstring view is assessed; literal summarizes
+ * the symbols one bit each and literal_bits holds them packed, which is only
+ * done when the symbols are binary. stream is the BitstringStream that
+ * already ran the bitstring view of a session, or NULL. literal_index
+ * supplies the suffix index of the symbols to the literal t-Tuple and LRS
+ * job; without it the job builds its own.
+ */
+struct NonIidFrontEnd {
+    const BitstringStream* stream;
+    SharedSuffixIndex* literal_index;
+    const long* symbol_counts;
+    bitstring_summary bitstring;
+    bitstring_summary literal;
+    const uint64_t* literal_bits;
+    std::vector<uint64_t, scratch_allocator<uint64_t> > literal_storage;
+};
+
+/**
+ * @brief Builds the summaries of fe in one sweep over each bit string.
+ *
+ * 1-bit symbols already are the packed bitstring; wider binary symbols are
+ * packed once here for the Collision, Markov and Compression literal jobs.
+ * The sweep of the bitstring is only finished if a stream started it.
+ */
+static void summarize_non_iid_data(const data_t* dp, const SampleCounts* counts, BitstringStream* stream, bool bitstring_view, bool binary_literal, NonIidFrontEnd* fe) {
+    fe->stream = stream;
+    fe->literal_index = NULL;
+    fe->symbol_counts = counts->symbols;
+    fe->literal_bits = NULL;
+
+    if (bitstring_view && stream) {
+        assert(stream->bits == dp->blen);
+        bitstring_summary_finish(&fe->bitstring, &stream->summary, stream->window.data(), stream->first_word, dp->blen);
+    } else if (bitstring_view) {
+        bitstring_summary_init(&fe->bitstring, dp->pbsymbols, dp->blen);
+    }
+    if (binary_literal) {
+        if (dp->word_size == 1) {
+            fe->literal_bits = dp->pbsymbols;
+        } else {
+            fe->literal_storage.resize(packed_word_count(dp->len));
+            pack_bitstring(dp->symbols, dp->len, 1, fe->literal_storage.data());
+            fe->literal_bits = fe->literal_storage.data();
+        }
+        bitstring_summary_init(&fe->literal, fe->literal_bits, dp->len);
+    }
+}
+
+/**
+ * @brief Runs a single non-IID job. Every job only reads dp and fe, so any
+ *        number of them may run at once.
+ */
+static void run_non_iid_job(NonIidJob job, const data_t* dp, const NonIidFrontEnd* fe, int verbose, NonIidJobResult* out) {
+    switch (job) {
+    case JOB_MCV_BITSTRING:
+        out->value[0] = most_common(fe->bitstring, verbose, "Bitstring");
+        break;
+    case JOB_MCV_LITERAL:
+        out->value[0] = most_common(fe->symbol_counts, dp->len, dp->alph_size, verbose, "Literal");
+        break;
+    case JOB_COLLISION_BITSTRING:
+        out->value[0] = collision_test(fe->bitstring, verbose, "Bitstring");
+        break;
+    case JOB_COLLISION_LITERAL:
+        out->value[0] = collision_test(fe->literal, verbose, "Literal");
+        break;
+    case JOB_MARKOV_BITSTRING:
+        out->value[0] = markov_test(fe->bitstring, verbose, "Bitstring");
+        break;
+    case JOB_MARKOV_LITERAL:
+        out->value[0] = markov_test(fe->literal, verbose, "Literal");
+        break;
+    case JOB_COMPRESSION_BITSTRING:
+        if (fe->stream) {
+            out->value[0] = compression_test(fe->stream->compression, dp->blen, verbose, "Bitstring");
+        } else {
+            out->value[0] = compression_test(dp->pbsymbols, dp->blen, verbose, "Bitstring");
+        }
+        break;
+    case JOB_COMPRESSION_LITERAL:
+        out->value[0] = compression_test(fe->literal_bits, dp->len, verbose, "Literal");
+        break;
+    case JOB_SA_BITSTRING:
+        if (dp->bsymbols) {
+            SAalgs(dp->bsymbols, dp->blen, 2, out->value[0], out->value[1], verbose, "Bitstring");
+        } else {
+            SAalgs(dp->pbsymbols, dp->blen, out->value[0], out->value[1], verbose, "Bitstring");
+        }
+        break;
+    case JOB_SA_LITERAL:
+        if (fe->literal_index) {
+            SAalgs(fe->literal_index->get(dp->symbols, dp->len), dp->alph_size, out->value[0], out->value[1], verbose, "Literal");
+        } else {
+            SAalgs(dp->symbols, dp->len, dp->alph_size, out->value[0], out->value[1], verbose, "Literal");
+        }
+        break;
+    case JOB_MCW_BITSTRING:
+        if (fe->stream) {
+            out->value[0] = multi_mcw_test(fe->stream->mcw, dp->blen, verbose, "Bitstring");
+        } else if (dp->bsymbols) {
+            out->value[0] = multi_mcw_test(dp->bsymbols, dp->blen, 2, verbose, "Bitstring");
+        } else {
+            out->value[0] = multi_mcw_test(dp->pbsymbols, dp->blen, verbose, "Bitstring");
+        }
+        break;
+    case JOB_MCW_LITERAL:
+        out->value[0] = multi_mcw_test(dp->symbols, dp->len, dp->alph_size, verbose, "Literal");
+        break;
+    case JOB_LAG_BITSTRING:
+        if (fe->stream && fe->stream->lag_streamed) {
+            out->value[0] = lag_test(fe->stream->lag, 2, verbose, "Bitstring");
+        } else if (dp->bsymbols) {
+            out->value[0] = lag_test(dp->bsymbols, dp->blen, 2, verbose, "Bitstring");
+        } else {
+            out->value[0] = lag_test(dp->pbsymbols, dp->blen, verbose, "Bitstring");
+        }
+        break;
+    case JOB_LAG_LITERAL:
+        out->value[0] = lag_test(dp->symbols, dp->len, dp->alph_size, verbose, "Literal");
+        break;
+    case JOB_MMC_BITSTRING:
+        out->value[0] = multi_mmc_test(dp->pbsymbols, dp->blen, verbose, "Bitstring");
+        break;
+    case JOB_MMC_LITERAL:
+        out->value[0] = multi_mmc_test(dp->symbols, dp->len, dp->alph_size, verbose, "Literal");
+        break;
+    case JOB_LZ78Y_BITSTRING:
+        out->value[0] = LZ78Y_test(dp->pbsymbols, dp->blen, verbose, "Bitstring");
+        break;
+    case JOB_LZ78Y_LITERAL:
+        out->value[0] = LZ78Y_test(dp->symbols, dp->len, dp->alph_size, verbose, "Literal");
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Runs every enabled job and leaves its output in results[job].
+ *
+ * With verbose == 0 the jobs run as independent OpenMP iterations, so the
+ * total latency is close to that of the slowest job. Otherwise they run one
+ * after another in NonIidJob order, which keeps the estimator output in the
+ * same order as the reference tool. With instrumented set every job is
+ * measured into its stats.
+ */
+static void run_non_iid_jobs(const data_t* dp, const NonIidFrontEnd* fe, int verbose, bool instrumented, NonIidJobResult results[NON_IID_JOB_COUNT]) {
+    bool parallel = (verbose == 0) && (omp_get_max_threads() > 1);
+    const cancel_token* token = active_cancel_token;
+
+    #pragma omp parallel for schedule(dynamic, 1) if(parallel)
+    for (int i = 0; i < NON_IID_JOB_COUNT; i++) {
+        NonIidJob job = parallel ? non_iid_parallel_order[i] : (NonIidJob)i;
+        NonIidJobResult* out = &results[job];
+
+        if (!out->enabled) continue;
+
+        // Worker threads do not inherit the caller's cancellation token
+        cancel_scope scope(token);
+        try {
+            check_cancelled();
+            // Jobs are numbered bitstring view first, then literal view
+            EstimatorProbe probe(instrumented ? &out->stats : NULL, (job % 2) == 1 ? dp->len : dp->blen);
+            run_non_iid_job(job, dp, fe, verbose, out);
+        } catch (...) {
+            out->error = std::current_exception();
+        }
+    }
+
+    for (int job = 0; job < NON_IID_JOB_COUNT; job++) {
+        if (results[job].error) std::rethrow_exception(results[job].error);
+    }
+}
+
+/**
+ * @brief Combined stats of the bitstring and literal jobs of one estimator.
+ *
+ * The t-Tuple and LRS estimates share a job, so both report its stats.
+ */
+static EstimatorStats job_stats(const NonIidJobResult jobs[NON_IID_JOB_COUNT], NonIidJob bitstring, NonIidJob literal) {
+    EstimatorStats stats = jobs[bitstring].stats;
+    const EstimatorStats& other = jobs[literal].stats;
+
+    stats.wall_seconds += other.wall_seconds;
+    stats.cpu_seconds += other.cpu_seconds;
+    stats.peak_bytes = std::max(stats.peak_bytes, other.peak_bytes);
+    stats.iterations += other.iterations;
+    return stats;
+}
+
+// Caller-owned cancellation token handed to the calculate_* functions.
+struct EntropyCancelToken {
+    cancel_token token;
+
+    explicit EntropyCancelToken(double timeout_seconds) : token(timeout_seconds) {}
+};
+
+// Token to install for an assessment given the caller's handle, which may be NULL.
+static const cancel_token* token_of(const EntropyCancelToken* cancel) {
+    return cancel ? &cancel->token : NULL;
+}
+
+/**
+ * @brief Process-wide budget of OpenMP threads shared by concurrent calls.
+ *
+ * Each calculate_* call leases a team size when it starts and returns it when
+ * it ends. A call is granted its fair share of the budget (the budget divided
+ * by the number of calls in flight), capped by the threads still unleased and
+ * by the call's own max_threads hint, but always at least one thread. Team
+ * sizes are fixed once a parallel region starts, so a call keeps its grant
+ * until it returns; calls arriving while the budget is exhausted run single
+ * threaded instead of oversubscribing the host.
+ */
+class ThreadBudget {
+public:
+    ThreadBudget() : total_(0), leased_(0), active_(0) {}
+
+    void set_total(int threads) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        total_ = threads;
+    }
+
+    int acquire(int max_threads) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // No lease is active on the calling thread yet, so this is the OpenMP default
+        if (total_ <= 0) total_ = omp_get_max_threads();
+
+        active_++;
+        int grant = std::min(total_ / active_, total_ - leased_);
+        if (max_threads > 0) grant = std::min(grant, max_threads);
+        grant = std::max(grant, 1);
+
+        leased_ += grant;
+        return grant;
+    }
+
+    void release(int threads) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        leased_ -= threads;
+        active_--;
+    }
+private:
+    std::mutex mutex_;
+    int total_;  // Threads shared by all calls, 0 until first use
+    int leased_; // Threads currently granted (may exceed total_ by the minimum grants)
+    int active_; // Calls in flight
+};
+
+static ThreadBudget thread_budget;
+
+/**
+ * @brief Leases threads from thread_budget for the duration of one call.
+ *
+ * The lease sets the team size of every parallel region the calling thread
+ * opens (OpenMP keeps it per thread), and restores the previous setting when
+ * it ends, so the other threads of the process are not affected.
+ */
+class ThreadLease {
+public:
+    explicit ThreadLease(int max_threads)
+        : threads_(thread_budget.acquire(max_threads)), previous_(omp_get_max_threads()) {
+        omp_set_num_threads(threads_);
+    }
+    ~ThreadLease() {
+        omp_set_num_threads(previous_);
+        thread_budget.release(threads_);
+    }
+
+    // Non-copyable
+    ThreadLease(const ThreadLease&) = delete;
+    ThreadLease& operator=(const ThreadLease&) = delete;
+private:
+    int threads_;
+    int previous_;
+};
+
+// Smallest mapping a SampleBuffer makes
+#define SAMPLE_BUFFER_MIN_BYTES ((size_t)1 << 20)
+
+/**
+ * @brief Samples of a session, held in one anonymous mapping.
+ *
+ * The mapping doubles by mremap, which extends it in place or moves its pages
+ * to a larger range of addresses. Unlike a reallocating vector, growing never
+ * copies the samples already held, so they are never held twice.
+ */
+class SampleBuffer {
+public:
+    SampleBuffer() : data_(NULL), length_(0), capacity_(0) {}
+    ~SampleBuffer() { release(); }
+
+    // Appends length bytes; false if the mapping cannot grow
+    bool append(const uint8_t* data, size_t length) {
+        if (length > capacity_ - length_) {
+            size_t capacity = std::max(capacity_, SAMPLE_BUFFER_MIN_BYTES);
+            while (capacity - length_ < length) {
+                if (capacity > SIZE_MAX / 2) return false;
+                capacity *= 2;
+            }
+
+            void* p = data_ ? mremap(data_, capacity_, capacity, MREMAP_MAYMOVE)
+                            : mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) return false;
+            data_ = (uint8_t*)p;
+            capacity_ = capacity;
+        }
+        if (length > 0) memcpy(data_ + length_, data, length);
+        length_ += length;
+        return true;
+    }
+
+    void release() {
+        if (data_) munmap(data_, capacity_);
+        data_ = NULL;
+        length_ = 0;
+        capacity_ = 0;
+    }
+
+    const uint8_t* data() const { return data_; }
+    size_t length() const { return length_; }
+
+    // Non-copyable
+    SampleBuffer(const SampleBuffer&) = delete;
+    SampleBuffer& operator=(const SampleBuffer&) = delete;
+private:
+    uint8_t* data_;
+    size_t length_;
+    size_t capacity_;
+};
+
+/**
+ * @brief Samples of a streaming Non-IID assessment, collected until it is
+ *        finalized.
+ *
+ * With the word size given the bitstring estimators that can read their
+ * input in one pass run as the samples arrive (see BitstringStream).
+ * The suffix array, prediction and literal estimators need all the samples
+ * and the alphabet, so they still run on the buffered samples when the
+ * session is finalized.
+ */
+struct EntropySession {
+    SampleBuffer samples;
+    BitstringStream bitstring;
+    int bits_per_symbol;
+    bool is_binary;
+    int verbose;
+    bool streamed;              // whether bitstring runs while the samples are fed
+    bool incomplete;            // a feed failed part of the way through
+    bool finalized;
+
+    EntropySession(int bits, bool binary, int verbosity)
+        : bitstring(bits), bits_per_symbol(bits), is_binary(binary), verbose(verbosity),
+          streamed(bits >= 1 && bits <= 8), incomplete(false), finalized(false) {}
+};
+
+// Continuous health tests of one noise source
+struct EntropyHealthMonitor {
+    health_state state;
+};
+
 extern "C" {
 
+// Zero-initializes an EntropyResult.
+static void init_result(EntropyResult* result) {
+    result->min_entropy = 0.0;
+    result->h_original = 0.0;
+    result->h_bitstring = 0.0;
+    result->h_assessed = 0.0;
+    result->data_word_size = 0;
+    result->error_code = 0;
+    result->error_message[0] = '\0';
+    result->estimator_count = 0;
+    result->instrumented = instrumentation_enabled.load(std::memory_order_relaxed);
+    result->permutations_executed = 0;
+    for (int i = 0; i < PERMUTATION_STATISTICS; i++) {
+        result->permutation_decided_at[i] = -1;
+    }
+    memset(result->permutation_seed, 0, sizeof(result->permutation_seed));
+}
+
 // Allocates and zero-initializes an EntropyResult on the heap.
 static EntropyResult* create_result() {
     EntropyResult* result = (EntropyResult*)malloc(sizeof(EntropyResult));
     if (result) {
-        result->min_entropy = 0.0;
-        result->h_original = 0.0;
-        result->h_bitstring = 0.0;
-        result->h_assessed = 0.0;
-        result->data_word_size = 0;
-        result->error_code = 0;
-        result->error_message[0] = '\0';
-        result->estimator_count = 0;
+        init_result(result);
     }
     return result;
 }
 
 // Appends an estimator entry with a valid entropy value to the result array.
-static void add_estimator(EntropyResult* result, const char* name, double entropy, bool passed) {
+// stats may be NULL if the estimator was not measured.
+static void add_estimator(EntropyResult* result, const char* name, double entropy, bool passed,
+                          const EstimatorStats* stats = NULL) {
     if (result->estimator_count >= MAX_ESTIMATORS) return;
     EstimatorResult* est = &result->estimators[result->estimator_count++];
     strncpy(est->name, name, sizeof(est->name) - 1);
@@ -82,10 +678,16 @@ static void add_estimator(EntropyResult* result, const char* name, double entrop
     est->entropy_estimate = entropy;
     est->passed = passed;
     est->is_entropy_valid = (entropy >= 0.0);
+    if (stats) {
+        est->stats = *stats;
+    } else {
+        memset(&est->stats, 0, sizeof(est->stats));
+    }
 }
 
 // Appends a pass/fail test result without an entropy estimate.
-static void add_test_result(EntropyResult* result, const char* name, bool passed) {
+static void add_test_result(EntropyResult* result, const char* name, bool passed,
+                            const EstimatorStats* stats = NULL) {
     if (result->estimator_count >= MAX_ESTIMATORS) return;
     EstimatorResult* est = &result->estimators[result->estimator_count++];
     strncpy(est->name, name, sizeof(est->name) - 1);
@@ -93,6 +695,11 @@ static void add_test_result(EntropyResult* result, const char* name, bool passed
     est->entropy_estimate = -1.0;
     est->passed = passed;
     est->is_entropy_valid = false;
+    if (stats) {
+        est->stats = *stats;
+    } else {
+        memset(&est->stats, 0, sizeof(est->stats));
+    }
 }
 
 // Records an error code and message in the result structure.
@@ -107,50 +714,47 @@ static void set_error(EntropyResult* result, int code, const char* message) {
  *
  * Handles word-size auto-detection when bits_per_symbol is 0, builds the
  * symbol alphabet mapping, and constructs the bitstring representation
- * required by several Non-IID estimators.
+ * required by several Non-IID estimators. The word size and the alphabet
+ * follow from the histogram of the samples, which is left in counts.
+ *
+ * The estimators only read the samples and the caller's buffer outlives the
+ * call, so rawsymbols borrows data instead of copying it. symbols is a
+ * separate buffer only when masking to the word size or mapping down the
+ * alphabet changes some byte; otherwise it borrows data as well. The data_t
+ * must be released through a DataGuard constructed with data.
  *
  * @return true on success; false if memory allocation fails (error is
  *         recorded in result).
  */
-static bool prepare_data(data_t* dp, const uint8_t* data, size_t length, int bits_per_symbol, EntropyResult* result) {
+static bool prepare_data(data_t* dp, const uint8_t* data, size_t length, int bits_per_symbol, SampleCounts* counts, EntropyResult* result) {
     dp->word_size = bits_per_symbol;
     dp->len = (long)length;
     dp->symbols = NULL;
-    dp->rawsymbols = NULL;
+    dp->rawsymbols = const_cast<uint8_t*>(data);
     dp->bsymbols = NULL;
+    dp->pbsymbols = NULL;
+    dp->map_base = NULL;
+    dp->map_len = 0;
     dp->alph_size = 0;
     dp->maxsymbol = 0;
     dp->blen = 0;
 
-    // Allocate memory for symbols
-    dp->symbols = (uint8_t*)malloc(sizeof(uint8_t) * dp->len);
-    dp->rawsymbols = (uint8_t*)malloc(sizeof(uint8_t) * dp->len);
+    byte_histogram(data, dp->len, counts->raw);
 
-    if (!dp->symbols || !dp->rawsymbols) {
-        set_error(result, -1, "Failed to allocate memory for symbols");
-        if (dp->symbols) free(dp->symbols);
-        if (dp->rawsymbols) free(dp->rawsymbols);
-        return false;
+    uint8_t datamask = 0;
+    for (int v = 0; v < 256; v++) {
+        if (counts->raw[v] > 0) datamask |= v;
     }
 
-    // Copy data
-    memcpy(dp->symbols, data, dp->len);
-    memcpy(dp->rawsymbols, data, dp->len);
-
-    // Auto-detect word size if needed
+    // Auto-detect word size if needed: the highest order bit in use, as the
+    // reference tool establishes it
     if (dp->word_size == 0) {
-        uint8_t datamask = 0;
-        for (long i = 0; i < dp->len; i++) {
-            datamask |= dp->symbols[i];
-        }
-
-        uint8_t curbit = 0x80;
         int detected_size = 8;
-        for (int i = 8; i > 0 && (datamask & curbit) == 0; i--) {
-            curbit >>= 1;
-            detected_size = i - 1;
+        for (uint8_t curbit = 0x80; detected_size > 0 && (datamask & curbit) == 0; curbit >>= 1) {
+            detected_size--;
         }
-        dp->word_size = (detected_size == -1) ? 1 : detected_size + 1;
+        // All-zero data is rejected for its single symbol, but still needs a valid width
+        dp->word_size = std::max(detected_size, 1);
     }
 
     // Validate symbol width (max 8 bits = 256 symbols)
@@ -164,14 +768,14 @@ static bool prepare_data(data_t* dp, const uint8_t* data, size_t length, int bit
     dp->alph_size = 0;
     dp->maxsymbol = 0;
 
-    for (long i = 0; i < dp->len; i++) {
-        dp->symbols[i] &= mask;
-        if (dp->symbols[i] > dp->maxsymbol) {
-            dp->maxsymbol = dp->symbols[i];
-        }
-        if (symbol_map_down_table[dp->symbols[i]] == 0) {
-            symbol_map_down_table[dp->symbols[i]] = 1;
+    for (int v = 0; v < 256; v++) {
+        if (counts->raw[v] == 0) continue;
+
+        uint8_t symbol = v & mask;
+        if (symbol > dp->maxsymbol) {
+            dp->maxsymbol = symbol;
         }
+        symbol_map_down_table[symbol] = 1;
     }
 
     // Create symbol mapping
@@ -181,102 +785,200 @@ static bool prepare_data(data_t* dp, const uint8_t* data, size_t length, int bit
         }
     }
 
-    // Build bitstring from rawsymbols rather than mapped symbols to match
-    // the corrected NIST reference implementation behavior.
-    dp->blen = dp->len * dp->word_size;
-    if (dp->word_size == 1) {
-        dp->bsymbols = dp->symbols;
-    } else {
-        dp->bsymbols = (uint8_t*)malloc(dp->blen);
-        if (!dp->bsymbols) {
-            set_error(result, -1, "Failed to allocate memory for bitstring");
-            free(dp->symbols);
-            free(dp->rawsymbols);
+    for (int i = 0; i < 256; i++) counts->symbols[i] = 0;
+    for (int v = 0; v < 256; v++) {
+        counts->symbols[symbol_map_down_table[v & mask]] += counts->raw[v];
+    }
+
+    // Mask and map down symbols, unless both leave every byte as it is
+    bool masked = (datamask & ~mask) != 0;
+    bool mapped = dp->alph_size < dp->maxsymbol + 1;
+
+    if (masked || mapped) {
+        dp->symbols = (uint8_t*)scratch_alloc(sizeof(uint8_t) * dp->len);
+        if (!dp->symbols) {
+            set_error(result, -1, "Failed to allocate memory for symbols");
             return false;
         }
 
         for (long i = 0; i < dp->len; i++) {
-            uint8_t raw = dp->rawsymbols[i] & mask;
-            for (int j = 0; j < dp->word_size; j++) {
-                dp->bsymbols[i * dp->word_size + j] =
-                    (raw >> (dp->word_size - 1 - j)) & 0x1;
-            }
+            uint8_t symbol = data[i] & mask;
+            dp->symbols[i] = mapped ? (uint8_t)symbol_map_down_table[symbol] : symbol;
         }
+    } else {
+        dp->symbols = dp->rawsymbols;
     }
 
-    // Map down symbols
-    if (dp->alph_size < dp->maxsymbol + 1) {
-        for (long i = 0; i < dp->len; i++) {
-            dp->symbols[i] = (uint8_t)symbol_map_down_table[dp->symbols[i]];
-        }
+    // Build the packed bitstring from rawsymbols rather than mapped symbols to
+    // match the corrected NIST reference implementation behavior. Only 1-bit
+    // data has a one byte per bit form, the symbols themselves; the bitstring
+    // estimators read the packed form otherwise, and the suffix index unpacks
+    // it only while it is built.
+    dp->blen = dp->len * dp->word_size;
+    dp->pbsymbols = (uint64_t*)scratch_alloc(sizeof(uint64_t) * packed_word_count(dp->blen));
+    if (!dp->pbsymbols) {
+        set_error(result, -1, "Failed to allocate memory for bitstring");
+        if (dp->symbols != dp->rawsymbols) scratch_free(dp->symbols);
+        return false;
+    }
+    pack_bitstring(dp->rawsymbols, dp->len, dp->word_size, dp->pbsymbols);
+    if (dp->word_size == 1) {
+        dp->bsymbols = dp->symbols;
     }
 
     return true;
 }
 
-EntropyResult* calculate_iid_entropy(
+/**
+ * @brief One assessment's use of the suffix index of its literal symbols.
+ *
+ * The index is shared with the other assessments of the same samples in a
+ * batch (see calculate_entropy_batch), or else only used by this one. The
+ * lease releases it as soon as the assessment is done with it, and at the
+ * latest when the assessment returns.
+ */
+class LiteralIndexLease {
+public:
+    explicit LiteralIndexLease(SharedSuffixIndex* shared)
+        : own_(1), shared_(shared ? shared : &own_) {}
+    ~LiteralIndexLease() { release(); }
+
+    SharedSuffixIndex* get() { return shared_; }
+
+    void release() {
+        if (shared_) shared_->release();
+        shared_ = NULL;
+    }
+
+    // Non-copyable
+    LiteralIndexLease(const LiteralIndexLease&) = delete;
+    LiteralIndexLease& operator=(const LiteralIndexLease&) = delete;
+private:
+    SharedSuffixIndex own_;
+    SharedSuffixIndex* shared_;
+};
+
+// Runs an IID assessment and leaves its outcome in result. If tally is not
+// NULL, the permutation tests are decided by it instead of being run.
+// literal_index is the suffix index shared with other assessments of the
+// same samples, or NULL.
+static void assess_iid_entropy(
     const uint8_t* data,
     size_t length,
     int bits_per_symbol,
     bool is_binary,
-    int verbose
+    int verbose,
+    const EntropyCancelToken* cancel,
+    EntropyResult* result,
+    const uint64_t* tally_seed = NULL,
+    const PermutationTally* tally = NULL,
+    SharedSuffixIndex* literal_index = NULL
 ) {
-    EntropyResult* result = create_result();
-    if (!result) {
-        return NULL;
-    }
-
+    cancel_scope scope(token_of(cancel));
+    LiteralIndexLease index_lease(literal_index);
     try {
+        check_cancelled();
+
         // Validate input
         if (!data || length == 0) {
             set_error(result, -1, "Invalid input: data is NULL or empty");
-            return result;
+            return;
         }
 
         if (bits_per_symbol < 0 || bits_per_symbol > 8) {
             set_error(result, -1, "Invalid bits_per_symbol: must be 0-8");
-            return result;
+            return;
         }
 
         // Prepare data structure
         data_t dp;
-        if (!prepare_data(&dp, data, length, bits_per_symbol, result)) {
-            return result;
+        SampleCounts counts;
+        if (!prepare_data(&dp, data, length, bits_per_symbol, &counts, result)) {
+            return;
         }
-        DataGuard guard(&dp);  // RAII: ensures free_data() on any exit path
+        DataGuard guard(&dp, data);  // RAII: ensures free_data() on any exit path
 
         // Check alphabet size
         if (dp.alph_size <= 1) {
             set_error(result, -1, "Symbol alphabet consists of 1 symbol. No entropy awarded.");
-            return result;
+            return;
         }
 
         // Calculate entropy estimates
         double H_original = dp.word_size;
         double H_bitstring = 1.0;
 
+        bool instrumented = result->instrumented;
+        EstimatorStats mcv_stats, chi_square_stats, lrs_stats, perm_stats;
+        memset(&mcv_stats, 0, sizeof(mcv_stats));
+        memset(&chi_square_stats, 0, sizeof(chi_square_stats));
+        memset(&lrs_stats, 0, sizeof(lrs_stats));
+        memset(&perm_stats, 0, sizeof(perm_stats));
+
         // Most Common Value estimate
-        H_original = most_common(dp.symbols, dp.len, dp.alph_size, verbose, "Literal");
-        add_estimator(result, "Most Common Value", H_original, true);
+        {
+            EstimatorProbe probe(instrumented ? &mcv_stats : NULL, dp.len);
+            H_original = most_common(counts.symbols, dp.len, dp.alph_size, verbose, "Literal");
+        }
 
         if (dp.alph_size > 2) {
-            H_bitstring = most_common(dp.bsymbols, dp.blen, 2, verbose, "Bitstring");
+            EstimatorProbe probe(instrumented ? &mcv_stats : NULL, dp.blen);
+            H_bitstring = most_common(dp.pbsymbols, dp.blen, verbose, "Bitstring");
         }
+        add_estimator(result, "Most Common Value", H_original, true, &mcv_stats);
 
         // Chi-square tests
-        bool chi_square_pass = chi_square_tests(dp.symbols, dp.len, dp.alph_size, verbose);
-        add_test_result(result, "Chi-Square Tests", chi_square_pass);
+        check_cancelled();
+        bool chi_square_pass;
+        {
+            EstimatorProbe probe(instrumented ? &chi_square_stats : NULL, dp.len);
+            chi_square_pass = chi_square_tests(dp.symbols, dp.len, dp.alph_size, verbose);
+        }
+        add_test_result(result, "Chi-Square Tests", chi_square_pass, &chi_square_stats);
 
         // LRS test
-        bool lrs_pass = len_LRS_test(dp.symbols, dp.len, dp.alph_size, verbose, "Literal");
-        add_test_result(result, "Length of Longest Repeated Substring Test", lrs_pass);
+        check_cancelled();
+        bool lrs_pass;
+        {
+            EstimatorProbe probe(instrumented ? &lrs_stats : NULL, dp.len);
+            lrs_pass = len_LRS_test(dp.symbols, dp.len, dp.alph_size, verbose, "Literal", index_lease.get());
+        }
+        index_lease.release();
+        add_test_result(result, "Length of Longest Repeated Substring Test", lrs_pass, &lrs_stats);
 
         // Permutation tests
-        double rawmean, median;
-        calc_stats(&dp, rawmean, median);
         IidTestCase tc;
-        bool perm_pass = permutation_tests(&dp, rawmean, median, verbose, tc);
-        add_test_result(result, "Permutation Tests", perm_pass);
+        permutation_stats perm;
+        bool perm_pass;
+        {
+            EstimatorProbe probe(instrumented ? &perm_stats : NULL, 0, true);
+            if (tally) {
+                int C[num_tests][3];
+                memcpy(C, tally->counts, sizeof(C));
+                memcpy(result->permutation_seed, tally_seed, sizeof(result->permutation_seed));
+                if (verbose > 1) print_results(C, verbose);
+
+                perm_pass = true;
+                perm.executed = (long)tally->permutations_executed;
+                for (unsigned int i = 0; i < num_tests; i++) {
+                    perm_pass = perm_pass && permutation_decided(C[i]);
+                    perm.decided_at[i] = -1;
+                }
+            } else {
+                double rawmean, median;
+                calc_stats(counts.raw, counts.symbols, dp.len, dp.alph_size, rawmean, median);
+                perm_pass = permutation_tests(&dp, rawmean, median, verbose, tc, instrumented ? &perm : NULL,
+                                              result->permutation_seed);
+            }
+        }
+        if (instrumented) {
+            perm_stats.iterations = (uint64_t)perm.executed;
+            result->permutations_executed = (uint64_t)perm.executed;
+            for (int i = 0; i < PERMUTATION_STATISTICS; i++) {
+                result->permutation_decided_at[i] = perm.decided_at[i];
+            }
+        }
+        add_test_result(result, "Permutation Tests", perm_pass, &perm_stats);
 
         // Calculate assessed entropy
         double h_assessed = dp.word_size;
@@ -295,50 +997,76 @@ EntropyResult* calculate_iid_entropy(
 
         // guard destructor calls free_data(&dp) automatically
 
+    } catch (const assessment_cancelled& e) {
+        set_error(result, ENTROPY_ERROR_CANCELLED, e.what());
     } catch (const std::exception& e) {
         set_error(result, -2, e.what());
     } catch (...) {
         set_error(result, -2, "Unknown exception occurred");
     }
-
-    return result;
 }
 
-EntropyResult* calculate_non_iid_entropy(
+EntropyResult* calculate_iid_entropy(
     const uint8_t* data,
     size_t length,
     int bits_per_symbol,
     bool is_binary,
-    int verbose
+    int verbose,
+    int max_threads,
+    const EntropyCancelToken* cancel
 ) {
     EntropyResult* result = create_result();
     if (!result) {
         return NULL;
     }
 
+    ThreadLease lease(max_threads);
+    assess_iid_entropy(data, length, bits_per_symbol, is_binary, verbose, cancel, result);
+    return result;
+}
+
+// Runs an Non-IID assessment and leaves its outcome in result. stream is the
+// BitstringStream of a session, and literal_index the suffix index shared
+// with other assessments of the same samples; either may be NULL.
+static void assess_non_iid_entropy(
+    const uint8_t* data,
+    size_t length,
+    int bits_per_symbol,
+    bool is_binary,
+    int verbose,
+    const EntropyCancelToken* cancel,
+    BitstringStream* stream,
+    SharedSuffixIndex* literal_index,
+    EntropyResult* result
+) {
+    cancel_scope scope(token_of(cancel));
+    LiteralIndexLease index_lease(literal_index);
     try {
+        check_cancelled();
+
         // Validate input
         if (!data || length == 0) {
             set_error(result, -1, "Invalid input: data is NULL or empty");
-            return result;
+            return;
         }
 
         if (bits_per_symbol < 0 || bits_per_symbol > 8) {
             set_error(result, -1, "Invalid bits_per_symbol: must be 0-8");
-            return result;
+            return;
         }
 
         // Prepare data structure
         data_t dp;
-        if (!prepare_data(&dp, data, length, bits_per_symbol, result)) {
-            return result;
+        SampleCounts counts;
+        if (!prepare_data(&dp, data, length, bits_per_symbol, &counts, result)) {
+            return;
         }
-        DataGuard guard(&dp);  // RAII: ensures free_data() on any exit path
+        DataGuard guard(&dp, data);  // RAII: ensures free_data() on any exit path
 
         // Check alphabet size
         if (dp.alph_size <= 1) {
             set_error(result, -1, "Symbol alphabet consists of 1 symbol. No entropy awarded.");
-            return result;
+            return;
         }
 
         // Initialize entropy estimates
@@ -346,77 +1074,106 @@ EntropyResult* calculate_non_iid_entropy(
         double H_bitstring = 1.0;
         double ret_min_entropy;
 
-        // Section 6.3.1 - Most Common Value
         // Note: is_binary parameter represents initial_entropy mode (not whether data is binary)
         bool initial_entropy = is_binary;
+        bool bitstring_view = (dp.alph_size > 2) || !initial_entropy;
+        bool binary_literal = initial_entropy && (dp.alph_size == 2);
+
+        NonIidJobResult jobs[NON_IID_JOB_COUNT];
+        for (int job = 0; job < NON_IID_JOB_COUNT; job++) {
+            // Jobs are numbered bitstring view first, then literal view
+            bool literal = (job % 2) == 1;
+
+            jobs[job].enabled = literal ? initial_entropy : bitstring_view;
+            jobs[job].value[0] = -1.0;
+            jobs[job].value[1] = -1.0;
+            memset(&jobs[job].stats, 0, sizeof(jobs[job].stats));
+        }
+        // Collision, Markov and Compression only apply to binary literal data
+        jobs[JOB_COLLISION_LITERAL].enabled = binary_literal;
+        jobs[JOB_MARKOV_LITERAL].enabled = binary_literal;
+        jobs[JOB_COMPRESSION_LITERAL].enabled = binary_literal;
+
+        NonIidFrontEnd front_end;
+        summarize_non_iid_data(&dp, &counts, stream, bitstring_view, binary_literal, &front_end);
+        front_end.literal_index = index_lease.get();
+
+        run_non_iid_jobs(&dp, &front_end, verbose, result->instrumented, jobs);
+        index_lease.release();
+        EstimatorStats stats;
+
+        // Section 6.3.1 - Most Common Value
         double mcv_entropy = -1.0;
 
-        if ((dp.alph_size > 2) || !initial_entropy) {
-            ret_min_entropy = most_common(dp.bsymbols, dp.blen, 2, verbose, "Bitstring");
+        if (jobs[JOB_MCV_BITSTRING].enabled) {
+            ret_min_entropy = jobs[JOB_MCV_BITSTRING].value[0];
             H_bitstring = std::min(ret_min_entropy, H_bitstring);
             mcv_entropy = ret_min_entropy;
         }
-        if (initial_entropy) {
-            ret_min_entropy = most_common(dp.symbols, dp.len, dp.alph_size, verbose, "Literal");
+        if (jobs[JOB_MCV_LITERAL].enabled) {
+            ret_min_entropy = jobs[JOB_MCV_LITERAL].value[0];
             H_original = std::min(ret_min_entropy, H_original);
             mcv_entropy = ret_min_entropy;
         }
-        add_estimator(result, "Most Common Value", mcv_entropy, true);
+        stats = job_stats(jobs, JOB_MCV_BITSTRING, JOB_MCV_LITERAL);
+        add_estimator(result, "Most Common Value", mcv_entropy, true, &stats);
 
         // Section 6.3.2 - Collision Test (bit strings only)
         double collision_entropy = -1.0;
-        if ((dp.alph_size > 2) || !initial_entropy) {
-            ret_min_entropy = collision_test(dp.bsymbols, dp.blen, verbose, "Bitstring");
+        if (jobs[JOB_COLLISION_BITSTRING].enabled) {
+            ret_min_entropy = jobs[JOB_COLLISION_BITSTRING].value[0];
             H_bitstring = std::min(ret_min_entropy, H_bitstring);
             collision_entropy = ret_min_entropy;
         }
-        if (initial_entropy && (dp.alph_size == 2)) {
-            ret_min_entropy = collision_test(dp.symbols, dp.len, verbose, "Literal");
+        if (jobs[JOB_COLLISION_LITERAL].enabled) {
+            ret_min_entropy = jobs[JOB_COLLISION_LITERAL].value[0];
             H_original = std::min(ret_min_entropy, H_original);
             collision_entropy = ret_min_entropy;
         }
-        add_estimator(result, "Collision Test", collision_entropy, true);
+        stats = job_stats(jobs, JOB_COLLISION_BITSTRING, JOB_COLLISION_LITERAL);
+        add_estimator(result, "Collision Test", collision_entropy, true, &stats);
 
         // Section 6.3.3 - Markov Test (bit strings only)
         double markov_entropy = -1.0;
-        if ((dp.alph_size > 2) || !initial_entropy) {
-            ret_min_entropy = markov_test(dp.bsymbols, dp.blen, verbose, "Bitstring");
+        if (jobs[JOB_MARKOV_BITSTRING].enabled) {
+            ret_min_entropy = jobs[JOB_MARKOV_BITSTRING].value[0];
             H_bitstring = std::min(ret_min_entropy, H_bitstring);
             markov_entropy = ret_min_entropy;
         }
-        if (initial_entropy && (dp.alph_size == 2)) {
-            ret_min_entropy = markov_test(dp.symbols, dp.len, verbose, "Literal");
+        if (jobs[JOB_MARKOV_LITERAL].enabled) {
+            ret_min_entropy = jobs[JOB_MARKOV_LITERAL].value[0];
             H_original = std::min(ret_min_entropy, H_original);
             markov_entropy = ret_min_entropy;
         }
-        add_estimator(result, "Markov Test", markov_entropy, true);
+        stats = job_stats(jobs, JOB_MARKOV_BITSTRING, JOB_MARKOV_LITERAL);
+        add_estimator(result, "Markov Test", markov_entropy, true, &stats);
 
         // Section 6.3.4 - Compression Test (bit strings only)
         double compression_entropy = -1.0;
-        if ((dp.alph_size > 2) || !initial_entropy) {
-            ret_min_entropy = compression_test(dp.bsymbols, dp.blen, verbose, "Bitstring");
+        if (jobs[JOB_COMPRESSION_BITSTRING].enabled) {
+            ret_min_entropy = jobs[JOB_COMPRESSION_BITSTRING].value[0];
             if (ret_min_entropy >= 0) {
                 H_bitstring = std::min(ret_min_entropy, H_bitstring);
                 compression_entropy = ret_min_entropy;
             }
         }
-        if (initial_entropy && (dp.alph_size == 2)) {
-            ret_min_entropy = compression_test(dp.symbols, dp.len, verbose, "Literal");
+        if (jobs[JOB_COMPRESSION_LITERAL].enabled) {
+            ret_min_entropy = jobs[JOB_COMPRESSION_LITERAL].value[0];
             if (ret_min_entropy >= 0) {
                 H_original = std::min(ret_min_entropy, H_original);
                 compression_entropy = ret_min_entropy;
             }
         }
-        add_estimator(result, "Compression Test", compression_entropy, compression_entropy >= 0);
+        stats = job_stats(jobs, JOB_COMPRESSION_BITSTRING, JOB_COMPRESSION_LITERAL);
+        add_estimator(result, "Compression Test", compression_entropy, compression_entropy >= 0, &stats);
 
         // Section 6.3.5 - t-Tuple Test
         // Section 6.3.6 - LRS Test
-        double bin_t_tuple_res = -1.0, bin_lrs_res = -1.0;
-        double t_tuple_res = -1.0, lrs_res = -1.0;
         double t_tuple_entropy = -1.0, lrs_entropy = -1.0;
 
-        if ((dp.alph_size > 2) || !initial_entropy) {
-            SAalgs(dp.bsymbols, dp.blen, 2, bin_t_tuple_res, bin_lrs_res, verbose, "Bitstring");
+        if (jobs[JOB_SA_BITSTRING].enabled) {
+            double bin_t_tuple_res = jobs[JOB_SA_BITSTRING].value[0];
+            double bin_lrs_res = jobs[JOB_SA_BITSTRING].value[1];
             if (bin_t_tuple_res >= 0.0) {
                 H_bitstring = std::min(bin_t_tuple_res, H_bitstring);
                 t_tuple_entropy = bin_t_tuple_res;
@@ -427,8 +1184,9 @@ EntropyResult* calculate_non_iid_entropy(
             }
         }
 
-        if (initial_entropy) {
-            SAalgs(dp.symbols, dp.len, dp.alph_size, t_tuple_res, lrs_res, verbose, "Literal");
+        if (jobs[JOB_SA_LITERAL].enabled) {
+            double t_tuple_res = jobs[JOB_SA_LITERAL].value[0];
+            double lrs_res = jobs[JOB_SA_LITERAL].value[1];
             if (t_tuple_res >= 0.0) {
                 H_original = std::min(t_tuple_res, H_original);
                 t_tuple_entropy = t_tuple_res;
@@ -438,80 +1196,85 @@ EntropyResult* calculate_non_iid_entropy(
                 lrs_entropy = lrs_res;
             }
         }
-        add_estimator(result, "t-Tuple Test", t_tuple_entropy, t_tuple_entropy >= 0);
-        add_estimator(result, "LRS Test", lrs_entropy, lrs_entropy >= 0);
+        stats = job_stats(jobs, JOB_SA_BITSTRING, JOB_SA_LITERAL);
+        add_estimator(result, "t-Tuple Test", t_tuple_entropy, t_tuple_entropy >= 0, &stats);
+        add_estimator(result, "LRS Test", lrs_entropy, lrs_entropy >= 0, &stats);
 
         // Section 6.3.7 - MultiMCW Test
         double mcw_entropy = -1.0;
-        if ((dp.alph_size > 2) || !initial_entropy) {
-            ret_min_entropy = multi_mcw_test(dp.bsymbols, dp.blen, 2, verbose, "Bitstring");
+        if (jobs[JOB_MCW_BITSTRING].enabled) {
+            ret_min_entropy = jobs[JOB_MCW_BITSTRING].value[0];
             if (ret_min_entropy >= 0) {
                 H_bitstring = std::min(ret_min_entropy, H_bitstring);
                 mcw_entropy = ret_min_entropy;
             }
         }
-        if (initial_entropy) {
-            ret_min_entropy = multi_mcw_test(dp.symbols, dp.len, dp.alph_size, verbose, "Literal");
+        if (jobs[JOB_MCW_LITERAL].enabled) {
+            ret_min_entropy = jobs[JOB_MCW_LITERAL].value[0];
             if (ret_min_entropy >= 0) {
                 H_original = std::min(ret_min_entropy, H_original);
                 mcw_entropy = ret_min_entropy;
             }
         }
-        add_estimator(result, "Multi Most Common in Window Test", mcw_entropy, mcw_entropy >= 0);
+        stats = job_stats(jobs, JOB_MCW_BITSTRING, JOB_MCW_LITERAL);
+        add_estimator(result, "Multi Most Common in Window Test", mcw_entropy, mcw_entropy >= 0, &stats);
 
         // Section 6.3.8 - Lag Prediction Test
         double lag_entropy = -1.0;
-        if ((dp.alph_size > 2) || !initial_entropy) {
-            ret_min_entropy = lag_test(dp.bsymbols, dp.blen, 2, verbose, "Bitstring");
+        if (jobs[JOB_LAG_BITSTRING].enabled) {
+            ret_min_entropy = jobs[JOB_LAG_BITSTRING].value[0];
             if (ret_min_entropy >= 0) {
                 H_bitstring = std::min(ret_min_entropy, H_bitstring);
                 lag_entropy = ret_min_entropy;
             }
         }
-        if (initial_entropy) {
-            ret_min_entropy = lag_test(dp.symbols, dp.len, dp.alph_size, verbose, "Literal");
+        if (jobs[JOB_LAG_LITERAL].enabled) {
+            ret_min_entropy = jobs[JOB_LAG_LITERAL].value[0];
             if (ret_min_entropy >= 0) {
                 H_original = std::min(ret_min_entropy, H_original);
                 lag_entropy = ret_min_entropy;
             }
         }
-        add_estimator(result, "Lag Prediction Test", lag_entropy, lag_entropy >= 0);
+        stats = job_stats(jobs, JOB_LAG_BITSTRING, JOB_LAG_LITERAL);
+        add_estimator(result, "Lag Prediction Test", lag_entropy, lag_entropy >= 0, &stats);
 
         // Section 6.3.9 - MultiMMC Test
         double mmc_entropy = -1.0;
-        if ((dp.alph_size > 2) || !initial_entropy) {
-            ret_min_entropy = multi_mmc_test(dp.bsymbols, dp.blen, 2, verbose, "Bitstring");
+        if (jobs[JOB_MMC_BITSTRING].enabled) {
+            ret_min_entropy = jobs[JOB_MMC_BITSTRING].value[0];
             if (ret_min_entropy >= 0) {
                 H_bitstring = std::min(ret_min_entropy, H_bitstring);
                 mmc_entropy = ret_min_entropy;
             }
         }
-        if (initial_entropy) {
-            ret_min_entropy = multi_mmc_test(dp.symbols, dp.len, dp.alph_size, verbose, "Literal");
+        if (jobs[JOB_MMC_LITERAL].enabled) {
+            ret_min_entropy = jobs[JOB_MMC_LITERAL].value[0];
             if (ret_min_entropy >= 0) {
                 H_original = std::min(ret_min_entropy, H_original);
                 mmc_entropy = ret_min_entropy;
             }
         }
-        add_estimator(result, "Multi Markov Model with Counting Test", mmc_entropy, mmc_entropy >= 0);
+        stats = job_stats(jobs, JOB_MMC_BITSTRING, JOB_MMC_LITERAL);
+        add_estimator(result, "Multi Markov Model with Counting Test", mmc_entropy, mmc_entropy >= 0, &stats);
 
         // Section 6.3.10 - LZ78Y Test
         double lz78y_entropy = -1.0;
-        if ((dp.alph_size > 2) || !initial_entropy) {
-            ret_min_entropy = LZ78Y_test(dp.bsymbols, dp.blen, 2, verbose, "Bitstring");
+        if (jobs[JOB_LZ78Y_BITSTRING].enabled) {
+            ret_min_entropy = jobs[JOB_LZ78Y_BITSTRING].value[0];
             if (ret_min_entropy >= 0) {
                 H_bitstring = std::min(ret_min_entropy, H_bitstring);
                 lz78y_entropy = ret_min_entropy;
             }
         }
-        if (initial_entropy) {
-            ret_min_entropy = LZ78Y_test(dp.symbols, dp.len, dp.alph_size, verbose, "Literal");
+        if (jobs[JOB_LZ78Y_LITERAL].enabled) {
+            ret_min_entropy = jobs[JOB_LZ78Y_LITERAL].value[0];
             if (ret_min_entropy >= 0) {
                 H_original = std::min(ret_min_entropy, H_original);
                 lz78y_entropy = ret_min_entropy;
             }
         }
-        add_estimator(result, "LZ78Y Test", lz78y_entropy, lz78y_entropy >= 0);
+        stats = job_stats(jobs, JOB_LZ78Y_BITSTRING, JOB_LZ78Y_LITERAL);
+        add_estimator(result, "LZ78Y Test", lz78y_entropy, lz78y_entropy >= 0, &stats);
 
         // Calculate assessed entropy
         // Following NIST SP800-90B Section 3.1.3 (non_iid_main.cpp lines 491-496)
@@ -533,12 +1296,187 @@ EntropyResult* calculate_non_iid_entropy(
 
         // guard destructor calls free_data(&dp) automatically
 
+    } catch (const assessment_cancelled& e) {
+        set_error(result, ENTROPY_ERROR_CANCELLED, e.what());
     } catch (const std::exception& e) {
         set_error(result, -2, e.what());
     } catch (...) {
         set_error(result, -2, "Unknown exception occurred");
     }
+}
+
+EntropyResult* calculate_non_iid_entropy(
+    const uint8_t* data,
+    size_t length,
+    int bits_per_symbol,
+    bool is_binary,
+    int verbose,
+    int max_threads,
+    const EntropyCancelToken* cancel
+) {
+    EntropyResult* result = create_result();
+    if (!result) {
+        return NULL;
+    }
+
+    ThreadLease lease(max_threads);
+    assess_non_iid_entropy(data, length, bits_per_symbol, is_binary, verbose, cancel, NULL, NULL, result);
+    return result;
+}
+
+void set_entropy_thread_budget(int threads) {
+    thread_budget.set_total(std::max(threads, 0));
+}
+
+void set_entropy_scratch_limit(size_t bytes) {
+    scratch_pool_set_limit(bytes);
+}
+
+void set_entropy_instrumentation(bool enabled) {
+    instrumentation_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+const char* permutation_statistic_name(int index) {
+    if (index < 0 || index >= PERMUTATION_STATISTICS) {
+        return NULL;
+    }
+    return test_names[index].c_str();
+}
+
+const char* entropy_tool_version(void) {
+    return VERSION;
+}
+
+uint64_t entropy_literal_index_builds(void) {
+    return SharedSuffixIndex::builds().load(std::memory_order_relaxed);
+}
+
+EntropyCancelToken* entropy_cancel_token_create(double timeout_seconds) {
+    return new (std::nothrow) EntropyCancelToken(timeout_seconds);
+}
+
+void entropy_cancel_token_cancel(EntropyCancelToken* cancel) {
+    if (cancel) {
+        cancel->token.cancel();
+    }
+}
+
+void entropy_cancel_token_free(EntropyCancelToken* cancel) {
+    delete cancel;
+}
+
+// Runs calculate_permutation_tally on an initialized tally.
+static void assess_permutation_tally(
+    const uint8_t* data,
+    size_t length,
+    int bits_per_symbol,
+    const uint64_t seed[4],
+    int first_stream,
+    int stream_count,
+    const bool undecided[PERMUTATION_STATISTICS],
+    const EntropyCancelToken* cancel,
+    PermutationTally* tally
+) {
+    EntropyResult status;
+    init_result(&status);
+
+    cancel_scope scope(token_of(cancel));
+    try {
+        check_cancelled();
+
+        if (!data || length == 0) {
+            set_error(&status, -1, "Invalid input: data is NULL or empty");
+        } else if (bits_per_symbol < 0 || bits_per_symbol > 8) {
+            set_error(&status, -1, "Invalid bits_per_symbol: must be 0-8");
+        } else if (!seed) {
+            set_error(&status, -1, "Invalid input: seed is NULL");
+        } else if (first_stream < 0 || stream_count < 0 || stream_count > PERMUTATION_STREAMS - first_stream) {
+            set_error(&status, -1, "Invalid stream range: must lie within 0 to PERMUTATION_STREAMS");
+        } else {
+            data_t dp;
+            SampleCounts counts;
+            if (prepare_data(&dp, data, length, bits_per_symbol, &counts, &status)) {
+                DataGuard guard(&dp, data);
+
+                if (dp.alph_size <= 1) {
+                    set_error(&status, -1, "Symbol alphabet consists of 1 symbol. No entropy awarded.");
+                } else {
+                    bool run[num_tests];
+                    double rawmean, median;
+
+                    for (unsigned int i = 0; i < num_tests; i++) run[i] = !undecided || undecided[i];
+                    calc_stats(counts.raw, counts.symbols, dp.len, dp.alph_size, rawmean, median);
+                    tally->permutations_executed = (uint64_t)permutation_tally(&dp, rawmean, median, seed,
+                                                                               first_stream, stream_count, run,
+                                                                               tally->counts);
+                }
+            }
+        }
+    } catch (const assessment_cancelled& e) {
+        set_error(&status, ENTROPY_ERROR_CANCELLED, e.what());
+    } catch (const std::exception& e) {
+        set_error(&status, -2, e.what());
+    } catch (...) {
+        set_error(&status, -2, "Unknown exception occurred");
+    }
+
+    if (status.error_code != 0) {
+        memset(tally->counts, 0, sizeof(tally->counts));
+        tally->permutations_executed = 0;
+        tally->error_code = status.error_code;
+        memcpy(tally->error_message, status.error_message, sizeof(tally->error_message));
+    }
+}
+
+PermutationTally* calculate_permutation_tally(
+    const uint8_t* data,
+    size_t length,
+    int bits_per_symbol,
+    const uint64_t seed[4],
+    int first_stream,
+    int stream_count,
+    const bool undecided[PERMUTATION_STATISTICS],
+    int max_threads,
+    const EntropyCancelToken* cancel
+) {
+    PermutationTally* tally = (PermutationTally*)calloc(1, sizeof(PermutationTally));
+    if (!tally) {
+        return NULL;
+    }
+
+    ThreadLease lease(max_threads);
+    assess_permutation_tally(data, length, bits_per_symbol, seed, first_stream, stream_count, undecided, cancel,
+                             tally);
+    return tally;
+}
+
+void free_permutation_tally(PermutationTally* tally) {
+    free(tally);
+}
+
+EntropyResult* calculate_iid_entropy_with_tally(
+    const uint8_t* data,
+    size_t length,
+    int bits_per_symbol,
+    bool is_binary,
+    int verbose,
+    int max_threads,
+    const uint64_t seed[4],
+    const PermutationTally* tally,
+    const EntropyCancelToken* cancel
+) {
+    EntropyResult* result = create_result();
+    if (!result) {
+        return NULL;
+    }
+
+    if (!seed || !tally) {
+        set_error(result, -1, "Invalid input: seed or tally is NULL");
+        return result;
+    }
 
+    ThreadLease lease(max_threads);
+    assess_iid_entropy(data, length, bits_per_symbol, is_binary, verbose, cancel, result, seed, tally);
     return result;
 }
 
@@ -548,4 +1486,205 @@ void free_entropy_result(EntropyResult* result) {
     }
 }
 
+// Runs one job of a calculate_entropy_batch call, leaving its outcome in result.
+static void assess_batch_job(const EntropyJob* job, int verbose, const EntropyCancelToken* cancel,
+                             SharedSuffixIndex* literal_index, EntropyResult* result) {
+    init_result(result);
+
+    switch (job->mode) {
+    case ENTROPY_MODE_IID:
+        assess_iid_entropy(job->data, job->length, job->bits_per_symbol, job->is_binary, verbose, cancel, result,
+                           NULL, NULL, literal_index);
+        break;
+    case ENTROPY_MODE_NON_IID:
+        assess_non_iid_entropy(job->data, job->length, job->bits_per_symbol, job->is_binary, verbose, cancel, NULL,
+                               literal_index, result);
+        break;
+    default:
+        set_error(result, -1, "Invalid mode: must be ENTROPY_MODE_IID or ENTROPY_MODE_NON_IID");
+        break;
+    }
+}
+
+// Whether two batch jobs assess the same samples with the same word size
+static bool same_samples(const EntropyJob* a, const EntropyJob* b) {
+    return a->data == b->data && a->length == b->length && a->bits_per_symbol == b->bits_per_symbol;
+}
+
+EntropyResult* calculate_entropy_batch(const EntropyJob* jobs, size_t count, int verbose,
+                                      int max_threads, const EntropyCancelToken* cancel) {
+    if (!jobs || count == 0) {
+        return NULL;
+    }
+
+    EntropyResult* results = (EntropyResult*)malloc(sizeof(EntropyResult) * count);
+    if (!results) {
+        return NULL;
+    }
+
+    // Jobs that assess the same samples with the same word size map them to
+    // the same literal symbols, so they share one suffix index of them. It is
+    // built by the first job that needs it and freed once all of them are
+    // done with it.
+    std::vector<SharedSuffixIndex*> literal_index(count, NULL);
+    std::deque<SharedSuffixIndex> shared_indexes;
+    for (size_t i = 0; i < count; i++) {
+        if (!jobs[i].data || jobs[i].length == 0 || literal_index[i]) continue;
+
+        int users = 0;
+        for (size_t j = i; j < count; j++) {
+            if (same_samples(&jobs[i], &jobs[j])) users++;
+        }
+        shared_indexes.emplace_back(users);
+        for (size_t j = i; j < count; j++) {
+            if (same_samples(&jobs[i], &jobs[j])) literal_index[j] = &shared_indexes.back();
+        }
+    }
+
+    // Small jobs run one per thread. Their own parallel regions are nested
+    // inside this one and therefore run on that single thread.
+    ThreadLease lease(max_threads);
+    bool parallel = (verbose == 0) && (omp_get_max_threads() > 1);
+
+    #pragma omp parallel for schedule(dynamic, 1) if(parallel)
+    for (long i = 0; i < (long)count; i++) {
+        if (!parallel || jobs[i].length <= BATCH_SMALL_JOB_MAX) {
+            assess_batch_job(&jobs[i], verbose, cancel, literal_index[i], &results[i]);
+        }
+    }
+
+    // Large jobs run one after another, each using every thread for its estimators
+    if (parallel) {
+        for (size_t i = 0; i < count; i++) {
+            if (jobs[i].length > BATCH_SMALL_JOB_MAX) {
+                assess_batch_job(&jobs[i], verbose, cancel, literal_index[i], &results[i]);
+            }
+        }
+    }
+
+    return results;
+}
+
+void free_entropy_batch(EntropyResult* results) {
+    if (results) {
+        free(results);
+    }
+}
+
+EntropySession* entropy_session_create(int bits_per_symbol, bool is_binary, int verbose) {
+    return new (std::nothrow) EntropySession(bits_per_symbol, is_binary, verbose);
+}
+
+int entropy_session_feed(EntropySession* session, const uint8_t* data, size_t length) {
+    if (!session || session->finalized || (!data && length > 0)) {
+        return -1;
+    }
+    if (session->incomplete) {
+        return -2;
+    }
+
+    if (!session->samples.append(data, length)) {
+        return -2;
+    }
+    try {
+        if (session->streamed) session->bitstring.feed(data, length);
+    } catch (const std::exception&) {
+        // The samples are stored but the stream lost track of them
+        session->incomplete = true;
+        return -2;
+    }
+    return 0;
+}
+
+size_t entropy_session_length(const EntropySession* session) {
+    return session ? session->samples.length() : 0;
+}
+
+EntropyResult* entropy_session_finalize(EntropySession* session, int max_threads,
+                                        const EntropyCancelToken* cancel) {
+    EntropyResult* result = create_result();
+    if (!result) {
+        return NULL;
+    }
+
+    if (!session || session->finalized) {
+        set_error(result, -1, "Invalid session: NULL or already finalized");
+        return result;
+    }
+    session->finalized = true;
+    if (session->incomplete) {
+        set_error(result, -1, "Invalid session: samples were lost when a feed failed");
+    } else {
+        // The samples are contiguous, so they are assessed in place like a caller's buffer
+        ThreadLease lease(max_threads);
+        assess_non_iid_entropy(session->samples.data(), session->samples.length(), session->bits_per_symbol,
+                               session->is_binary, session->verbose, cancel,
+                               session->streamed ? &session->bitstring : NULL, NULL, result);
+    }
+
+    session->samples.release();
+    std::vector<uint64_t, scratch_allocator<uint64_t> >().swap(session->bitstring.window);
+    return result;
+}
+
+void entropy_session_free(EntropySession* session) {
+    delete session;
+}
+
+EntropyHealthMonitor* entropy_health_create(double h_min, int bits_per_symbol, int alpha_exponent) {
+    if (alpha_exponent == 0) {
+        alpha_exponent = ENTROPY_HEALTH_DEFAULT_ALPHA_EXPONENT;
+    }
+
+    if (bits_per_symbol < 1 || bits_per_symbol > 8 || !(h_min > 0.0) || h_min > bits_per_symbol ||
+        alpha_exponent < 1 || alpha_exponent > HEALTH_MAX_ALPHA_EXPONENT ||
+        !rct_cutoff_fits(h_min, alpha_exponent)) {
+        return NULL;
+    }
+
+    EntropyHealthMonitor* monitor = new (std::nothrow) EntropyHealthMonitor;
+    if (monitor) {
+        health_state_init(&monitor->state, h_min, bits_per_symbol, alpha_exponent);
+    }
+    return monitor;
+}
+
+int64_t entropy_health_feed(EntropyHealthMonitor* monitor, const uint8_t* data, size_t length) {
+    if (!monitor || (!data && length > 0)) {
+        return -1;
+    }
+
+    const uint64_t before = monitor->state.rct_alarms + monitor->state.apt_alarms;
+    health_process(&monitor->state, data, length);
+    return (int64_t)(monitor->state.rct_alarms + monitor->state.apt_alarms - before);
+}
+
+int entropy_health_counters(const EntropyHealthMonitor* monitor, EntropyHealthCounters* counters) {
+    if (!monitor || !counters) {
+        return -1;
+    }
+
+    const health_state& hs = monitor->state;
+    counters->samples = hs.samples;
+    counters->rct_alarms = hs.rct_alarms;
+    counters->apt_alarms = hs.apt_alarms;
+    counters->apt_windows = hs.apt_windows;
+    counters->longest_run = hs.longest_run;
+    counters->max_window_count = hs.max_window_count;
+    counters->rct_cutoff = hs.rct_cutoff;
+    counters->apt_cutoff = hs.apt_cutoff;
+    counters->apt_window = hs.apt_window;
+    return 0;
+}
+
+void entropy_health_reset(EntropyHealthMonitor* monitor) {
+    if (monitor) {
+        health_state_reset(&monitor->state);
+    }
+}
+
+void entropy_health_free(EntropyHealthMonitor* monitor) {
+    delete monitor;
+}
+
 } // extern "C"
@@ -2,9 +2,12 @@
  * @file wrapper.h
  * @brief C-linkage API for NIST SP 800-90B entropy assessment.
  *
- * Declares the IID and Non-IID assessment entry points, the result structures
- * returned to the caller, and the corresponding free function. This header is
- * designed for consumption by CGO.
+ * Declares the IID and Non-IID assessment entry points, the batch entry point,
+ * streaming Non-IID sessions, distributed permutation tests, continuous
+ * health test monitors, the result structures returned to the caller,
+ * the corresponding free functions, cancellation tokens, the thread budget,
+ * the instrumentation switch and the tool version. This header is designed
+ * for consumption by CGO.
  */
 
 #ifndef ENTROPY_WRAPPER_H
@@ -21,12 +24,37 @@ extern "C" {
 // Maximum number of estimators per assessment
 #define MAX_ESTIMATORS 16
 
+// Number of statistics evaluated by the IID permutation tests
+#define PERMUTATION_STATISTICS 19
+
+// Number of RNG streams the rounds of the IID permutation tests are split into
+#define PERMUTATION_STREAMS 64
+
+// Error code of an assessment abandoned through its EntropyCancelToken
+#define ENTROPY_ERROR_CANCELLED -3
+
+// Bytes of released scratch buffers kept for later calls unless
+// set_entropy_scratch_limit says otherwise (256 MiB)
+#define ENTROPY_SCRATCH_DEFAULT_LIMIT ((size_t)1 << 28)
+
+// EstimatorStats holds the instrumentation of a single estimator or test.
+// All fields are zero unless instrumentation is enabled (see
+// set_entropy_instrumentation). Estimators assessed on both the bitstring and
+// the literal symbols report the sum of both passes, and the larger peak.
+typedef struct {
+    double wall_seconds;     // Elapsed wall-clock time
+    double cpu_seconds;      // CPU time of the thread running the estimator
+    uint64_t peak_bytes;     // Peak scratch buffer bytes allocated by that thread
+    uint64_t iterations;     // Samples processed (permutations for the permutation tests)
+} EstimatorStats;
+
 // EstimatorResult holds the output of a single entropy estimator or statistical test.
 typedef struct {
     char name[64];           // Estimator name (e.g., "Most Common Value")
     double entropy_estimate; // Entropy estimate (-1.0 if not applicable)
     bool passed;             // Whether the test passed
     bool is_entropy_valid;   // true if entropy_estimate is valid
+    EstimatorStats stats;    // Instrumentation, zero unless enabled
 } EstimatorResult;
 
 // EntropyResult holds the aggregate output of an IID or Non-IID assessment.
@@ -42,16 +70,118 @@ typedef struct {
     // Individual estimator results
     EstimatorResult estimators[MAX_ESTIMATORS];
     int estimator_count;     // Number of valid entries in estimators array
+
+    // Instrumentation, only filled in if instrumented is true
+    bool instrumented;       // Whether the stats of this result were recorded
+    uint64_t permutations_executed; // Permutations run by the IID permutation tests
+    // Permutations counted when each permutation statistic was decided, or -1
+    // if it never was (see permutation_statistic_name for the order)
+    int permutation_decided_at[PERMUTATION_STATISTICS];
+
+    // xoshiro256** seed drawn for the IID permutation tests, all zero for
+    // Non-IID results. Recorded so that a cached result can be traced back
+    // to the exact permutation sequence it was computed from.
+    uint64_t permutation_seed[4];
 } EntropyResult;
 
+/**
+ * Opaque cancellation token. A caller that may give up on an assessment
+ * passes a token to calculate_*; cancelling it, or reaching its deadline,
+ * makes the long-running estimator loops stop at their next poll, and the
+ * call returns with error code ENTROPY_ERROR_CANCELLED. Polls happen every
+ * 65536 iterations of those loops, and every permutation round.
+ */
+typedef struct EntropyCancelToken EntropyCancelToken;
+
+/**
+ * Create a cancellation token.
+ *
+ * @param timeout_seconds Deadline relative to now, or 0 (or less) for none.
+ * @return New token (caller must free with entropy_cancel_token_free), or
+ *         NULL if allocation fails.
+ */
+EntropyCancelToken* entropy_cancel_token_create(double timeout_seconds);
+
+/**
+ * Cancel the assessments using a token. Safe to call from any thread while
+ * they run, and more than once.
+ *
+ * @param cancel Token to cancel (NULL-safe).
+ */
+void entropy_cancel_token_cancel(EntropyCancelToken* cancel);
+
+/**
+ * Free a cancellation token. No assessment may still be using it.
+ *
+ * @param cancel Token to free (NULL-safe).
+ */
+void entropy_cancel_token_free(EntropyCancelToken* cancel);
+
+/**
+ * Set the number of threads shared by all concurrent calculate_* calls.
+ * Each call is granted its fair share of this budget (see max_threads), so
+ * concurrent assessments do not each start a full OpenMP team.
+ *
+ * @param threads Threads in the budget, or 0 for the OpenMP default (the
+ *                default): OMP_NUM_THREADS if set, else one per processor.
+ */
+void set_entropy_thread_budget(int threads);
+
+/**
+ * Set the most bytes of released scratch buffers (suffix and LCP arrays,
+ * symbol and bit strings, permutation and compression buffers) kept for
+ * later calls. Buffers are reused across calls, so steady-state assessments
+ * of similar inputs neither map memory nor take page faults on it. Buffers
+ * of 2 MiB or more are backed by transparent huge pages where available.
+ *
+ * @param bytes Retention limit; 0 releases and keeps none. The default is
+ *              ENTROPY_SCRATCH_DEFAULT_LIMIT.
+ */
+void set_entropy_scratch_limit(size_t bytes);
+
+/**
+ * Enable or disable per-estimator instrumentation for subsequent
+ * assessments. Disabled by default; while disabled no clocks are read and
+ * no allocations are counted.
+ *
+ * @param enabled Whether to fill in the stats fields of EntropyResult.
+ */
+void set_entropy_instrumentation(bool enabled);
+
+/**
+ * Name of a permutation test statistic, as used in the reference tool output.
+ *
+ * @param index Statistic index, 0 to PERMUTATION_STATISTICS - 1.
+ * @return Static string, or NULL if index is out of range.
+ */
+const char* permutation_statistic_name(int index);
+
+/**
+ * Version of the SP 800-90B reference code the library was built from.
+ *
+ * @return Static string, e.g. "1.1.8".
+ */
+const char* entropy_tool_version(void);
+
+/**
+ * Number of suffix indexes of literal symbols built so far by the process,
+ * for the IID LRS test and the Non-IID t-Tuple and LRS estimates. Jobs of a
+ * calculate_entropy_batch call that assess the same samples build one.
+ */
+uint64_t entropy_literal_index_builds(void);
+
 /**
  * Calculate IID (Independent and Identically Distributed) entropy estimate.
  *
- * @param data Pointer to raw sample bytes.
+ * @param data Pointer to raw sample bytes. The buffer is read in place, so it
+ *             must stay valid and unmodified until the call returns.
  * @param length Number of bytes in data.
  * @param bits_per_symbol Number of bits per symbol (1-8), 0 for auto-detect.
  * @param is_binary If true, run in initial-entropy mode (unconditioned source).
  * @param verbose Verbosity level (0=quiet, 1=normal, 2=verbose, 3=very verbose).
+ * @param max_threads Most threads the call may use, or 0 for no limit beyond
+ *                    its share of the thread budget.
+ * @param cancel Cancellation token, or NULL if the call cannot be cancelled.
  * @return Pointer to EntropyResult (caller must free with free_entropy_result).
  */
 EntropyResult* calculate_iid_entropy(
@@ -59,18 +189,27 @@ EntropyResult* calculate_iid_entropy(
     size_t length,
     int bits_per_symbol,
     bool is_binary,
-    int verbose
+    int verbose,
+    int max_threads,
+    const EntropyCancelToken* cancel
 );
 
 /**
  * Calculate Non-IID entropy estimate using all ten SP 800-90B Section 6.3
  * estimators.
  *
- * @param data Pointer to raw sample bytes.
+ * With verbose == 0 the estimators run concurrently on the threads granted
+ * to the call; results are always reported in the same order.
+ *
+ * @param data Pointer to raw sample bytes. The buffer is read in place, so it
+ *             must stay valid and unmodified until the call returns.
  * @param length Number of bytes in data.
  * @param bits_per_symbol Number of bits per symbol (1-8), 0 for auto-detect.
  * @param is_binary If true, run in initial-entropy mode (unconditioned source).
  * @param verbose Verbosity level (0=quiet, 1=normal, 2=verbose, 3=very verbose).
+ * @param max_threads Most threads the call may use, or 0 for no limit beyond
+ *                    its share of the thread budget.
+ * @param cancel Cancellation token, or NULL if the call cannot be cancelled.
  * @return Pointer to EntropyResult (caller must free with free_entropy_result).
  */
 EntropyResult* calculate_non_iid_entropy(
@@ -78,7 +217,96 @@ EntropyResult* calculate_non_iid_entropy(
     size_t length,
     int bits_per_symbol,
     bool is_binary,
-    int verbose
+    int verbose,
+    int max_threads,
+    const EntropyCancelToken* cancel
+);
+
+// PermutationTally holds the outcomes of the permutation test rounds of a
+// range of RNG streams (see calculate_permutation_tally). Tallies of disjoint
+// stream ranges of the same data and seed are merged by adding their counts.
+typedef struct {
+    // counts[i][0], [1] and [2] count the rounds in which permuted statistic
+    // i was greater than, equal to and less than the unpermuted one
+    int counts[PERMUTATION_STATISTICS][3];
+    uint64_t permutations_executed; // Permutations run
+    int error_code;          // 0 = success, negative = error
+    char error_message[512]; // Error description
+} PermutationTally;
+
+/**
+ * Run the permutation test rounds of some of the RNG streams of an IID
+ * assessment, so that the rounds can be split between processes or hosts.
+ *
+ * Stream k starts from seed jumped k * 2^128 calls ahead, as in
+ * calculate_iid_entropy. A stream stops early once its own outcomes decide
+ * every statistic it runs, so the merged tallies of all PERMUTATION_STREAMS
+ * streams decide the same statistics as calculate_iid_entropy with that seed.
+ * Statistics that are already decided by the tallies gathered so far may be
+ * left out of the remaining streams.
+ *
+ * @param data Pointer to raw sample bytes, as for calculate_iid_entropy.
+ * @param length Number of bytes in data.
+ * @param bits_per_symbol Number of bits per symbol (1-8), 0 for auto-detect.
+ * @param seed xoshiro256** seed of the permutation tests.
+ * @param first_stream First stream to run, 0 to PERMUTATION_STREAMS - 1.
+ * @param stream_count Number of consecutive streams to run.
+ * @param undecided Statistics to run (see permutation_statistic_name for the
+ *                  order), or NULL to run them all.
+ * @param max_threads Thread limit, as for calculate_iid_entropy.
+ * @param cancel Cancellation token, or NULL if the call cannot be cancelled.
+ * @return Pointer to PermutationTally (caller must free with
+ *         free_permutation_tally), or NULL if allocation fails.
+ */
+PermutationTally* calculate_permutation_tally(
+    const uint8_t* data,
+    size_t length,
+    int bits_per_symbol,
+    const uint64_t seed[4],
+    int first_stream,
+    int stream_count,
+    const bool undecided[PERMUTATION_STATISTICS],
+    int max_threads,
+    const EntropyCancelToken* cancel
+);
+
+/**
+ * Free a PermutationTally allocated by calculate_permutation_tally.
+ *
+ * @param tally Pointer to PermutationTally to free (NULL-safe).
+ */
+void free_permutation_tally(PermutationTally* tally);
+
+/**
+ * Calculate an IID entropy estimate whose permutation test rounds were run
+ * by calculate_permutation_tally. The other tests run as in
+ * calculate_iid_entropy, and the permutation tests pass if tally decides
+ * every statistic. The result reports seed as its permutation seed; the
+ * permutation_decided_at entries of an instrumented result are -1.
+ *
+ * @param data Pointer to raw sample bytes, as for calculate_iid_entropy.
+ * @param length Number of bytes in data.
+ * @param bits_per_symbol Number of bits per symbol (1-8), 0 for auto-detect.
+ * @param is_binary As for calculate_iid_entropy.
+ * @param verbose Verbosity level, as for calculate_iid_entropy.
+ * @param max_threads Thread limit, as for calculate_iid_entropy.
+ * @param seed Seed the tallies were computed with.
+ * @param tally Merged tallies of all streams, or of the streams run until
+ *              every statistic was decided.
+ * @param cancel Cancellation token, or NULL if the call cannot be cancelled.
+ * @return Pointer to EntropyResult (caller must free with free_entropy_result),
+ *         with error code -1 if seed or tally is NULL.
+ */
+EntropyResult* calculate_iid_entropy_with_tally(
+    const uint8_t* data,
+    size_t length,
+    int bits_per_symbol,
+    bool is_binary,
+    int verbose,
+    int max_threads,
+    const uint64_t seed[4],
+    const PermutationTally* tally,
+    const EntropyCancelToken* cancel
 );
 
 /**
@@ -88,6 +316,206 @@ EntropyResult* calculate_non_iid_entropy(
  */
 void free_entropy_result(EntropyResult* result);
 
+// Assessment modes of an EntropyJob
+#define ENTROPY_MODE_IID 0
+#define ENTROPY_MODE_NON_IID 1
+
+// EntropyJob describes one assessment of a calculate_entropy_batch call.
+typedef struct {
+    const uint8_t* data;     // Raw sample bytes, read in place
+    size_t length;           // Number of bytes in data
+    int bits_per_symbol;     // Bits per symbol (1-8), 0 for auto-detect
+    int mode;                // ENTROPY_MODE_IID or ENTROPY_MODE_NON_IID
+    bool is_binary;          // Initial-entropy mode, as for the calculate_* functions
+} EntropyJob;
+
+/**
+ * Run several independent assessments in one call.
+ *
+ * Each job is assessed exactly as calculate_iid_entropy or
+ * calculate_non_iid_entropy would assess it. Small jobs run concurrently,
+ * one job per thread. Large jobs then run one at a time, and each of them
+ * spreads its estimators over all threads of the call. With verbose != 0
+ * the jobs run in order, so their output does not interleave. Jobs with the
+ * same data pointer, length and bits_per_symbol, such as the IID and Non-IID
+ * assessments of one capture, build the suffix index of the symbols once
+ * for all of them and free it as soon as the last of them is done with it.
+ *
+ * @param jobs Array of count job descriptors.
+ * @param count Number of jobs.
+ * @param verbose Verbosity level, as for the calculate_* functions.
+ * @param max_threads Thread limit of the whole batch, as for the calculate_*
+ *                    functions.
+ * @param cancel Cancellation token shared by all jobs, or NULL. Once it
+ *               fires, every unfinished job reports ENTROPY_ERROR_CANCELLED.
+ * @return Array of count EntropyResult entries, entry i holding the outcome
+ *         of jobs[i] (caller must free with free_entropy_batch), or NULL if
+ *         jobs is NULL, count is 0 or allocation fails.
+ */
+EntropyResult* calculate_entropy_batch(const EntropyJob* jobs, size_t count, int verbose,
+                                      int max_threads, const EntropyCancelToken* cancel);
+
+/**
+ * Free the result array returned by calculate_entropy_batch.
+ *
+ * @param results Pointer returned by calculate_entropy_batch (NULL-safe).
+ */
+void free_entropy_batch(EntropyResult* results);
+
+/**
+ * Opaque Non-IID assessment session. A session collects the samples of one
+ * assessment as they arrive, in chunks passed to entropy_session_feed, so
+ * that the caller does not need to hold the whole capture in memory.
+ * entropy_session_finalize then assesses the samples exactly as
+ * calculate_non_iid_entropy assesses them in one buffer. With an explicit
+ * word size the bitstring MCV, Collision, Markov, Compression, MultiMCW and
+ * Lag estimates already run as the chunks are fed, leaving the rest of the
+ * estimators to finalize. The samples are held once, in a mapping that grows
+ * without copying them. A session is not safe for concurrent use.
+ */
+typedef struct EntropySession EntropySession;
+
+/**
+ * Start a streaming Non-IID assessment.
+ *
+ * @param bits_per_symbol Number of bits per symbol (1-8), 0 for auto-detect.
+ * @param is_binary If true, run in initial-entropy mode (unconditioned source).
+ * @param verbose Verbosity level, as for calculate_non_iid_entropy.
+ * @return New session (caller must free with entropy_session_free), or NULL
+ *         if allocation fails. Invalid parameters are reported by
+ *         entropy_session_finalize.
+ */
+EntropySession* entropy_session_create(int bits_per_symbol, bool is_binary, int verbose);
+
+/**
+ * Append samples to a session. The chunk is copied, so the caller may reuse
+ * its buffer as soon as the call returns.
+ *
+ * @param session Session to feed.
+ * @param data Pointer to length raw sample bytes (may be NULL if length is 0).
+ * @param length Number of bytes in data.
+ * @return 0 on success, -1 if session is NULL or already finalized or data
+ *         is NULL, -2 if the samples cannot be stored. A -2 from the
+ *         estimators that run while the session is fed leaves the session
+ *         unusable: finalizing it reports an error.
+ */
+int entropy_session_feed(EntropySession* session, const uint8_t* data, size_t length);
+
+/**
+ * Number of samples fed to a session so far.
+ *
+ * @param session Session to query (NULL-safe, 0 for NULL).
+ */
+size_t entropy_session_length(const EntropySession* session);
+
+/**
+ * Assess the samples of a session and release them. A session can only be
+ * finalized once; afterwards it can only be freed.
+ *
+ * @param session Session to finalize.
+ * @param max_threads Thread limit, as for calculate_non_iid_entropy.
+ * @param cancel Cancellation token, or NULL if the call cannot be cancelled.
+ * @return Pointer to EntropyResult (caller must free with free_entropy_result),
+ *         with error code -1 if session is NULL, already finalized, holds no
+ *         samples or lost some in a failed feed, or NULL if allocation fails.
+ */
+EntropyResult* entropy_session_finalize(EntropySession* session, int max_threads,
+                                        const EntropyCancelToken* cancel);
+
+/**
+ * Free a session and any samples it still holds.
+ *
+ * @param session Session to free (NULL-safe).
+ */
+void entropy_session_free(EntropySession* session);
+
+// -log2(alpha) used by entropy_health_create when 0 is passed: alpha = 2^-20,
+// the false positive probability Section 4.4 recommends
+#define ENTROPY_HEALTH_DEFAULT_ALPHA_EXPONENT 20
+
+// EntropyHealthCounters holds the state of an EntropyHealthMonitor (see
+// entropy_health_counters).
+typedef struct {
+    uint64_t samples;           // Samples processed
+    uint64_t rct_alarms;        // Runs that reached the Repetition Count Test cutoff
+    uint64_t apt_alarms;        // Windows that reached the Adaptive Proportion Test cutoff
+    uint64_t apt_windows;       // Adaptive Proportion Test windows completed
+    uint64_t longest_run;       // Longest run of identical samples
+    uint32_t max_window_count;  // Largest count of the first sample of a completed window
+    uint32_t rct_cutoff;        // Repetition Count Test cutoff C
+    uint32_t apt_cutoff;        // Adaptive Proportion Test cutoff C
+    uint32_t apt_window;        // Adaptive Proportion Test window size W
+} EntropyHealthCounters;
+
+/**
+ * Opaque continuous health test monitor of one noise source. A monitor runs
+ * the SP 800-90B Section 4.4 Repetition Count and Adaptive Proportion tests
+ * on the samples passed to entropy_health_feed, in constant memory however
+ * long the stream. Each source gets its own monitor; different monitors may
+ * be fed from different threads at the same time, but a monitor is not safe
+ * for concurrent use.
+ */
+typedef struct EntropyHealthMonitor EntropyHealthMonitor;
+
+/**
+ * Start monitoring a noise source. The cutoffs are derived from the
+ * min-entropy per sample, such as h_assessed of an assessment of the source.
+ *
+ * @param h_min Min-entropy per sample, more than 0 and at most bits_per_symbol.
+ *              It must also be at least alpha_exponent / (UINT_MAX - 1) so
+ *              that the Repetition Count Test cutoff fits in an unsigned int.
+ * @param bits_per_symbol Number of bits per sample (1-8); the monitor masks
+ *                        each byte to this many low bits. 1 selects the
+ *                        binary Adaptive Proportion Test window of 1024
+ *                        samples, other widths the window of 512 samples.
+ * @param alpha_exponent -log2 of the false positive probability of each
+ *                       test (1-64), or 0 for
+ *                       ENTROPY_HEALTH_DEFAULT_ALPHA_EXPONENT.
+ * @return New monitor (caller must free with entropy_health_free), or NULL
+ *         if a parameter is invalid or allocation fails.
+ */
+EntropyHealthMonitor* entropy_health_create(double h_min, int bits_per_symbol, int alpha_exponent);
+
+/**
+ * Run the health tests on the next samples of the source. The stream may be
+ * split into chunks of any size; the counters do not depend on the split. A
+ * run of identical samples raises one alarm when it reaches the Repetition
+ * Count Test cutoff, however much longer it gets, and a window raises at
+ * most one Adaptive Proportion Test alarm.
+ *
+ * @param monitor Monitor of the source.
+ * @param data Pointer to length raw sample bytes (may be NULL if length is 0).
+ * @param length Number of bytes in data.
+ * @return Number of alarms raised by this chunk, or -1 if monitor is NULL or
+ *         data is NULL.
+ */
+int64_t entropy_health_feed(EntropyHealthMonitor* monitor, const uint8_t* data, size_t length);
+
+/**
+ * Read the counters and cutoffs of a monitor.
+ *
+ * @param monitor Monitor to query.
+ * @param counters Filled in with the counters.
+ * @return 0 on success, -1 if monitor or counters is NULL.
+ */
+int entropy_health_counters(const EntropyHealthMonitor* monitor, EntropyHealthCounters* counters);
+
+/**
+ * Restart a monitor, as after the source recovered from an alarm: the
+ * current run and window are forgotten and the counters zeroed, while the
+ * cutoffs are kept.
+ *
+ * @param monitor Monitor to reset (NULL-safe).
+ */
+void entropy_health_reset(EntropyHealthMonitor* monitor);
+
+/**
+ * Free a monitor.
+ *
+ * @param monitor Monitor to free (NULL-safe).
+ */
+void entropy_health_free(EntropyHealthMonitor* monitor);
+
 #ifdef __cplusplus
 }
 #endif
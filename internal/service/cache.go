@@ -0,0 +1,211 @@
+package service
+
+import (
+	"container/list"
+	"crypto/sha256"
+	"encoding/json"
+	"fmt"
+	"os"
+	"path/filepath"
+	"sync"
+
+	"github.com/rs/zerolog/log"
+
+	"github.com/AmmannChristian/nist-800-90b/internal/entropy"
+	"github.com/AmmannChristian/nist-800-90b/internal/metrics"
+)
+
+// ResultCache is a content-addressed cache of assessment results. Entries
+// are keyed by the SHA-256 of the samples, the bits per symbol, the test type
+// and the version of the reference code (see ResultCacheKey), so a repeated
+// submission of the same capture is answered without running the
+// estimators again. A bounded number of results is kept in memory and
+// evicted in least-recently-used order; if a directory is configured, every
+// result is also stored there and survives restarts.
+//
+// Non-IID results are deterministic. IID results depend on the randomly
+// seeded permutation tests; a cached IID result keeps the PermutationSeed of
+// the run that produced it, so a repeated request reproduces the original
+// verdict along with the seed it was computed from.
+//
+// A ResultCache is safe for concurrent use.
+type ResultCache struct {
+	mu       sync.Mutex
+	capacity int
+	order    *list.List // Most recently used entry first
+	index    map[string]*list.Element
+	dir      string
+}
+
+// cacheEntry is an element of ResultCache.order.
+type cacheEntry struct {
+	key    string
+	result *entropy.Result
+}
+
+// NewResultCache creates a cache holding up to entries results in memory.
+// If dir is non-empty, results are also persisted as JSON files in dir,
+// which is created if necessary.
+func NewResultCache(entries int, dir string) (*ResultCache, error) {
+	if entries < 1 {
+		return nil, fmt.Errorf("result cache must hold at least 1 entry, got %d", entries)
+	}
+
+	if dir != "" {
+		if err := os.MkdirAll(dir, 0o750); err != nil {
+			return nil, fmt.Errorf("failed to create result cache directory: %w", err)
+		}
+	}
+
+	return &ResultCache{
+		capacity: entries,
+		order:    list.New(),
+		index:    make(map[string]*list.Element, entries),
+		dir:      dir,
+	}, nil
+}
+
+// ResultCacheKey returns the cache key of an assessment of data with the
+// given bits per symbol and test type. The key is safe to use as a file name.
+func ResultCacheKey(data []byte, bitsPerSymbol int, testType entropy.TestType) string {
+	sum := sha256.Sum256(data)
+	return resultCacheKeyFromSum(sum[:], bitsPerSymbol, testType)
+}
+
+// resultCacheKeyFromSum is like ResultCacheKey, but takes the SHA-256 of the
+// data, for data that is hashed as it arrives.
+func resultCacheKeyFromSum(sum []byte, bitsPerSymbol int, testType entropy.TestType) string {
+	mode := "iid"
+	if testType == entropy.NonIID {
+		mode = "noniid"
+	}
+	return fmt.Sprintf("%x-%d-%s-%s", sum, bitsPerSymbol, mode, entropy.ToolVersion())
+}
+
+// Get returns a copy of the result stored under key, looking in the
+// directory store if the result is not held in memory. testType labels the
+// lookup in the cache metrics.
+func (c *ResultCache) Get(key string, testType entropy.TestType) (*entropy.Result, bool) {
+	c.mu.Lock()
+	if elem, ok := c.index[key]; ok {
+		c.order.MoveToFront(elem)
+		res := cloneResult(elem.Value.(*cacheEntry).result)
+		c.mu.Unlock()
+		metrics.RecordCacheLookup(testType.String(), true)
+		return res, true
+	}
+	c.mu.Unlock()
+
+	res, ok := c.load(key)
+	if ok {
+		c.insert(key, res)
+		res = cloneResult(res)
+	}
+	metrics.RecordCacheLookup(testType.String(), ok)
+	return res, ok
+}
+
+// Put stores a copy of res under key. Instrumentation describes the run that
+// produced a result, so it is not cached.
+func (c *ResultCache) Put(key string, res *entropy.Result) {
+	if res == nil {
+		return
+	}
+
+	stored := cloneResult(res)
+	stored.Permutation = nil
+	for i := range stored.Estimators {
+		stored.Estimators[i].Stats = nil
+	}
+
+	c.insert(key, stored)
+	c.store(key, stored)
+}
+
+// Len returns the number of results held in memory.
+func (c *ResultCache) Len() int {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	return c.order.Len()
+}
+
+// insert adds or refreshes an in-memory entry, evicting the least recently
+// used entry if the cache is full.
+func (c *ResultCache) insert(key string, res *entropy.Result) {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	if elem, ok := c.index[key]; ok {
+		elem.Value.(*cacheEntry).result = res
+		c.order.MoveToFront(elem)
+		return
+	}
+
+	c.index[key] = c.order.PushFront(&cacheEntry{key: key, result: res})
+	if c.order.Len() > c.capacity {
+		oldest := c.order.Back()
+		c.order.Remove(oldest)
+		delete(c.index, oldest.Value.(*cacheEntry).key)
+	}
+}
+
+// load reads the result stored under key from the directory store.
+func (c *ResultCache) load(key string) (*entropy.Result, bool) {
+	if c.dir == "" {
+		return nil, false
+	}
+
+	raw, err := os.ReadFile(filepath.Join(c.dir, key+".json"))
+	if err != nil {
+		return nil, false
+	}
+
+	var res entropy.Result
+	if err := json.Unmarshal(raw, &res); err != nil {
+		log.Warn().Err(err).Str("key", key).Msg("Ignoring unreadable result cache entry")
+		return nil, false
+	}
+	return &res, true
+}
+
+// store writes res to the directory store. The file is written under a
+// temporary name and renamed, so readers never see a partial entry.
+func (c *ResultCache) store(key string, res *entropy.Result) {
+	if c.dir == "" {
+		return
+	}
+
+	raw, err := json.Marshal(res)
+	if err != nil {
+		// Results without any valid estimator hold infinities, which JSON
+		// cannot represent; those are cached in memory only.
+		return
+	}
+
+	tmp, err := os.CreateTemp(c.dir, key+".*.tmp")
+	if err != nil {
+		log.Warn().Err(err).Str("key", key).Msg("Failed to store result cache entry")
+		return
+	}
+	_, err = tmp.Write(raw)
+	if closeErr := tmp.Close(); err == nil {
+		err = closeErr
+	}
+	if err == nil {
+		err = os.Rename(tmp.Name(), filepath.Join(c.dir, key+".json"))
+	}
+	if err != nil {
+		os.Remove(tmp.Name())
+		log.Warn().Err(err).Str("key", key).Msg("Failed to store result cache entry")
+	}
+}
+
+// cloneResult returns a copy of res that shares no mutable state with it.
+func cloneResult(res *entropy.Result) *entropy.Result {
+	clone := *res
+	if res.Estimators != nil {
+		clone.Estimators = make([]entropy.EstimatorResult, len(res.Estimators))
+		copy(clone.Estimators, res.Estimators)
+	}
+	return &clone
+}
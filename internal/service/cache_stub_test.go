@@ -0,0 +1,162 @@
+//go:build teststub
+
+package service
+
+import (
+	"context"
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"github.com/AmmannChristian/nist-800-90b/internal/entropy"
+)
+
+func TestResultCacheKey(t *testing.T) {
+	data := []byte{1, 2, 3, 4}
+
+	key := ResultCacheKey(data, 8, entropy.IID)
+	assert.Equal(t, key, ResultCacheKey([]byte{1, 2, 3, 4}, 8, entropy.IID))
+	assert.NotEqual(t, key, ResultCacheKey(data, 4, entropy.IID))
+	assert.NotEqual(t, key, ResultCacheKey(data, 8, entropy.NonIID))
+	assert.NotEqual(t, key, ResultCacheKey([]byte{1, 2, 3, 5}, 8, entropy.IID))
+	assert.Contains(t, key, entropy.ToolVersion())
+}
+
+func TestNewResultCacheInvalidSize(t *testing.T) {
+	_, err := NewResultCache(0, "")
+	require.Error(t, err)
+}
+
+func TestResultCacheEvictsLeastRecentlyUsed(t *testing.T) {
+	cache, err := NewResultCache(2, "")
+	require.NoError(t, err)
+
+	cache.Put("a", &entropy.Result{MinEntropy: 1})
+	cache.Put("b", &entropy.Result{MinEntropy: 2})
+	_, ok := cache.Get("a", entropy.IID) // a is now the most recently used
+	require.True(t, ok)
+	cache.Put("c", &entropy.Result{MinEntropy: 3})
+
+	assert.Equal(t, 2, cache.Len())
+	_, ok = cache.Get("b", entropy.IID)
+	assert.False(t, ok)
+	res, ok := cache.Get("a", entropy.IID)
+	require.True(t, ok)
+	assert.Equal(t, 1.0, res.MinEntropy)
+}
+
+func TestResultCacheDropsInstrumentation(t *testing.T) {
+	cache, err := NewResultCache(4, "")
+	require.NoError(t, err)
+
+	original := &entropy.Result{
+		MinEntropy:      7.5,
+		TestType:        entropy.IID,
+		Estimators:      []entropy.EstimatorResult{{Name: "Most Common Value", Stats: &entropy.EstimatorStats{WallSeconds: 1}}},
+		Permutation:     &entropy.PermutationStats{Executed: 12},
+		PermutationSeed: "00ff",
+	}
+	cache.Put("k", original)
+
+	res, ok := cache.Get("k", entropy.IID)
+	require.True(t, ok)
+	assert.Nil(t, res.Permutation)
+	assert.Nil(t, res.Estimators[0].Stats)
+	assert.Equal(t, "00ff", res.PermutationSeed)
+
+	// The caller's result is left untouched and copies are independent
+	assert.NotNil(t, original.Estimators[0].Stats)
+	res.Estimators[0].Name = "changed"
+	again, _ := cache.Get("k", entropy.IID)
+	assert.Equal(t, "Most Common Value", again.Estimators[0].Name)
+}
+
+func TestResultCachePersistsToDirectory(t *testing.T) {
+	dir := filepath.Join(t.TempDir(), "cache")
+	cache, err := NewResultCache(4, dir)
+	require.NoError(t, err)
+
+	key := ResultCacheKey([]byte{1, 2, 3, 4}, 8, entropy.NonIID)
+	cache.Put(key, &entropy.Result{MinEntropy: 6.5, TestType: entropy.NonIID})
+	_, err = os.Stat(filepath.Join(dir, key+".json"))
+	require.NoError(t, err)
+
+	// A fresh cache on the same directory finds the stored result
+	reopened, err := NewResultCache(4, dir)
+	require.NoError(t, err)
+	res, ok := reopened.Get(key, entropy.NonIID)
+	require.True(t, ok)
+	assert.Equal(t, 6.5, res.MinEntropy)
+	assert.Equal(t, entropy.NonIID, res.TestType)
+	assert.Equal(t, 1, reopened.Len())
+}
+
+func TestService_ResultCache(t *testing.T) {
+	cache, err := NewResultCache(8, "")
+	require.NoError(t, err)
+	svc := NewService()
+	svc.SetResultCache(cache)
+	data := []byte{1, 2, 3, 4}
+
+	res, err := svc.AssessIID(context.Background(), data, 8)
+	require.NoError(t, err)
+	assert.Equal(t, 7.5, res.MinEntropy)
+	assert.NotEmpty(t, res.PermutationSeed)
+	assert.Equal(t, 1, cache.Len())
+
+	// A cached result is returned without running the assessment
+	cache.Put(ResultCacheKey(data, 8, entropy.NonIID), &entropy.Result{MinEntropy: 1.25, TestType: entropy.NonIID})
+	res, err = svc.AssessNonIID(context.Background(), data, 8)
+	require.NoError(t, err)
+	assert.Equal(t, 1.25, res.MinEntropy)
+
+	// Failed assessments are not cached
+	_, err = svc.AssessIID(context.Background(), []byte{0xFF, 1, 2, 3}, 8)
+	require.Error(t, err)
+	assert.Equal(t, 2, cache.Len())
+
+	results := svc.AssessBatch(context.Background(), []entropy.BatchItem{
+		{Data: data, BitsPerSymbol: 8, TestType: entropy.NonIID},
+		{Data: []byte{5, 6, 7, 8}, BitsPerSymbol: 8, TestType: entropy.IID},
+		{Data: nil, BitsPerSymbol: 8, TestType: entropy.IID},
+	})
+	require.Len(t, results, 3)
+	require.NoError(t, results[0].Err)
+	assert.Equal(t, 1.25, results[0].Result.MinEntropy)
+	require.NoError(t, results[1].Err)
+	assert.Equal(t, 7.5, results[1].Result.MinEntropy)
+	require.Error(t, results[2].Err)
+	assert.Equal(t, 3, cache.Len())
+}
+
+func TestNonIIDStream_ResultCache(t *testing.T) {
+	cache, err := NewResultCache(8, "")
+	require.NoError(t, err)
+	svc := NewService()
+	svc.SetResultCache(cache)
+
+	// A stream is cached under the same key as the concatenated samples
+	cache.Put(ResultCacheKey([]byte{1, 2, 3, 4}, 8, entropy.NonIID), &entropy.Result{MinEntropy: 1.25, TestType: entropy.NonIID})
+	stream, err := svc.NewNonIIDStream(8)
+	require.NoError(t, err)
+	defer stream.Close()
+	require.NoError(t, stream.Feed([]byte{1, 2}))
+	require.NoError(t, stream.Feed([]byte{3, 4}))
+	res, err := stream.Finish(context.Background())
+	require.NoError(t, err)
+	assert.Equal(t, 1.25, res.MinEntropy)
+
+	other, err := svc.NewNonIIDStream(8)
+	require.NoError(t, err)
+	defer other.Close()
+	require.NoError(t, other.Feed([]byte{5, 6, 7, 8}))
+	res, err = other.Finish(context.Background())
+	require.NoError(t, err)
+	assert.Equal(t, 6.5, res.MinEntropy)
+	cached, ok := cache.Get(ResultCacheKey([]byte{5, 6, 7, 8}, 8, entropy.NonIID), entropy.NonIID)
+	require.True(t, ok)
+	assert.Equal(t, 6.5, cached.MinEntropy)
+}
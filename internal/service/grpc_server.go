@@ -2,6 +2,10 @@ package service
 
 import (
 	"context"
+	"crypto/sha256"
+	"errors"
+	"fmt"
+	"io"
 	"math"
 	"time"
 
@@ -34,7 +38,8 @@ func NewGRPCServer(svc *EntropyService) *GRPCServer {
 }
 
 // AssessEntropy handles gRPC requests for NIST SP 800-90B entropy assessment.
-// It supports IID mode, Non-IID mode, or both simultaneously. The overall
+// It supports IID mode, Non-IID mode, or both simultaneously, in which case
+// both are run by EntropyService.AssessBoth. The overall
 // min-entropy is the minimum across all enabled modes. If either mode produces
 // an infinity result (no valid estimators), min-entropy falls back to zero.
 func (s *GRPCServer) AssessEntropy(ctx context.Context, req *pb.Sp80090BAssessmentRequest) (*pb.Sp80090BAssessmentResponse, error) {
@@ -55,100 +60,485 @@ func (s *GRPCServer) AssessEntropy(ctx context.Context, req *pb.Sp80090BAssessme
 		Bool("non_iid_mode", req.NonIidMode).
 		Msg("AssessEntropy request received")
 
+	if err := validateAssessmentRequest("AssessEntropy", requestID, req); err != nil {
+		return nil, err
+	}
+
+	testType := requestTestType(req)
+	startTime := time.Now()
+	metrics.RecordRequest(testType)
+	metrics.RecordDataSize(testType, len(req.Data))
+
+	bits := int(req.BitsPerSymbol)
+	var iid, nonIID entropy.BatchResult
+	switch {
+	case req.IidMode && req.NonIidMode:
+		iid, nonIID = s.svc.AssessBoth(ctx, req.Data, bits)
+	case req.IidMode:
+		iid.Result, iid.Err = s.svc.AssessIID(ctx, req.Data, bits)
+	default:
+		nonIID.Result, nonIID.Err = s.svc.AssessNonIID(ctx, req.Data, bits)
+	}
+
+	// IID path
+	if req.IidMode {
+		if iid.Err != nil {
+			metrics.RecordError("IID", assessmentErrorType("IID", iid.Err))
+			metrics.RecordDuration(testType, time.Since(startTime).Seconds())
+			return nil, assessmentStatus(ctx, "IID", iid.Err)
+		}
+		recordEstimatorMetrics(iid.Result)
+	}
+
+	// Non-IID path
+	if req.NonIidMode {
+		if nonIID.Err != nil {
+			metrics.RecordError("Non-IID", assessmentErrorType("Non-IID", nonIID.Err))
+			metrics.RecordDuration(testType, time.Since(startTime).Seconds())
+			return nil, assessmentStatus(ctx, "Non-IID", nonIID.Err)
+		}
+		recordEstimatorMetrics(nonIID.Result)
+	}
+
+	response, finite := buildAssessmentResponse(len(req.Data), req.BitsPerSymbol, iid.Result, nonIID.Result)
+	if finite {
+		metrics.RecordMinEntropy(testType, response.MinEntropy)
+	}
+	metrics.RecordDuration(testType, time.Since(startTime).Seconds())
+
+	log.Info().
+		Str("request_id", requestID).
+		Int64("execution_time_ms", time.Since(startTime).Milliseconds()).
+		Float64("min_entropy", response.MinEntropy).
+		Int("iid_results_count", len(response.IidResults)).
+		Int("non_iid_results_count", len(response.NonIidResults)).
+		Msg("AssessEntropy completed successfully")
+
+	return response, nil
+}
+
+// AssessEntropyBatch handles gRPC requests that carry several independent
+// assessments. Every entry is validated and assessed like an AssessEntropy
+// request, but all entries are handed to the C++ library in one call so
+// that small buffers are assessed concurrently. A failing entry is reported
+// in its own result and does not fail the whole batch.
+func (s *GRPCServer) AssessEntropyBatch(ctx context.Context, req *pb.Sp80090BBatchAssessmentRequest) (*pb.Sp80090BBatchAssessmentResponse, error) {
+	requestID := middleware.GetRequestID(ctx)
+
+	if req == nil || len(req.Requests) == 0 {
+		log.Error().
+			Str("request_id", requestID).
+			Msg("AssessEntropyBatch request validation failed: batch cannot be empty")
+		return nil, status.Error(codes.InvalidArgument, "batch must contain at least one request")
+	}
+
+	log.Info().
+		Str("request_id", requestID).
+		Int("batch_size", len(req.Requests)).
+		Msg("AssessEntropyBatch request received")
+
+	startTime := time.Now()
+	results := make([]*pb.Sp80090BBatchAssessmentResult, len(req.Requests))
+
+	// Each valid entry contributes one item per enabled mode; iidIndex and
+	// nonIIDIndex locate them in items, or hold -1 if the mode is disabled.
+	items := make([]entropy.BatchItem, 0, 2*len(req.Requests))
+	iidIndex := make([]int, len(req.Requests))
+	nonIIDIndex := make([]int, len(req.Requests))
+	for i, r := range req.Requests {
+		iidIndex[i], nonIIDIndex[i] = -1, -1
+		if r == nil {
+			results[i] = &pb.Sp80090BBatchAssessmentResult{Error: "request cannot be nil"}
+			continue
+		}
+		if err := validateAssessmentRequest("AssessEntropyBatch", requestID, r); err != nil {
+			results[i] = &pb.Sp80090BBatchAssessmentResult{Error: status.Convert(err).Message()}
+			continue
+		}
+
+		testType := requestTestType(r)
+		metrics.RecordRequest(testType)
+		metrics.RecordDataSize(testType, len(r.Data))
+
+		bits := int(r.BitsPerSymbol)
+		if r.IidMode {
+			iidIndex[i] = len(items)
+			items = append(items, entropy.BatchItem{Data: r.Data, BitsPerSymbol: bits, TestType: entropy.IID})
+		}
+		if r.NonIidMode {
+			nonIIDIndex[i] = len(items)
+			items = append(items, entropy.BatchItem{Data: r.Data, BitsPerSymbol: bits, TestType: entropy.NonIID})
+		}
+	}
+
+	batch := s.svc.AssessBatch(ctx, items)
+	if err := ctx.Err(); err != nil {
+		// The client is gone or out of time, so per-entry results are moot
+		log.Warn().
+			Str("request_id", requestID).
+			Err(err).
+			Msg("AssessEntropyBatch abandoned")
+		return nil, status.FromContextError(err).Err()
+	}
+
+	failed := 0
+	for i, r := range req.Requests {
+		if results[i] != nil {
+			failed++
+			continue
+		}
+
+		testType := requestTestType(r)
+		var iidRes, nonIIDRes *entropy.Result
+		var errMsg string
+		if j := iidIndex[i]; j >= 0 {
+			if batch[j].Err != nil {
+				metrics.RecordError("IID", assessmentErrorType("IID", batch[j].Err))
+				errMsg = fmt.Sprintf("IID assessment failed: %v", batch[j].Err)
+			}
+			iidRes = batch[j].Result
+			recordEstimatorMetrics(iidRes)
+		}
+		if j := nonIIDIndex[i]; j >= 0 && errMsg == "" {
+			if batch[j].Err != nil {
+				metrics.RecordError("Non-IID", assessmentErrorType("Non-IID", batch[j].Err))
+				errMsg = fmt.Sprintf("Non-IID assessment failed: %v", batch[j].Err)
+			}
+			nonIIDRes = batch[j].Result
+			recordEstimatorMetrics(nonIIDRes)
+		}
+
+		if errMsg != "" {
+			metrics.RecordDuration(testType, time.Since(startTime).Seconds())
+			results[i] = &pb.Sp80090BBatchAssessmentResult{Error: errMsg}
+			failed++
+			continue
+		}
+
+		response, finite := buildAssessmentResponse(len(r.Data), r.BitsPerSymbol, iidRes, nonIIDRes)
+		if finite {
+			metrics.RecordMinEntropy(testType, response.MinEntropy)
+		}
+		metrics.RecordDuration(testType, time.Since(startTime).Seconds())
+		results[i] = &pb.Sp80090BBatchAssessmentResult{Response: response}
+	}
+
+	log.Info().
+		Str("request_id", requestID).
+		Int64("execution_time_ms", time.Since(startTime).Milliseconds()).
+		Int("batch_size", len(req.Requests)).
+		Int("failed_count", failed).
+		Msg("AssessEntropyBatch completed")
+
+	return &pb.Sp80090BBatchAssessmentResponse{Results: results}, nil
+}
+
+// AssessEntropyStream handles client-streaming Non-IID assessments. The
+// samples arrive in chunks, which are handed to the C++ library as they come
+// in instead of being assembled into one message, so a capture is not bound
+// by the gRPC message size limit, only by the maximum stream size of the
+// service. bits_per_symbol is taken from the first chunk. The estimators run
+// once the client closes the stream.
+func (s *GRPCServer) AssessEntropyStream(stream pb.Sp80090BAssessmentService_AssessEntropyStreamServer) error {
+	ctx := stream.Context()
+	requestID := middleware.GetRequestID(ctx)
+
+	chunk, err := stream.Recv()
+	if errors.Is(err, io.EOF) {
+		log.Error().
+			Str("request_id", requestID).
+			Msg("AssessEntropyStream request validation failed: data cannot be empty")
+		return status.Error(codes.InvalidArgument, "data cannot be empty")
+	}
+	if err != nil {
+		return err
+	}
+
+	bitsPerSymbol := chunk.BitsPerSymbol
+	if bitsPerSymbol > 8 {
+		log.Error().
+			Str("request_id", requestID).
+			Uint32("bits_per_symbol", bitsPerSymbol).
+			Msg("AssessEntropyStream request validation failed: bits_per_symbol out of range")
+		return status.Errorf(codes.InvalidArgument, "bits_per_symbol must be between 0 and 8, got %d", bitsPerSymbol)
+	}
+
+	assessment, err := s.svc.NewNonIIDStream(int(bitsPerSymbol))
+	if err != nil {
+		return assessmentStatus(ctx, "Non-IID", err)
+	}
+	defer assessment.Close()
+
+	startTime := time.Now()
+	chunks := 0
+	for {
+		if err := assessment.Feed(chunk.Data); err != nil {
+			log.Error().
+				Str("request_id", requestID).
+				Int("sample_count", assessment.Len()).
+				Err(err).
+				Msg("AssessEntropyStream upload rejected")
+			if errors.Is(err, ErrStreamTooLarge) {
+				return status.Error(codes.ResourceExhausted, err.Error())
+			}
+			return assessmentStatus(ctx, "Non-IID", err)
+		}
+		chunks++
+
+		chunk, err = stream.Recv()
+		if errors.Is(err, io.EOF) {
+			break
+		}
+		if err != nil {
+			return err
+		}
+	}
+
+	log.Info().
+		Str("request_id", requestID).
+		Int("sample_count", assessment.Len()).
+		Int("chunk_count", chunks).
+		Uint32("bits_per_symbol", bitsPerSymbol).
+		Int64("upload_time_ms", time.Since(startTime).Milliseconds()).
+		Msg("AssessEntropyStream request received")
+
+	if assessment.Len() == 0 {
+		log.Error().
+			Str("request_id", requestID).
+			Msg("AssessEntropyStream request validation failed: data cannot be empty")
+		return status.Error(codes.InvalidArgument, "data cannot be empty")
+	}
+
+	const testType = "Non-IID"
+	startTime = time.Now()
+	metrics.RecordRequest(testType)
+	metrics.RecordDataSize(testType, assessment.Len())
+
+	res, err := assessment.Finish(ctx)
+	if err != nil {
+		metrics.RecordError("Non-IID", assessmentErrorType("Non-IID", err))
+		metrics.RecordDuration(testType, time.Since(startTime).Seconds())
+		return assessmentStatus(ctx, "Non-IID", err)
+	}
+	recordEstimatorMetrics(res)
+
+	response, finite := buildAssessmentResponse(assessment.Len(), bitsPerSymbol, nil, res)
+	if finite {
+		metrics.RecordMinEntropy(testType, response.MinEntropy)
+	}
+	metrics.RecordDuration(testType, time.Since(startTime).Seconds())
+
+	log.Info().
+		Str("request_id", requestID).
+		Int64("execution_time_ms", time.Since(startTime).Milliseconds()).
+		Float64("min_entropy", response.MinEntropy).
+		Int("non_iid_results_count", len(response.NonIidResults)).
+		Msg("AssessEntropyStream completed successfully")
+
+	return stream.SendAndClose(response)
+}
+
+// RunPermutationShard handles the shards of permutation test rounds that a
+// coordinating server hands out for its IID assessments. The data is sent
+// with the first shard of an assessment and named by data_sha256 in later
+// ones; a shard naming data the server no longer holds fails with
+// FailedPrecondition, and the coordinator resends it with the data.
+func (s *GRPCServer) RunPermutationShard(ctx context.Context, req *pb.Sp80090BPermutationShardRequest) (*pb.Sp80090BPermutationShardResponse, error) {
+	requestID := middleware.GetRequestID(ctx)
+
+	if err := validatePermutationShardRequest(requestID, req); err != nil {
+		return nil, err
+	}
+
+	shard := entropy.PermutationShard{
+		FirstStream: int(req.FirstStream),
+		StreamCount: int(req.StreamCount),
+	}
+	copy(shard.Seed[:], req.Seed)
+	copy(shard.Decided[:], req.Decided)
+
+	startTime := time.Now()
+	tally, err := s.svc.RunPermutationShard(ctx, req.Data, req.DataSha256, int(req.BitsPerSymbol), shard)
+	if errors.Is(err, ErrShardDataMissing) {
+		return nil, status.Error(codes.FailedPrecondition, err.Error())
+	}
+	if err != nil {
+		return nil, assessmentStatus(ctx, "Permutation shard", err)
+	}
+
+	log.Debug().
+		Str("request_id", requestID).
+		Uint32("first_stream", req.FirstStream).
+		Uint32("stream_count", req.StreamCount).
+		Uint64("permutations_executed", tally.Executed).
+		Int64("execution_time_ms", time.Since(startTime).Milliseconds()).
+		Msg("RunPermutationShard completed")
+
+	resp := &pb.Sp80090BPermutationShardResponse{
+		Greater:              make([]uint32, entropy.PermutationStatistics),
+		Equal:                make([]uint32, entropy.PermutationStatistics),
+		Less:                 make([]uint32, entropy.PermutationStatistics),
+		PermutationsExecuted: tally.Executed,
+	}
+	for i, c := range tally.Counts {
+		resp.Greater[i], resp.Equal[i], resp.Less[i] = uint32(c[0]), uint32(c[1]), uint32(c[2])
+	}
+	return resp, nil
+}
+
+// validatePermutationShardRequest checks the fields of a shard request and
+// returns an InvalidArgument status error describing the first problem.
+func validatePermutationShardRequest(requestID string, req *pb.Sp80090BPermutationShardRequest) error {
+	var msg string
+	switch {
+	case req == nil:
+		msg = "request cannot be nil"
+	case len(req.Data) == 0 && len(req.DataSha256) != sha256.Size:
+		msg = "either data or a 32-byte data_sha256 is required"
+	case req.BitsPerSymbol > 8:
+		msg = fmt.Sprintf("bits_per_symbol must be between 0 and 8, got %d", req.BitsPerSymbol)
+	case len(req.Seed) != len(entropy.PermutationSeed{}):
+		msg = fmt.Sprintf("seed must hold %d words, got %d", len(entropy.PermutationSeed{}), len(req.Seed))
+	case req.StreamCount < 1 || req.FirstStream >= entropy.PermutationStreams ||
+		req.StreamCount > entropy.PermutationStreams-req.FirstStream:
+		msg = fmt.Sprintf("streams %d to %d are out of range", req.FirstStream, req.FirstStream+req.StreamCount-1)
+	case len(req.Decided) != 0 && len(req.Decided) != entropy.PermutationStatistics:
+		msg = fmt.Sprintf("decided must be empty or hold %d flags, got %d", entropy.PermutationStatistics, len(req.Decided))
+	default:
+		return nil
+	}
+
+	log.Error().
+		Str("request_id", requestID).
+		Msg("RunPermutationShard request validation failed: " + msg)
+	return status.Error(codes.InvalidArgument, msg)
+}
+
+// assessmentStatus converts an assessment failure into a gRPC status error.
+// Assessments abandoned because the client cancelled or its deadline passed
+// report the status of ctx; any other failure is an invalid argument.
+func assessmentStatus(ctx context.Context, mode string, err error) error {
+	if errors.Is(err, entropy.ErrCancelled) {
+		if ctxErr := ctx.Err(); ctxErr != nil {
+			return status.FromContextError(ctxErr).Err()
+		}
+		return status.Errorf(codes.DeadlineExceeded, "%s assessment failed: %v", mode, err)
+	}
+	return status.Errorf(codes.InvalidArgument, "%s assessment failed: %v", mode, err)
+}
+
+// assessmentErrorType classifies an assessment failure for the error metric.
+func assessmentErrorType(mode string, err error) string {
+	if errors.Is(err, entropy.ErrCancelled) {
+		return mode + " assessment cancelled"
+	}
+	return mode + " assessment failed"
+}
+
+// validateAssessmentRequest checks the fields of a non-nil assessment request
+// and returns an InvalidArgument status error describing the first problem.
+// Failures are logged on behalf of the named method.
+func validateAssessmentRequest(method, requestID string, req *pb.Sp80090BAssessmentRequest) error {
 	if len(req.Data) == 0 {
 		log.Error().
 			Str("request_id", requestID).
-			Msg("AssessEntropy request validation failed: data cannot be empty")
-		return nil, status.Error(codes.InvalidArgument, "data cannot be empty")
+			Msg(method + " request validation failed: data cannot be empty")
+		return status.Error(codes.InvalidArgument, "data cannot be empty")
 	}
 
 	if req.BitsPerSymbol > 8 {
 		log.Error().
 			Str("request_id", requestID).
 			Uint32("bits_per_symbol", req.BitsPerSymbol).
-			Msg("AssessEntropy request validation failed: bits_per_symbol out of range")
-		return nil, status.Errorf(codes.InvalidArgument, "bits_per_symbol must be between 0 and 8, got %d", req.BitsPerSymbol)
+			Msg(method + " request validation failed: bits_per_symbol out of range")
+		return status.Errorf(codes.InvalidArgument, "bits_per_symbol must be between 0 and 8, got %d", req.BitsPerSymbol)
 	}
 
 	if !req.IidMode && !req.NonIidMode {
 		log.Error().
 			Str("request_id", requestID).
-			Msg("AssessEntropy request validation failed: no assessment mode selected")
-		return nil, status.Error(codes.InvalidArgument, "either iid_mode or non_iid_mode must be enabled")
+			Msg(method + " request validation failed: no assessment mode selected")
+		return status.Error(codes.InvalidArgument, "either iid_mode or non_iid_mode must be enabled")
 	}
 
-	testType := "mixed"
+	return nil
+}
+
+// requestTestType returns the metrics label for the modes a request enables.
+func requestTestType(req *pb.Sp80090BAssessmentRequest) string {
 	if req.IidMode && !req.NonIidMode {
-		testType = "IID"
+		return "IID"
 	} else if req.NonIidMode && !req.IidMode {
-		testType = "Non-IID"
+		return "Non-IID"
 	}
-	startTime := time.Now()
-	metrics.RecordRequest(testType)
-	metrics.RecordDataSize(testType, len(req.Data))
+	return "mixed"
+}
 
-	bits := int(req.BitsPerSymbol)
+// buildAssessmentResponse combines the IID and Non-IID results of a request
+// for sampleCount samples of bitsPerSymbol bits, either of which may be nil
+// when its mode is disabled, into the response message. An overall
+// min-entropy of infinity is reported as zero; the returned flag tells
+// whether the min-entropy was finite.
+func buildAssessmentResponse(sampleCount int, bitsPerSymbol uint32, iidRes, nonIIDRes *entropy.Result) (*pb.Sp80090BAssessmentResponse, bool) {
 	var iidResults []*pb.Sp80090BEstimatorResult
 	var nonIIDResults []*pb.Sp80090BEstimatorResult
 	minEntropy := math.Inf(1)
 	var usedBits uint32
 
-	// IID path
-	if req.IidMode {
-		res, err := s.svc.AssessIID(req.Data, bits)
-		if err != nil {
-			metrics.RecordError("IID", "IID assessment failed")
-			metrics.RecordDuration(testType, time.Since(startTime).Seconds())
-			return nil, status.Errorf(codes.InvalidArgument, "IID assessment failed: %v", err)
-		}
-		minEntropy = math.Min(minEntropy, res.MinEntropy)
-		usedBits = uint32(res.DataWordSize)
-		iidResults = convertEstimatorsToProto(res.Estimators)
+	if iidRes != nil {
+		minEntropy = math.Min(minEntropy, iidRes.MinEntropy)
+		usedBits = uint32(iidRes.DataWordSize)
+		iidResults = convertEstimatorsToProto(iidRes.Estimators)
 	}
 
-	// Non-IID path
-	if req.NonIidMode {
-		res, err := s.svc.AssessNonIID(req.Data, bits)
-		if err != nil {
-			metrics.RecordError("Non-IID", "Non-IID assessment failed")
-			metrics.RecordDuration(testType, time.Since(startTime).Seconds())
-			return nil, status.Errorf(codes.InvalidArgument, "Non-IID assessment failed: %v", err)
-		}
-		minEntropy = math.Min(minEntropy, res.MinEntropy)
-		usedBits = uint32(res.DataWordSize)
-		nonIIDResults = convertEstimatorsToProto(res.Estimators)
+	if nonIIDRes != nil {
+		minEntropy = math.Min(minEntropy, nonIIDRes.MinEntropy)
+		usedBits = uint32(nonIIDRes.DataWordSize)
+		nonIIDResults = convertEstimatorsToProto(nonIIDRes.Estimators)
 	}
 
 	if usedBits == 0 {
-		usedBits = req.BitsPerSymbol
+		usedBits = bitsPerSymbol
 	}
 
-	if !math.IsInf(minEntropy, 1) {
-		metrics.RecordMinEntropy(testType, minEntropy)
-	} else {
+	finite := !math.IsInf(minEntropy, 1)
+	if !finite {
 		minEntropy = 0
 	}
-	metrics.RecordDuration(testType, time.Since(startTime).Seconds())
 
-	response := &pb.Sp80090BAssessmentResponse{
+	return &pb.Sp80090BAssessmentResponse{
 		MinEntropy:        minEntropy,
 		IidResults:        iidResults,
 		NonIidResults:     nonIIDResults,
 		Passed:            true,
 		AssessmentSummary: "NIST SP 800-90B entropy assessment completed",
-		SampleCount:       uint64(len(req.Data)),
+		SampleCount:       uint64(sampleCount),
 		BitsPerSymbol:     usedBits,
+	}, finite
+}
+
+// recordEstimatorMetrics records the per-estimator instrumentation of an
+// assessment result, if it carries any (see entropy.SetInstrumentation).
+func recordEstimatorMetrics(res *entropy.Result) {
+	if res == nil {
+		return
 	}
 
-	log.Info().
-		Str("request_id", requestID).
-		Int64("execution_time_ms", time.Since(startTime).Milliseconds()).
-		Float64("min_entropy", response.MinEntropy).
-		Int("iid_results_count", len(response.IidResults)).
-		Int("non_iid_results_count", len(response.NonIidResults)).
-		Msg("AssessEntropy completed successfully")
+	testType := res.TestType.String()
+	for _, est := range res.Estimators {
+		if est.Stats == nil {
+			continue
+		}
+		metrics.RecordEstimatorStats(testType, est.Name, est.Stats.WallSeconds, est.Stats.CPUSeconds, est.Stats.PeakBytes, est.Stats.Iterations)
+	}
 
-	return response, nil
+	if res.Permutation != nil {
+		for statistic, round := range res.Permutation.DecidedAt {
+			if round >= 0 {
+				metrics.RecordPermutationDecision(statistic, round)
+			}
+		}
+	}
 }
 
 // convertEstimatorsToProto maps internal EstimatorResult values to their
@@ -4,13 +4,19 @@ package service
 
 import (
 	"context"
+	"crypto/sha256"
+	"io"
 	"testing"
 
+	"github.com/prometheus/client_golang/prometheus/testutil"
 	"github.com/stretchr/testify/assert"
 	"github.com/stretchr/testify/require"
+	"google.golang.org/grpc"
 	"google.golang.org/grpc/codes"
 	"google.golang.org/grpc/status"
 
+	"github.com/AmmannChristian/nist-800-90b/internal/entropy"
+	"github.com/AmmannChristian/nist-800-90b/internal/metrics"
 	pb "github.com/AmmannChristian/nist-800-90b/pkg/pb"
 )
 
@@ -105,6 +111,105 @@ func TestAssessEntropyNonIIDError(t *testing.T) {
 	assert.Contains(t, st.Message(), "Non-IID assessment failed")
 }
 
+func TestAssessEntropyCancelled(t *testing.T) {
+	server := NewGRPCServer(NewService())
+	ctx, cancel := context.WithCancel(context.Background())
+	cancel()
+
+	_, err := server.AssessEntropy(ctx, &pb.Sp80090BAssessmentRequest{
+		Data:          []byte{1, 2, 3, 4},
+		BitsPerSymbol: 8,
+		IidMode:       true,
+		NonIidMode:    false,
+	})
+	require.Error(t, err)
+	st, _ := status.FromError(err)
+	assert.Equal(t, codes.Canceled, st.Code())
+
+	_, err = server.AssessEntropyBatch(ctx, &pb.Sp80090BBatchAssessmentRequest{
+		Requests: []*pb.Sp80090BAssessmentRequest{
+			{Data: []byte{1, 2, 3, 4}, BitsPerSymbol: 8, NonIidMode: true},
+		},
+	})
+	require.Error(t, err)
+	st, _ = status.FromError(err)
+	assert.Equal(t, codes.Canceled, st.Code())
+}
+
+// fakeChunkStream is an AssessEntropyStream server stream that replays chunks.
+type fakeChunkStream struct {
+	grpc.ServerStream
+	ctx      context.Context
+	chunks   []*pb.Sp80090BStreamChunk
+	response *pb.Sp80090BAssessmentResponse
+}
+
+func (f *fakeChunkStream) Context() context.Context {
+	return f.ctx
+}
+
+func (f *fakeChunkStream) Recv() (*pb.Sp80090BStreamChunk, error) {
+	if len(f.chunks) == 0 {
+		return nil, io.EOF
+	}
+	chunk := f.chunks[0]
+	f.chunks = f.chunks[1:]
+	return chunk, nil
+}
+
+func (f *fakeChunkStream) SendAndClose(resp *pb.Sp80090BAssessmentResponse) error {
+	f.response = resp
+	return nil
+}
+
+func TestAssessEntropyStream(t *testing.T) {
+	server := NewGRPCServer(NewService())
+
+	stream := &fakeChunkStream{ctx: context.Background(), chunks: []*pb.Sp80090BStreamChunk{
+		{Data: []byte{1, 2}, BitsPerSymbol: 8},
+		{Data: []byte{3, 4, 5}, BitsPerSymbol: 4}, // Only the first chunk sets the word size
+	}}
+	require.NoError(t, server.AssessEntropyStream(stream))
+	require.NotNil(t, stream.response)
+	assert.Equal(t, 6.5, stream.response.MinEntropy)
+	assert.Len(t, stream.response.NonIidResults, 10)
+	assert.Empty(t, stream.response.IidResults)
+	assert.Equal(t, uint64(5), stream.response.SampleCount)
+	assert.Equal(t, uint32(8), stream.response.BitsPerSymbol)
+}
+
+func TestAssessEntropyStreamErrors(t *testing.T) {
+	svc := NewService()
+	svc.SetMaxStreamSize(4)
+	server := NewGRPCServer(svc)
+	cancelled, cancel := context.WithCancel(context.Background())
+	cancel()
+
+	tests := []struct {
+		name   string
+		ctx    context.Context
+		chunks []*pb.Sp80090BStreamChunk
+		code   codes.Code
+	}{
+		{"no chunks", context.Background(), nil, codes.InvalidArgument},
+		{"empty chunks", context.Background(), []*pb.Sp80090BStreamChunk{{BitsPerSymbol: 8}, {}}, codes.InvalidArgument},
+		{"bits out of range", context.Background(), []*pb.Sp80090BStreamChunk{{Data: []byte{1}, BitsPerSymbol: 9}}, codes.InvalidArgument},
+		{"too large", context.Background(), []*pb.Sp80090BStreamChunk{{Data: []byte{1, 2, 3}}, {Data: []byte{4, 5}}}, codes.ResourceExhausted},
+		{"assessment error", context.Background(), []*pb.Sp80090BStreamChunk{{Data: []byte{0xFF, 1}}}, codes.InvalidArgument},
+		{"cancelled", cancelled, []*pb.Sp80090BStreamChunk{{Data: []byte{1, 2}}}, codes.Canceled},
+	}
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			stream := &fakeChunkStream{ctx: tt.ctx, chunks: tt.chunks}
+			err := server.AssessEntropyStream(stream)
+			require.Error(t, err)
+			assert.Equal(t, tt.code, status.Code(err))
+			assert.Nil(t, stream.response)
+		})
+	}
+}
+
 func TestAssessEntropyInfinityFallback(t *testing.T) {
 	server := NewGRPCServer(NewService())
 
@@ -118,3 +223,139 @@ func TestAssessEntropyInfinityFallback(t *testing.T) {
 	assert.Equal(t, float64(0), resp.MinEntropy)
 	assert.Equal(t, uint32(8), resp.BitsPerSymbol)
 }
+
+func TestAssessEntropyBatchStub(t *testing.T) {
+	server := NewGRPCServer(NewService())
+	data := []byte{1, 2, 3, 4}
+
+	resp, err := server.AssessEntropyBatch(context.Background(), &pb.Sp80090BBatchAssessmentRequest{
+		Requests: []*pb.Sp80090BAssessmentRequest{
+			{Data: data, BitsPerSymbol: 8, IidMode: true},
+			{Data: data, BitsPerSymbol: 8, NonIidMode: true},
+			{Data: data, BitsPerSymbol: 8, IidMode: true, NonIidMode: true},
+			{Data: []byte{0xFF, 1, 2}, BitsPerSymbol: 8, NonIidMode: true},
+			{Data: data, BitsPerSymbol: 8},
+			nil,
+		},
+	})
+	require.NoError(t, err)
+	require.Len(t, resp.Results, 6)
+
+	assert.Empty(t, resp.Results[0].Error)
+	assert.Len(t, resp.Results[0].Response.IidResults, 4)
+	assert.Len(t, resp.Results[0].Response.NonIidResults, 0)
+	assert.Equal(t, 7.5, resp.Results[0].Response.MinEntropy)
+
+	assert.Empty(t, resp.Results[1].Error)
+	assert.Len(t, resp.Results[1].Response.NonIidResults, 10)
+	assert.Equal(t, 6.5, resp.Results[1].Response.MinEntropy)
+
+	// Mixed mode takes the minimum of both modes
+	assert.Empty(t, resp.Results[2].Error)
+	assert.Len(t, resp.Results[2].Response.IidResults, 4)
+	assert.Len(t, resp.Results[2].Response.NonIidResults, 10)
+	assert.Equal(t, 6.5, resp.Results[2].Response.MinEntropy)
+
+	// Failing entries do not fail the batch
+	assert.Nil(t, resp.Results[3].Response)
+	assert.Contains(t, resp.Results[3].Error, "Non-IID assessment failed")
+	assert.Contains(t, resp.Results[4].Error, "either iid_mode or non_iid_mode must be enabled")
+	assert.Contains(t, resp.Results[5].Error, "request cannot be nil")
+}
+
+func TestAssessEntropyRecordsEstimatorMetrics(t *testing.T) {
+	server := NewGRPCServer(NewService())
+	metrics.EstimatorDurationSeconds.Reset()
+	metrics.PermutationDecisionRound.Reset()
+
+	entropy.SetInstrumentation(true)
+	defer entropy.SetInstrumentation(false)
+
+	_, err := server.AssessEntropy(context.Background(), &pb.Sp80090BAssessmentRequest{
+		Data:          []byte{1, 2, 3, 4},
+		BitsPerSymbol: 8,
+		IidMode:       true,
+		NonIidMode:    true,
+	})
+	require.NoError(t, err)
+	assert.Equal(t, 14, testutil.CollectAndCount(metrics.EstimatorDurationSeconds)) // 4 IID + 10 Non-IID
+	assert.Equal(t, 1, testutil.CollectAndCount(metrics.PermutationDecisionRound))  // undecided statistics are skipped
+}
+
+func TestRunPermutationShard(t *testing.T) {
+	server := NewGRPCServer(NewService())
+	data := []byte{1, 2, 3, 4}
+	digest := sha256.Sum256(data)
+	req := &pb.Sp80090BPermutationShardRequest{
+		DataSha256:    digest[:],
+		BitsPerSymbol: 8,
+		Seed:          []uint64{1, 2, 3, 4},
+		FirstStream:   60,
+		StreamCount:   4,
+	}
+
+	// The data has not been sent yet
+	_, err := server.RunPermutationShard(context.Background(), req)
+	assert.Equal(t, codes.FailedPrecondition, status.Code(err))
+
+	req.Data = data
+	resp, err := server.RunPermutationShard(context.Background(), req)
+	require.NoError(t, err)
+	require.Len(t, resp.Greater, entropy.PermutationStatistics)
+	assert.Equal(t, uint32(8), resp.Greater[0])
+	assert.Equal(t, uint32(4), resp.Equal[0])
+	assert.Equal(t, uint32(8), resp.Less[0])
+	assert.Equal(t, uint64(20), resp.PermutationsExecuted)
+
+	req.Data = nil
+	req.Decided = make([]bool, entropy.PermutationStatistics)
+	req.Decided[18] = true
+	resp, err = server.RunPermutationShard(context.Background(), req)
+	require.NoError(t, err)
+	assert.Equal(t, uint32(8), resp.Greater[0])
+	assert.Equal(t, uint32(0), resp.Greater[18])
+
+	req.Data = []byte{0xFF, 1, 2, 3}
+	_, err = server.RunPermutationShard(context.Background(), req)
+	assert.Equal(t, codes.InvalidArgument, status.Code(err))
+}
+
+func TestRunPermutationShardValidation(t *testing.T) {
+	server := NewGRPCServer(NewService())
+	valid := func() *pb.Sp80090BPermutationShardRequest {
+		return &pb.Sp80090BPermutationShardRequest{
+			Data:          []byte{1, 2, 3, 4},
+			BitsPerSymbol: 8,
+			Seed:          []uint64{1, 2, 3, 4},
+			FirstStream:   0,
+			StreamCount:   1,
+		}
+	}
+
+	tests := []struct {
+		name   string
+		mutate func(*pb.Sp80090BPermutationShardRequest)
+		errMsg string
+	}{
+		{"no data", func(r *pb.Sp80090BPermutationShardRequest) { r.Data = nil }, "data_sha256"},
+		{"short digest", func(r *pb.Sp80090BPermutationShardRequest) { r.Data, r.DataSha256 = nil, []byte{1} }, "data_sha256"},
+		{"bits", func(r *pb.Sp80090BPermutationShardRequest) { r.BitsPerSymbol = 9 }, "bits_per_symbol"},
+		{"seed", func(r *pb.Sp80090BPermutationShardRequest) { r.Seed = r.Seed[:3] }, "seed"},
+		{"no streams", func(r *pb.Sp80090BPermutationShardRequest) { r.StreamCount = 0 }, "out of range"},
+		{"streams past end", func(r *pb.Sp80090BPermutationShardRequest) { r.FirstStream, r.StreamCount = 60, 5 }, "out of range"},
+		{"decided", func(r *pb.Sp80090BPermutationShardRequest) { r.Decided = []bool{true} }, "decided"},
+	}
+
+	_, err := server.RunPermutationShard(context.Background(), nil)
+	assert.Equal(t, codes.InvalidArgument, status.Code(err))
+
+	for _, tt := range tests {
+		t.Run(tt.name, func(t *testing.T) {
+			req := valid()
+			tt.mutate(req)
+			_, err := server.RunPermutationShard(context.Background(), req)
+			assert.Equal(t, codes.InvalidArgument, status.Code(err))
+			assert.Contains(t, err.Error(), tt.errMsg)
+		})
+	}
+}
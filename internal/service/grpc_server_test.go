@@ -65,6 +65,30 @@ func TestAssessEntropyValidation(t *testing.T) {
 	}
 }
 
+func TestAssessEntropyBatchValidation(t *testing.T) {
+	server := NewGRPCServer(NewService())
+
+	for _, req := range []*pb.Sp80090BBatchAssessmentRequest{nil, {}} {
+		_, err := server.AssessEntropyBatch(context.Background(), req)
+		if assert.Error(t, err) {
+			st, _ := status.FromError(err)
+			assert.Equal(t, codes.InvalidArgument, st.Code())
+		}
+	}
+
+	// Entries failing validation are reported per entry
+	resp, err := server.AssessEntropyBatch(context.Background(), &pb.Sp80090BBatchAssessmentRequest{
+		Requests: []*pb.Sp80090BAssessmentRequest{
+			{Data: []byte{}, IidMode: true, BitsPerSymbol: 8},
+			{Data: []byte{1, 2, 3}, IidMode: true, BitsPerSymbol: nineBits()},
+		},
+	})
+	if assert.NoError(t, err) && assert.Len(t, resp.Results, 2) {
+		assert.Equal(t, "data cannot be empty", resp.Results[0].Error)
+		assert.Contains(t, resp.Results[1].Error, "bits_per_symbol")
+	}
+}
+
 // nineBits returns a uint32 value exceeding the valid bits-per-symbol range,
 // used to avoid a compile-time constant overflow warning in test literals.
 func nineBits() uint32 {
@@ -0,0 +1,361 @@
+package service
+
+import (
+	"bytes"
+	"context"
+	"crypto/sha256"
+	"errors"
+	"fmt"
+	"sync"
+
+	"github.com/rs/zerolog/log"
+	"google.golang.org/grpc/codes"
+	"google.golang.org/grpc/status"
+
+	"github.com/AmmannChristian/nist-800-90b/internal/entropy"
+	pb "github.com/AmmannChristian/nist-800-90b/pkg/pb"
+)
+
+// ErrWorkerUnavailable is wrapped by the errors of a PermutationWorker that
+// could not run a shard for reasons unrelated to the data, such as an
+// unreachable server. The coordinator hands the shard to another worker.
+var ErrWorkerUnavailable = errors.New("permutation worker unavailable")
+
+// ErrShardDataMissing is returned by RunPermutationShard when a request
+// identifies its data by digest only and the data is not held by the server.
+var ErrShardDataMissing = errors.New("shard data is not cached, resend it")
+
+// shardDataEntries is the number of captures RunPermutationShard keeps, so
+// that the later shards of an assessment need not carry the data again.
+const shardDataEntries = 2
+
+// PermutationJob is the data of an IID assessment whose permutation test
+// rounds are distributed.
+type PermutationJob struct {
+	Data          []byte
+	Digest        [sha256.Size]byte // SHA-256 of Data
+	BitsPerSymbol int
+}
+
+// NewPermutationJob creates the job of the assessment of data.
+func NewPermutationJob(data []byte, bitsPerSymbol int) *PermutationJob {
+	return &PermutationJob{
+		Data:          data,
+		Digest:        sha256.Sum256(data),
+		BitsPerSymbol: bitsPerSymbol,
+	}
+}
+
+// PermutationWorker runs shards of permutation test rounds for a
+// PermutationCoordinator. Implementations must be safe for concurrent use.
+type PermutationWorker interface {
+	// Name identifies the worker in logs.
+	Name() string
+
+	// RunShard returns the tally of the rounds selected by shard. Failures
+	// that say nothing about the data wrap ErrWorkerUnavailable.
+	RunShard(ctx context.Context, job *PermutationJob, shard entropy.PermutationShard) (*entropy.PermutationTally, error)
+}
+
+// localPermutationWorker runs shards in this process.
+type localPermutationWorker struct {
+	assessment *entropy.Assessment
+}
+
+// LocalPermutationWorker returns a worker that runs shards in this process
+// with the thread limit of the service.
+func (s *EntropyService) LocalPermutationWorker() PermutationWorker {
+	return &localPermutationWorker{assessment: s.assessment}
+}
+
+func (w *localPermutationWorker) Name() string {
+	return "local"
+}
+
+func (w *localPermutationWorker) RunShard(ctx context.Context, job *PermutationJob, shard entropy.PermutationShard) (*entropy.PermutationTally, error) {
+	return w.assessment.PermutationTally(ctx, job.Data, job.BitsPerSymbol, shard)
+}
+
+// RemotePermutationWorker runs shards on another server through its
+// RunPermutationShard RPC. The data of a job is sent with the first shard
+// only; later shards name it by digest, and the data is sent again if the
+// server no longer holds it.
+type RemotePermutationWorker struct {
+	name   string
+	client pb.Sp80090BAssessmentServiceClient
+
+	mu   sync.Mutex
+	sent [sha256.Size]byte // Digest of the data last sent
+}
+
+// NewRemotePermutationWorker creates a worker calling client; name
+// identifies it in logs.
+func NewRemotePermutationWorker(name string, client pb.Sp80090BAssessmentServiceClient) *RemotePermutationWorker {
+	return &RemotePermutationWorker{
+		name:   name,
+		client: client,
+	}
+}
+
+// Name returns the name the worker was created with.
+func (w *RemotePermutationWorker) Name() string {
+	return w.name
+}
+
+// RunShard runs shard on the remote server. Every failure wraps
+// ErrWorkerUnavailable; invalid data is reported by the local worker.
+func (w *RemotePermutationWorker) RunShard(ctx context.Context, job *PermutationJob, shard entropy.PermutationShard) (*entropy.PermutationTally, error) {
+	req := &pb.Sp80090BPermutationShardRequest{
+		DataSha256:    job.Digest[:],
+		BitsPerSymbol: uint32(job.BitsPerSymbol),
+		Seed:          shard.Seed[:],
+		FirstStream:   uint32(shard.FirstStream),
+		StreamCount:   uint32(shard.StreamCount),
+		Decided:       shard.Decided[:],
+	}
+
+	w.mu.Lock()
+	if w.sent != job.Digest {
+		req.Data = job.Data
+	}
+	w.mu.Unlock()
+
+	resp, err := w.client.RunPermutationShard(ctx, req)
+	if status.Code(err) == codes.FailedPrecondition && req.Data == nil {
+		req.Data = job.Data
+		resp, err = w.client.RunPermutationShard(ctx, req)
+	}
+	if err != nil {
+		return nil, fmt.Errorf("%w: %s: %v", ErrWorkerUnavailable, w.name, err)
+	}
+
+	if req.Data != nil {
+		w.mu.Lock()
+		w.sent = job.Digest
+		w.mu.Unlock()
+	}
+
+	if len(resp.Greater) != entropy.PermutationStatistics || len(resp.Equal) != entropy.PermutationStatistics ||
+		len(resp.Less) != entropy.PermutationStatistics {
+		return nil, fmt.Errorf("%w: %s: malformed tally", ErrWorkerUnavailable, w.name)
+	}
+
+	tally := &entropy.PermutationTally{Executed: resp.PermutationsExecuted}
+	for i := range tally.Counts {
+		tally.Counts[i] = [3]int{int(resp.Greater[i]), int(resp.Equal[i]), int(resp.Less[i])}
+	}
+	return tally, nil
+}
+
+// PermutationCoordinator spreads the permutation test rounds of an IID
+// assessment over a set of workers. The PermutationStreams streams of rounds
+// are cut into shards of a fixed number of streams; every worker takes one
+// shard at a time, together with the statistics the tallies merged so far
+// already decide, so that later shards skip them. Once every statistic is
+// decided the shards still running are cancelled.
+//
+// Each stream runs the rounds the single-host assessment with the same seed
+// would run, so the merged tally passes or fails the same statistics. Which
+// rounds decide a statistic, and how many rounds run in all, can differ, as
+// they do between runs with different thread counts.
+type PermutationCoordinator struct {
+	workers         []PermutationWorker
+	streamsPerShard int
+}
+
+// NewPermutationCoordinator creates a coordinator handing shards of
+// streamsPerShard streams to workers.
+func NewPermutationCoordinator(streamsPerShard int, workers ...PermutationWorker) (*PermutationCoordinator, error) {
+	if streamsPerShard < 1 || streamsPerShard > entropy.PermutationStreams {
+		return nil, fmt.Errorf("streams per shard must be between 1 and %d, got %d", entropy.PermutationStreams, streamsPerShard)
+	}
+	if len(workers) == 0 {
+		return nil, fmt.Errorf("permutation coordinator needs at least one worker")
+	}
+
+	return &PermutationCoordinator{
+		workers:         workers,
+		streamsPerShard: streamsPerShard,
+	}, nil
+}
+
+// Run draws a seed and runs the permutation test rounds of job on the
+// workers, returning the seed and the merged tally. A shard whose worker
+// fails with ErrWorkerUnavailable is handed to another worker, and the
+// failed worker takes no further shards of this run; any other failure ends
+// the run. Run fails if no worker is left while shards remain, and with an
+// error wrapping entropy.ErrCancelled once ctx is done.
+func (c *PermutationCoordinator) Run(ctx context.Context, job *PermutationJob) (entropy.PermutationSeed, *entropy.PermutationTally, error) {
+	seed, err := entropy.NewPermutationSeed()
+	if err != nil {
+		return seed, nil, err
+	}
+
+	runCtx, cancel := context.WithCancel(ctx)
+	defer cancel()
+
+	var (
+		mu        sync.Mutex
+		cond      = sync.NewCond(&mu)
+		pending   []int // First streams of the shards not yet handed out
+		remaining int   // Shards not yet tallied
+		alive     = len(c.workers)
+		merged    = &entropy.PermutationTally{}
+		runErr    error
+		lastErr   error
+	)
+	for first := 0; first < entropy.PermutationStreams; first += c.streamsPerShard {
+		pending = append(pending, first)
+	}
+	remaining = len(pending)
+
+	// Wake the idle workers once the run is over or abandoned
+	stop := context.AfterFunc(runCtx, func() {
+		mu.Lock()
+		cond.Broadcast()
+		mu.Unlock()
+	})
+	defer stop()
+
+	finished := func() bool {
+		return remaining == 0 || runErr != nil || runCtx.Err() != nil || (len(pending) == 0 && alive == 0)
+	}
+
+	var wg sync.WaitGroup
+	for _, worker := range c.workers {
+		wg.Add(1)
+		go func(worker PermutationWorker) {
+			defer wg.Done()
+
+			mu.Lock()
+			defer mu.Unlock()
+			for {
+				for len(pending) == 0 && !finished() {
+					cond.Wait()
+				}
+				if finished() {
+					return
+				}
+
+				shard := entropy.PermutationShard{
+					Seed:        seed,
+					FirstStream: pending[0],
+					StreamCount: min(c.streamsPerShard, entropy.PermutationStreams-pending[0]),
+					Decided:     merged.Decided(),
+				}
+				pending = pending[1:]
+
+				mu.Unlock()
+				tally, err := worker.RunShard(runCtx, job, shard)
+				mu.Lock()
+
+				switch {
+				case err == nil:
+					merged.Add(tally)
+					remaining--
+					if merged.AllDecided() {
+						cancel()
+					}
+				case runCtx.Err() != nil:
+					// Decided or abandoned meanwhile; the failure is moot
+				case errors.Is(err, ErrWorkerUnavailable):
+					log.Warn().
+						Err(err).
+						Str("worker", worker.Name()).
+						Int("first_stream", shard.FirstStream).
+						Msg("Permutation worker failed, reassigning its shard")
+					pending = append(pending, shard.FirstStream)
+					lastErr = err
+					alive--
+					cond.Broadcast()
+					return
+				default:
+					runErr = err
+				}
+				cond.Broadcast()
+			}
+		}(worker)
+	}
+	wg.Wait()
+
+	if runErr != nil {
+		return seed, nil, runErr
+	}
+	if remaining > 0 && !merged.AllDecided() {
+		if err := ctx.Err(); err != nil {
+			return seed, nil, &entropy.EntropyError{Op: "PermutationCoordinator.Run", Err: entropy.ErrCancelled, Msg: err.Error()}
+		}
+		return seed, nil, fmt.Errorf("no permutation worker left for %d shards: %w", remaining, lastErr)
+	}
+	return seed, merged, nil
+}
+
+// shardDataCache holds the most recent captures sent with RunPermutationShard
+// requests, keyed by their SHA-256.
+type shardDataCache struct {
+	mu      sync.Mutex
+	entries []*PermutationJob // Most recently used first
+}
+
+// get returns the capture with the given digest.
+func (c *shardDataCache) get(digest []byte) ([]byte, bool) {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	for i, entry := range c.entries {
+		if bytes.Equal(entry.Digest[:], digest) {
+			copy(c.entries[1:i+1], c.entries[:i])
+			c.entries[0] = entry
+			return entry.Data, true
+		}
+	}
+	return nil, false
+}
+
+// put stores data under its digest, evicting the least recently used capture
+// if the cache is full.
+func (c *shardDataCache) put(digest [sha256.Size]byte, data []byte) {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	for i, entry := range c.entries {
+		if entry.Digest == digest {
+			c.entries = append(c.entries[:i], c.entries[i+1:]...)
+			break
+		}
+	}
+	if len(c.entries) == shardDataEntries {
+		c.entries = c.entries[:shardDataEntries-1]
+	}
+	c.entries = append([]*PermutationJob{{Data: data, Digest: digest}}, c.entries...)
+}
+
+// RunPermutationShard runs the permutation test rounds selected by shard on
+// behalf of a coordinating server. The data may be omitted if digest names
+// data sent with an earlier shard; ErrShardDataMissing is returned if that
+// data is no longer held. If both are given, digest must match data.
+func (s *EntropyService) RunPermutationShard(ctx context.Context, data, digest []byte, bitsPerSymbol int,
+	shard entropy.PermutationShard) (*entropy.PermutationTally, error) {
+	if bitsPerSymbol < 0 || bitsPerSymbol > 8 {
+		return nil, fmt.Errorf("bits_per_symbol must be between 0 (auto-detect) and 8, got %d", bitsPerSymbol)
+	}
+
+	if len(data) > 0 {
+		sum := sha256.Sum256(data)
+		if len(digest) > 0 && !bytes.Equal(digest, sum[:]) {
+			return nil, fmt.Errorf("data_sha256 does not match data")
+		}
+		s.shardData.put(sum, data)
+	} else {
+		var ok bool
+		if data, ok = s.shardData.get(digest); !ok {
+			return nil, ErrShardDataMissing
+		}
+	}
+
+	tally, err := s.assessment.PermutationTally(ctx, data, bitsPerSymbol, shard)
+	if err != nil {
+		return nil, fmt.Errorf("permutation shard failed: %w", err)
+	}
+	return tally, nil
+}
@@ -0,0 +1,272 @@
+//go:build teststub
+
+package service
+
+import (
+	"context"
+	"crypto/sha256"
+	"fmt"
+	"sync"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+	"google.golang.org/grpc"
+	"google.golang.org/grpc/codes"
+	"google.golang.org/grpc/status"
+
+	"github.com/AmmannChristian/nist-800-90b/internal/entropy"
+	pb "github.com/AmmannChristian/nist-800-90b/pkg/pb"
+)
+
+// recordingWorker wraps a worker and records the shards it was handed.
+type recordingWorker struct {
+	PermutationWorker
+
+	mu     sync.Mutex
+	shards []entropy.PermutationShard
+}
+
+func (w *recordingWorker) RunShard(ctx context.Context, job *PermutationJob, shard entropy.PermutationShard) (*entropy.PermutationTally, error) {
+	w.mu.Lock()
+	w.shards = append(w.shards, shard)
+	w.mu.Unlock()
+	return w.PermutationWorker.RunShard(ctx, job, shard)
+}
+
+// failingWorker fails every shard as an unreachable server would.
+type failingWorker struct {
+	mu    sync.Mutex
+	calls int
+}
+
+func (w *failingWorker) Name() string {
+	return "failing"
+}
+
+func (w *failingWorker) RunShard(context.Context, *PermutationJob, entropy.PermutationShard) (*entropy.PermutationTally, error) {
+	w.mu.Lock()
+	w.calls++
+	w.mu.Unlock()
+	return nil, fmt.Errorf("%w: connection refused", ErrWorkerUnavailable)
+}
+
+func TestPermutationCoordinator_StopsOnceDecided(t *testing.T) {
+	svc := NewService()
+	coordinator, err := NewPermutationCoordinator(4, svc.LocalPermutationWorker())
+	require.NoError(t, err)
+
+	// A stub stream adds 2/1/2 to every statistic, so one shard of four
+	// streams decides them all
+	seed, tally, err := coordinator.Run(context.Background(), NewPermutationJob([]byte{1, 2, 3, 4}, 8))
+	require.NoError(t, err)
+	assert.NotEqual(t, entropy.PermutationSeed{}, seed)
+	assert.True(t, tally.AllDecided())
+	assert.Equal(t, [3]int{8, 4, 8}, tally.Counts[0])
+	assert.Equal(t, uint64(20), tally.Executed)
+}
+
+func TestPermutationCoordinator_PassesDecidedStatistics(t *testing.T) {
+	svc := NewService()
+	worker := &recordingWorker{PermutationWorker: svc.LocalPermutationWorker()}
+	coordinator, err := NewPermutationCoordinator(1, worker)
+	require.NoError(t, err)
+
+	_, tally, err := coordinator.Run(context.Background(), NewPermutationJob([]byte{1, 2, 3, 4}, 8))
+	require.NoError(t, err)
+	assert.True(t, tally.AllDecided())
+
+	// Two single-stream shards decide every statistic; the second is handed
+	// the (empty) mask of the first
+	require.Len(t, worker.shards, 2)
+	assert.Equal(t, 0, worker.shards[0].FirstStream)
+	assert.Equal(t, 1, worker.shards[1].FirstStream)
+	assert.Equal(t, 1, worker.shards[1].StreamCount)
+	assert.Equal(t, [entropy.PermutationStatistics]bool{}, worker.shards[1].Decided)
+	assert.Equal(t, worker.shards[0].Seed, worker.shards[1].Seed)
+}
+
+func TestPermutationCoordinator_ReassignsFailedShards(t *testing.T) {
+	svc := NewService()
+	failing := &failingWorker{}
+	coordinator, err := NewPermutationCoordinator(1, failing, svc.LocalPermutationWorker())
+	require.NoError(t, err)
+
+	_, tally, err := coordinator.Run(context.Background(), NewPermutationJob([]byte{1, 2, 3, 4}, 8))
+	require.NoError(t, err)
+	assert.True(t, tally.AllDecided())
+	assert.LessOrEqual(t, failing.calls, 1)
+}
+
+func TestPermutationCoordinator_NoWorkerLeft(t *testing.T) {
+	coordinator, err := NewPermutationCoordinator(8, &failingWorker{}, &failingWorker{})
+	require.NoError(t, err)
+
+	_, _, err = coordinator.Run(context.Background(), NewPermutationJob([]byte{1, 2, 3, 4}, 8))
+	require.Error(t, err)
+	assert.ErrorIs(t, err, ErrWorkerUnavailable)
+	assert.Contains(t, err.Error(), "no permutation worker left")
+}
+
+func TestPermutationCoordinator_DataError(t *testing.T) {
+	svc := NewService()
+	coordinator, err := NewPermutationCoordinator(8, svc.LocalPermutationWorker())
+	require.NoError(t, err)
+
+	_, _, err = coordinator.Run(context.Background(), NewPermutationJob([]byte{0xFF, 1, 2, 3}, 8))
+	require.Error(t, err)
+	assert.ErrorIs(t, err, entropy.ErrInvalidData)
+}
+
+func TestPermutationCoordinator_Cancelled(t *testing.T) {
+	svc := NewService()
+	coordinator, err := NewPermutationCoordinator(8, svc.LocalPermutationWorker())
+	require.NoError(t, err)
+
+	ctx, cancel := context.WithCancel(context.Background())
+	cancel()
+	_, _, err = coordinator.Run(ctx, NewPermutationJob([]byte{1, 2, 3, 4}, 8))
+	require.Error(t, err)
+	assert.ErrorIs(t, err, entropy.ErrCancelled)
+}
+
+func TestNewPermutationCoordinator_Invalid(t *testing.T) {
+	_, err := NewPermutationCoordinator(0, &failingWorker{})
+	assert.Error(t, err)
+
+	_, err = NewPermutationCoordinator(entropy.PermutationStreams+1, &failingWorker{})
+	assert.Error(t, err)
+
+	_, err = NewPermutationCoordinator(4)
+	assert.Error(t, err)
+}
+
+func TestService_AssessIID_Distributed(t *testing.T) {
+	svc := NewService()
+	local, err := svc.AssessIID(context.Background(), []byte{1, 2, 3, 4}, 8)
+	require.NoError(t, err)
+
+	coordinator, err := NewPermutationCoordinator(4, svc.LocalPermutationWorker())
+	require.NoError(t, err)
+	svc.SetPermutationCoordinator(coordinator, 4)
+
+	res, err := svc.AssessIID(context.Background(), []byte{1, 2, 3, 4}, 8)
+	require.NoError(t, err)
+	assert.Len(t, res.PermutationSeed, 64)
+	assert.NotEqual(t, local.PermutationSeed, res.PermutationSeed)
+	for _, est := range res.Estimators {
+		if est.Name == "Permutation Tests" {
+			assert.True(t, est.Passed)
+		}
+	}
+
+	// Smaller captures are assessed in this process
+	res, err = svc.AssessIID(context.Background(), []byte{1, 2, 3}, 8)
+	require.NoError(t, err)
+	assert.Equal(t, local.PermutationSeed, res.PermutationSeed)
+}
+
+func TestService_RunPermutationShard(t *testing.T) {
+	svc := NewService()
+	data := []byte{1, 2, 3, 4}
+	digest := sha256.Sum256(data)
+	shard := entropy.PermutationShard{FirstStream: 0, StreamCount: 2}
+
+	_, err := svc.RunPermutationShard(context.Background(), nil, digest[:], 8, shard)
+	assert.ErrorIs(t, err, ErrShardDataMissing)
+
+	_, err = svc.RunPermutationShard(context.Background(), data, make([]byte, sha256.Size), 8, shard)
+	require.Error(t, err)
+	assert.Contains(t, err.Error(), "does not match")
+
+	tally, err := svc.RunPermutationShard(context.Background(), data, digest[:], 8, shard)
+	require.NoError(t, err)
+	assert.Equal(t, [3]int{4, 2, 4}, tally.Counts[0])
+
+	// Later shards name the data by digest
+	shard.Decided[0] = true
+	tally, err = svc.RunPermutationShard(context.Background(), nil, digest[:], 8, shard)
+	require.NoError(t, err)
+	assert.Equal(t, [3]int{}, tally.Counts[0])
+	assert.Equal(t, [3]int{4, 2, 4}, tally.Counts[1])
+
+	_, err = svc.RunPermutationShard(context.Background(), []byte{0xFF}, nil, 8, shard)
+	require.Error(t, err)
+	assert.Contains(t, err.Error(), "permutation shard failed")
+}
+
+func TestShardDataCache_EvictsLeastRecentlyUsed(t *testing.T) {
+	var cache shardDataCache
+	a, b, c := sha256.Sum256([]byte("a")), sha256.Sum256([]byte("b")), sha256.Sum256([]byte("c"))
+
+	cache.put(a, []byte("a"))
+	cache.put(b, []byte("b"))
+	_, ok := cache.get(a[:])
+	require.True(t, ok)
+	cache.put(c, []byte("c"))
+
+	_, ok = cache.get(b[:])
+	assert.False(t, ok)
+	data, ok := cache.get(a[:])
+	require.True(t, ok)
+	assert.Equal(t, []byte("a"), data)
+	_, ok = cache.get(c[:])
+	assert.True(t, ok)
+}
+
+// shardClient serves RunPermutationShard calls with a GRPCServer in process.
+type shardClient struct {
+	pb.Sp80090BAssessmentServiceClient
+	server *GRPCServer
+
+	mu       sync.Mutex
+	withData []bool
+}
+
+func (c *shardClient) RunPermutationShard(ctx context.Context, in *pb.Sp80090BPermutationShardRequest, _ ...grpc.CallOption) (*pb.Sp80090BPermutationShardResponse, error) {
+	c.mu.Lock()
+	c.withData = append(c.withData, len(in.Data) > 0)
+	c.mu.Unlock()
+	return c.server.RunPermutationShard(ctx, in)
+}
+
+func TestRemotePermutationWorker_SendsDataOnce(t *testing.T) {
+	client := &shardClient{server: NewGRPCServer(NewService())}
+	worker := NewRemotePermutationWorker("remote", client)
+	assert.Equal(t, "remote", worker.Name())
+
+	job := NewPermutationJob([]byte{1, 2, 3, 4}, 8)
+	shard := entropy.PermutationShard{FirstStream: 4, StreamCount: 4}
+	tally, err := worker.RunShard(context.Background(), job, shard)
+	require.NoError(t, err)
+	assert.Equal(t, [3]int{8, 4, 8}, tally.Counts[0])
+	assert.Equal(t, uint64(20), tally.Executed)
+
+	_, err = worker.RunShard(context.Background(), job, shard)
+	require.NoError(t, err)
+	assert.Equal(t, []bool{true, false}, client.withData)
+
+	// A server that lost the data is sent it again
+	client.server = NewGRPCServer(NewService())
+	_, err = worker.RunShard(context.Background(), job, shard)
+	require.NoError(t, err)
+	assert.Equal(t, []bool{true, false, false, true}, client.withData)
+}
+
+func TestRemotePermutationWorker_Unavailable(t *testing.T) {
+	worker := NewRemotePermutationWorker("remote", &unavailableClient{})
+
+	_, err := worker.RunShard(context.Background(), NewPermutationJob([]byte{1, 2, 3, 4}, 8), entropy.PermutationShard{StreamCount: 1})
+	require.Error(t, err)
+	assert.ErrorIs(t, err, ErrWorkerUnavailable)
+	assert.Contains(t, err.Error(), "remote")
+}
+
+// unavailableClient fails every call as an unreachable server would.
+type unavailableClient struct {
+	pb.Sp80090BAssessmentServiceClient
+}
+
+func (c *unavailableClient) RunPermutationShard(context.Context, *pb.Sp80090BPermutationShardRequest, ...grpc.CallOption) (*pb.Sp80090BPermutationShardResponse, error) {
+	return nil, status.Error(codes.Unavailable, "connection refused")
+}
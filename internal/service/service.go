@@ -4,15 +4,23 @@
 package service
 
 import (
+	"context"
 	"fmt"
 
 	"github.com/AmmannChristian/nist-800-90b/internal/entropy"
 )
 
 // EntropyService provides the business-logic layer for entropy assessment,
-// wrapping the lower-level Assessment with input validation.
+// wrapping the lower-level Assessment with input validation and an optional
+// result cache.
 type EntropyService struct {
-	assessment *entropy.Assessment
+	assessment    *entropy.Assessment
+	cache         *ResultCache // nil unless set with SetResultCache
+	maxStreamSize int64        // 0 unless set with SetMaxStreamSize
+
+	permutations          *PermutationCoordinator // nil unless set with SetPermutationCoordinator
+	permutationMinSamples int
+	shardData             shardDataCache // Data of the shards run for other servers
 }
 
 // NewService creates a new EntropyService with default assessment settings.
@@ -27,9 +35,40 @@ func (s *EntropyService) SetVerbose(level int) {
 	s.assessment.SetVerbose(level)
 }
 
+// SetMaxThreads limits the number of threads a single assessment may use;
+// 0 leaves each assessment its fair share of the process-wide budget.
+func (s *EntropyService) SetMaxThreads(threads int) {
+	s.assessment.SetMaxThreads(threads)
+}
+
+// SetResultCache makes the service answer repeated assessments of the same
+// data from cache. A nil cache disables caching. It must be called before the
+// service handles requests.
+func (s *EntropyService) SetResultCache(cache *ResultCache) {
+	s.cache = cache
+}
+
+// SetMaxStreamSize limits the number of bytes a NonIIDStream accepts; 0
+// disables the limit. It must be called before the service handles requests.
+func (s *EntropyService) SetMaxStreamSize(bytes int64) {
+	s.maxStreamSize = bytes
+}
+
+// SetPermutationCoordinator makes AssessIID run the permutation test rounds
+// of captures of at least minSamples samples on the workers of coordinator.
+// A nil coordinator runs every assessment in this process. It must be called
+// before the service handles requests.
+func (s *EntropyService) SetPermutationCoordinator(coordinator *PermutationCoordinator, minSamples int) {
+	s.permutations = coordinator
+	s.permutationMinSamples = minSamples
+}
+
 // AssessIID validates inputs and performs an IID entropy assessment on the
-// provided data. A bitsPerSymbol of 0 enables auto-detection.
-func (s *EntropyService) AssessIID(data []byte, bitsPerSymbol int) (*entropy.Result, error) {
+// provided data. A bitsPerSymbol of 0 enables auto-detection. The assessment
+// is abandoned with an error wrapping entropy.ErrCancelled once ctx is done.
+// With a permutation coordinator, the permutation test rounds of large
+// captures are distributed; batch assessments always run in this process.
+func (s *EntropyService) AssessIID(ctx context.Context, data []byte, bitsPerSymbol int) (*entropy.Result, error) {
 	if len(data) == 0 {
 		return nil, fmt.Errorf("data cannot be empty")
 	}
@@ -38,7 +77,12 @@ func (s *EntropyService) AssessIID(data []byte, bitsPerSymbol int) (*entropy.Res
 		return nil, fmt.Errorf("bits_per_symbol must be between 0 (auto-detect) and 8, got %d", bitsPerSymbol)
 	}
 
-	result, err := s.assessment.AssessIID(data, bitsPerSymbol)
+	assess := s.assessment.AssessIIDContext
+	if s.distributesPermutations(len(data)) {
+		assess = s.assessIIDDistributed
+	}
+
+	result, err := s.cached(ctx, data, bitsPerSymbol, entropy.IID, assess)
 	if err != nil {
 		return nil, fmt.Errorf("IID assessment failed: %w", err)
 	}
@@ -46,9 +90,26 @@ func (s *EntropyService) AssessIID(data []byte, bitsPerSymbol int) (*entropy.Res
 	return result, nil
 }
 
+// distributesPermutations reports whether AssessIID runs the permutation test
+// rounds of a capture of samples samples on the permutation coordinator.
+func (s *EntropyService) distributesPermutations(samples int) bool {
+	return s.permutations != nil && samples >= s.permutationMinSamples
+}
+
+// assessIIDDistributed runs the permutation test rounds of an IID assessment
+// on the workers of the permutation coordinator and the other tests here.
+func (s *EntropyService) assessIIDDistributed(ctx context.Context, data []byte, bitsPerSymbol int) (*entropy.Result, error) {
+	seed, tally, err := s.permutations.Run(ctx, NewPermutationJob(data, bitsPerSymbol))
+	if err != nil {
+		return nil, err
+	}
+	return s.assessment.AssessIIDWithTally(ctx, data, bitsPerSymbol, seed, tally)
+}
+
 // AssessNonIID validates inputs and performs a Non-IID entropy assessment on
-// the provided data. A bitsPerSymbol of 0 enables auto-detection.
-func (s *EntropyService) AssessNonIID(data []byte, bitsPerSymbol int) (*entropy.Result, error) {
+// the provided data. A bitsPerSymbol of 0 enables auto-detection. The
+// assessment is abandoned like that of AssessIID once ctx is done.
+func (s *EntropyService) AssessNonIID(ctx context.Context, data []byte, bitsPerSymbol int) (*entropy.Result, error) {
 	if len(data) == 0 {
 		return nil, fmt.Errorf("data cannot be empty")
 	}
@@ -57,10 +118,111 @@ func (s *EntropyService) AssessNonIID(data []byte, bitsPerSymbol int) (*entropy.
 		return nil, fmt.Errorf("bits_per_symbol must be between 0 (auto-detect) and 8, got %d", bitsPerSymbol)
 	}
 
-	result, err := s.assessment.AssessNonIID(data, bitsPerSymbol)
+	result, err := s.cached(ctx, data, bitsPerSymbol, entropy.NonIID, s.assessment.AssessNonIIDContext)
 	if err != nil {
 		return nil, fmt.Errorf("Non-IID assessment failed: %w", err)
 	}
 
 	return result, nil
 }
+
+// AssessBoth performs the IID and the Non-IID assessment of data, as
+// AssessIID and AssessNonIID do. Unless the permutation test rounds are
+// distributed, both run in one batch, so that the suffix index of the
+// samples, which each of them needs, is built only once. If the assessments
+// run one after the other, the Non-IID one is skipped once the IID one fails.
+func (s *EntropyService) AssessBoth(ctx context.Context, data []byte, bitsPerSymbol int) (iid, nonIID entropy.BatchResult) {
+	if len(data) == 0 || bitsPerSymbol < 0 || bitsPerSymbol > 8 || s.distributesPermutations(len(data)) {
+		iid.Result, iid.Err = s.AssessIID(ctx, data, bitsPerSymbol)
+		if iid.Err == nil {
+			nonIID.Result, nonIID.Err = s.AssessNonIID(ctx, data, bitsPerSymbol)
+		}
+		return iid, nonIID
+	}
+
+	results := s.AssessBatch(ctx, []entropy.BatchItem{
+		{Data: data, BitsPerSymbol: bitsPerSymbol, TestType: entropy.IID},
+		{Data: data, BitsPerSymbol: bitsPerSymbol, TestType: entropy.NonIID},
+	})
+	return results[0], results[1]
+}
+
+// cached returns the cached result of the assessment of data, or runs assess
+// and caches its result. Failed assessments are not cached.
+func (s *EntropyService) cached(ctx context.Context, data []byte, bitsPerSymbol int, testType entropy.TestType,
+	assess func(context.Context, []byte, int) (*entropy.Result, error)) (*entropy.Result, error) {
+	if s.cache == nil {
+		return assess(ctx, data, bitsPerSymbol)
+	}
+
+	key := ResultCacheKey(data, bitsPerSymbol, testType)
+	if result, ok := s.cache.Get(key, testType); ok {
+		return result, nil
+	}
+
+	result, err := assess(ctx, data, bitsPerSymbol)
+	if err == nil {
+		s.cache.Put(key, result)
+	}
+	return result, err
+}
+
+// AssessBatch performs the assessments described by items in a single call
+// into the assessment library. Items found in the result cache are answered
+// from it and not passed on. results[i] belongs to items[i]; failures are
+// reported per item and wrapped like those of AssessIID and AssessNonIID.
+// Once ctx is done, unfinished items fail with entropy.ErrCancelled.
+func (s *EntropyService) AssessBatch(ctx context.Context, items []entropy.BatchItem) []entropy.BatchResult {
+	results := s.assessBatch(ctx, items)
+	for i := range results {
+		if results[i].Err == nil {
+			continue
+		}
+		if items[i].TestType == entropy.NonIID {
+			results[i].Err = fmt.Errorf("Non-IID assessment failed: %w", results[i].Err)
+		} else {
+			results[i].Err = fmt.Errorf("IID assessment failed: %w", results[i].Err)
+		}
+	}
+	return results
+}
+
+// assessBatch runs the cache misses among items as one batch.
+func (s *EntropyService) assessBatch(ctx context.Context, items []entropy.BatchItem) []entropy.BatchResult {
+	if s.cache == nil {
+		return s.assessment.AssessBatchContext(ctx, items)
+	}
+
+	results := make([]entropy.BatchResult, len(items))
+	keys := make([]string, len(items))
+	misses := make([]entropy.BatchItem, 0, len(items))
+	index := make([]int, 0, len(items))
+	for i, item := range items {
+		if len(item.Data) == 0 {
+			// Invalid items are reported by the assessment library
+			misses = append(misses, item)
+			index = append(index, i)
+			continue
+		}
+		keys[i] = ResultCacheKey(item.Data, item.BitsPerSymbol, item.TestType)
+		if result, ok := s.cache.Get(keys[i], item.TestType); ok {
+			results[i].Result = result
+			continue
+		}
+		misses = append(misses, item)
+		index = append(index, i)
+	}
+
+	if len(misses) == 0 {
+		return results
+	}
+
+	for j, res := range s.assessment.AssessBatchContext(ctx, misses) {
+		i := index[j]
+		results[i] = res
+		if res.Err == nil && keys[i] != "" {
+			s.cache.Put(keys[i], res.Result)
+		}
+	}
+	return results
+}
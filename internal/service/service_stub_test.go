@@ -3,23 +3,26 @@
 package service
 
 import (
+	"context"
 	"testing"
 
 	"github.com/stretchr/testify/assert"
 	"github.com/stretchr/testify/require"
+
+	"github.com/AmmannChristian/nist-800-90b/internal/entropy"
 )
 
 // Success paths rely on the teststub build tag to avoid CGO.
 func TestService_AssessIID_SuccessStub(t *testing.T) {
 	svc := NewService()
-	res, err := svc.AssessIID([]byte{1, 2, 3, 4}, 8)
+	res, err := svc.AssessIID(context.Background(), []byte{1, 2, 3, 4}, 8)
 	require.NoError(t, err)
 	assert.Equal(t, 7.5, res.MinEntropy)
 }
 
 func TestService_AssessNonIID_SuccessStub(t *testing.T) {
 	svc := NewService()
-	res, err := svc.AssessNonIID([]byte{1, 2, 3, 4}, 8)
+	res, err := svc.AssessNonIID(context.Background(), []byte{1, 2, 3, 4}, 8)
 	require.NoError(t, err)
 	assert.Equal(t, 6.5, res.MinEntropy)
 }
@@ -27,7 +30,7 @@ func TestService_AssessNonIID_SuccessStub(t *testing.T) {
 func TestService_AssessIID_AssessmentError(t *testing.T) {
 	svc := NewService()
 
-	_, err := svc.AssessIID([]byte{0xFF, 1, 2, 3}, 8)
+	_, err := svc.AssessIID(context.Background(), []byte{0xFF, 1, 2, 3}, 8)
 	require.Error(t, err)
 	assert.Contains(t, err.Error(), "IID assessment failed")
 }
@@ -35,7 +38,41 @@ func TestService_AssessIID_AssessmentError(t *testing.T) {
 func TestService_AssessNonIID_AssessmentError(t *testing.T) {
 	svc := NewService()
 
-	_, err := svc.AssessNonIID([]byte{0xFF, 1, 2, 3}, 8)
+	_, err := svc.AssessNonIID(context.Background(), []byte{0xFF, 1, 2, 3}, 8)
 	require.Error(t, err)
 	assert.Contains(t, err.Error(), "Non-IID assessment failed")
 }
+
+func TestService_AssessBatch_Stub(t *testing.T) {
+	svc := NewService()
+
+	results := svc.AssessBatch(context.Background(), []entropy.BatchItem{
+		{Data: []byte{1, 2, 3, 4}, BitsPerSymbol: 8, TestType: entropy.IID},
+		{Data: []byte{0xFF, 1, 2, 3}, BitsPerSymbol: 8, TestType: entropy.NonIID},
+	})
+	require.Len(t, results, 2)
+	require.NoError(t, results[0].Err)
+	assert.Equal(t, 7.5, results[0].Result.MinEntropy)
+	require.Error(t, results[1].Err)
+	assert.Contains(t, results[1].Err.Error(), "Non-IID assessment failed")
+}
+
+func TestService_AssessBoth_Stub(t *testing.T) {
+	svc := NewService()
+
+	iid, nonIID := svc.AssessBoth(context.Background(), []byte{1, 2, 3, 4}, 8)
+	require.NoError(t, iid.Err)
+	require.NoError(t, nonIID.Err)
+	assert.Equal(t, 7.5, iid.Result.MinEntropy)
+	assert.Equal(t, 6.5, nonIID.Result.MinEntropy)
+
+	iid, nonIID = svc.AssessBoth(context.Background(), []byte{0xFF, 1, 2, 3}, 8)
+	require.Error(t, iid.Err)
+	assert.Contains(t, iid.Err.Error(), "IID assessment failed")
+	require.Error(t, nonIID.Err)
+	assert.Contains(t, nonIID.Err.Error(), "Non-IID assessment failed")
+
+	iid, _ = svc.AssessBoth(context.Background(), nil, 8)
+	require.Error(t, iid.Err)
+	assert.Contains(t, iid.Err.Error(), "data cannot be empty")
+}
@@ -1,6 +1,7 @@
 package service
 
 import (
+	"context"
 	"testing"
 
 	"github.com/stretchr/testify/assert"
@@ -32,17 +33,17 @@ func TestService_AssessIID_ValidationErrors(t *testing.T) {
 	svc := NewService()
 
 	// Empty data
-	_, err := svc.AssessIID([]byte{}, 8)
+	_, err := svc.AssessIID(context.Background(), []byte{}, 8)
 	require.Error(t, err)
 	assert.Contains(t, err.Error(), "cannot be empty")
 
 	// Invalid bits_per_symbol - too low
-	_, err = svc.AssessIID([]byte{1, 2, 3}, -1)
+	_, err = svc.AssessIID(context.Background(), []byte{1, 2, 3}, -1)
 	require.Error(t, err)
 	assert.Contains(t, err.Error(), "bits_per_symbol")
 
 	// Invalid bits_per_symbol - too high
-	_, err = svc.AssessIID([]byte{1, 2, 3}, 9)
+	_, err = svc.AssessIID(context.Background(), []byte{1, 2, 3}, 9)
 	require.Error(t, err)
 	assert.Contains(t, err.Error(), "bits_per_symbol")
 }
@@ -51,17 +52,17 @@ func TestService_AssessNonIID_ValidationErrors(t *testing.T) {
 	svc := NewService()
 
 	// Empty data
-	_, err := svc.AssessNonIID([]byte{}, 8)
+	_, err := svc.AssessNonIID(context.Background(), []byte{}, 8)
 	require.Error(t, err)
 	assert.Contains(t, err.Error(), "cannot be empty")
 
 	// Invalid bits_per_symbol - too low
-	_, err = svc.AssessNonIID([]byte{1, 2, 3}, -1)
+	_, err = svc.AssessNonIID(context.Background(), []byte{1, 2, 3}, -1)
 	require.Error(t, err)
 	assert.Contains(t, err.Error(), "bits_per_symbol")
 
 	// Invalid bits_per_symbol - too high
-	_, err = svc.AssessNonIID([]byte{1, 2, 3}, 9)
+	_, err = svc.AssessNonIID(context.Background(), []byte{1, 2, 3}, 9)
 	require.Error(t, err)
 	assert.Contains(t, err.Error(), "bits_per_symbol")
 }
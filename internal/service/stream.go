@@ -0,0 +1,102 @@
+package service
+
+import (
+	"context"
+	"crypto/sha256"
+	"errors"
+	"fmt"
+	"hash"
+
+	"github.com/AmmannChristian/nist-800-90b/internal/entropy"
+)
+
+// ErrStreamTooLarge is returned by NonIIDStream.Feed once the samples of a
+// stream would exceed the limit set with SetMaxStreamSize.
+var ErrStreamTooLarge = errors.New("stream exceeds the maximum upload size")
+
+// NonIIDStream is a Non-IID assessment of samples that arrive in chunks. It
+// wraps an entropy.NonIIDSession with the size limit and the result cache of
+// the service that created it; the cache key is hashed as the chunks arrive,
+// so the chunks need not be kept. A NonIIDStream is not safe for concurrent
+// use, and Close must be called once it is no longer needed.
+type NonIIDStream struct {
+	service       *EntropyService
+	session       *entropy.NonIIDSession
+	digest        hash.Hash // nil unless the service caches results
+	bitsPerSymbol int
+}
+
+// NewNonIIDStream starts a streaming Non-IID assessment. A bitsPerSymbol of 0
+// enables auto-detection.
+func (s *EntropyService) NewNonIIDStream(bitsPerSymbol int) (*NonIIDStream, error) {
+	if bitsPerSymbol < 0 || bitsPerSymbol > 8 {
+		return nil, fmt.Errorf("bits_per_symbol must be between 0 (auto-detect) and 8, got %d", bitsPerSymbol)
+	}
+
+	session, err := s.assessment.NewNonIIDSession(bitsPerSymbol)
+	if err != nil {
+		return nil, fmt.Errorf("Non-IID assessment failed: %w", err)
+	}
+
+	stream := &NonIIDStream{
+		service:       s,
+		session:       session,
+		bitsPerSymbol: bitsPerSymbol,
+	}
+	if s.cache != nil {
+		stream.digest = sha256.New()
+	}
+	return stream, nil
+}
+
+// Feed appends chunk to the samples of the stream.
+func (st *NonIIDStream) Feed(chunk []byte) error {
+	if limit := st.service.maxStreamSize; limit > 0 && int64(st.session.Len())+int64(len(chunk)) > limit {
+		return fmt.Errorf("%w of %d bytes", ErrStreamTooLarge, limit)
+	}
+
+	if err := st.session.Feed(chunk); err != nil {
+		return fmt.Errorf("Non-IID assessment failed: %w", err)
+	}
+	if st.digest != nil {
+		st.digest.Write(chunk)
+	}
+	return nil
+}
+
+// Len returns the number of samples fed so far.
+func (st *NonIIDStream) Len() int {
+	return st.session.Len()
+}
+
+// Finish assesses the samples of the stream, or answers from the result
+// cache if the same samples were assessed before. The assessment is
+// abandoned like that of AssessNonIID once ctx is done.
+func (st *NonIIDStream) Finish(ctx context.Context) (*entropy.Result, error) {
+	if st.session.Len() == 0 {
+		return nil, fmt.Errorf("data cannot be empty")
+	}
+
+	var key string
+	if st.digest != nil {
+		key = resultCacheKeyFromSum(st.digest.Sum(nil), st.bitsPerSymbol, entropy.NonIID)
+		if result, ok := st.service.cache.Get(key, entropy.NonIID); ok {
+			return result, nil
+		}
+	}
+
+	result, err := st.session.Finalize(ctx)
+	if err != nil {
+		return nil, fmt.Errorf("Non-IID assessment failed: %w", err)
+	}
+
+	if st.digest != nil {
+		st.service.cache.Put(key, result)
+	}
+	return result, nil
+}
+
+// Close releases the samples of the stream.
+func (st *NonIIDStream) Close() {
+	st.session.Close()
+}
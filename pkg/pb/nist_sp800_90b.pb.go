@@ -285,6 +285,384 @@ func (x *Sp80090BEstimatorResult) GetDescription() string {
 	return ""
 }
 
+// Sp80090bBatchAssessmentRequest contains several independent assessment requests.
+type Sp80090BBatchAssessmentRequest struct {
+	state protoimpl.MessageState `protogen:"open.v1"`
+	// Assessments to perform. Each entry is validated and assessed as an AssessEntropy request.
+	Requests      []*Sp80090BAssessmentRequest `protobuf:"bytes,1,rep,name=requests,proto3" json:"requests,omitempty"`
+	unknownFields protoimpl.UnknownFields
+	sizeCache     protoimpl.SizeCache
+}
+
+func (x *Sp80090BBatchAssessmentRequest) Reset() {
+	*x = Sp80090BBatchAssessmentRequest{}
+	mi := &file_nist_sp800_90b_proto_msgTypes[3]
+	ms := protoimpl.X.MessageStateOf(protoimpl.Pointer(x))
+	ms.StoreMessageInfo(mi)
+}
+
+func (x *Sp80090BBatchAssessmentRequest) String() string {
+	return protoimpl.X.MessageStringOf(x)
+}
+
+func (*Sp80090BBatchAssessmentRequest) ProtoMessage() {}
+
+func (x *Sp80090BBatchAssessmentRequest) ProtoReflect() protoreflect.Message {
+	mi := &file_nist_sp800_90b_proto_msgTypes[3]
+	if x != nil {
+		ms := protoimpl.X.MessageStateOf(protoimpl.Pointer(x))
+		if ms.LoadMessageInfo() == nil {
+			ms.StoreMessageInfo(mi)
+		}
+		return ms
+	}
+	return mi.MessageOf(x)
+}
+
+// Deprecated: Use Sp80090BBatchAssessmentRequest.ProtoReflect.Descriptor instead.
+func (*Sp80090BBatchAssessmentRequest) Descriptor() ([]byte, []int) {
+	return file_nist_sp800_90b_proto_rawDescGZIP(), []int{3}
+}
+
+func (x *Sp80090BBatchAssessmentRequest) GetRequests() []*Sp80090BAssessmentRequest {
+	if x != nil {
+		return x.Requests
+	}
+	return nil
+}
+
+// Sp80090bBatchAssessmentResponse contains one result per request of a batch, in request order.
+type Sp80090BBatchAssessmentResponse struct {
+	state protoimpl.MessageState `protogen:"open.v1"`
+	// Results, where results[i] belongs to requests[i].
+	Results       []*Sp80090BBatchAssessmentResult `protobuf:"bytes,1,rep,name=results,proto3" json:"results,omitempty"`
+	unknownFields protoimpl.UnknownFields
+	sizeCache     protoimpl.SizeCache
+}
+
+func (x *Sp80090BBatchAssessmentResponse) Reset() {
+	*x = Sp80090BBatchAssessmentResponse{}
+	mi := &file_nist_sp800_90b_proto_msgTypes[4]
+	ms := protoimpl.X.MessageStateOf(protoimpl.Pointer(x))
+	ms.StoreMessageInfo(mi)
+}
+
+func (x *Sp80090BBatchAssessmentResponse) String() string {
+	return protoimpl.X.MessageStringOf(x)
+}
+
+func (*Sp80090BBatchAssessmentResponse) ProtoMessage() {}
+
+func (x *Sp80090BBatchAssessmentResponse) ProtoReflect() protoreflect.Message {
+	mi := &file_nist_sp800_90b_proto_msgTypes[4]
+	if x != nil {
+		ms := protoimpl.X.MessageStateOf(protoimpl.Pointer(x))
+		if ms.LoadMessageInfo() == nil {
+			ms.StoreMessageInfo(mi)
+		}
+		return ms
+	}
+	return mi.MessageOf(x)
+}
+
+// Deprecated: Use Sp80090BBatchAssessmentResponse.ProtoReflect.Descriptor instead.
+func (*Sp80090BBatchAssessmentResponse) Descriptor() ([]byte, []int) {
+	return file_nist_sp800_90b_proto_rawDescGZIP(), []int{4}
+}
+
+func (x *Sp80090BBatchAssessmentResponse) GetResults() []*Sp80090BBatchAssessmentResult {
+	if x != nil {
+		return x.Results
+	}
+	return nil
+}
+
+// Sp80090bBatchAssessmentResult contains the outcome of a single request of a batch.
+type Sp80090BBatchAssessmentResult struct {
+	state protoimpl.MessageState `protogen:"open.v1"`
+	// Assessment response, set when the request succeeded.
+	Response *Sp80090BAssessmentResponse `protobuf:"bytes,1,opt,name=response,proto3" json:"response,omitempty"`
+	// Error description, set when the request failed.
+	Error         string `protobuf:"bytes,2,opt,name=error,proto3" json:"error,omitempty"`
+	unknownFields protoimpl.UnknownFields
+	sizeCache     protoimpl.SizeCache
+}
+
+func (x *Sp80090BBatchAssessmentResult) Reset() {
+	*x = Sp80090BBatchAssessmentResult{}
+	mi := &file_nist_sp800_90b_proto_msgTypes[5]
+	ms := protoimpl.X.MessageStateOf(protoimpl.Pointer(x))
+	ms.StoreMessageInfo(mi)
+}
+
+func (x *Sp80090BBatchAssessmentResult) String() string {
+	return protoimpl.X.MessageStringOf(x)
+}
+
+func (*Sp80090BBatchAssessmentResult) ProtoMessage() {}
+
+func (x *Sp80090BBatchAssessmentResult) ProtoReflect() protoreflect.Message {
+	mi := &file_nist_sp800_90b_proto_msgTypes[5]
+	if x != nil {
+		ms := protoimpl.X.MessageStateOf(protoimpl.Pointer(x))
+		if ms.LoadMessageInfo() == nil {
+			ms.StoreMessageInfo(mi)
+		}
+		return ms
+	}
+	return mi.MessageOf(x)
+}
+
+// Deprecated: Use Sp80090BBatchAssessmentResult.ProtoReflect.Descriptor instead.
+func (*Sp80090BBatchAssessmentResult) Descriptor() ([]byte, []int) {
+	return file_nist_sp800_90b_proto_rawDescGZIP(), []int{5}
+}
+
+func (x *Sp80090BBatchAssessmentResult) GetResponse() *Sp80090BAssessmentResponse {
+	if x != nil {
+		return x.Response
+	}
+	return nil
+}
+
+func (x *Sp80090BBatchAssessmentResult) GetError() string {
+	if x != nil {
+		return x.Error
+	}
+	return ""
+}
+
+// Sp80090bStreamChunk carries a part of the samples of an AssessEntropyStream call.
+type Sp80090BStreamChunk struct {
+	state protoimpl.MessageState `protogen:"open.v1"`
+	// Raw entropy samples packed into bytes, appended to those of the previous chunks.
+	Data []byte `protobuf:"bytes,1,opt,name=data,proto3" json:"data,omitempty"`
+	// Number of bits per symbol (0 for auto-detect, 1-8). Only read from the first chunk.
+	BitsPerSymbol uint32 `protobuf:"varint,2,opt,name=bits_per_symbol,json=bitsPerSymbol,proto3" json:"bits_per_symbol,omitempty"`
+	unknownFields protoimpl.UnknownFields
+	sizeCache     protoimpl.SizeCache
+}
+
+func (x *Sp80090BStreamChunk) Reset() {
+	*x = Sp80090BStreamChunk{}
+	mi := &file_nist_sp800_90b_proto_msgTypes[6]
+	ms := protoimpl.X.MessageStateOf(protoimpl.Pointer(x))
+	ms.StoreMessageInfo(mi)
+}
+
+func (x *Sp80090BStreamChunk) String() string {
+	return protoimpl.X.MessageStringOf(x)
+}
+
+func (*Sp80090BStreamChunk) ProtoMessage() {}
+
+func (x *Sp80090BStreamChunk) ProtoReflect() protoreflect.Message {
+	mi := &file_nist_sp800_90b_proto_msgTypes[6]
+	if x != nil {
+		ms := protoimpl.X.MessageStateOf(protoimpl.Pointer(x))
+		if ms.LoadMessageInfo() == nil {
+			ms.StoreMessageInfo(mi)
+		}
+		return ms
+	}
+	return mi.MessageOf(x)
+}
+
+// Deprecated: Use Sp80090BStreamChunk.ProtoReflect.Descriptor instead.
+func (*Sp80090BStreamChunk) Descriptor() ([]byte, []int) {
+	return file_nist_sp800_90b_proto_rawDescGZIP(), []int{6}
+}
+
+func (x *Sp80090BStreamChunk) GetData() []byte {
+	if x != nil {
+		return x.Data
+	}
+	return nil
+}
+
+func (x *Sp80090BStreamChunk) GetBitsPerSymbol() uint32 {
+	if x != nil {
+		return x.BitsPerSymbol
+	}
+	return 0
+}
+
+// Sp80090bPermutationShardRequest selects the permutation test rounds of a RunPermutationShard call.
+type Sp80090BPermutationShardRequest struct {
+	state protoimpl.MessageState `protogen:"open.v1"`
+	// Raw entropy samples packed into bytes. May be left empty if the worker already holds the
+	// samples with digest data_sha256 from an earlier shard.
+	Data []byte `protobuf:"bytes,1,opt,name=data,proto3" json:"data,omitempty"`
+	// SHA-256 digest of the samples.
+	DataSha256 []byte `protobuf:"bytes,2,opt,name=data_sha256,json=dataSha256,proto3" json:"data_sha256,omitempty"`
+	// Number of bits per symbol (0 for auto-detect, 1-8).
+	BitsPerSymbol uint32 `protobuf:"varint,3,opt,name=bits_per_symbol,json=bitsPerSymbol,proto3" json:"bits_per_symbol,omitempty"`
+	// xoshiro256** seed of the permutation tests, as four 64-bit words.
+	Seed []uint64 `protobuf:"fixed64,4,rep,packed,name=seed,proto3" json:"seed,omitempty"`
+	// First RNG stream to run (0-63).
+	FirstStream uint32 `protobuf:"varint,5,opt,name=first_stream,json=firstStream,proto3" json:"first_stream,omitempty"`
+	// Number of consecutive RNG streams to run (at least 1).
+	StreamCount uint32 `protobuf:"varint,6,opt,name=stream_count,json=streamCount,proto3" json:"stream_count,omitempty"`
+	// Statistics already decided by the coordinator, in the order of the reference tool output.
+	// Empty if none is decided yet.
+	Decided       []bool `protobuf:"varint,7,rep,packed,name=decided,proto3" json:"decided,omitempty"`
+	unknownFields protoimpl.UnknownFields
+	sizeCache     protoimpl.SizeCache
+}
+
+func (x *Sp80090BPermutationShardRequest) Reset() {
+	*x = Sp80090BPermutationShardRequest{}
+	mi := &file_nist_sp800_90b_proto_msgTypes[7]
+	ms := protoimpl.X.MessageStateOf(protoimpl.Pointer(x))
+	ms.StoreMessageInfo(mi)
+}
+
+func (x *Sp80090BPermutationShardRequest) String() string {
+	return protoimpl.X.MessageStringOf(x)
+}
+
+func (*Sp80090BPermutationShardRequest) ProtoMessage() {}
+
+func (x *Sp80090BPermutationShardRequest) ProtoReflect() protoreflect.Message {
+	mi := &file_nist_sp800_90b_proto_msgTypes[7]
+	if x != nil {
+		ms := protoimpl.X.MessageStateOf(protoimpl.Pointer(x))
+		if ms.LoadMessageInfo() == nil {
+			ms.StoreMessageInfo(mi)
+		}
+		return ms
+	}
+	return mi.MessageOf(x)
+}
+
+// Deprecated: Use Sp80090BPermutationShardRequest.ProtoReflect.Descriptor instead.
+func (*Sp80090BPermutationShardRequest) Descriptor() ([]byte, []int) {
+	return file_nist_sp800_90b_proto_rawDescGZIP(), []int{7}
+}
+
+func (x *Sp80090BPermutationShardRequest) GetData() []byte {
+	if x != nil {
+		return x.Data
+	}
+	return nil
+}
+
+func (x *Sp80090BPermutationShardRequest) GetDataSha256() []byte {
+	if x != nil {
+		return x.DataSha256
+	}
+	return nil
+}
+
+func (x *Sp80090BPermutationShardRequest) GetBitsPerSymbol() uint32 {
+	if x != nil {
+		return x.BitsPerSymbol
+	}
+	return 0
+}
+
+func (x *Sp80090BPermutationShardRequest) GetSeed() []uint64 {
+	if x != nil {
+		return x.Seed
+	}
+	return nil
+}
+
+func (x *Sp80090BPermutationShardRequest) GetFirstStream() uint32 {
+	if x != nil {
+		return x.FirstStream
+	}
+	return 0
+}
+
+func (x *Sp80090BPermutationShardRequest) GetStreamCount() uint32 {
+	if x != nil {
+		return x.StreamCount
+	}
+	return 0
+}
+
+func (x *Sp80090BPermutationShardRequest) GetDecided() []bool {
+	if x != nil {
+		return x.Decided
+	}
+	return nil
+}
+
+// Sp80090bPermutationShardResponse contains the tallies of the rounds of a shard. Entry i of each
+// list belongs to statistic i.
+type Sp80090BPermutationShardResponse struct {
+	state protoimpl.MessageState `protogen:"open.v1"`
+	// Rounds in which the permuted statistic was greater than the unpermuted one.
+	Greater []uint32 `protobuf:"varint,1,rep,packed,name=greater,proto3" json:"greater,omitempty"`
+	// Rounds in which the permuted statistic was equal to the unpermuted one.
+	Equal []uint32 `protobuf:"varint,2,rep,packed,name=equal,proto3" json:"equal,omitempty"`
+	// Rounds in which the permuted statistic was less than the unpermuted one.
+	Less []uint32 `protobuf:"varint,3,rep,packed,name=less,proto3" json:"less,omitempty"`
+	// Permutations run.
+	PermutationsExecuted uint64 `protobuf:"varint,4,opt,name=permutations_executed,json=permutationsExecuted,proto3" json:"permutations_executed,omitempty"`
+	unknownFields        protoimpl.UnknownFields
+	sizeCache            protoimpl.SizeCache
+}
+
+func (x *Sp80090BPermutationShardResponse) Reset() {
+	*x = Sp80090BPermutationShardResponse{}
+	mi := &file_nist_sp800_90b_proto_msgTypes[8]
+	ms := protoimpl.X.MessageStateOf(protoimpl.Pointer(x))
+	ms.StoreMessageInfo(mi)
+}
+
+func (x *Sp80090BPermutationShardResponse) String() string {
+	return protoimpl.X.MessageStringOf(x)
+}
+
+func (*Sp80090BPermutationShardResponse) ProtoMessage() {}
+
+func (x *Sp80090BPermutationShardResponse) ProtoReflect() protoreflect.Message {
+	mi := &file_nist_sp800_90b_proto_msgTypes[8]
+	if x != nil {
+		ms := protoimpl.X.MessageStateOf(protoimpl.Pointer(x))
+		if ms.LoadMessageInfo() == nil {
+			ms.StoreMessageInfo(mi)
+		}
+		return ms
+	}
+	return mi.MessageOf(x)
+}
+
+// Deprecated: Use Sp80090BPermutationShardResponse.ProtoReflect.Descriptor instead.
+func (*Sp80090BPermutationShardResponse) Descriptor() ([]byte, []int) {
+	return file_nist_sp800_90b_proto_rawDescGZIP(), []int{8}
+}
+
+func (x *Sp80090BPermutationShardResponse) GetGreater() []uint32 {
+	if x != nil {
+		return x.Greater
+	}
+	return nil
+}
+
+func (x *Sp80090BPermutationShardResponse) GetEqual() []uint32 {
+	if x != nil {
+		return x.Equal
+	}
+	return nil
+}
+
+func (x *Sp80090BPermutationShardResponse) GetLess() []uint32 {
+	if x != nil {
+		return x.Less
+	}
+	return nil
+}
+
+func (x *Sp80090BPermutationShardResponse) GetPermutationsExecuted() uint64 {
+	if x != nil {
+		return x.PermutationsExecuted
+	}
+	return 0
+}
+
 var File_nist_sp800_90b_proto protoreflect.FileDescriptor
 
 const file_nist_sp800_90b_proto_rawDesc = "" +
@@ -315,9 +693,36 @@ const file_nist_sp800_90b_proto_rawDesc = "" +
 	"\vdescription\x18\x05 \x01(\tR\vdescription\x1a:\n" +
 	"\fDetailsEntry\x12\x10\n" +
 	"\x03key\x18\x01 \x01(\tR\x03key\x12\x14\n" +
-	"\x05value\x18\x02 \x01(\x01R\x05value:\x028\x012\x89\x01\n" +
+	"\x05value\x18\x02 \x01(\x01R\x05value:\x028\x01\"j\n" +
+	"\x1eSp80090bBatchAssessmentRequest\x12H\n" +
+	"\brequests\x18\x01 \x03(\v2,.nist.sp800_90b.v1.Sp80090bAssessmentRequestR\brequests\"m\n" +
+	"\x1fSp80090bBatchAssessmentResponse\x12J\n" +
+	"\aresults\x18\x01 \x03(\v20.nist.sp800_90b.v1.Sp80090bBatchAssessmentResultR\aresults\"\x80\x01\n" +
+	"\x1dSp80090bBatchAssessmentResult\x12I\n" +
+	"\bresponse\x18\x01 \x01(\v2-.nist.sp800_90b.v1.Sp80090bAssessmentResponseR\bresponse\x12\x14\n" +
+	"\x05error\x18\x02 \x01(\tR\x05error\"Q\n" +
+	"\x13Sp80090bStreamChunk\x12\x12\n" +
+	"\x04data\x18\x01 \x01(\fR\x04data\x12&\n" +
+	"\x0fbits_per_symbol\x18\x02 \x01(\rR\rbitsPerSymbol\"\xf2\x01\n" +
+	"\x1fSp80090bPermutationShardRequest\x12\x12\n" +
+	"\x04data\x18\x01 \x01(\fR\x04data\x12\x1f\n" +
+	"\vdata_sha256\x18\x02 \x01(\fR\n" +
+	"dataSha256\x12&\n" +
+	"\x0fbits_per_symbol\x18\x03 \x01(\rR\rbitsPerSymbol\x12\x12\n" +
+	"\x04seed\x18\x04 \x03(\x06R\x04seed\x12!\n" +
+	"\ffirst_stream\x18\x05 \x01(\rR\vfirstStream\x12!\n" +
+	"\fstream_count\x18\x06 \x01(\rR\vstreamCount\x12\x18\n" +
+	"\adecided\x18\a \x03(\bR\adecided\"\x9b\x01\n" +
+	" Sp80090bPermutationShardResponse\x12\x18\n" +
+	"\agreater\x18\x01 \x03(\rR\agreater\x12\x14\n" +
+	"\x05equal\x18\x02 \x03(\rR\x05equal\x12\x12\n" +
+	"\x04less\x18\x03 \x03(\rR\x04less\x123\n" +
+	"\x15permutations_executed\x18\x04 \x01(\x04R\x14permutationsExecuted2\xf6\x03\n" +
 	"\x19Sp80090bAssessmentService\x12l\n" +
-	"\rAssessEntropy\x12,.nist.sp800_90b.v1.Sp80090bAssessmentRequest\x1a-.nist.sp800_90b.v1.Sp80090bAssessmentResponseB?Z=github.com/AmmannChristian/nist-800-90b/pkg/pb;nistsp80090bv1b\x06proto3"
+	"\rAssessEntropy\x12,.nist.sp800_90b.v1.Sp80090bAssessmentRequest\x1a-.nist.sp800_90b.v1.Sp80090bAssessmentResponse\x12{\n" +
+	"\x12AssessEntropyBatch\x121.nist.sp800_90b.v1.Sp80090bBatchAssessmentRequest\x1a2.nist.sp800_90b.v1.Sp80090bBatchAssessmentResponse\x12n\n" +
+	"\x13AssessEntropyStream\x12&.nist.sp800_90b.v1.Sp80090bStreamChunk\x1a-.nist.sp800_90b.v1.Sp80090bAssessmentResponse(\x01\x12~\n" +
+	"\x13RunPermutationShard\x122.nist.sp800_90b.v1.Sp80090bPermutationShardRequest\x1a3.nist.sp800_90b.v1.Sp80090bPermutationShardResponseB?Z=github.com/AmmannChristian/nist-800-90b/pkg/pb;nistsp80090bv1b\x06proto3"
 
 var (
 	file_nist_sp800_90b_proto_rawDescOnce sync.Once
@@ -331,24 +736,39 @@ func file_nist_sp800_90b_proto_rawDescGZIP() []byte {
 	return file_nist_sp800_90b_proto_rawDescData
 }
 
-var file_nist_sp800_90b_proto_msgTypes = make([]protoimpl.MessageInfo, 4)
+var file_nist_sp800_90b_proto_msgTypes = make([]protoimpl.MessageInfo, 10)
 var file_nist_sp800_90b_proto_goTypes = []any{
-	(*Sp80090BAssessmentRequest)(nil),  // 0: nist.sp800_90b.v1.Sp80090bAssessmentRequest
-	(*Sp80090BAssessmentResponse)(nil), // 1: nist.sp800_90b.v1.Sp80090bAssessmentResponse
-	(*Sp80090BEstimatorResult)(nil),    // 2: nist.sp800_90b.v1.Sp80090bEstimatorResult
-	nil,                                // 3: nist.sp800_90b.v1.Sp80090bEstimatorResult.DetailsEntry
+	(*Sp80090BAssessmentRequest)(nil),        // 0: nist.sp800_90b.v1.Sp80090bAssessmentRequest
+	(*Sp80090BAssessmentResponse)(nil),       // 1: nist.sp800_90b.v1.Sp80090bAssessmentResponse
+	(*Sp80090BEstimatorResult)(nil),          // 2: nist.sp800_90b.v1.Sp80090bEstimatorResult
+	(*Sp80090BBatchAssessmentRequest)(nil),   // 3: nist.sp800_90b.v1.Sp80090bBatchAssessmentRequest
+	(*Sp80090BBatchAssessmentResponse)(nil),  // 4: nist.sp800_90b.v1.Sp80090bBatchAssessmentResponse
+	(*Sp80090BBatchAssessmentResult)(nil),    // 5: nist.sp800_90b.v1.Sp80090bBatchAssessmentResult
+	(*Sp80090BStreamChunk)(nil),              // 6: nist.sp800_90b.v1.Sp80090bStreamChunk
+	(*Sp80090BPermutationShardRequest)(nil),  // 7: nist.sp800_90b.v1.Sp80090bPermutationShardRequest
+	(*Sp80090BPermutationShardResponse)(nil), // 8: nist.sp800_90b.v1.Sp80090bPermutationShardResponse
+	nil,                                      // 9: nist.sp800_90b.v1.Sp80090bEstimatorResult.DetailsEntry
 }
 var file_nist_sp800_90b_proto_depIdxs = []int32{
-	2, // 0: nist.sp800_90b.v1.Sp80090bAssessmentResponse.iid_results:type_name -> nist.sp800_90b.v1.Sp80090bEstimatorResult
-	2, // 1: nist.sp800_90b.v1.Sp80090bAssessmentResponse.non_iid_results:type_name -> nist.sp800_90b.v1.Sp80090bEstimatorResult
-	3, // 2: nist.sp800_90b.v1.Sp80090bEstimatorResult.details:type_name -> nist.sp800_90b.v1.Sp80090bEstimatorResult.DetailsEntry
-	0, // 3: nist.sp800_90b.v1.Sp80090bAssessmentService.AssessEntropy:input_type -> nist.sp800_90b.v1.Sp80090bAssessmentRequest
-	1, // 4: nist.sp800_90b.v1.Sp80090bAssessmentService.AssessEntropy:output_type -> nist.sp800_90b.v1.Sp80090bAssessmentResponse
-	4, // [4:5] is the sub-list for method output_type
-	3, // [3:4] is the sub-list for method input_type
-	3, // [3:3] is the sub-list for extension type_name
-	3, // [3:3] is the sub-list for extension extendee
-	0, // [0:3] is the sub-list for field type_name
+	2,  // 0: nist.sp800_90b.v1.Sp80090bAssessmentResponse.iid_results:type_name -> nist.sp800_90b.v1.Sp80090bEstimatorResult
+	2,  // 1: nist.sp800_90b.v1.Sp80090bAssessmentResponse.non_iid_results:type_name -> nist.sp800_90b.v1.Sp80090bEstimatorResult
+	9,  // 2: nist.sp800_90b.v1.Sp80090bEstimatorResult.details:type_name -> nist.sp800_90b.v1.Sp80090bEstimatorResult.DetailsEntry
+	0,  // 3: nist.sp800_90b.v1.Sp80090bBatchAssessmentRequest.requests:type_name -> nist.sp800_90b.v1.Sp80090bAssessmentRequest
+	5,  // 4: nist.sp800_90b.v1.Sp80090bBatchAssessmentResponse.results:type_name -> nist.sp800_90b.v1.Sp80090bBatchAssessmentResult
+	1,  // 5: nist.sp800_90b.v1.Sp80090bBatchAssessmentResult.response:type_name -> nist.sp800_90b.v1.Sp80090bAssessmentResponse
+	0,  // 6: nist.sp800_90b.v1.Sp80090bAssessmentService.AssessEntropy:input_type -> nist.sp800_90b.v1.Sp80090bAssessmentRequest
+	3,  // 7: nist.sp800_90b.v1.Sp80090bAssessmentService.AssessEntropyBatch:input_type -> nist.sp800_90b.v1.Sp80090bBatchAssessmentRequest
+	6,  // 8: nist.sp800_90b.v1.Sp80090bAssessmentService.AssessEntropyStream:input_type -> nist.sp800_90b.v1.Sp80090bStreamChunk
+	7,  // 9: nist.sp800_90b.v1.Sp80090bAssessmentService.RunPermutationShard:input_type -> nist.sp800_90b.v1.Sp80090bPermutationShardRequest
+	1,  // 10: nist.sp800_90b.v1.Sp80090bAssessmentService.AssessEntropy:output_type -> nist.sp800_90b.v1.Sp80090bAssessmentResponse
+	4,  // 11: nist.sp800_90b.v1.Sp80090bAssessmentService.AssessEntropyBatch:output_type -> nist.sp800_90b.v1.Sp80090bBatchAssessmentResponse
+	1,  // 12: nist.sp800_90b.v1.Sp80090bAssessmentService.AssessEntropyStream:output_type -> nist.sp800_90b.v1.Sp80090bAssessmentResponse
+	8,  // 13: nist.sp800_90b.v1.Sp80090bAssessmentService.RunPermutationShard:output_type -> nist.sp800_90b.v1.Sp80090bPermutationShardResponse
+	10, // [10:14] is the sub-list for method output_type
+	6,  // [6:10] is the sub-list for method input_type
+	6,  // [6:6] is the sub-list for extension type_name
+	6,  // [6:6] is the sub-list for extension extendee
+	0,  // [0:6] is the sub-list for field type_name
 }
 
 func init() { file_nist_sp800_90b_proto_init() }
@@ -362,7 +782,7 @@ func file_nist_sp800_90b_proto_init() {
 			GoPackagePath: reflect.TypeOf(x{}).PkgPath(),
 			RawDescriptor: unsafe.Slice(unsafe.StringData(file_nist_sp800_90b_proto_rawDesc), len(file_nist_sp800_90b_proto_rawDesc)),
 			NumEnums:      0,
-			NumMessages:   4,
+			NumMessages:   10,
 			NumExtensions: 0,
 			NumServices:   1,
 		},
@@ -19,7 +19,10 @@ import (
 const _ = grpc.SupportPackageIsVersion9
 
 const (
-	Sp80090BAssessmentService_AssessEntropy_FullMethodName = "/nist.sp800_90b.v1.Sp80090bAssessmentService/AssessEntropy"
+	Sp80090BAssessmentService_AssessEntropy_FullMethodName       = "/nist.sp800_90b.v1.Sp80090bAssessmentService/AssessEntropy"
+	Sp80090BAssessmentService_AssessEntropyBatch_FullMethodName  = "/nist.sp800_90b.v1.Sp80090bAssessmentService/AssessEntropyBatch"
+	Sp80090BAssessmentService_AssessEntropyStream_FullMethodName = "/nist.sp800_90b.v1.Sp80090bAssessmentService/AssessEntropyStream"
+	Sp80090BAssessmentService_RunPermutationShard_FullMethodName = "/nist.sp800_90b.v1.Sp80090bAssessmentService/RunPermutationShard"
 )
 
 // Sp80090BAssessmentServiceClient is the client API for Sp80090BAssessmentService service.
@@ -30,6 +33,14 @@ const (
 type Sp80090BAssessmentServiceClient interface {
 	// AssessEntropy performs NIST SP 800-90B entropy assessment on the provided data samples.
 	AssessEntropy(ctx context.Context, in *Sp80090BAssessmentRequest, opts ...grpc.CallOption) (*Sp80090BAssessmentResponse, error)
+	// AssessEntropyBatch assesses several independent sample buffers in one call.
+	AssessEntropyBatch(ctx context.Context, in *Sp80090BBatchAssessmentRequest, opts ...grpc.CallOption) (*Sp80090BBatchAssessmentResponse, error)
+	// AssessEntropyStream performs a Non-IID assessment of samples uploaded as a stream of chunks.
+	// The assessment runs once the client closes the stream.
+	AssessEntropyStream(ctx context.Context, opts ...grpc.CallOption) (grpc.ClientStreamingClient[Sp80090BStreamChunk, Sp80090BAssessmentResponse], error)
+	// RunPermutationShard runs some of the permutation test rounds of an IID assessment for a
+	// coordinating server, which merges the tallies of all shards.
+	RunPermutationShard(ctx context.Context, in *Sp80090BPermutationShardRequest, opts ...grpc.CallOption) (*Sp80090BPermutationShardResponse, error)
 }
 
 type sp80090BAssessmentServiceClient struct {
@@ -50,6 +61,39 @@ func (c *sp80090BAssessmentServiceClient) AssessEntropy(ctx context.Context, in
 	return out, nil
 }
 
+func (c *sp80090BAssessmentServiceClient) AssessEntropyBatch(ctx context.Context, in *Sp80090BBatchAssessmentRequest, opts ...grpc.CallOption) (*Sp80090BBatchAssessmentResponse, error) {
+	cOpts := append([]grpc.CallOption{grpc.StaticMethod()}, opts...)
+	out := new(Sp80090BBatchAssessmentResponse)
+	err := c.cc.Invoke(ctx, Sp80090BAssessmentService_AssessEntropyBatch_FullMethodName, in, out, cOpts...)
+	if err != nil {
+		return nil, err
+	}
+	return out, nil
+}
+
+func (c *sp80090BAssessmentServiceClient) AssessEntropyStream(ctx context.Context, opts ...grpc.CallOption) (grpc.ClientStreamingClient[Sp80090BStreamChunk, Sp80090BAssessmentResponse], error) {
+	cOpts := append([]grpc.CallOption{grpc.StaticMethod()}, opts...)
+	stream, err := c.cc.NewStream(ctx, &Sp80090BAssessmentService_ServiceDesc.Streams[0], Sp80090BAssessmentService_AssessEntropyStream_FullMethodName, cOpts...)
+	if err != nil {
+		return nil, err
+	}
+	x := &grpc.GenericClientStream[Sp80090BStreamChunk, Sp80090BAssessmentResponse]{ClientStream: stream}
+	return x, nil
+}
+
+// This type alias is provided for backwards compatibility with existing code that references the prior non-generic stream type by name.
+type Sp80090BAssessmentService_AssessEntropyStreamClient = grpc.ClientStreamingClient[Sp80090BStreamChunk, Sp80090BAssessmentResponse]
+
+func (c *sp80090BAssessmentServiceClient) RunPermutationShard(ctx context.Context, in *Sp80090BPermutationShardRequest, opts ...grpc.CallOption) (*Sp80090BPermutationShardResponse, error) {
+	cOpts := append([]grpc.CallOption{grpc.StaticMethod()}, opts...)
+	out := new(Sp80090BPermutationShardResponse)
+	err := c.cc.Invoke(ctx, Sp80090BAssessmentService_RunPermutationShard_FullMethodName, in, out, cOpts...)
+	if err != nil {
+		return nil, err
+	}
+	return out, nil
+}
+
 // Sp80090BAssessmentServiceServer is the server API for Sp80090BAssessmentService service.
 // All implementations must embed UnimplementedSp80090BAssessmentServiceServer
 // for forward compatibility.
@@ -58,6 +102,14 @@ func (c *sp80090BAssessmentServiceClient) AssessEntropy(ctx context.Context, in
 type Sp80090BAssessmentServiceServer interface {
 	// AssessEntropy performs NIST SP 800-90B entropy assessment on the provided data samples.
 	AssessEntropy(context.Context, *Sp80090BAssessmentRequest) (*Sp80090BAssessmentResponse, error)
+	// AssessEntropyBatch assesses several independent sample buffers in one call.
+	AssessEntropyBatch(context.Context, *Sp80090BBatchAssessmentRequest) (*Sp80090BBatchAssessmentResponse, error)
+	// AssessEntropyStream performs a Non-IID assessment of samples uploaded as a stream of chunks.
+	// The assessment runs once the client closes the stream.
+	AssessEntropyStream(grpc.ClientStreamingServer[Sp80090BStreamChunk, Sp80090BAssessmentResponse]) error
+	// RunPermutationShard runs some of the permutation test rounds of an IID assessment for a
+	// coordinating server, which merges the tallies of all shards.
+	RunPermutationShard(context.Context, *Sp80090BPermutationShardRequest) (*Sp80090BPermutationShardResponse, error)
 	mustEmbedUnimplementedSp80090BAssessmentServiceServer()
 }
 
@@ -71,6 +123,15 @@ type UnimplementedSp80090BAssessmentServiceServer struct{}
 func (UnimplementedSp80090BAssessmentServiceServer) AssessEntropy(context.Context, *Sp80090BAssessmentRequest) (*Sp80090BAssessmentResponse, error) {
 	return nil, status.Error(codes.Unimplemented, "method AssessEntropy not implemented")
 }
+func (UnimplementedSp80090BAssessmentServiceServer) AssessEntropyBatch(context.Context, *Sp80090BBatchAssessmentRequest) (*Sp80090BBatchAssessmentResponse, error) {
+	return nil, status.Error(codes.Unimplemented, "method AssessEntropyBatch not implemented")
+}
+func (UnimplementedSp80090BAssessmentServiceServer) AssessEntropyStream(grpc.ClientStreamingServer[Sp80090BStreamChunk, Sp80090BAssessmentResponse]) error {
+	return status.Error(codes.Unimplemented, "method AssessEntropyStream not implemented")
+}
+func (UnimplementedSp80090BAssessmentServiceServer) RunPermutationShard(context.Context, *Sp80090BPermutationShardRequest) (*Sp80090BPermutationShardResponse, error) {
+	return nil, status.Error(codes.Unimplemented, "method RunPermutationShard not implemented")
+}
 func (UnimplementedSp80090BAssessmentServiceServer) mustEmbedUnimplementedSp80090BAssessmentServiceServer() {
 }
 func (UnimplementedSp80090BAssessmentServiceServer) testEmbeddedByValue() {}
@@ -111,6 +172,49 @@ func _Sp80090BAssessmentService_AssessEntropy_Handler(srv interface{}, ctx conte
 	return interceptor(ctx, in, info, handler)
 }
 
+func _Sp80090BAssessmentService_AssessEntropyBatch_Handler(srv interface{}, ctx context.Context, dec func(interface{}) error, interceptor grpc.UnaryServerInterceptor) (interface{}, error) {
+	in := new(Sp80090BBatchAssessmentRequest)
+	if err := dec(in); err != nil {
+		return nil, err
+	}
+	if interceptor == nil {
+		return srv.(Sp80090BAssessmentServiceServer).AssessEntropyBatch(ctx, in)
+	}
+	info := &grpc.UnaryServerInfo{
+		Server:     srv,
+		FullMethod: Sp80090BAssessmentService_AssessEntropyBatch_FullMethodName,
+	}
+	handler := func(ctx context.Context, req interface{}) (interface{}, error) {
+		return srv.(Sp80090BAssessmentServiceServer).AssessEntropyBatch(ctx, req.(*Sp80090BBatchAssessmentRequest))
+	}
+	return interceptor(ctx, in, info, handler)
+}
+
+func _Sp80090BAssessmentService_AssessEntropyStream_Handler(srv interface{}, stream grpc.ServerStream) error {
+	return srv.(Sp80090BAssessmentServiceServer).AssessEntropyStream(&grpc.GenericServerStream[Sp80090BStreamChunk, Sp80090BAssessmentResponse]{ServerStream: stream})
+}
+
+// This type alias is provided for backwards compatibility with existing code that references the prior non-generic stream type by name.
+type Sp80090BAssessmentService_AssessEntropyStreamServer = grpc.ClientStreamingServer[Sp80090BStreamChunk, Sp80090BAssessmentResponse]
+
+func _Sp80090BAssessmentService_RunPermutationShard_Handler(srv interface{}, ctx context.Context, dec func(interface{}) error, interceptor grpc.UnaryServerInterceptor) (interface{}, error) {
+	in := new(Sp80090BPermutationShardRequest)
+	if err := dec(in); err != nil {
+		return nil, err
+	}
+	if interceptor == nil {
+		return srv.(Sp80090BAssessmentServiceServer).RunPermutationShard(ctx, in)
+	}
+	info := &grpc.UnaryServerInfo{
+		Server:     srv,
+		FullMethod: Sp80090BAssessmentService_RunPermutationShard_FullMethodName,
+	}
+	handler := func(ctx context.Context, req interface{}) (interface{}, error) {
+		return srv.(Sp80090BAssessmentServiceServer).RunPermutationShard(ctx, req.(*Sp80090BPermutationShardRequest))
+	}
+	return interceptor(ctx, in, info, handler)
+}
+
 // Sp80090BAssessmentService_ServiceDesc is the grpc.ServiceDesc for Sp80090BAssessmentService service.
 // It's only intended for direct use with grpc.RegisterService,
 // and not to be introspected or modified (even as a copy)
@@ -122,7 +226,21 @@ var Sp80090BAssessmentService_ServiceDesc = grpc.ServiceDesc{
 			MethodName: "AssessEntropy",
 			Handler:    _Sp80090BAssessmentService_AssessEntropy_Handler,
 		},
+		{
+			MethodName: "AssessEntropyBatch",
+			Handler:    _Sp80090BAssessmentService_AssessEntropyBatch_Handler,
+		},
+		{
+			MethodName: "RunPermutationShard",
+			Handler:    _Sp80090BAssessmentService_RunPermutationShard_Handler,
+		},
+	},
+	Streams: []grpc.StreamDesc{
+		{
+			StreamName:    "AssessEntropyStream",
+			Handler:       _Sp80090BAssessmentService_AssessEntropyStream_Handler,
+			ClientStreams: true,
+		},
 	},
-	Streams:  []grpc.StreamDesc{},
 	Metadata: "nist_sp800_90b.proto",
 }